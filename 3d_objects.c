@@ -604,6 +604,9 @@ int add_e3d_at_id(int id, const char* file_name,
 				get_3dobject_id(id, i), bbox, blended, ground,
 				is_transparent, self_lit, texture_id, dynamic);
 	}
+#ifdef	SHADOW_MAP_CACHE
+	invalidate_shadow_cache();
+#endif	/* SHADOW_MAP_CACHE */
 
 	add_ec_effect_to_e3d(our_object);
 	ec_add_object_obstruction(our_object, returned_e3d, 2.0);
@@ -867,6 +870,9 @@ void destroy_3d_object(int i)
 	ec_remove_obstruction_by_object3d(objects_list[i]);
 
 	delete_3dobject_from_abt(main_bbox_tree, i, objects_list[i]->blended, objects_list[i]->self_lit);
+#ifdef	SHADOW_MAP_CACHE
+	invalidate_shadow_cache();
+#endif	/* SHADOW_MAP_CACHE */
 	free(objects_list[i]);
 	objects_list[i] = NULL;
 	if (i == next_obj_3d-1)
@@ -894,6 +900,9 @@ void destroy_all_3d_objects(void)
 
 	// reset the top pointer
 	next_obj_3d = 0;
+#ifdef	SHADOW_MAP_CACHE
+	invalidate_shadow_cache();
+#endif	/* SHADOW_MAP_CACHE */
 }
 
 Uint32 free_e3d_va(e3d_object *e3d_id)
@@ -949,6 +958,10 @@ void set_3d_object (Uint8 display, const void *ptr, int len)
 {
 	const Uint32 *id_ptr = ptr;
 
+#ifdef	SHADOW_MAP_CACHE
+	invalidate_shadow_cache();
+#endif	/* SHADOW_MAP_CACHE */
+
 	// first look for the override to process ALL objects
 	if (len < sizeof(*id_ptr))
 	{
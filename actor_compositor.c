@@ -0,0 +1,288 @@
+/****************************************************************************
+ *            actor_compositor.c
+ *
+ * Builds the enhanced actor textures with a frame buffer object.
+ ****************************************************************************/
+
+#ifdef	FBO_ACTOR_TEXTURES
+
+#include <stdlib.h>
+#include "actor_compositor.h"
+#include "errors.h"
+#include "gl_init.h"
+#include "load_gl_extensions.h"
+
+/* The texture coordinates come from the fixed function vertex processing,
+ * the result is rounded to eight bits when it is written. */
+static const char* actor_compositor_source =
+	"uniform sampler2D part;\n"
+	"uniform sampler2D base;\n"
+	"uniform sampler2D mask;\n"
+	"uniform float masked;\n"
+	"\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 color;\n"
+	"\n"
+	"	color = texture2D(part, gl_TexCoord[0].st);\n"
+	"\n"
+	"	if (masked > 0.5)\n"
+	"	{\n"
+	"		color = mix(texture2D(base, gl_TexCoord[0].st), color,\n"
+	"			texture2D(mask, gl_TexCoord[0].st).a);\n"
+	"	}\n"
+	"\n"
+	"	gl_FragColor = color;\n"
+	"}\n";
+
+static GLhandleARB actor_compositor_program = 0;
+static GLuint actor_compositor_fbo = 0;
+static GLint actor_compositor_masked = -1;
+
+static GLhandleARB build_actor_compositor_program()
+{
+	GLhandleARB program, shader;
+	GLcharARB log[1024];
+	GLint status;
+
+	shader = ELglCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB);
+	ELglShaderSourceARB(shader, 1, &actor_compositor_source, NULL);
+	ELglCompileShaderARB(shader);
+	ELglGetObjectParameterivARB(shader, GL_OBJECT_COMPILE_STATUS_ARB,
+		&status);
+
+	if (status != 1)
+	{
+		ELglGetInfoLogARB(shader, sizeof(log), NULL, log);
+		LOG_ERROR("Compiling actor texture shader failed: %s", log);
+		ELglDeleteObjectARB(shader);
+
+		return 0;
+	}
+
+	program = ELglCreateProgramObjectARB();
+	ELglAttachObjectARB(program, shader);
+	ELglDeleteObjectARB(shader);
+	ELglLinkProgramARB(program);
+	ELglGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB,
+		&status);
+
+	if (status != 1)
+	{
+		ELglGetInfoLogARB(program, sizeof(log), NULL, log);
+		LOG_ERROR("Linking actor texture shader failed: %s", log);
+		ELglDeleteObjectARB(program);
+
+		return 0;
+	}
+
+	return program;
+}
+
+Uint32 init_actor_compositor()
+{
+	GLhandleARB program;
+
+	if (actor_compositor_program != 0)
+	{
+		return 1;
+	}
+
+	actor_compositor_program = build_actor_compositor_program();
+
+	CHECK_GL_ERRORS();
+
+	if (actor_compositor_program == 0)
+	{
+		return 0;
+	}
+
+	program = ELglGetHandleARB(GL_PROGRAM_OBJECT_ARB);
+
+	ELglUseProgramObjectARB(actor_compositor_program);
+	ELglUniform1iARB(ELglGetUniformLocationARB(actor_compositor_program,
+		"part"), 0);
+	ELglUniform1iARB(ELglGetUniformLocationARB(actor_compositor_program,
+		"base"), 1);
+	ELglUniform1iARB(ELglGetUniformLocationARB(actor_compositor_program,
+		"mask"), 2);
+	actor_compositor_masked = ELglGetUniformLocationARB(
+		actor_compositor_program, "masked");
+	ELglUseProgramObjectARB(program);
+
+	ELglGenFramebuffersEXT(1, &actor_compositor_fbo);
+
+	CHECK_GL_ERRORS();
+
+	return 1;
+}
+
+void free_actor_compositor()
+{
+	if (actor_compositor_program != 0)
+	{
+		ELglDeleteObjectARB(actor_compositor_program);
+		actor_compositor_program = 0;
+	}
+
+	if (actor_compositor_fbo != 0)
+	{
+		ELglDeleteFramebuffersEXT(1, &actor_compositor_fbo);
+		actor_compositor_fbo = 0;
+	}
+}
+
+static void bind_actor_texture_layer(const GLenum unit, const GLuint texture)
+{
+	ELglActiveTextureARB(unit);
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+GLuint build_actor_texture(const actor_texture_layer_t* layers,
+	const Uint32 count, const Uint32 scale, const GLenum min_filter,
+	const Uint32 af)
+{
+	GLhandleARB program;
+	GLuint texture;
+	GLint fbo;
+	GLenum status;
+	Uint32 i, size;
+
+	if (init_actor_compositor() == 0)
+	{
+		return 0;
+	}
+
+	size = ACTOR_TEXTURE_LAYOUT_SIZE * scale;
+
+	// the textures are built while the actors are drawn, maybe into the
+	// frame buffer of a reflection or shadow pass and with the vertex
+	// program of the animations, none of them are kept by glPushAttrib()
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &fbo);
+	program = ELglGetHandleARB(GL_PROGRAM_OBJECT_ARB);
+
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+
+	glDisable(GL_VERTEX_PROGRAM_ARB);
+
+	glGenTextures(1, &texture);
+	bind_actor_texture_layer(GL_TEXTURE0, texture);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+
+	if (af != 0)
+	{
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+			anisotropic_filter);
+	}
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA,
+		GL_UNSIGNED_BYTE, NULL);
+
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, actor_compositor_fbo);
+	ELglFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+		GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, texture, 0);
+
+	status = ELglCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE_EXT)
+	{
+		LOG_ERROR("Frame buffer for actor texture is not complete: "
+			"0x%x", status);
+
+		ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+		glPopAttrib();
+		glDeleteTextures(1, &texture);
+
+		return 0;
+	}
+
+	glDisable(GL_BLEND);
+	glDisable(GL_ALPHA_TEST);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_FOG);
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_STENCIL_TEST);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	glViewport(0, 0, size, size);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, ACTOR_TEXTURE_LAYOUT_SIZE, 0, ACTOR_TEXTURE_LAYOUT_SIZE,
+		-1, 1);
+	glMatrixMode(GL_TEXTURE);
+	glPushMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	// the parts are drawn over white like on the CPU
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	ELglUseProgramObjectARB(actor_compositor_program);
+
+	// the rows of the images start at the bottom of the textures, so the
+	// layout is drawn the same way
+	for (i = 0; i < count; i++)
+	{
+		if ((layers[i].base != 0) && (layers[i].mask != 0))
+		{
+			bind_actor_texture_layer(GL_TEXTURE2, layers[i].mask);
+			bind_actor_texture_layer(GL_TEXTURE1, layers[i].base);
+			ELglUniform1fARB(actor_compositor_masked, 1.0f);
+		}
+		else
+		{
+			ELglUniform1fARB(actor_compositor_masked, 0.0f);
+		}
+
+		bind_actor_texture_layer(GL_TEXTURE0, layers[i].part);
+
+		glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 0.0f);
+		glVertex2i(layers[i].x, layers[i].y);
+		glTexCoord2f(1.0f, 0.0f);
+		glVertex2i(layers[i].x + layers[i].width, layers[i].y);
+		glTexCoord2f(1.0f, 1.0f);
+		glVertex2i(layers[i].x + layers[i].width,
+			layers[i].y + layers[i].height);
+		glTexCoord2f(0.0f, 1.0f);
+		glVertex2i(layers[i].x, layers[i].y + layers[i].height);
+		glEnd();
+	}
+
+	ELglUseProgramObjectARB(program);
+
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glMatrixMode(GL_TEXTURE);
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+
+	ELglFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+		GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, 0, 0);
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+
+	bind_actor_texture_layer(GL_TEXTURE2, 0);
+	bind_actor_texture_layer(GL_TEXTURE1, 0);
+	bind_actor_texture_layer(GL_TEXTURE0, texture);
+	ELglGenerateMipmapEXT(GL_TEXTURE_2D);
+
+	glPopAttrib();
+
+	CHECK_GL_ERRORS();
+
+	return texture;
+}
+
+#endif	/* FBO_ACTOR_TEXTURES */
@@ -0,0 +1,82 @@
+/*!
+ * \file
+ * \ingroup textures
+ * \brief Builds the enhanced actor textures on the GPU.
+ *
+ * The parts of an enhanced actor texture are kept as textures and drawn
+ * into the texture of the actor with a frame buffer object. A part with a
+ * mask is blended over its base by a small shader, the same way
+ * fast_blend() blends them on the CPU, so the textures don't have to be
+ * built in memory and uploaded again when the actor changes.
+ */
+#ifndef	UUID_8d41f6b0_5c2e_4b9a_a37e_0f6c2d9e41b7
+#define	UUID_8d41f6b0_5c2e_4b9a_a37e_0f6c2d9e41b7
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef	FBO_ACTOR_TEXTURES
+/*!
+ * The size of the layout of the actor textures, the parts are placed in a
+ * texture of this size times the scale.
+ */
+#define ACTOR_TEXTURE_LAYOUT_SIZE 128
+
+/*!
+ * A part of an enhanced actor texture.
+ */
+typedef struct
+{
+	GLuint part;	/*!< the texture of the part */
+	GLuint base;	/*!< the texture the part is blended over, or zero */
+	GLuint mask;	/*!< the texture with the blend factors in alpha, or zero */
+	Uint32 x;	/*!< the position of the part in the layout */
+	Uint32 y;
+	Uint32 width;	/*!< the size of the part in the layout */
+	Uint32 height;
+} actor_texture_layer_t;
+
+/*!
+ * \ingroup textures
+ * \brief Builds the shader and the frame buffer object.
+ *
+ * The frame buffer object and shader object extensions must be supported.
+ * \retval Uint32 Returns one if the textures can be built, zero else.
+ */
+Uint32 init_actor_compositor(void);
+
+/*!
+ * \ingroup textures
+ * \brief Frees the shader and the frame buffer object.
+ */
+void free_actor_compositor(void);
+
+/*!
+ * \ingroup textures
+ * \brief Builds an actor texture.
+ *
+ * Creates a RGBA8 texture of scale times the layout size, clears it to
+ * white and draws the layers into it in order. A layer with base and mask
+ * is drawn as mix(base, part, mask.a), else the part is copied. Then the
+ * mipmaps are generated. The OpenGL state is restored, including the
+ * bound frame buffer and program object.
+ * \param layers The layers to draw.
+ * \param count The number of layers.
+ * \param scale The scale of the texture, a power of two.
+ * \param min_filter The minification filter of the texture.
+ * \param af Use anisotropic filtering for the texture if not zero.
+ * \retval GLuint The new texture, zero if the frame buffer is not complete.
+ */
+GLuint build_actor_texture(const actor_texture_layer_t* layers,
+	const Uint32 count, const Uint32 scale, const GLenum min_filter,
+	const Uint32 af);
+#endif	/* FBO_ACTOR_TEXTURES */
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif	/* UUID_8d41f6b0_5c2e_4b9a_a37e_0f6c2d9e41b7 */
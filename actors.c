@@ -32,6 +32,14 @@
 #ifdef	FSAA
 #include "fsaa/fsaa.h"
 #endif	/* FSAA */
+#ifdef	OCCLUSION_CULLING
+#include "occlusion_culling.h"
+#endif	/* OCCLUSION_CULLING */
+#ifdef	ACTOR_SOCIAL_FLAGS
+#include "buddy.h"
+#include "ignore.h"
+#include "named_colours.h"
+#endif	/* ACTOR_SOCIAL_FLAGS */
 
 #ifdef ELC
 #define DRAW_ORTHO_INGAME_NORMAL(x, y, z, our_string, max_lines)	draw_ortho_ingame_string(x, y, z, (const Uint8*)our_string, max_lines, INGAME_FONT_X_LEN*10.0, INGAME_FONT_Y_LEN*10.0)
@@ -1146,7 +1154,12 @@ void get_actors_in_range()
 			VAddEq(bbox.bbmin, pos);
 			VAddEq(bbox.bbmax, pos);
 
-			if (aabb_in_frustum(bbox))
+			if (aabb_in_frustum(bbox)
+#ifdef	OCCLUSION_CULLING
+				&& ((get_cur_intersect_type(main_bbox_tree) != INTERSECTION_TYPE_DEFAULT) ||
+				aabb_not_occluded(bbox))
+#endif	/* OCCLUSION_CULLING */
+				)
 			{
 				near_actors[no_near_actors].actor = i;
 				near_actors[no_near_actors].ghost = actors_list[i]->ghost;
@@ -1621,6 +1634,9 @@ void add_actor_from_server (const char *in_data, int len)
 			LOG_ERROR("%s (%d): %s/%d\n", bad_actor_name_length, actors_list[i]->actor_type,&in_data[17], (int)strlen(&in_data[17]));
 		}
 	else my_strncp(actors_list[i]->actor_name,&in_data[17],30);
+#ifdef	ACTOR_SOCIAL_FLAGS
+	update_actor_social_flags(actors_list[i]);
+#endif	/* ACTOR_SOCIAL_FLAGS */
 
 	if (attachment_type >= 0)
 		add_actor_attachment(actor_id, attachment_type);
@@ -1679,6 +1695,86 @@ void	add_displayed_text_to_actor( actor * actor_ptr, const char* text )
 	actor_ptr->current_displayed_text_time_left += MINI_BUBBLE_MS;
 }
 
+#ifdef	ACTOR_SOCIAL_FLAGS
+Uint32 actor_social_generation = 1;
+
+static elgl_colour_handle minimap_npc_colour = ELGL_COLOUR_HANDLE("minimap.npc");
+static elgl_colour_handle minimap_yourself_colour = ELGL_COLOUR_HANDLE("minimap.yourself");
+static elgl_colour_handle minimap_pkable_colour = ELGL_COLOUR_HANDLE("minimap.pkable");
+static elgl_colour_handle minimap_buddy_colour = ELGL_COLOUR_HANDLE("minimap.buddy");
+static elgl_colour_handle minimap_creature_colour = ELGL_COLOUR_HANDLE("minimap.creature");
+static elgl_colour_handle minimap_deadcreature_colour = ELGL_COLOUR_HANDLE("minimap.deadcreature");
+static elgl_colour_handle minimap_otherplayer_colour = ELGL_COLOUR_HANDLE("minimap.otherplayer");
+
+void invalidate_actor_social_flags(void)
+{
+	actor_social_generation++;
+}
+
+void update_actor_social_flags(actor *a)
+{
+	actor *me;
+	const char *name;
+	char onlyname[32];
+	Uint32 flags;
+	int i;
+
+	flags = 0;
+
+	if (a->is_enhanced_model)
+	{
+		if (is_in_buddylist(a->actor_name))
+			flags |= ACTOR_SOCIAL_BUDDY;
+		if (a->kind_of_actor == PKABLE_HUMAN || a->kind_of_actor == PKABLE_COMPUTER_CONTROLLED)
+			flags |= ACTOR_SOCIAL_PK;
+
+		me = get_our_actor();
+		if (me != NULL && me != a && me->is_enhanced_model && a->body_parts->guild_id != 0 &&
+			a->body_parts->guild_id == me->body_parts->guild_id)
+			flags |= ACTOR_SOCIAL_GUILD;
+	}
+
+	// the ignore list holds the names without colours and guild tags
+	for (name = a->actor_name; *name && is_color((unsigned char)*name); name++);
+	for (i = 0; i < (int)sizeof(onlyname) - 1 && name[i] > 32; i++)
+		onlyname[i] = name[i];
+	onlyname[i] = '\0';
+	if (onlyname[0] && check_if_ignored(onlyname))
+		flags |= ACTOR_SOCIAL_IGNORED;
+
+	// the same order as the minimap used to check them every frame
+	if (a->kind_of_actor == NPC)
+		a->minimap_colour = elglGetColourHandleId(&minimap_npc_colour);
+	else if (a->actor_id == yourself)
+		a->minimap_colour = elglGetColourHandleId(&minimap_yourself_colour);
+	else if (flags & ACTOR_SOCIAL_PK)
+		a->minimap_colour = elglGetColourHandleId(&minimap_pkable_colour);
+	else if (flags & ACTOR_SOCIAL_BUDDY)
+		a->minimap_colour = elglGetColourHandleId(&minimap_buddy_colour);
+	else if (is_color((unsigned char)a->actor_name[0]))
+		a->minimap_colour = ELGL_INVALID_COLOUR;
+	else if (!a->is_enhanced_model)
+		a->minimap_colour = elglGetColourHandleId(&minimap_creature_colour);
+	else
+		a->minimap_colour = elglGetColourHandleId(&minimap_otherplayer_colour);
+
+	a->social_flags = flags;
+	a->social_generation = actor_social_generation;
+}
+
+size_t get_actor_minimap_colour(actor *a)
+{
+	get_actor_social_flags(a);
+
+	// dead creatures change their colour without changing their flags
+	if (a->dead && !a->is_enhanced_model &&
+		a->minimap_colour == elglGetColourHandleId(&minimap_creature_colour))
+		return elglGetColourHandleId(&minimap_deadcreature_colour);
+
+	return a->minimap_colour;
+}
+#endif	/* ACTOR_SOCIAL_FLAGS */
+
 //--- LoganDugenoux [5/25/2004]
 actor *	get_actor_ptr_from_id( int actor_id )
 {
@@ -622,6 +622,11 @@ typedef struct
 	char ghost;		/*!< Sets the actor type to ghost (Disable lightning, enable blending (GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA))*/
 	char has_alpha;		/*!< is alpha blending needed for this actor? */
 	int kind_of_actor;	/*!< Defines the kind_of_actor (NPC, HUMAN, COMPUTER_CONTROLLED_HUMAN, PKABLE, PKABLE_COMPUTER_CONTROLLED)*/
+#ifdef	ACTOR_SOCIAL_FLAGS
+	Uint32 social_flags;	/*!< The ACTOR_SOCIAL_* bits of the actor, use get_actor_social_flags()*/
+	Uint32 social_generation;	/*!< The actor_social_generation the social_flags and minimap_colour are computed for*/
+	size_t minimap_colour;	/*!< The named colour of the actor on the minimap, ELGL_INVALID_COLOUR for the colour of the name*/
+#endif	/* ACTOR_SOCIAL_FLAGS */
 	Uint32 buffs;		/*!<Contains the buffs on this actor as bits (currently only invisibility)*/
 	/*! \} */
 
@@ -669,6 +674,62 @@ extern actor_types actors_defs[MAX_ACTOR_DEFS];	/*!< The actor definitions*/
 
 extern attached_actors_types attached_actors_defs[MAX_ACTOR_DEFS]; /*!< The definitions for the attached actors */
 
+#ifdef	ACTOR_SOCIAL_FLAGS
+#define ACTOR_SOCIAL_BUDDY	0x01	/*!< The actor is in the buddy list*/
+#define ACTOR_SOCIAL_IGNORED	0x02	/*!< The actor is in the ignore list*/
+#define ACTOR_SOCIAL_GUILD	0x04	/*!< The actor is in your guild*/
+#define ACTOR_SOCIAL_PK		0x08	/*!< The actor can be attacked*/
+
+extern Uint32 actor_social_generation;	/*!< Changed when the flags of all actors must be computed again*/
+
+/*!
+ * \ingroup	display_actors
+ * \brief	Marks the social flags of all actors as outdated
+ *
+ *	Called when the buddy list, the ignore list, the named colours or your
+ *	own actor change. The flags are computed again when they are used.
+ */
+void invalidate_actor_social_flags(void);
+
+/*!
+ * \ingroup	display_actors
+ * \brief	Computes the social flags and the minimap colour of an actor
+ *
+ * \param a The actor.
+ */
+void update_actor_social_flags(actor *a);
+
+/*!
+ * \ingroup	display_actors
+ * \brief	Gets the social flags of an actor
+ *
+ *	The flags are only computed again if they are outdated, so the
+ *	buddy and ignore lists are not searched every frame.
+ *
+ * \param a The actor.
+ * \return The ACTOR_SOCIAL_* bits of the actor.
+ */
+static __inline__ Uint32 get_actor_social_flags(actor *a)
+{
+	if (a->social_generation != actor_social_generation)
+	{
+		update_actor_social_flags(a);
+	}
+
+	return a->social_flags;
+}
+
+/*!
+ * \ingroup	display_actors
+ * \brief	Gets the colour of an actor on the minimap
+ *
+ * \param a The actor.
+ * \return The id of the named colour, ELGL_INVALID_COLOUR if the colour of
+ *	the name is used.
+ */
+size_t get_actor_minimap_colour(actor *a);
+#endif	/* ACTOR_SOCIAL_FLAGS */
+
 
 static __inline__ int is_actor_barehanded(actor *act, int hand){
 	if(hand==EMOTE_BARE_L)
@@ -812,6 +873,10 @@ static __inline__ actor *get_our_actor ()
 static __inline__ void set_our_actor (actor *act)
 {
 	your_actor = act;
+#ifdef	ACTOR_SOCIAL_FLAGS
+	// the guild flags depend on your actor
+	invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 }
 
 /*!
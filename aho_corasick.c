@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+#include "aho_corasick.h"
+
+static Uint8 lower_case(const Uint8 ch)
+{
+	if ((ch >= 'A') && (ch <= 'Z'))
+	{
+		return ch + 32;
+	}
+
+	return ch;
+}
+
+void aho_corasick_free(aho_corasick_t* automaton)
+{
+	free(automaton->transitions);
+	free(automaton->depths);
+	free(automaton->match_offsets);
+	free(automaton->matches);
+	free(automaton->pattern_lengths);
+
+	memset(automaton, 0, sizeof(aho_corasick_t));
+}
+
+void aho_corasick_build(aho_corasick_t* automaton, const char** patterns,
+	const Uint32* lengths, const Uint32 count)
+{
+	Uint32 *failures, *queue, *own_matches, *next_match;
+	Uint32 i, j, state, next, max_states, class_count, head, tail, size;
+	Uint8 ch;
+
+	aho_corasick_free(automaton);
+
+	/* Class zero is for the characters that are in no pattern */
+	class_count = 1;
+	max_states = 1;
+
+	for (i = 0; i < count; i++)
+	{
+		for (j = 0; j < lengths[i]; j++)
+		{
+			ch = lower_case(patterns[i][j]);
+
+			if (automaton->classes[ch] == 0)
+			{
+				automaton->classes[ch] = class_count;
+
+				if ((ch >= 'a') && (ch <= 'z'))
+				{
+					automaton->classes[ch - 32] = class_count;
+				}
+
+				class_count++;
+			}
+		}
+
+		max_states += lengths[i];
+	}
+
+	automaton->class_count = class_count;
+	automaton->pattern_count = count;
+	automaton->transitions = malloc(max_states * class_count *
+		sizeof(Uint32));
+	automaton->depths = calloc(max_states, sizeof(Uint32));
+	automaton->pattern_lengths = malloc((count + 1) * sizeof(Uint32));
+	memset(automaton->transitions, 0xFF, max_states * class_count *
+		sizeof(Uint32));
+
+	failures = calloc(max_states, sizeof(Uint32));
+	queue = malloc(max_states * sizeof(Uint32));
+	own_matches = malloc(max_states * sizeof(Uint32));
+	next_match = malloc((count + 1) * sizeof(Uint32));
+	memset(own_matches, 0xFF, max_states * sizeof(Uint32));
+
+	/* The trie of the patterns */
+	automaton->state_count = 1;
+
+	for (i = 0; i < count; i++)
+	{
+		automaton->pattern_lengths[i] = lengths[i];
+		next_match[i] = AHO_CORASICK_NONE;
+
+		if (lengths[i] == 0)
+		{
+			continue;
+		}
+
+		state = 0;
+
+		for (j = 0; j < lengths[i]; j++)
+		{
+			next = state * class_count +
+				automaton->classes[(Uint8)patterns[i][j]];
+
+			if (automaton->transitions[next] == AHO_CORASICK_NONE)
+			{
+				automaton->transitions[next] =
+					automaton->state_count;
+				automaton->depths[automaton->state_count] = j + 1;
+				automaton->state_count++;
+			}
+
+			state = automaton->transitions[next];
+		}
+
+		next_match[i] = own_matches[state];
+		own_matches[state] = i;
+	}
+
+	/*
+	 * Breadth first, so the failure state of a state is done before it.
+	 * The missing transitions are taken from the failure state.
+	 */
+	head = 0;
+	tail = 0;
+
+	for (i = 0; i < class_count; i++)
+	{
+		next = automaton->transitions[i];
+
+		if (next == AHO_CORASICK_NONE)
+		{
+			automaton->transitions[i] = 0;
+		}
+		else
+		{
+			failures[next] = 0;
+			queue[tail++] = next;
+		}
+	}
+
+	while (head < tail)
+	{
+		state = queue[head++];
+
+		for (i = 0; i < class_count; i++)
+		{
+			next = automaton->transitions[state * class_count + i];
+
+			if (next == AHO_CORASICK_NONE)
+			{
+				automaton->transitions[state * class_count + i] =
+					automaton->transitions[failures[state] *
+					class_count + i];
+			}
+			else
+			{
+				failures[next] = automaton->transitions[
+					failures[state] * class_count + i];
+				queue[tail++] = next;
+			}
+		}
+	}
+
+	/*
+	 * The matches of a state are its own patterns and the matches of its
+	 * failure state.
+	 */
+	automaton->match_offsets = calloc(automaton->state_count + 1,
+		sizeof(Uint32));
+
+	for (i = 0; i < tail; i++)
+	{
+		state = queue[i];
+		size = automaton->match_offsets[failures[state] + 1];
+
+		for (j = own_matches[state]; j != AHO_CORASICK_NONE;
+			j = next_match[j])
+		{
+			size++;
+		}
+
+		automaton->match_offsets[state + 1] = size;
+	}
+
+	for (i = 0; i < automaton->state_count; i++)
+	{
+		automaton->match_offsets[i + 1] += automaton->match_offsets[i];
+	}
+
+	automaton->matches = malloc((automaton->match_offsets[
+		automaton->state_count] + 1) * sizeof(Uint32));
+
+	for (i = 0; i < tail; i++)
+	{
+		state = queue[i];
+		size = automaton->match_offsets[state];
+
+		for (j = own_matches[state]; j != AHO_CORASICK_NONE;
+			j = next_match[j])
+		{
+			automaton->matches[size++] = j;
+		}
+
+		for (j = automaton->match_offsets[failures[state]];
+			j < automaton->match_offsets[failures[state] + 1]; j++)
+		{
+			automaton->matches[size++] = automaton->matches[j];
+		}
+	}
+
+	free(failures);
+	free(queue);
+	free(own_matches);
+	free(next_match);
+}
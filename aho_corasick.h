@@ -0,0 +1,85 @@
+/*!
+ * \file
+ * \ingroup misc_utils
+ * \brief Aho-Corasick automaton to find many strings in a text at once.
+ *
+ * The automaton is built from a list of patterns and then finds all of
+ * them in one pass over the text, no matter how many patterns there are.
+ * Upper and lower case ASCII letters are the same, like in my_strncompare().
+ */
+#ifndef UUID_7e2c94b1_5d0a_4f68_b3a9_c61e8d20f457
+#define UUID_7e2c94b1_5d0a_4f68_b3a9_c61e8d20f457
+
+#include "platform.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define AHO_CORASICK_NONE	0xFFFFFFFF
+
+/*!
+ * The automaton. Every state has a transition for each character, so a
+ * step is one table lookup. Characters that are in no pattern share one
+ * column of the table.
+ */
+typedef struct
+{
+	Uint32* transitions;	/*!< the next state, state * class_count + class */
+	Uint32* depths;		/*!< the length of the prefix of each state */
+	Uint32* match_offsets;	/*!< the first entry of each state in matches, state_count + 1 entries */
+	Uint32* matches;	/*!< the patterns that end in each state */
+	Uint32* pattern_lengths;	/*!< the length of each pattern */
+	Uint32 state_count;	/*!< the number of states */
+	Uint32 pattern_count;	/*!< the number of patterns */
+	Uint32 class_count;	/*!< the number of character classes */
+	Uint8 classes[256];	/*!< the class of each character */
+} aho_corasick_t;
+
+/*!
+ * \ingroup misc_utils
+ * \brief Builds the automaton.
+ *
+ * Empty patterns are never found.
+ * \param automaton The automaton to build, its old content is freed. Must
+ * be zeroed before it is built the first time.
+ * \param patterns The patterns.
+ * \param lengths The length of each pattern.
+ * \param count The number of patterns.
+ */
+void aho_corasick_build(aho_corasick_t* automaton, const char** patterns,
+	const Uint32* lengths, const Uint32 count);
+
+/*!
+ * \ingroup misc_utils
+ * \brief Frees the automaton.
+ * \param automaton The automaton to free.
+ */
+void aho_corasick_free(aho_corasick_t* automaton);
+
+/*!
+ * \ingroup misc_utils
+ * \brief Gets the state after the next character.
+ *
+ * The scan starts in state zero. The patterns that end with the character
+ * are the entries from match_offsets[state] to match_offsets[state + 1] of
+ * matches, the depth of the state is the length of the longest pattern
+ * prefix that ends with the character.
+ * \param automaton The automaton.
+ * \param state The current state.
+ * \param ch The next character.
+ * \retval Uint32 The next state.
+ */
+static __inline__ Uint32 aho_corasick_next(const aho_corasick_t* automaton,
+	const Uint32 state, const Uint8 ch)
+{
+	return automaton->transitions[state * automaton->class_count +
+		automaton->classes[ch]];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UUID_7e2c94b1_5d0a_4f68_b3a9_c61e8d20f457 */
@@ -499,6 +499,30 @@ void check_bbox_tree(BBOX_TREE* bbox_tree)
 	else BBOX_TREE_LOG_INFO("bbox_tree");
 }
 
+#ifdef	OCCLUSION_CULLING
+void filter_intersect_items(BBOX_TREE* bbox_tree, int (*visible)(const BBOX_ITEM* item))
+{
+	Uint32 idx, i, count;
+
+	if (bbox_tree != NULL)
+	{
+		idx = bbox_tree->cur_intersect_type;
+		count = 0;
+		for (i = 0; i < bbox_tree->intersect[idx].count; i++)
+		{
+			if (visible(&bbox_tree->intersect[idx].items[i]))
+			{
+				if (i != count) bbox_tree->intersect[idx].items[count] = bbox_tree->intersect[idx].items[i];
+				count++;
+			}
+		}
+		bbox_tree->intersect[idx].count = count;
+		build_start_stop(bbox_tree);
+	}
+	else BBOX_TREE_LOG_INFO("bbox_tree");
+}
+#endif	/* OCCLUSION_CULLING */
+
 void calc_scene_bbox(BBOX_TREE* bbox_tree, AABBOX* bbox)
 {
 	Uint32 idx;
@@ -583,6 +583,22 @@ static __inline__ Uint32 get_type_mask_from_type(Uint32 type)
  */
 void check_bbox_tree(BBOX_TREE* bbox_tree);
 
+#ifdef	OCCLUSION_CULLING
+/**
+ * @ingroup misc
+ * @brief Removes items from the current intersection list.
+ *
+ * Removes all items of the current intersection list for which the
+ * function returns zero. The order of the remaining items is kept.
+ *
+ * @param bbox_tree	The bounding-box-tree holding the objects.
+ * @param visible	The function called for each item.
+ *
+ * @callgraph
+ */
+void filter_intersect_items(BBOX_TREE* bbox_tree, int (*visible)(const BBOX_ITEM* item));
+#endif	/* OCCLUSION_CULLING */
+
 /**
  * @ingroup misc
  * @brief Frees the given bounding-box-tree.
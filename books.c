@@ -17,6 +17,9 @@
 #include "gl_init.h"
 #endif
 #include "io/elfilewrapper.h"
+#ifdef	LAZY_BOOKS
+#include "io/elpathwrapper.h"
+#endif	/* LAZY_BOOKS */
 
 #ifdef BSD
  #include <stdlib.h>
@@ -48,6 +51,11 @@
 
 #define KNOWLEDGE_BOOK_OFFSET 10000
 
+#ifdef	LAZY_BOOKS
+#define	BOOK_CACHE_VERSION	1
+#define	BOOK_CACHE_BYTE_ORDER	0x01020304
+#endif	/* LAZY_BOOKS */
+
 int book_opened=-1;//The ID of the book opened
 
 static int paper1_text = -1; // Index in the texture cache of the paper texture
@@ -91,6 +99,11 @@ typedef struct _book {
 
 	int active_page;
 
+#ifdef	LAZY_BOOKS
+	char file[200];	// the file of a local book, it is read when the book is opened
+	int loaded;
+#endif	/* LAZY_BOOKS */
+
 	struct _book * next;
 } book;
 
@@ -98,6 +111,10 @@ book * books=NULL;
 
 void add_book(book *bs);
 void display_book_window(book *b);
+#ifdef	LAZY_BOOKS
+static int load_book(book *b);
+static void remove_book(book *b);
+#endif	/* LAZY_BOOKS */
 
 /*Memory handling etc.*/
 
@@ -118,7 +135,7 @@ page * add_page(book * b)
 	return p;
 }
 
-book *create_book (const char* title, int type, int id)
+static book *new_book (const char* title, int type, int id)
 {
 	book *b=(book*)calloc(1,sizeof(book));
 	
@@ -138,9 +155,19 @@ book *create_book (const char* title, int type, int id)
 	b->type=type;
 	b->id=id;
 	safe_snprintf(b->title, sizeof(b->title), "%s", title);
-	
+#ifdef	LAZY_BOOKS
+	b->loaded=1;
+#endif	/* LAZY_BOOKS */
+
+	return b;
+}
+
+book *create_book (const char* title, int type, int id)
+{
+	book *b=new_book(title, type, id);
+
 	add_book(b);
-	
+
 	return b;
 }
 
@@ -156,6 +183,9 @@ _image *create_image (const char* file, int x, int y, int w, int h, float u_star
 	img->u[1]=u_end;
 	img->v[0]=v_start;
 	img->v[1]=v_end;
+#ifdef	LAZY_BOOKS
+	safe_strncpy(img->file, file, sizeof(img->file));
+#endif	/* LAZY_BOOKS */
 
 #ifdef	NEW_TEXTURES
 	img->texture = load_texture_cached(file, tt_image);
@@ -180,7 +210,7 @@ void free_page(page * p)
 	free(p);
 }
 
-void free_book(book * b)
+static void free_book_pages(book * b)
 {
 	int i;
 	page **p;
@@ -188,6 +218,13 @@ void free_book(book * b)
 	p=b->pages;
 	for(i=0;i<b->no_pages;i++,p++) free_page(*p);
 	free(b->pages);
+	b->pages=NULL;
+	b->no_pages=0;
+}
+
+void free_book(book * b)
+{
+	free_book_pages(b);
 	free(b);
 }
 
@@ -200,6 +237,16 @@ book * get_book(int id)
 	for(b=books;b;b=b->next){
 		if(b->id==id) break;
 	}
+#ifdef	LAZY_BOOKS
+	if(b && !b->loaded){
+		b->loaded=load_book(b);
+		if(!b->loaded){
+			remove_book(b);
+			free_book(b);
+			b=NULL;
+		}
+	}
+#endif	/* LAZY_BOOKS */
 	
 	return b;
 }
@@ -215,6 +262,21 @@ void add_book(book *bs)
 	}
 }
 
+#ifdef	LAZY_BOOKS
+static void remove_book(book *b)
+{
+	book **l;
+
+	for(l=&books;*l;l=&(*l)->next){
+		if(*l==b){
+			*l=b->next;
+			b->next=NULL;
+			break;
+		}
+	}
+}
+#endif	/* LAZY_BOOKS */
+
 /*Book parser*/
 
 page * add_str_to_page(char * str, int type, book *b, page *p)
@@ -440,10 +502,9 @@ void add_xml_page(xmlNode *cur, book * b)
 	}
 }
 
-book * parse_book(xmlNode *in, char * title, int type, int id)
+void parse_book(xmlNode *in, book * b)
 {
 	xmlNode * cur;
-	book * b=create_book(title, type, id);
 	
 	for(cur=in;cur;cur=cur->next){
 		if(cur->type == XML_ELEMENT_NODE){
@@ -452,16 +513,15 @@ book * parse_book(xmlNode *in, char * title, int type, int id)
 			}
 		}
 	}
-
-	return b;
 }
 
-book * read_book(char * file, int type, int id)
+/* Reads the title and the pages of a local book from its xml file */
+static int read_book_pages(const char * file, book *b)
 {
 	xmlDoc * doc;
 	xmlNode * root=NULL;
 	xmlChar *title=NULL;
-	book *b=NULL;
+	int ok=0;
 	char path[1024];
 
 	safe_snprintf(path, sizeof(path), "languages/%s/%s", lang, file);
@@ -482,7 +542,9 @@ book * read_book(char * file, int type, int id)
 	} else if((title=xmlGetProp(root,(xmlChar*)"title"))==NULL){
 		LOG_ERROR("Root element in %s does not contain a title=\"<short title>\" property.", path);
 	} else {
-		b=parse_book(root->children, (char*)title, type, id);
+		safe_snprintf(b->title, sizeof(b->title), "%s", (char*)title);
+		parse_book(root->children, b);
+		ok=1;
 	}
 	
 	if(title) {
@@ -491,9 +553,303 @@ book * read_book(char * file, int type, int id)
 	
 	xmlFreeDoc(doc);
 
+	return ok;
+}
+
+book * read_book(char * file, int type, int id)
+{
+	book *b=new_book("", type, id);
+
+	if(!read_book_pages(file, b)) {
+		free_book(b);
+		return NULL;
+	}
+	add_book(b);
+
 	return b;
 }
 
+#ifdef	LAZY_BOOKS
+/*
+ * The pages of the local books are kept in book_cache/ in the config
+ * directory, tagged with the crc32 and size of the xml file and the size of
+ * the pages, so opening a book again in a later session skips parsing and
+ * wrapping the text. Books are typeset with a fixed number of characters
+ * per line and lines per page, so the font and window size don't change
+ * the layout.
+ */
+typedef struct
+{
+	char magic[4];			/* "elbc" */
+	Uint32 version;
+	Uint32 byte_order;		/* BOOK_CACHE_BYTE_ORDER in the byte order of the writer */
+	Uint32 file_crc;		/* crc32 of the xml file */
+	Uint32 file_size;		/* size of the xml file */
+	Uint32 max_width;
+	Uint32 max_lines;
+	Uint32 no_pages;
+	char title[36];
+} book_cache_header;
+
+/* Each page is stored as the number of lines, a book_cache_image if
+ * has_image is set and the lines, each as its length and the text */
+typedef struct
+{
+	Uint32 no_lines;
+	Uint32 has_image;
+} book_cache_page;
+
+typedef struct
+{
+	char file[200];
+	Sint32 x, y, w, h;
+	Sint32 u[2], v[2];
+} book_cache_image;
+
+static int find_book_file(const char * file, char * path, int size)
+{
+	safe_snprintf(path, size, "languages/%s/%s", lang, file);
+	if(el_file_exists(path))
+		return 1;
+
+	safe_snprintf(path, size, "languages/en/%s", file);
+	return el_file_exists(path);
+}
+
+static void get_book_cache_name(const char * path, char * name, int size)
+{
+	char *c;
+
+	safe_snprintf(name, size, "book_cache/%s.cache", path);
+	for(c=name+strlen("book_cache/");*c;c++){
+		if(*c=='/' || *c=='\\')
+			*c='_';
+	}
+}
+
+static const char * read_cache_data(const char * pos, const char * end, void * data, Uint32 size)
+{
+	if(pos==NULL || (Uint32)(end-pos)<size)
+		return NULL;
+
+	memcpy(data, pos, size);
+
+	return pos+size;
+}
+
+static int read_book_cache(const char * path, Uint32 crc, Uint32 size, book * b)
+{
+	book_cache_header header;
+	book_cache_page cache_page;
+	book_cache_image cache_image;
+	char name[256];
+	FILE *file;
+	char *data=NULL;
+	const char *pos, *end;
+	page *p;
+	long file_size;
+	Uint32 i, j, l;
+
+	get_book_cache_name(path, name, sizeof(name));
+
+	file=open_file_config(name, "rb");
+	if(file==NULL)
+		return 0;
+
+	fseek(file, 0, SEEK_END);
+	file_size=ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	if(file_size>=(long)sizeof(header)) {
+		data=(char*)malloc(file_size);
+		if(fread(data, file_size, 1, file)!=1) {
+			free(data);
+			data=NULL;
+		}
+	}
+	fclose(file);
+
+	if(data==NULL)
+		return 0;
+
+	end=data+file_size;
+	pos=read_cache_data(data, end, &header, sizeof(header));
+
+	if(memcmp(header.magic, "elbc", 4) || header.version!=BOOK_CACHE_VERSION ||
+		header.byte_order!=BOOK_CACHE_BYTE_ORDER || header.file_crc!=crc ||
+		header.file_size!=size || header.max_width!=b->max_width ||
+		header.max_lines!=b->max_lines) {
+		LOG_DEBUG("Book cache '%s' is outdated.", name);
+		free(data);
+		return 0;
+	}
+
+	header.title[sizeof(header.title)-1]=0;
+	safe_snprintf(b->title, sizeof(b->title), "%s", header.title);
+
+	for(i=0;pos && i<header.no_pages;i++) {
+		pos=read_cache_data(pos, end, &cache_page, sizeof(cache_page));
+		if(pos==NULL || cache_page.no_lines>b->max_lines)
+			break;
+
+		p=add_page(b);
+
+		if(cache_page.has_image) {
+			pos=read_cache_data(pos, end, &cache_image, sizeof(cache_image));
+			if(pos==NULL)
+				break;
+			cache_image.file[sizeof(cache_image.file)-1]=0;
+			p->image=create_image(cache_image.file, cache_image.x, cache_image.y,
+				cache_image.w, cache_image.h, cache_image.u[0], cache_image.v[0],
+				cache_image.u[1], cache_image.v[1]);
+		}
+
+		for(j=0;j<cache_page.no_lines;j++) {
+			pos=read_cache_data(pos, end, &l, sizeof(l));
+			if(pos==NULL || (Uint32)(end-pos)<l) {
+				pos=NULL;
+				break;
+			}
+			p->lines[j]=(char*)malloc(l+1);
+			memcpy(p->lines[j], pos, l);
+			p->lines[j][l]=0;
+			pos+=l;
+		}
+	}
+
+	free(data);
+
+	if(pos==NULL || i<header.no_pages) {
+		LOG_ERROR("Book cache '%s' is damaged.", name);
+		free_book_pages(b);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void write_book_cache(const char * path, Uint32 crc, Uint32 size, const book * b)
+{
+	book_cache_header header;
+	book_cache_page cache_page;
+	book_cache_image cache_image;
+	char name[256];
+	FILE *file;
+	page *p;
+	Uint32 l;
+	int i, j;
+
+	get_book_cache_name(path, name, sizeof(name));
+
+	mkdir_config("book_cache");
+
+	file=open_file_config(name, "wb");
+	if(file==NULL) {
+		LOG_ERROR("Can't write book cache '%s'", name);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "elbc", 4);
+	header.version=BOOK_CACHE_VERSION;
+	header.byte_order=BOOK_CACHE_BYTE_ORDER;
+	header.file_crc=crc;
+	header.file_size=size;
+	header.max_width=b->max_width;
+	header.max_lines=b->max_lines;
+	header.no_pages=b->no_pages;
+	safe_strncpy(header.title, b->title, sizeof(header.title));
+	fwrite(&header, sizeof(header), 1, file);
+
+	for(i=0;i<b->no_pages;i++) {
+		p=b->pages[i];
+
+		for(j=0;p->lines[j];j++);
+		cache_page.no_lines=j;
+		cache_page.has_image=p->image!=NULL;
+		fwrite(&cache_page, sizeof(cache_page), 1, file);
+
+		if(p->image) {
+			memset(&cache_image, 0, sizeof(cache_image));
+			safe_strncpy(cache_image.file, p->image->file, sizeof(cache_image.file));
+			cache_image.x=p->image->x;
+			cache_image.y=p->image->y;
+			cache_image.w=p->image->w;
+			cache_image.h=p->image->h;
+			cache_image.u[0]=p->image->u[0];
+			cache_image.u[1]=p->image->u[1];
+			cache_image.v[0]=p->image->v[0];
+			cache_image.v[1]=p->image->v[1];
+			fwrite(&cache_image, sizeof(cache_image), 1, file);
+		}
+
+		for(j=0;p->lines[j];j++) {
+			l=strlen(p->lines[j]);
+			fwrite(&l, sizeof(l), 1, file);
+			fwrite(p->lines[j], 1, l, file);
+		}
+	}
+
+	fclose(file);
+
+	LOG_DEBUG("Book cache '%s' written.", name);
+}
+
+/* Reads the pages of a local book that was added with add_local_book,
+ * from the cache if it is up to date */
+static int load_book(book *b)
+{
+	char path[1024];
+	el_file_ptr file;
+	Uint32 crc, size;
+
+	if(!find_book_file(b->file, path, sizeof(path)) || (file=el_open(path))==NULL)
+		return read_book_pages(b->file, b);
+
+	crc=el_crc32(file);
+	size=el_get_size(file);
+	el_close(file);
+
+	if(read_book_cache(path, crc, size, b))
+		return 1;
+
+	if(!read_book_pages(b->file, b))
+		return 0;
+
+	write_book_cache(path, crc, size, b);
+
+	return 1;
+}
+#endif	/* LAZY_BOOKS */
+
+/* Adds a local book. With LAZY_BOOKS its pages are only read when it is
+ * opened for the first time, else they are read now. */
+static int add_local_book(const char * file, int type, int id)
+{
+#ifdef	LAZY_BOOKS
+	book *b;
+	char path[1024];
+
+	if(!find_book_file(file, path, sizeof(path))) {
+		char str[200];
+
+		safe_snprintf(str, sizeof(str), book_open_err_str, path);
+		LOG_ERROR(str);
+		LOG_TO_CONSOLE(c_red1,str);
+		return 0;
+	}
+
+	b=new_book("", type, id);
+	safe_strncpy(b->file, file, sizeof(b->file));
+	b->loaded=0;
+	add_book(b);
+
+	return 1;
+#else	/* LAZY_BOOKS */
+	return read_book((char*)file, type, id)!=NULL;
+#endif	/* LAZY_BOOKS */
+}
+
 void parse_knowledge_item(xmlNode *in)
 {
 	xmlNode * cur;
@@ -509,7 +865,7 @@ void parse_knowledge_item(xmlNode *in)
 				} else {
 					id = atoi(strID);
 					if(cur->children && cur->children->content && MY_XMLSTRCPY(&string, (char*)cur->children->content)!=-1){
-						if (read_book(string, 2, id + KNOWLEDGE_BOOK_OFFSET) != NULL) {
+						if (add_local_book(string, 2, id + KNOWLEDGE_BOOK_OFFSET)) {
 							knowledge_list[id].has_book = 1;
 						}
 					} else {
@@ -561,12 +917,12 @@ void init_books()
 	book1_text = load_texture_cache_deferred ("./textures/book1.bmp", 0);
 #endif	/* NEW_TEXTURES */
 
-	read_book("books/races/human.xml", 2, book_human);
-	read_book("books/races/dwarf.xml", 2, book_dwarf);
-	read_book("books/races/elf.xml", 2, book_elf);
-	read_book("books/races/gnome.xml", 2, book_gnome);
-	read_book("books/races/orchan.xml", 2, book_orchan);
-	read_book("books/races/draegoni.xml", 2, book_draegoni);
+	add_local_book("books/races/human.xml", 2, book_human);
+	add_local_book("books/races/dwarf.xml", 2, book_dwarf);
+	add_local_book("books/races/elf.xml", 2, book_elf);
+	add_local_book("books/races/gnome.xml", 2, book_gnome);
+	add_local_book("books/races/orchan.xml", 2, book_orchan);
+	add_local_book("books/races/draegoni.xml", 2, book_draegoni);
 
 	read_knowledge_book_index();
 }
@@ -1173,6 +1529,66 @@ void free_books()
 		free_book(books);
 }
 
+#ifdef	LAZY_BOOKS
+int command_book_benchmark(char *text, int len)
+{
+	char path[1024], name[256], str[256];
+	book *b;
+	Uint32 start, xml, cold, warm;
+	int count=0, pages=0;
+
+	// read every local book once, so the textures of the images are
+	// loaded for all the timings
+	for(b=books;b;b=b->next){
+		if(b->file[0]){
+			free_book_pages(b);
+			b->loaded=read_book_pages(b->file, b);
+		}
+	}
+
+	start=SDL_GetTicks();
+	for(b=books;b;b=b->next){
+		if(b->file[0] && b->loaded){
+			free_book_pages(b);
+			read_book_pages(b->file, b);
+		}
+	}
+	xml=SDL_GetTicks()-start;
+
+	for(b=books;b;b=b->next){
+		if(b->file[0] && b->loaded && find_book_file(b->file, path, sizeof(path))){
+			get_book_cache_name(path, name, sizeof(name));
+			file_remove_config(name);
+		}
+	}
+
+	start=SDL_GetTicks();
+	for(b=books;b;b=b->next){
+		if(b->file[0] && b->loaded){
+			free_book_pages(b);
+			b->loaded=load_book(b);
+		}
+	}
+	cold=SDL_GetTicks()-start;
+
+	start=SDL_GetTicks();
+	for(b=books;b;b=b->next){
+		if(b->file[0] && b->loaded){
+			free_book_pages(b);
+			b->loaded=load_book(b);
+			pages+=b->no_pages;
+			count++;
+		}
+	}
+	warm=SDL_GetTicks()-start;
+
+	safe_snprintf(str, sizeof(str), "%d books, %d pages: %d ms xml, %d ms xml and cache write, %d ms from the cache", count, pages, xml, cold, warm);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* LAZY_BOOKS */
+
 /* currently UNUSED
 int have_book(int id)
 {
@@ -83,6 +83,20 @@ void open_book(int id);
  */
 void close_book(int book_id);
 
+#ifdef	LAZY_BOOKS
+/*!
+ * \ingroup	books_window
+ * \brief	Times reading the local books
+ *
+ * 		Times reading all local books from their xml files and from the book cache.
+ *
+ * \param	text unused
+ * \param	len unused
+ * \retval int	always 1
+ */
+int command_book_benchmark(char *text, int len);
+#endif	/* LAZY_BOOKS */
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -17,6 +17,9 @@
 #include "multiplayer.h"
 #include "queue.h"
 #include "translate.h"
+#ifdef	ACTOR_SOCIAL_FLAGS
+#include "actors.h"
+#endif	/* ACTOR_SOCIAL_FLAGS */
 #ifdef OPENGL_TRACE
 #include "gl_init.h"
 #endif
@@ -600,6 +603,9 @@ void add_buddy (const char *name, int type, int len)
 				// found then add buddy
 				buddy_list[i].type = type;
 				safe_snprintf (buddy_list[i].name, sizeof(buddy_list[i].name), "%.*s", len, name);
+#ifdef	ACTOR_SOCIAL_FLAGS
+				invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 				// write optional online message
 				if ((buddy_log_notice == 1) && (type != 0xFE))
 				{
@@ -624,6 +630,9 @@ void del_buddy (const char *name, int len)
 		{
 			buddy_list[i].type = 0xff;
 			memset (buddy_list[i].name, 0, sizeof (buddy_list[i].name));
+#ifdef	ACTOR_SOCIAL_FLAGS
+			invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 			break;
 		}
 	}
@@ -636,6 +645,9 @@ void clear_buddy()
 		buddy_list[i].type= 0xff;
 		buddy_list[i].name[0]=0;
 	}
+#ifdef	ACTOR_SOCIAL_FLAGS
+	invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 }
 
 int is_in_buddylist(const char *name)
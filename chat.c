@@ -432,7 +432,12 @@ void update_chat_window (text_message *msg, char highlight)
 	if (chat_win < 0) return;
 
 	// rewrap message to get correct # of lines
+#ifdef	CHAT_LINE_INDEX
+	// the same width as the lines are found with
+	width = chat_win_text_width;
+#else	/* CHAT_LINE_INDEX */
 	width = windows_list.window[chat_win].len_x;
+#endif	/* CHAT_LINE_INDEX */
 	nlines = rewrap_message(msg, chat_zoom, width, NULL);
 	
 	// first check if we need to display in all open channels
@@ -782,7 +787,20 @@ int resize_chat_handler(window_info *win, int width, int height)
 
 void update_chat_win_buffers(void)
 {
-	int itab, imsg;
+	int itab;
+#ifndef	CHAT_LINE_INDEX
+	int imsg;
+#endif	/* CHAT_LINE_INDEX */
+#ifdef	CHAT_LINE_INDEX
+	// count the lines, the messages are rewrapped when they are shown
+	for (itab = 0; itab < MAX_CHAT_TABS; itab++)
+	{
+		if (channels[itab].open)
+			channels[itab].nr_lines = get_display_line_count (channels[itab].chan_nr, chat_zoom, chat_win_text_width);
+		else
+			channels[itab].nr_lines = 0;
+	}
+#else	/* CHAT_LINE_INDEX */
 	// recompute line breaks
 	for (itab = 0; itab < MAX_CHAT_TABS; itab++)
 		channels[itab].nr_lines = 0;
@@ -796,6 +814,7 @@ void update_chat_win_buffers(void)
 		if (++imsg >= DISPLAY_TEXT_BUFFER_SIZE)
 			imsg = 0;
 	}
+#endif	/* CHAT_LINE_INDEX */
 	
 	// adjust the text position and scroll bar
 	nr_displayed_lines = (int) (chat_out_text_height / (18.0f * chat_zoom));
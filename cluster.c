@@ -19,7 +19,7 @@ void set_clusters (const char* data)
 		clusters[idx] = SDL_SwapLE16 (cdata[idx]);	
 }
 
-#ifdef MAP_EDITOR
+#if defined MAP_EDITOR || defined MAP_CACHE
 void get_clusters (char** data, int *len)
 {
 	if (!clusters)
@@ -225,7 +225,7 @@ static __inline__ void update_occupied_with_particle_system (char* occupied, int
  */
 void set_clusters (const char* data);
 
-#ifdef MAP_EDITOR
+#if defined MAP_EDITOR || defined MAP_CACHE
 /*!
  * \ingroup maps
  * \brief Get file data for the cluster map
@@ -31,6 +31,8 @@
 #include "pm_log.h"
 #include "platform.h"
 #include "questlog.h"
+#include "shadows.h"
+#include "sky.h"
 #include "sound.h"
 #include "spells.h"
 #include "tabs.h"
@@ -43,6 +45,33 @@
 #include "errors.h"
 #include "io/elpathwrapper.h"
 #include "io/elfilewrapper.h"
+#ifdef MAP_CACHE
+#include "io/map_cache.h"
+#endif // MAP_CACHE
+#ifdef PARALLEL_XZ
+#include "io/xz_blocks.h"
+#endif // PARALLEL_XZ
+#ifdef FAST_CHECKSUMS
+#include "io/checksum.h"
+#endif // FAST_CHECKSUMS
+#ifdef BUFFERED_CHAT_LOG
+#include "io/chat_log.h"
+#endif // BUFFERED_CHAT_LOG
+#ifdef PAWN
+#include "pawn/elpawn.h"
+#endif // PAWN
+#ifdef LAZY_BOOKS
+#include "books.h"
+#endif // LAZY_BOOKS
+#ifdef PACKED_VERTICES
+#include "io/e3d_io.h"
+#endif // PACKED_VERTICES
+#ifdef DDS_TEXTURE_CACHE
+#include "textures.h"
+#endif // DDS_TEXTURE_CACHE
+#ifdef ACTOR_PART_CACHE
+#include "textures.h"
+#endif // ACTOR_PART_CACHE
 #include "calc.h"
 #ifdef TEXT_ALIASES
 #include "text_aliases.h"
@@ -1749,6 +1778,54 @@ add_command("horse", &horse_cmd);
 	add_command("chat_to_counters", &chat_to_counters_command);
 	add_command(cmd_session_counters, &session_counters);
 	add_command("exp", &show_exp);
+#ifdef MAP_CACHE
+	add_command("map_cache_bench", &command_map_cache_benchmark);
+#endif // MAP_CACHE
+#ifdef SHADOW_MAP_CACHE
+	add_command("shadow_stats", &command_shadow_stats);
+#endif // SHADOW_MAP_CACHE
+#ifdef USE_SIMD
+	add_command("sky_bench", &command_sky_benchmark);
+#endif // USE_SIMD
+#if defined NEW_SOUND && defined SOUND_ASYNC_DECODE
+	add_command("sound_cache", &command_sound_cache);
+#endif // NEW_SOUND && SOUND_ASYNC_DECODE
+#ifdef ASYNC_LOGGING
+	add_command("log_bench", &command_log_benchmark);
+#endif // ASYNC_LOGGING
+#ifdef GLYPH_RUN_CACHE
+	add_command("glyph_stats", &command_glyph_run_stats);
+	add_command("text_bench", &command_glyph_run_benchmark);
+#endif // GLYPH_RUN_CACHE
+#ifdef PARALLEL_XZ
+	add_command("xz_bench", &command_xz_benchmark);
+#endif // PARALLEL_XZ
+#ifdef FAST_CHECKSUMS
+	add_command("checksum_bench", &command_checksum_benchmark);
+	add_command("verify_data", &command_verify_data);
+#endif // FAST_CHECKSUMS
+#ifdef FAST_CHAT_FILTER
+	add_command("filter_bench", &command_filter_benchmark);
+#endif // FAST_CHAT_FILTER
+#ifdef BUFFERED_CHAT_LOG
+	add_command("search_log", &command_search_log);
+#endif // BUFFERED_CHAT_LOG
+#ifdef PAWN
+	add_command("pawn_bench", &command_pawn_benchmark);
+	add_command("pawn_profile", &command_pawn_profile);
+#endif // PAWN
+#ifdef LAZY_BOOKS
+	add_command("book_bench", &command_book_benchmark);
+#endif // LAZY_BOOKS
+#ifdef PACKED_VERTICES
+	add_command("e3d_bench", &command_e3d_benchmark);
+#endif // PACKED_VERTICES
+#ifdef DDS_TEXTURE_CACHE
+	add_command("texture_bench", &command_texture_cache_benchmark);
+#endif // DDS_TEXTURE_CACHE
+#ifdef ACTOR_PART_CACHE
+	add_command("actor_textures", &command_actor_texture_stats);
+#endif // ACTOR_PART_CACHE
 #ifdef CONTEXT_MENUS_TEST
 	add_command("cmtest", &cm_test_window);
 #endif
@@ -240,6 +240,12 @@ static int resize_console_handler (window_info *win, int width, int height)
 
 	nr_console_lines = (int) (text_display_height / (DEFAULT_FONT_Y_LEN * chat_zoom));
 
+#ifdef	CHAT_LINE_INDEX
+	/* the messages are only rewrapped when they are shown */
+	total_nr_lines = get_display_line_count(FILTER_ALL, chat_zoom, console_text_width);
+	console_text_changed = 1;
+#endif	/* CHAT_LINE_INDEX */
+
 	if (console_scrollbar_enabled)
 	{
 		widget_resize(console_root_win, console_scrollbar_id, ELW_BOX_SIZE, text_display_height);
@@ -394,7 +400,9 @@ void create_console_root_window (int width, int height)
 {
 	if (console_root_win < 0)
 	{
+#ifndef	CHAT_LINE_INDEX
 		size_t i;
+#endif	/* CHAT_LINE_INDEX */
 		int scrollbar_x_adjust = (console_scrollbar_enabled) ?ELW_BOX_SIZE :0;
 		int console_active_width = width - HUD_MARGIN_X;
 		int console_active_height = height - HUD_MARGIN_Y;
@@ -413,10 +421,14 @@ void create_console_root_window (int width, int height)
 			console_text_width, console_active_height - INPUT_HEIGHT - CONSOLE_SEP_HEIGHT - CONSOLE_TEXT_Y_BORDER,
 			0, chat_zoom, -1.0f, -1.0f, -1.0f, display_text_buffer, DISPLAY_TEXT_BUFFER_SIZE, CHAT_ALL, 0, 0);
 
+#ifdef	CHAT_LINE_INDEX
+		total_nr_lines = get_display_line_count(FILTER_ALL, chat_zoom, console_text_width);
+#else	/* CHAT_LINE_INDEX */
 		total_nr_lines = 0;
 		for (i=0; i<DISPLAY_TEXT_BUFFER_SIZE; i++)
 			if (display_text_buffer[i].len && !display_text_buffer[i].deleted)
 				total_nr_lines += rewrap_message(&display_text_buffer[i], chat_zoom, console_text_width, NULL);
+#endif	/* CHAT_LINE_INDEX */
 
 		if(input_widget == NULL) {
 			Uint32 id;
@@ -6,6 +6,8 @@
  ****************************************************************************/
 
 #include "dds.h"
+#include <math.h>
+#include <string.h>
 
 void unpack_dxt_color(DXTColorBlock *block, Uint8 *values, Uint32 dxt1)
 {
@@ -217,3 +219,342 @@ void unpack_ati2(DXTInterpolatedAlphaBlock *first_block, DXTInterpolatedAlphaBlo
 		values[i * 4 + 3] = second_values[i];
 	}
 }
+
+static Uint16 pack_channel(const float value, const float scale)
+{
+	if (value <= 0.0f)
+	{
+		return 0;
+	}
+
+	if (value >= 255.0f)
+	{
+		return scale;
+	}
+
+	return value * scale / 255.0f + 0.5f;
+}
+
+static Uint16 pack_565(const float *color)
+{
+	return (pack_channel(color[0], 31.0f) << 11) |
+		(pack_channel(color[1], 63.0f) << 5) |
+		pack_channel(color[2], 31.0f);
+}
+
+static void unpack_565(const Uint16 value, float *color)
+{
+	color[0] = ((value & 0xF800) >> 11) * 255.0f / 31.0f;
+	color[1] = ((value & 0x07E0) >> 5) * 255.0f / 63.0f;
+	color[2] = (value & 0x001F) * 255.0f / 31.0f;
+}
+
+/* Chooses the nearest of the four colors of the end points for each texel,
+ * returns the squared error. */
+static float fit_dxt_color(const Uint8 *values, Uint16 color0, Uint16 color1,
+	DXTColorBlock *block)
+{
+	float colors[4][3];
+	float error, best_error, total, d;
+	Uint32 i, j, index, best;
+	Uint16 tmp;
+
+	if (color0 < color1)
+	{
+		tmp = color0;
+		color0 = color1;
+		color1 = tmp;
+	}
+
+	block->m_colors[0] = color0;
+	block->m_colors[1] = color1;
+
+	unpack_565(color0, colors[0]);
+	unpack_565(color1, colors[1]);
+
+	for (i = 0; i < 3; i++)
+	{
+		colors[2][i] = (2.0f * colors[0][i] + colors[1][i]) / 3.0f;
+		colors[3][i] = (colors[0][i] + 2.0f * colors[1][i]) / 3.0f;
+	}
+
+	total = 0.0f;
+
+	for (i = 0; i < 4; i++)
+	{
+		block->m_indices[i] = 0;
+
+		for (j = 0; j < 4; j++)
+		{
+			best = 0;
+			best_error = 0.0f;
+
+			// with equal end points all texels use the first one
+			for (index = 0; index < ((color0 == color1) ? 1 : 4); index++)
+			{
+				d = values[((i * 4) + j) * 4 + 0] - colors[index][0];
+				error = d * d;
+				d = values[((i * 4) + j) * 4 + 1] - colors[index][1];
+				error += d * d;
+				d = values[((i * 4) + j) * 4 + 2] - colors[index][2];
+				error += d * d;
+
+				if ((index == 0) || (error < best_error))
+				{
+					best = index;
+					best_error = error;
+				}
+			}
+
+			block->m_indices[i] |= best << (j * 2);
+			total += best_error;
+		}
+	}
+
+	return total;
+}
+
+static void pack_dxt_color(const Uint8 *values, DXTColorBlock *block)
+{
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	DXTColorBlock refined;
+	float mean[3], covariance[6], axis[3], tmp[3], ends[2][3];
+	float value, min, max, scale, a, b, ab, det, error;
+	float ax[3], bx[3];
+	Uint32 i, j, index, min_index, max_index;
+
+	mean[0] = 0.0f;
+	mean[1] = 0.0f;
+	mean[2] = 0.0f;
+
+	for (i = 0; i < 16; i++)
+	{
+		mean[0] += values[i * 4 + 0];
+		mean[1] += values[i * 4 + 1];
+		mean[2] += values[i * 4 + 2];
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		mean[i] /= 16.0f;
+		axis[i] = 0.0f;
+	}
+
+	memset(covariance, 0, sizeof(covariance));
+
+	for (i = 0; i < 16; i++)
+	{
+		tmp[0] = values[i * 4 + 0] - mean[0];
+		tmp[1] = values[i * 4 + 1] - mean[1];
+		tmp[2] = values[i * 4 + 2] - mean[2];
+
+		covariance[0] += tmp[0] * tmp[0];
+		covariance[1] += tmp[0] * tmp[1];
+		covariance[2] += tmp[0] * tmp[2];
+		covariance[3] += tmp[1] * tmp[1];
+		covariance[4] += tmp[1] * tmp[2];
+		covariance[5] += tmp[2] * tmp[2];
+
+		// start with the direction of the texel farthest from the mean
+		if ((fabsf(tmp[0]) + fabsf(tmp[1]) + fabsf(tmp[2])) >
+			(fabsf(axis[0]) + fabsf(axis[1]) + fabsf(axis[2])))
+		{
+			memcpy(axis, tmp, sizeof(axis));
+		}
+	}
+
+	// the principal axis of the colors, by power iteration
+	for (i = 0; i < 4; i++)
+	{
+		tmp[0] = covariance[0] * axis[0] + covariance[1] * axis[1] +
+			covariance[2] * axis[2];
+		tmp[1] = covariance[1] * axis[0] + covariance[3] * axis[1] +
+			covariance[4] * axis[2];
+		tmp[2] = covariance[2] * axis[0] + covariance[4] * axis[1] +
+			covariance[5] * axis[2];
+
+		scale = fabsf(tmp[0]) + fabsf(tmp[1]) + fabsf(tmp[2]);
+
+		if (scale <= 0.0f)
+		{
+			break;
+		}
+
+		axis[0] = tmp[0] / scale;
+		axis[1] = tmp[1] / scale;
+		axis[2] = tmp[2] / scale;
+	}
+
+	min_index = 0;
+	max_index = 0;
+	min = 0.0f;
+	max = 0.0f;
+
+	for (i = 0; i < 16; i++)
+	{
+		value = values[i * 4 + 0] * axis[0] + values[i * 4 + 1] * axis[1] +
+			values[i * 4 + 2] * axis[2];
+
+		if ((i == 0) || (value < min))
+		{
+			min = value;
+			min_index = i;
+		}
+
+		if ((i == 0) || (value > max))
+		{
+			max = value;
+			max_index = i;
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		ends[0][i] = values[max_index * 4 + i];
+		ends[1][i] = values[min_index * 4 + i];
+	}
+
+	error = fit_dxt_color(values, pack_565(ends[0]), pack_565(ends[1]),
+		block);
+
+	if (block->m_colors[0] == block->m_colors[1])
+	{
+		return;
+	}
+
+	// least squares fit of the end points to the chosen indices
+	a = 0.0f;
+	b = 0.0f;
+	ab = 0.0f;
+
+	for (i = 0; i < 3; i++)
+	{
+		ax[i] = 0.0f;
+		bx[i] = 0.0f;
+	}
+
+	for (i = 0; i < 16; i++)
+	{
+		index = (block->m_indices[i / 4] >> ((i % 4) * 2)) & 0x3;
+
+		a += weights[index] * weights[index];
+		b += (1.0f - weights[index]) * (1.0f - weights[index]);
+		ab += weights[index] * (1.0f - weights[index]);
+
+		for (j = 0; j < 3; j++)
+		{
+			ax[j] += weights[index] * values[i * 4 + j];
+			bx[j] += (1.0f - weights[index]) * values[i * 4 + j];
+		}
+	}
+
+	det = a * b - ab * ab;
+
+	if (fabsf(det) < 1e-6f)
+	{
+		return;
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		ends[0][i] = (b * ax[i] - ab * bx[i]) / det;
+		ends[1][i] = (a * bx[i] - ab * ax[i]) / det;
+	}
+
+	if (fit_dxt_color(values, pack_565(ends[0]), pack_565(ends[1]),
+		&refined) < error)
+	{
+		memcpy(block, &refined, sizeof(refined));
+	}
+}
+
+static void pack_dxt_interpolated_alpha(const Uint8 *values,
+	DXTInterpolatedAlphaBlock *block)
+{
+	float alphas[8];
+	float error, best_error;
+	Uint64 bits;
+	Uint32 i, index, best;
+	Uint8 min, max;
+
+	min = values[0];
+	max = values[0];
+
+	for (i = 1; i < 16; i++)
+	{
+		if (values[i] < min)
+		{
+			min = values[i];
+		}
+
+		if (values[i] > max)
+		{
+			max = values[i];
+		}
+	}
+
+	block->m_alphas[0] = max;
+	block->m_alphas[1] = min;
+
+	memset(block->m_indices, 0, sizeof(block->m_indices));
+
+	if (max == min)
+	{
+		return;
+	}
+
+	// eight alphas, as max is greater than min
+	alphas[0] = max;
+	alphas[1] = min;
+
+	for (i = 0; i < 6; i++)
+	{
+		alphas[i + 2] = ((6 - i) * max + (i + 1) * min) / 7.0f;
+	}
+
+	bits = 0;
+
+	for (i = 0; i < 16; i++)
+	{
+		best = 0;
+		best_error = 0.0f;
+
+		for (index = 0; index < 8; index++)
+		{
+			error = fabsf(values[i] - alphas[index]);
+
+			if ((index == 0) || (error < best_error))
+			{
+				best = index;
+				best_error = error;
+			}
+		}
+
+		bits |= (Uint64)best << (i * 3);
+	}
+
+	for (i = 0; i < 6; i++)
+	{
+		block->m_indices[i] = (bits >> (i * 8)) & 0xFF;
+	}
+}
+
+void pack_dxt1(const Uint8 *values, DXTColorBlock *block)
+{
+	pack_dxt_color(values, block);
+}
+
+void pack_dxt5(const Uint8 *values, DXTInterpolatedAlphaBlock *alpha_block, DXTColorBlock *color_block)
+{
+	Uint8 alpha_values[16];
+	Uint32 i;
+
+	pack_dxt_color(values, color_block);
+
+	for (i = 0; i < 16; i++)
+	{
+		alpha_values[i] = values[i * 4 + 3];
+	}
+
+	pack_dxt_interpolated_alpha(alpha_values, alpha_block);
+}
@@ -172,6 +172,8 @@ void unpack_dxt5(DXTInterpolatedAlphaBlock *alpha_block, DXTColorBlock *color_bl
 void unpack_ati1(DXTInterpolatedAlphaBlock *block, Uint8 *values);
 void unpack_ati2(DXTInterpolatedAlphaBlock *first_block, DXTInterpolatedAlphaBlock *second_block,
 	Uint8 *values);
+void pack_dxt1(const Uint8 *values, DXTColorBlock *block);
+void pack_dxt5(const Uint8 *values, DXTInterpolatedAlphaBlock *alpha_block, DXTColorBlock *color_block);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,551 @@
+/****************************************************************************
+ *            dds_cache.c
+ *
+ * Cache of the textures that are transcoded to dds files.
+ ****************************************************************************/
+
+#ifdef	DDS_TEXTURE_CACHE
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <SDL.h>
+#include <SDL_thread.h>
+#include "dds_cache.h"
+#include "asc.h"
+#include "dds.h"
+#include "ddsimage.h"
+#include "errors.h"
+#include "image.h"
+#include "memory.h"
+#include "misc.h"
+#include "queue.h"
+#include "threads.h"
+#include "io/elfilewrapper.h"
+#include "io/elpathwrapper.h"
+
+#define DDS_CACHE_MAGIC MAKEFOURCC('E', 'L', 'T', 'C')
+#define DDS_CACHE_VERSION 1
+/* The most memory the images that are not written yet can use, the images
+ * loaded after that are written the next time they are loaded. */
+#define DDS_CACHE_MAX_PENDING (64 * 1024 * 1024)
+
+typedef struct
+{
+	char name[64];	/*!< the name of the dds file in the config dir */
+	image_t image;	/*!< the image to write, RGBA8 without mipmaps */
+} dds_cache_job_t;
+
+int use_dds_cache = 1;
+
+static queue_t* dds_cache_queue = 0;
+static SDL_Thread* dds_cache_thread = 0;
+static SDL_mutex* dds_cache_mutex = 0;
+static Uint32 dds_cache_thread_done = 0;
+static Uint32 dds_cache_pending_size = 0;
+static Uint32 dds_cache_pending_count = 0;
+
+static Uint32 get_dds_cache_name(const char* file_name, char* name,
+	const Uint32 size)
+{
+	char buffer[128], alpha_buffer[128];
+	el_file_ptr file;
+	Uint32 crc, file_size, alpha_crc;
+
+	if (check_image_name(file_name, sizeof(buffer), buffer) == 0)
+	{
+		return 0;
+	}
+
+	file = el_open_custom(buffer);
+
+	if (file == 0)
+	{
+		return 0;
+	}
+
+	if ((el_get_size(file) >= 4) && check_dds(el_get_pointer(file)))
+	{
+		el_close(file);
+
+		return 0;
+	}
+
+	crc = el_crc32(file);
+	file_size = el_get_size(file);
+
+	el_close(file);
+
+	alpha_crc = 0;
+
+	if (check_alpha_image_name(buffer, sizeof(alpha_buffer),
+		alpha_buffer) != 0)
+	{
+		file = el_open_custom(alpha_buffer);
+
+		if (file == 0)
+		{
+			return 0;
+		}
+
+		alpha_crc = el_crc32(file);
+
+		el_close(file);
+	}
+
+	safe_snprintf(name, size, "texture_cache/%08x%08x%08x.dds", crc,
+		file_size, alpha_crc);
+
+	return 1;
+}
+
+static Uint32 get_level_size(const Uint32 width, const Uint32 height,
+	const Uint32 level, const Uint32 alpha)
+{
+	Uint32 w, h;
+
+	w = (max2u(width >> level, 1) + 3) / 4;
+	h = (max2u(height >> level, 1) + 3) / 4;
+
+	if (alpha != 0)
+	{
+		return w * h * 16;
+	}
+	else
+	{
+		return w * h * 8;
+	}
+}
+
+static Uint32 get_mipmap_count(const Uint32 width, const Uint32 height)
+{
+	Uint32 count;
+
+	count = 1;
+
+	while (((width >> count) > 0) || ((height >> count) > 0))
+	{
+		count++;
+	}
+
+	return min2u(count, MAX_IMAGE_MIPMAPS);
+}
+
+/* Halves the image with a box filter. */
+static void build_mipmap(const Uint8* source, const Uint32 width,
+	const Uint32 height, Uint8* dest)
+{
+	Uint32 x, y, w, h, x0, x1, y0, y1, i;
+
+	w = max2u(width / 2, 1);
+	h = max2u(height / 2, 1);
+
+	for (y = 0; y < h; y++)
+	{
+		y0 = min2u(y * 2, height - 1) * width;
+		y1 = min2u(y * 2 + 1, height - 1) * width;
+
+		for (x = 0; x < w; x++)
+		{
+			x0 = min2u(x * 2, width - 1);
+			x1 = min2u(x * 2 + 1, width - 1);
+
+			for (i = 0; i < 4; i++)
+			{
+				dest[(y * w + x) * 4 + i] =
+					(source[(y0 + x0) * 4 + i] +
+					source[(y0 + x1) * 4 + i] +
+					source[(y1 + x0) * 4 + i] +
+					source[(y1 + x1) * 4 + i] + 2) / 4;
+			}
+		}
+	}
+}
+
+static Uint8* pack_level(const Uint8* source, const Uint32 width,
+	const Uint32 height, const Uint32 alpha, Uint8* dest)
+{
+	DXTInterpolatedAlphaBlock alpha_block;
+	DXTColorBlock color_block;
+	Uint8 values[64];
+	Uint32 x, y, i, j, sx, sy;
+
+	for (y = 0; y < height; y += 4)
+	{
+		for (x = 0; x < width; x += 4)
+		{
+			// the small mipmaps repeat their texels in the block
+			for (i = 0; i < 4; i++)
+			{
+				sy = min2u(y + i, height - 1);
+
+				for (j = 0; j < 4; j++)
+				{
+					sx = min2u(x + j, width - 1);
+
+					memcpy(&values[(i * 4 + j) * 4],
+						&source[(sy * width + sx) * 4],
+						4);
+				}
+			}
+
+			if (alpha != 0)
+			{
+				pack_dxt5(values, &alpha_block, &color_block);
+
+				memcpy(dest, &alpha_block, sizeof(alpha_block));
+				dest += sizeof(alpha_block);
+			}
+			else
+			{
+				pack_dxt1(values, &color_block);
+			}
+
+			color_block.m_colors[0] =
+				SDL_SwapLE16(color_block.m_colors[0]);
+			color_block.m_colors[1] =
+				SDL_SwapLE16(color_block.m_colors[1]);
+
+			memcpy(dest, &color_block, sizeof(color_block));
+			dest += sizeof(color_block);
+		}
+	}
+
+	return dest;
+}
+
+static void write_dds_cache(const char* name, const image_t* image)
+{
+	DdsHeader header;
+	char tmp_name[80];
+	FILE* file;
+	Uint32* words;
+	const Uint8* source;
+	Uint8* buffer;
+	Uint8* level;
+	Uint8* next;
+	Uint8* dest;
+	Uint32 size, mipmaps, width, height, i, ok;
+
+	mipmaps = get_mipmap_count(image->width, image->height);
+	size = 4 + DDS_HEADER_SIZE;
+
+	for (i = 0; i < mipmaps; i++)
+	{
+		size += get_level_size(image->width, image->height, i,
+			image->alpha);
+	}
+
+	memset(&header, 0, sizeof(header));
+
+	header.m_size = DDS_HEADER_SIZE;
+	header.m_flags = DDSD_MIN_FLAGS | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.m_height = image->height;
+	header.m_width = image->width;
+	header.m_size_or_pitch = get_level_size(image->width, image->height,
+		0, image->alpha);
+	header.m_mipmap_count = mipmaps;
+	header.m_reserved1[0] = DDS_CACHE_MAGIC;
+	header.m_reserved1[1] = DDS_CACHE_VERSION;
+	header.m_reserved1[2] = size;
+	header.m_pixel_format.m_size = DDS_PIXEL_FORMAT_SIZE;
+	header.m_pixel_format.m_flags = DDPF_FOURCC;
+	header.m_pixel_format.m_fourcc = image->alpha ? DDSFMT_DXT5 :
+		DDSFMT_DXT1;
+	header.m_caps.m_caps1 = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP |
+		DDSCAPS_COMPLEX;
+
+	// the header is only made of Uint32 values
+	words = (Uint32*)&header;
+
+	for (i = 0; i < (DDS_HEADER_SIZE / 4); i++)
+	{
+		words[i] = SDL_SwapLE32(words[i]);
+	}
+
+	buffer = malloc(size);
+	// the first mipmap is the largest, a quarter of the RGBA8 image
+	level = malloc_aligned(image->width * image->height, 16);
+	next = malloc_aligned(image->width * image->height, 16);
+
+	memcpy(buffer, "DDS ", 4);
+	memcpy(buffer + 4, &header, DDS_HEADER_SIZE);
+
+	width = image->width;
+	height = image->height;
+
+	dest = pack_level(image->image, width, height, image->alpha,
+		buffer + 4 + DDS_HEADER_SIZE);
+
+	source = image->image;
+
+	for (i = 1; i < mipmaps; i++)
+	{
+		build_mipmap(source, width, height, next);
+
+		width = max2u(width / 2, 1);
+		height = max2u(height / 2, 1);
+
+		dest = pack_level(next, width, height, image->alpha, dest);
+
+		source = next;
+		next = level;
+		level = (Uint8*)source;
+	}
+
+	assert(dest == (buffer + size));
+
+	free_aligned(level);
+	free_aligned(next);
+
+	// written to a temporary file, so a crash leaves no broken dds file
+	safe_snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", name);
+
+	file = open_file_config(tmp_name, "wb");
+
+	if (file == 0)
+	{
+		LOG_ERROR("Can't write texture cache '%s'", tmp_name);
+
+		free(buffer);
+
+		return;
+	}
+
+	ok = fwrite(buffer, size, 1, file) == 1;
+
+	if (fclose(file) != 0)
+	{
+		ok = 0;
+	}
+
+	free(buffer);
+
+	if ((ok == 0) || (file_rename_config(tmp_name, name) != 0))
+	{
+		LOG_ERROR("Can't write texture cache '%s'", name);
+
+		file_remove_config(tmp_name);
+
+		return;
+	}
+
+	LOG_DEBUG("Texture cache '%s' written, %dx%d with %d mipmaps.", name,
+		image->width, image->height, mipmaps);
+}
+
+static void free_dds_cache_job(dds_cache_job_t* job)
+{
+	CHECK_AND_LOCK_MUTEX(dds_cache_mutex);
+
+	dds_cache_pending_size -= job->image.sizes[0];
+	dds_cache_pending_count--;
+
+	CHECK_AND_UNLOCK_MUTEX(dds_cache_mutex);
+
+	free_image(&job->image);
+	free(job);
+}
+
+static int dds_cache_thread_main(void* done)
+{
+	dds_cache_job_t* job;
+
+	init_thread_log("dds_cache");
+
+	while (*((Uint32*)done) == 0)
+	{
+		job = queue_pop_blocking(dds_cache_queue);
+
+		if (job == 0)
+		{
+			continue;
+		}
+
+		write_dds_cache(job->name, &job->image);
+
+		free_dds_cache_job(job);
+	}
+
+	return 1;
+}
+
+static void add_dds_cache_job(const char* name, const image_t* image)
+{
+	dds_cache_job_t* job;
+	Uint32 size;
+
+	if (dds_cache_queue == 0)
+	{
+		return;
+	}
+
+	size = image->sizes[0];
+
+	CHECK_AND_LOCK_MUTEX(dds_cache_mutex);
+
+	if ((dds_cache_pending_size + size) > DDS_CACHE_MAX_PENDING)
+	{
+		CHECK_AND_UNLOCK_MUTEX(dds_cache_mutex);
+
+		return;
+	}
+
+	dds_cache_pending_size += size;
+	dds_cache_pending_count++;
+
+	CHECK_AND_UNLOCK_MUTEX(dds_cache_mutex);
+
+	job = calloc(1, sizeof(dds_cache_job_t));
+
+	safe_strncpy(job->name, name, sizeof(job->name));
+	memcpy(&job->image, image, sizeof(image_t));
+
+	job->image.image = malloc_aligned(size, 16);
+	memcpy(job->image.image, image->image, size);
+
+	queue_push_signal(dds_cache_queue, job);
+}
+
+static Uint32 load_dds_cache(const char* name, const Uint32 compression,
+	const Uint32 strip_mipmaps, const Uint32 base_level, image_t* image)
+{
+	el_file_ptr file;
+	Uint32 words[3];
+	Uint32 result;
+
+	file = el_open_anywhere(name);
+
+	if (file == 0)
+	{
+		return 0;
+	}
+
+	result = 0;
+
+	// only whole files of this version, load_dds doesn't check the size
+	if (el_get_size(file) > (4 + DDS_HEADER_SIZE))
+	{
+		memcpy(words, (Uint8*)el_get_pointer(file) + 4 +
+			offsetof(DdsHeader, m_reserved1), sizeof(words));
+
+		if ((SDL_SwapLE32(words[0]) == DDS_CACHE_MAGIC) &&
+			(SDL_SwapLE32(words[1]) == DDS_CACHE_VERSION) &&
+			(SDL_SwapLE32(words[2]) == el_get_size(file)))
+		{
+			result = load_dds(file, compression, 0, strip_mipmaps,
+				base_level, image);
+		}
+	}
+
+	el_close(file);
+
+	if (result == 0)
+	{
+		LOG_ERROR("Removing invalid texture cache '%s'", name);
+
+		free_image(image);
+		file_remove_config(name);
+	}
+
+	return result;
+}
+
+Uint32 load_image_data_cached(const char* file_name,
+	const Uint32 compression, const Uint32 strip_mipmaps,
+	const Uint32 base_level, image_t* image)
+{
+	char name[64];
+
+	if ((use_dds_cache == 0) || ((compression & tct_s3tc) != tct_s3tc) ||
+		(get_dds_cache_name(file_name, name, sizeof(name)) == 0))
+	{
+		return load_image_data(file_name, compression, 0,
+			strip_mipmaps, base_level, image);
+	}
+
+	if ((file_exists_config(name) == 1) && (load_dds_cache(name,
+		compression, strip_mipmaps, base_level, image) != 0))
+	{
+		return 1;
+	}
+
+	if (load_image_data(file_name, compression, 0, strip_mipmaps,
+		base_level, image) == 0)
+	{
+		return 0;
+	}
+
+	// DXT needs blocks of four texels, mipmaps halve the size
+	if ((image->format == ift_rgba8) && (image->mipmaps == 1) &&
+		(image->width >= 4) && (image->height >= 4) &&
+		(popcount(image->width) == 1) && (popcount(image->height) == 1))
+	{
+		add_dds_cache_job(name, image);
+	}
+
+	return 1;
+}
+
+void wait_dds_cache()
+{
+	Uint32 count;
+
+	do
+	{
+		CHECK_AND_LOCK_MUTEX(dds_cache_mutex);
+
+		count = dds_cache_pending_count;
+
+		CHECK_AND_UNLOCK_MUTEX(dds_cache_mutex);
+
+		if (count > 0)
+		{
+			SDL_Delay(10);
+		}
+	}
+	while (count > 0);
+}
+
+void init_dds_cache()
+{
+	mkdir_config("texture_cache");
+
+	dds_cache_mutex = SDL_CreateMutex();
+	dds_cache_thread_done = 0;
+
+	queue_initialise(&dds_cache_queue);
+
+	dds_cache_thread = SDL_CreateThread(dds_cache_thread_main,
+		&dds_cache_thread_done);
+}
+
+void free_dds_cache()
+{
+	dds_cache_job_t* job;
+	int result;
+
+	if (dds_cache_queue == 0)
+	{
+		return;
+	}
+
+	dds_cache_thread_done = 1;
+
+	while ((job = queue_pop(dds_cache_queue)) != 0)
+	{
+		free_dds_cache_job(job);
+	}
+
+	SDL_CondBroadcast(dds_cache_queue->condition);
+	SDL_WaitThread(dds_cache_thread, &result);
+
+	queue_destroy(dds_cache_queue);
+	SDL_DestroyMutex(dds_cache_mutex);
+
+	dds_cache_queue = 0;
+	dds_cache_thread = 0;
+	dds_cache_mutex = 0;
+}
+
+#endif	/* DDS_TEXTURE_CACHE */
@@ -0,0 +1,72 @@
+/*!
+ * \file
+ * \ingroup textures
+ * \brief cache of the textures transcoded to dds
+ *
+ * Textures that are not dds files are decoded with SDL_image every time
+ * they are loaded, and uploaded without mipmaps. The first time such a
+ * texture is loaded, a thread compresses it to DXT1 or DXT5 with all
+ * mipmaps and writes a dds file into texture_cache/ in the config dir.
+ * The name of the dds file is made from the crc and size of the image and
+ * the crc of its alpha map, so changed images get a new file. The next
+ * time the dds file is loaded instead.
+ */
+#ifndef	UUID_3c9e1b52_0f4d_4a7e_b8c6_d21f57a9e063
+#define	UUID_3c9e1b52_0f4d_4a7e_b8c6_d21f57a9e063
+
+#include "platform.h"
+#include "image_loading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef	DDS_TEXTURE_CACHE
+extern int use_dds_cache;	/*!< load the textures from the cache if not zero */
+
+/*!
+ * \ingroup textures
+ * \brief Starts the thread that writes the cache.
+ */
+void init_dds_cache(void);
+
+/*!
+ * \ingroup textures
+ * \brief Stops the thread that writes the cache, the textures that are
+ * not written yet are dropped.
+ */
+void free_dds_cache(void);
+
+/*!
+ * \ingroup textures
+ * \brief Waits until all textures given to the cache are written.
+ */
+void wait_dds_cache(void);
+
+/*!
+ * \ingroup textures
+ * \brief Loads an image from the cache.
+ *
+ * Loads the dds file of the image from the cache if there is one, else
+ * loads the image with load_image_data() and gives it to the thread that
+ * writes the cache. Images that are dds files and images without a size
+ * that is a power of two are always loaded with load_image_data(). Only
+ * used if s3tc compression is in the compressions.
+ * \param file_name The file name to use.
+ * \param compression Set of texture compressions that can be used.
+ * \param strip_mipmaps Should we strip the mipmaps?
+ * \param base_level What base level should we use?
+ * \param image The image struct where we store the loaded data.
+ * \retval Uint32 Returns one if everything is ok, zero else.
+ * \see load_image_data
+ */
+Uint32 load_image_data_cached(const char* file_name,
+	const Uint32 compression, const Uint32 strip_mipmaps,
+	const Uint32 base_level, image_t* image);
+#endif	/* DDS_TEXTURE_CACHE */
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif	/* UUID_3c9e1b52_0f4d_4a7e_b8c6_d21f57a9e063 */
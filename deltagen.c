@@ -0,0 +1,141 @@
+/*
+ * Creates a binary delta patch for the updater.
+ *
+ * Usage: deltagen <old file> <new file> <name> [patch file]
+ *
+ * The patch is written to "<new file>.<md5 of old file>.delta" if no
+ * patch file is given, and the line for the update list is printed:
+ *
+ * DELTA (/<name>) = <md5 of old file> <md5 of new file>
+ *
+ * where name is the file name used in the update list.
+ *
+ * The patch can be compressed with xz like every other file of the
+ * update, it must keep its name without the .xz extension then.
+ *
+ * Build with io/delta.c and md5.c, it only needs the SDL headers:
+ *
+ * gcc -O2 -I. `sdl-config --cflags` deltagen.c io/delta.c md5.c -o deltagen
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "md5.h"
+#include "io/delta.h"
+
+static void *read_file(const char *file_name, Uint64 *size)
+{
+	FILE *file;
+	void *data;
+	long len;
+
+	file = fopen(file_name, "rb");
+
+	if (file == 0)
+	{
+		fprintf(stderr, "Can't open '%s'\n", file_name);
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data = malloc(len + 1);
+
+	if ((data == 0) || (fread(data, 1, len, file) != (size_t)len))
+	{
+		fprintf(stderr, "Can't read '%s'\n", file_name);
+		fclose(file);
+		free(data);
+		return 0;
+	}
+
+	fclose(file);
+
+	*size = len;
+
+	return data;
+}
+
+static void get_md5_string(const void *data, const Uint64 size, char *str)
+{
+	MD5 md5;
+	MD5_DIGEST digest;
+	int i;
+
+	MD5Open(&md5);
+	MD5Digest(&md5, data, size);
+	MD5Close(&md5, digest);
+
+	for (i = 0; i < 16; i++)
+	{
+		sprintf(str + i * 2, "%02x", digest[i]);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	char old_md5[33], new_md5[33];
+	char patch_name[1024];
+	void *source, *target, *patch;
+	Uint64 source_size, target_size, patch_size;
+	FILE *file;
+
+	if ((argc != 4) && (argc != 5))
+	{
+		fprintf(stderr, "Usage: %s <old file> <new file> <name> "
+			"[patch file]\n", argv[0]);
+		return 1;
+	}
+
+	source = read_file(argv[1], &source_size);
+	target = read_file(argv[2], &target_size);
+
+	if ((source == 0) || (target == 0))
+	{
+		return 1;
+	}
+
+	get_md5_string(source, source_size, old_md5);
+	get_md5_string(target, target_size, new_md5);
+
+	if (argc == 5)
+	{
+		snprintf(patch_name, sizeof(patch_name), "%s", argv[4]);
+	}
+	else
+	{
+		snprintf(patch_name, sizeof(patch_name), "%s.%s.delta",
+			argv[2], old_md5);
+	}
+
+	if (delta_patch_create(source, source_size, target, target_size,
+		&patch, &patch_size) != 0)
+	{
+		fprintf(stderr, "Can't create the patch\n");
+		return 1;
+	}
+
+	file = fopen(patch_name, "wb");
+
+	if ((file == 0) || (fwrite(patch, 1, patch_size, file) != patch_size))
+	{
+		fprintf(stderr, "Can't write '%s'\n", patch_name);
+		return 1;
+	}
+
+	fclose(file);
+
+	fprintf(stderr, "%s: %llu bytes, %llu bytes of the new file\n",
+		patch_name, (unsigned long long)patch_size,
+		(unsigned long long)target_size);
+
+	printf("DELTA (/%s) = %s %s\n", argv[3], old_md5, new_md5);
+
+	free(patch);
+	free(source);
+	free(target);
+
+	return 0;
+}
@@ -153,6 +153,9 @@ void draw_scene()
 	
 	SDL_GL_SwapBuffers();
 	CHECK_GL_ERRORS();
+#ifdef	GL_STATE_CACHE
+	gl_state_end_frame();
+#endif	/* GL_STATE_CACHE */
 
 	/* stuff to do not every frame, twice a second is fine */
 	{
@@ -70,6 +70,9 @@ typedef struct
 	GLuint vertex_vbo;		/**< an array of e3d vertex data */
 	GLuint indices_vbo;		/**< an array of el3d indices */
 	e3d_vertex_data* vertex_layout;	/**< Index of the vertex layout */
+#ifdef	PACKED_VERTICES
+	e3d_vertex_data packed_layout;	/**< the layout of the vertices if they are kept in the format of the file */
+#endif	/* PACKED_VERTICES */
 
 	/**
 	 * \name min/max values of x,y,z as well as the max size/dimension of the material
@@ -72,6 +72,12 @@
  #ifdef OSX
   #include "events.h"
  #endif // OSX
+ #ifdef OCCLUSION_CULLING
+  #include "occlusion_culling.h"
+ #endif // OCCLUSION_CULLING
+ #ifdef MAP_CACHE
+  #include "io/map_cache.h"
+ #endif // MAP_CACHE
 #endif
 
 #include "asc.h"
@@ -674,6 +680,14 @@ void change_clouds_shadows(int *value)
 //	else LOG_TO_CONSOLE(c_green2,disabled_clouds_shadows);
 }
 
+#ifdef	OCCLUSION_CULLING
+void change_occlusion_culling(int *value)
+{
+	change_var(value);
+	set_all_intersect_update_needed(main_bbox_tree);
+}
+#endif	/* OCCLUSION_CULLING */
+
 #ifdef	NEW_TEXTURES
 void change_small_actor_texture_cache(int *value)
 {
@@ -1317,6 +1331,16 @@ void change_shadow_mapping (int *sm)
 	update_fbos();
 }
 
+#ifdef	SHADOW_MAP_CACHE
+void change_shadow_map_cache (int *var)
+{
+	*var= !*var;
+	invalidate_shadow_cache();
+	// the light frustum is enlarged while the cache is used
+	calc_shadow_matrix();
+}
+#endif	/* SHADOW_MAP_CACHE */
+
 #ifndef MAP_EDITOR2
 void change_global_filters (int *use)
 {
@@ -2023,6 +2047,9 @@ static void init_ELC_vars(void)
 	add_var(OPT_FLOAT,"warn_gain", "wrngain", &warnings_gain, change_sound_level, 1, "Text Warning Sounds Volume", "Adjust the user configured text warning sound effects volume", AUDIO, 0.0, 1.0, 0.1);
 	add_var(OPT_BOOL,"enable_music","music",&music_on,toggle_music,0,"Enable Music","Turn music on/off",AUDIO);
 	add_var(OPT_FLOAT,"music_gain","mgain",&music_gain,change_sound_level,1,"Music Volume","Adjust the music volume",AUDIO,0.0,1.0,0.1);
+#ifdef	SOUND_ASYNC_DECODE
+	add_var(OPT_INT,"sound_cache_size","sndcache",&sound_cache_size,change_int,16,"Decoded Sound Cache Size","Size in MB of the sound effects kept decoded in memory, so they can be played again without decoding them. 0 disables the cache",AUDIO,0,256);
+#endif	/* SOUND_ASYNC_DECODE */
 #endif	//NEW_SOUND
 	// AUDIO TAB
 
@@ -2062,6 +2089,13 @@ static void init_ELC_vars(void)
 	add_var(OPT_INT_F,"water_shader_quality","water_shader_quality",&water_shader_quality,change_water_shader_quality,1,"  water shader quality","Defines what shader is used for water rendering. Higher values are slower but look better. Needs \"toggle frame buffer support\" to be turned on.",VIDEO, int_zero_func, int_max_water_shader_quality);
 #ifdef	NEW_TEXTURES
 	add_var(OPT_BOOL,"small_actor_texture_cache","small_actor_tc",&small_actor_texture_cache,change_small_actor_texture_cache,0,"Small actor texture cache","A small Actor texture cache uses less video memory, but actor loading can be slower.",VIDEO);
+#ifdef	ACTOR_PART_CACHE
+	add_var(OPT_INT,"actor_texture_threads","actor_threads",&actor_texture_thread_count,change_int,2,"Actor texture threads","The number of threads that build the textures of the actors, restart required to activate it",VIDEO,1,8);
+	add_var(OPT_INT,"actor_part_cache_size","actor_partcache",&actor_part_cache_size,change_int,32,"Actor Part Cache Size","Size in MB of the decoded skins, clothes and masks kept in memory, so the textures of other actors are built without decoding them again. 0 disables the cache",VIDEO,0,256);
+#endif	/* ACTOR_PART_CACHE */
+#ifdef	FBO_ACTOR_TEXTURES
+	add_var(OPT_BOOL,"use_fbo_actor_textures","fbo_actor_textures",&use_fbo_actor_textures,change_var,1,"Build actor textures on the GPU","Draws the skins, clothes and masks of the actors into their textures with a frame buffer object instead of building them on the CPU, restart required to activate it",VIDEO);
+#endif	/* FBO_ACTOR_TEXTURES */
 #else	/* NEW_TEXTURES */
 	add_var(OPT_BOOL,"use_mipmaps","mm",&use_mipmaps,change_mipmaps,0,"Mipmaps","Mipmaps is a texture effect that blurs the texture a bit - it may look smoother and better, or it may look worse depending on your graphics driver settings and the like.",VIDEO);
 #endif	/* NEW_TEXTURES */
@@ -2074,10 +2108,16 @@ static void init_ELC_vars(void)
 	// GFX TAB
 	add_var(OPT_BOOL,"shadows_on","shad",&shadows_on,change_shadows,0,"Shadows","Toggles the shadows", GFX);
 	add_var(OPT_BOOL,"use_shadow_mapping", "sm", &use_shadow_mapping, change_shadow_mapping, 0, "Shadow Mapping", "If you want to use some better quality shadows, enable this. It will use more resources, but look prettier.", GFX);
+#ifdef	SHADOW_MAP_CACHE
+	add_var(OPT_BOOL,"use_shadow_map_cache", "smcache", &use_shadow_map_cache, change_shadow_map_cache, 1, "Cache Shadow Map", "Renders the shadows of buildings and other static objects only when the light or the camera moves far enough. Needs frame buffer support.", GFX);
+#endif	/* SHADOW_MAP_CACHE */
 	add_var(OPT_MULTI,"shadow_map_size","smsize",&shadow_map_size_multi,change_shadow_map_size,1024,"Shadow Map Size","This parameter determines the quality of the shadow maps. You should as minimum set it to 512.",GFX,"256","512","768","1024","1280","1536","1792","2048","3072","4096",NULL);
 	add_var(OPT_BOOL,"no_adjust_shadows","noadj",&no_adjust_shadows,change_var,0,"Don't Adjust Shadows","If enabled, tell the engine not to disable the shadows if the frame rate is too low.",GFX);
 	add_var(OPT_BOOL,"clouds_shadows","cshad",&clouds_shadows,change_clouds_shadows,1,"Cloud Shadows","The clouds shadows are projected on the ground, and the game looks nicer with them on.",GFX);
 	add_var(OPT_BOOL,"show_reflection","refl",&show_reflection,change_reflection,1,"Show Reflections","Toggle the reflections",GFX);
+#ifdef	OCCLUSION_CULLING
+	add_var(OPT_BOOL,"use_occlusion_culling","occlusion",&use_occlusion_culling,change_occlusion_culling,1,"Occlusion Culling","Don't draw objects, actors and particles hidden behind large buildings. Uses a small software depth buffer on the cpu.",GFX);
+#endif	/* OCCLUSION_CULLING */
 	add_var(OPT_BOOL,"render_fog","fog",&use_fog,change_var,1,"Render Fog","Toggles fog rendering.",GFX);
 	add_var(OPT_BOOL,"show_weather","weather",&show_weather,change_var,1,"Show Weather Effects","Toggles thunder, lightning and rain effects.",GFX);
 	add_var(OPT_BOOL,"skybox_show_sky","sky", &skybox_show_sky, change_sky_var,1,"Show Sky", "Enable the sky box.", GFX);
@@ -2158,6 +2198,12 @@ static void init_ELC_vars(void)
 #endif
 	add_var(OPT_BOOL, "use_animation_program", "uap", &use_animation_program, change_use_animation_program, 1, "Use animation program", "Use GL_ARB_vertex_program for actor animation", TROUBLESHOOT);
 	add_var(OPT_BOOL,"poor_man","poor",&poor_man,change_poor_man,0,"Poor Man","If the game is running very slow for you, toggle this setting.",TROUBLESHOOT);
+#ifdef	MAP_CACHE
+	add_var(OPT_BOOL,"use_map_cache","mapcache",&use_map_cache,change_var,1,"Map Cache","Keep the data built when a map is loaded in the map_cache folder, so changing to the map again is faster. Disable this if objects of a map are missing.",TROUBLESHOOT);
+#endif	/* MAP_CACHE */
+#ifdef	GL_STATE_CACHE
+	add_var(OPT_BOOL,"show_gl_stats","glstats",&show_gl_stats,change_var,0,"Show OpenGL Statistics","Show the OpenGL state changes, texture and buffer binds and draw calls of every render pass of the last frame.",TROUBLESHOOT);
+#endif	/* GL_STATE_CACHE */
 	// TROUBLESHOOT TAB
 
 	// DEBUGTAB TAB
@@ -9,6 +9,11 @@
 #include "engine/logging.hpp"
 #include "io/elpathwrapper.h"
 #include "asc.h"
+#ifdef	ASYNC_LOGGING
+#include "text.h"
+#include <SDL_timer.h>
+#endif	/* ASYNC_LOGGING */
+#include <algorithm>
 #include <cassert>
 
 namespace el = eternal_lands;
@@ -208,3 +213,70 @@ extern "C" void init_thread_log(const char* name)
 	el::init_thread_log(name);
 }
 
+
+#ifdef	ASYNC_LOGGING
+extern "C" void set_log_async(const int async)
+{
+	el::set_log_async(async != 0);
+}
+
+namespace
+{
+
+	Uint32 benchmark_log_calls(const Uint32 count, const bool async)
+	{
+		Uint32 i, start;
+
+		el::set_log_async(async);
+
+		start = SDL_GetTicks();
+
+		for (i = 0; i < count; i++)
+		{
+			log_info(__FILE__, __LINE__, "Log benchmark message %d"
+				" of %d", i, count);
+		}
+
+		return SDL_GetTicks() - start;
+	}
+
+}
+
+extern "C" int command_log_benchmark(char *text, int len)
+{
+	char str[256];
+	Uint32 count, sync_time, async_time, flush_time, start;
+	el::LogLevelType log_level;
+	bool async;
+
+	count = 100000;
+
+	if ((text != 0) && (atoi(text) > 0))
+	{
+		count = atoi(text);
+	}
+
+	log_level = el::get_log_level();
+	async = el::get_log_async();
+
+	el::set_log_level(std::max(log_level, el::llt_info));
+
+	sync_time = benchmark_log_calls(count, false);
+	async_time = benchmark_log_calls(count, true);
+
+	start = SDL_GetTicks();
+	el::flush_logging();
+	flush_time = SDL_GetTicks() - start;
+
+	el::set_log_async(async);
+	el::set_log_level(log_level);
+
+	safe_snprintf(str, sizeof(str), "%d log messages: direct %.3f us per "
+		"call, writer thread %.3f us per call (%d ms to flush)", count,
+		sync_time * 1000.0f / count, async_time * 1000.0f / count,
+		flush_time);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* ASYNC_LOGGING */
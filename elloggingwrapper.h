@@ -136,6 +136,27 @@ int command_log_level(char *text, int len);
 
 void init_thread_log(const char* name);
 
+#ifdef	ASYNC_LOGGING
+/**
+ * @ingroup logging
+ *
+ * Switches between writing the log messages directly and passing them to
+ * the writer thread.
+ * @param async Non zero to use the writer thread.
+ */
+void set_log_async(const int async);
+
+/**
+ * @ingroup logging
+ *
+ * Logs the same number of messages directly and with the writer thread
+ * and prints the time per call of both.
+ * @param text The number of messages or empty
+ * @param len The length of the text.
+ */
+int command_log_benchmark(char *text, int len);
+#endif	/* ASYNC_LOGGING */
+
 #define LOG_ERROR(msg, args ...) log_error(__FILE__, __LINE__, msg, ## args)
 #define LOG_WARNING(msg, args ...) log_warning(__FILE__, __LINE__, msg,	\
 	## args)
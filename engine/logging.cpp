@@ -6,6 +6,7 @@
  ****************************************************************************/
 
 #include "logging.hpp"
+#include <algorithm>
 #include <bitset>
 #include <sstream>
 #include <iostream>
@@ -33,7 +34,6 @@ namespace eternal_lands
 		{
 			public:
 				std::string m_name;
-				Uint64 m_log_file_pos;
 
 		};
 
@@ -41,11 +41,31 @@ namespace eternal_lands
 		{
 			public:
 				std::vector<DebugMark> m_debug_marks;
+				/**
+				 * File positions of the entered debug marks,
+				 * only used while holding the log mutex.
+				 */
+				std::vector<Uint64> m_log_file_pos;
 				std::string m_name;
 				std::string m_last_message;
 				Uint32 m_last_message_count;
 				Uint32 m_message_level;
 				int m_log_file;
+#ifdef	ASYNC_LOGGING
+				/**
+				 * Records written by the thread and read by
+				 * the writer thread. Only the thread itself
+				 * moves the head and only the holder of the
+				 * log mutex moves the tail.
+				 */
+				std::vector<char> m_ring;
+				volatile Uint32 m_ring_head;
+				volatile Uint32 m_ring_tail;
+				std::string m_message;
+				std::string m_record;
+				std::time_t m_time;
+				char m_time_str[32];
+#endif	/* ASYNC_LOGGING */
 
 		};
 
@@ -56,6 +76,42 @@ namespace eternal_lands
 		ThreadDatas thread_datas;
 		volatile LogLevelType log_levels = llt_info;
 
+		void enter_mark_position(ThreadData &thread_data)
+		{
+			thread_data.m_log_file_pos.push_back(lseek(
+				thread_data.m_log_file, 0, SEEK_CUR));
+		}
+
+		void leave_mark_position(ThreadData &thread_data,
+			const bool truncate)
+		{
+			Uint64 size, pos;
+
+			if (thread_data.m_log_file_pos.empty())
+			{
+				return;
+			}
+
+			size = *thread_data.m_log_file_pos.rbegin();
+
+			thread_data.m_log_file_pos.pop_back();
+
+			if (!truncate)
+			{
+				return;
+			}
+
+			pos = lseek(thread_data.m_log_file, 0, SEEK_CUR);
+			lseek(thread_data.m_log_file, size, SEEK_SET);
+
+			if ((pos + 1024) < size)
+			{
+				if (ftruncate(thread_data.m_log_file, size) < 0)
+					std::cerr << "Failed to truncate log file: "
+						<< strerror(errno) << std::endl;
+			}
+		}
+
 		std::string get_str(const LogLevelType log_level)
 		{
 			switch (log_level)
@@ -74,6 +130,504 @@ namespace eternal_lands
 			}
 		}
 
+#ifdef	ASYNC_LOGGING
+		enum RecordType
+		{
+			rt_message = 0,
+			rt_enter_mark = 1,
+			rt_leave_mark = 2,
+			rt_leave_mark_truncate = 3
+		};
+
+		struct RecordHeader
+		{
+			Uint32 m_size;
+			Uint32 m_type;
+		};
+
+		/**
+		 * Size of the ring of each thread, must be a power of two.
+		 */
+		const Uint32 ring_size = 64 * 1024;
+		const Uint32 max_threads = 64;
+		const Uint32 writer_interval = 50;
+
+		/**
+		 * Registered threads for the lookup without the log mutex.
+		 * The data pointer is set before the id and the slots are
+		 * never reused, so a reader that finds its id also sees the
+		 * data.
+		 */
+		struct ThreadSlot
+		{
+			volatile Uint32 m_id;
+			ThreadData* volatile m_data;
+		};
+
+		ThreadSlot thread_slots[max_threads];
+		volatile Uint32 thread_slot_count = 0;
+		volatile bool log_async = false;
+		volatile bool writer_done = false;
+		SDL_Thread* writer_thread = 0;
+		SDL_sem* writer_semaphore = 0;
+
+		inline void memory_barrier()
+		{
+			__sync_synchronize();
+		}
+
+		ThreadData* find_thread_data()
+		{
+			Uint32 i, count, id;
+
+			id = SDL_ThreadID();
+			count = thread_slot_count;
+			memory_barrier();
+
+			for (i = 0; i < count; i++)
+			{
+				if (thread_slots[i].m_id == id)
+				{
+					return thread_slots[i].m_data;
+				}
+			}
+
+			return 0;
+		}
+
+		void register_thread_data(const Uint32 id,
+			ThreadData &thread_data)
+		{
+			Uint32 count;
+
+			thread_data.m_ring.resize(ring_size);
+			thread_data.m_ring_head = 0;
+			thread_data.m_ring_tail = 0;
+			thread_data.m_time = 0;
+			thread_data.m_time_str[0] = 0;
+
+			count = thread_slot_count;
+
+			if (count >= max_threads)
+			{
+				return;
+			}
+
+			thread_slots[count].m_data = &thread_data;
+			thread_slots[count].m_id = id;
+			memory_barrier();
+			thread_slot_count = count + 1;
+		}
+
+		void write_batch(ThreadData &thread_data, std::string &batch)
+		{
+			ssize_t ret;
+
+			if (batch.empty())
+			{
+				return;
+			}
+
+			ret = write(thread_data.m_log_file, batch.c_str(),
+				batch.length());
+
+			if (ret != static_cast<ssize_t>(batch.length()))
+				std::cerr << "Failed to write the log file: "
+					<< batch; // newline included
+
+			batch.clear();
+		}
+
+		void apply_record(ThreadData &thread_data,
+			const RecordType type, std::string &batch)
+		{
+			switch (type)
+			{
+				case rt_message:
+					break;
+				case rt_enter_mark:
+					write_batch(thread_data, batch);
+					enter_mark_position(thread_data);
+					break;
+				case rt_leave_mark:
+				case rt_leave_mark_truncate:
+					write_batch(thread_data, batch);
+					leave_mark_position(thread_data,
+						type == rt_leave_mark_truncate);
+					break;
+			}
+		}
+
+		void read_ring(const ThreadData &thread_data, const Uint32 pos,
+			void* data, const Uint32 size)
+		{
+			Uint32 index, count;
+
+			index = pos & (ring_size - 1);
+			count = std::min(size, ring_size - index);
+
+			memcpy(data, &thread_data.m_ring[index], count);
+			memcpy(static_cast<char*>(data) + count,
+				&thread_data.m_ring[0], size - count);
+		}
+
+		void write_ring(ThreadData &thread_data, const Uint32 pos,
+			const void* data, const Uint32 size)
+		{
+			Uint32 index, count;
+
+			index = pos & (ring_size - 1);
+			count = std::min(size, ring_size - index);
+
+			memcpy(&thread_data.m_ring[index], data, count);
+			memcpy(&thread_data.m_ring[0],
+				static_cast<const char*>(data) + count,
+				size - count);
+		}
+
+		/**
+		 * Writes all records of the thread to its log file, the log
+		 * mutex must be locked. Messages between debug marks are
+		 * written with one call.
+		 */
+		void drain_records(ThreadData &thread_data, std::string &batch)
+		{
+			RecordHeader header;
+			Uint32 head, tail, size;
+
+			head = thread_data.m_ring_head;
+			tail = thread_data.m_ring_tail;
+
+			if (head == tail)
+			{
+				return;
+			}
+
+			memory_barrier();
+
+			while (tail != head)
+			{
+				read_ring(thread_data, tail, &header,
+					sizeof(header));
+				tail += sizeof(header);
+
+				size = batch.size();
+				batch.resize(size + header.m_size);
+
+				if (header.m_size > 0)
+				{
+					read_ring(thread_data, tail,
+						&batch[size], header.m_size);
+				}
+
+				tail += (header.m_size + 3) & ~3;
+
+				apply_record(thread_data,
+					static_cast<RecordType>(header.m_type),
+					batch);
+			}
+
+			write_batch(thread_data, batch);
+
+			memory_barrier();
+
+			thread_data.m_ring_tail = tail;
+		}
+
+		void drain_records(ThreadData &thread_data)
+		{
+			std::string batch;
+
+			drain_records(thread_data, batch);
+		}
+
+		void drain_all_records(std::string &batch)
+		{
+			ThreadDatas::iterator it, end;
+
+			end = thread_datas.end();
+
+			for (it = thread_datas.begin(); it != end; ++it)
+			{
+				drain_records(it->second, batch);
+			}
+		}
+
+		int writer_thread_main(void* data)
+		{
+			std::string batch;
+
+			while (!writer_done)
+			{
+				SDL_SemWaitTimeout(writer_semaphore,
+					writer_interval);
+
+				SDL_LockMutex(log_mutex);
+
+				drain_all_records(batch);
+
+				SDL_UnlockMutex(log_mutex);
+			}
+
+			return 0;
+		}
+
+		/**
+		 * Adds a record to the ring of the thread. If the ring is
+		 * full, the thread writes its records itself.
+		 */
+		void push_record(ThreadData &thread_data, const RecordType type,
+			const std::string &text)
+		{
+			RecordHeader header;
+			Uint32 head, used, size;
+
+			header.m_size = text.length();
+			header.m_type = type;
+
+			size = sizeof(header) + ((header.m_size + 3) & ~3);
+
+			head = thread_data.m_ring_head;
+			used = head - thread_data.m_ring_tail;
+
+			if ((used + size) > ring_size)
+			{
+				std::string batch;
+
+				SDL_LockMutex(log_mutex);
+
+				drain_records(thread_data, batch);
+
+				batch = text;
+				apply_record(thread_data, type, batch);
+				write_batch(thread_data, batch);
+
+				SDL_UnlockMutex(log_mutex);
+
+				return;
+			}
+
+			write_ring(thread_data, head, &header, sizeof(header));
+
+			if (header.m_size > 0)
+			{
+				write_ring(thread_data, head + sizeof(header),
+					text.c_str(), header.m_size);
+			}
+
+			memory_barrier();
+
+			thread_data.m_ring_head = head + size;
+
+			if (((used + size) * 2) > ring_size)
+			{
+				SDL_SemPost(writer_semaphore);
+			}
+		}
+
+		void append_number(std::string &str, const Uint32 value)
+		{
+			char buffer[16];
+
+			snprintf(buffer, sizeof(buffer), "%u", value);
+
+			str += buffer;
+		}
+
+		/**
+		 * Same output as log_message, but formatted into buffers of
+		 * the thread that keep their memory and with the time string
+		 * only updated once per second.
+		 */
+		void push_message(const std::string &type,
+			const std::string &message,
+			const std::string &file, const Uint32 line,
+			ThreadData &thread)
+		{
+			std::time_t raw_time;
+			std::tm local_time;
+
+			if (thread.m_log_file == -1)
+			{
+				return;
+			}
+
+			std::time(&raw_time);
+
+			if (raw_time != thread.m_time)
+			{
+				// called by all threads without the log mutex,
+				// so the static buffer of localtime() can't be
+				// used
+#ifdef	WINDOWS
+				localtime_s(&local_time, &raw_time);
+#else	/* WINDOWS */
+				localtime_r(&raw_time, &local_time);
+#endif	/* WINDOWS */
+				thread.m_time = raw_time;
+				memset(thread.m_time_str, 0,
+					sizeof(thread.m_time_str));
+				std::strftime(thread.m_time_str,
+					sizeof(thread.m_time_str), "%X",
+					&local_time);
+			}
+
+			thread.m_message = ", ";
+			thread.m_message += file;
+			thread.m_message += ":";
+			append_number(thread.m_message, line);
+			thread.m_message += "] ";
+			thread.m_message += type;
+			thread.m_message += ": ";
+			thread.m_message += message;
+
+			if (thread.m_message == thread.m_last_message)
+			{
+				thread.m_last_message_count++;
+				return;
+			}
+
+			thread.m_record.clear();
+
+			if (thread.m_last_message_count > 0)
+			{
+				thread.m_record += "[";
+				thread.m_record += thread.m_time_str;
+
+				if (log_levels >= llt_debug_verbose)
+				{
+					thread.m_record += ", " __FILE__ ":";
+					append_number(thread.m_record,
+						__LINE__);
+				}
+
+				thread.m_record += "] Last message repeated ";
+				append_number(thread.m_record,
+					thread.m_last_message_count);
+				thread.m_record += " time";
+
+				if (thread.m_last_message_count > 1)
+				{
+					thread.m_record += "s";
+				}
+
+				thread.m_record += "\n";
+			}
+
+			thread.m_record += "[";
+			thread.m_record += thread.m_time_str;
+			thread.m_record += thread.m_message;
+
+			if (message.empty() || (*message.rbegin() != '\n'))
+			{
+				thread.m_record += "\n";
+			}
+
+			thread.m_last_message = thread.m_message;
+			thread.m_last_message_count = 0;
+
+			push_record(thread, rt_message, thread.m_record);
+		}
+
+		void push_log_message(const LogLevelType log_level,
+			const std::string &message, const std::string &file,
+			const Uint32 line, ThreadData &thread_data)
+		{
+			Uint32 level;
+
+			push_message(get_str(log_level), message, file,
+				line, thread_data);
+
+			if (log_level < llt_debug)
+			{
+				level = thread_data.m_debug_marks.size();
+				thread_data.m_message_level = std::max(level,
+					thread_data.m_message_level);
+			}
+		}
+
+		void push_enter_debug_mark(const std::string &name,
+			const std::string &file, const Uint32 line,
+			ThreadData &thread_data)
+		{
+			DebugMark debug_mark;
+
+			debug_mark.m_name = name;
+
+			thread_data.m_debug_marks.push_back(debug_mark);
+
+			push_record(thread_data, rt_enter_mark, std::string());
+
+			push_log_message(llt_debug, "Enter debug mark '" +
+				name + "'", file, line, thread_data);
+		}
+
+		void push_leave_debug_mark(const std::string &name,
+			const std::string &file, const Uint32 line,
+			ThreadData &thread_data)
+		{
+			RecordType type;
+			Uint32 level;
+
+			if (thread_data.m_debug_marks.rbegin() ==
+				thread_data.m_debug_marks.rend())
+			{
+				if (log_levels >= llt_debug)
+				{
+					push_log_message(llt_error,
+						"Can't leave debug mark '" +
+						name + "', because no debug "
+						"mark entered.", file, line,
+						thread_data);
+				}
+
+				return;
+			}
+
+			if (thread_data.m_debug_marks.rbegin()->m_name != name)
+			{
+				push_log_message(llt_error,
+					"Can't leave debug mark '" + name +
+					"', because current debug mark is '" +
+					thread_data.m_debug_marks.rbegin(
+						)->m_name + "'.", file, line,
+					thread_data);
+
+				thread_data.m_debug_marks.pop_back();
+
+				push_record(thread_data, rt_leave_mark,
+					std::string());
+
+				return;
+			}
+
+			type = rt_leave_mark;
+
+			if (log_levels < llt_debug_verbose)
+			{
+				if (thread_data.m_message_level <
+					thread_data.m_debug_marks.size())
+				{
+					type = rt_leave_mark_truncate;
+				}
+			}
+			else
+			{
+				push_log_message(llt_debug_verbose,
+					"Leave debug mark '" + name + "'",
+					file, line, thread_data);
+			}
+
+			push_record(thread_data, type, std::string());
+
+			thread_data.m_debug_marks.pop_back();
+
+			level = thread_data.m_debug_marks.size();
+			thread_data.m_message_level = std::min(level,
+				thread_data.m_message_level);
+		}
+#endif	/* ASYNC_LOGGING */
+
 		void log_message(const std::string &type,
 			const std::string &message, const std::string &file,
 			const Uint32 line, ThreadData &thread)
@@ -174,8 +728,8 @@ namespace eternal_lands
 			std::stringstream str;
 
 			debug_mark.m_name = name;
-			debug_mark.m_log_file_pos = lseek(
-				thread_data.m_log_file, 0, SEEK_CUR);
+
+			enter_mark_position(thread_data);
 
 			thread_data.m_debug_marks.push_back(debug_mark);
 
@@ -190,7 +744,6 @@ namespace eternal_lands
 			ThreadData &thread_data)
 		{
 			std::stringstream str;
-			Uint64 size, pos;
 			Uint32 level;
 
 			if (thread_data.m_debug_marks.rbegin() ==
@@ -221,32 +774,16 @@ namespace eternal_lands
 					line, thread_data);
 
 				thread_data.m_debug_marks.pop_back();
+				leave_mark_position(thread_data, false);
 
 				return;
 			}
 
 			if (log_levels < llt_debug_verbose)
 			{
-				size = thread_data.m_debug_marks.rbegin(
-					)->m_log_file_pos;
-
-				if (thread_data.m_message_level <
-					thread_data.m_debug_marks.size())
-				{
-					pos = lseek(thread_data.m_log_file, 0,
-						SEEK_CUR);
-					lseek(thread_data.m_log_file, size,
-						SEEK_SET);
-
-					if ((pos + 1024) < size)
-					{
-						if (ftruncate(
-							thread_data.m_log_file,
-							size) < 0)
-						std::cerr << "Failed to truncate log file: "
-							<< strerror(errno) << std::endl;
-					}
-				}
+				leave_mark_position(thread_data,
+					thread_data.m_message_level <
+					thread_data.m_debug_marks.size());
 			}
 			else
 			{
@@ -254,6 +791,8 @@ namespace eternal_lands
 
 				do_log_message(llt_debug_verbose, str.str(),
 					file, line, thread_data);
+
+				leave_mark_position(thread_data, false);
 			}
 
 			thread_data.m_debug_marks.pop_back();
@@ -305,6 +844,9 @@ namespace eternal_lands
 			thread_datas[id].m_message_level = 0;
 			thread_datas[id].m_log_file = open(file_name.str(
 				).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#ifdef	ASYNC_LOGGING
+			register_thread_data(id, thread_datas[id]);
+#endif	/* ASYNC_LOGGING */
 
 			log_message("Log started at", get_local_time_string(),
 				__FILE__, __LINE__, thread_datas[id]);
@@ -358,6 +900,12 @@ namespace eternal_lands
 #endif	/* WINDOWS */
 
 		init_thread_log("main");
+
+#ifdef	ASYNC_LOGGING
+		writer_done = false;
+		writer_semaphore = SDL_CreateSemaphore(0);
+		writer_thread = SDL_CreateThread(writer_thread_main, 0);
+#endif	/* ASYNC_LOGGING */
 	}
 
 	void exit_logging()
@@ -365,6 +913,20 @@ namespace eternal_lands
 		ThreadDatas::iterator it, end;
 		Uint64 pos;
 
+#ifdef	ASYNC_LOGGING
+		log_async = false;
+		writer_done = true;
+
+		SDL_SemPost(writer_semaphore);
+		SDL_WaitThread(writer_thread, 0);
+		SDL_DestroySemaphore(writer_semaphore);
+
+		writer_thread = 0;
+		writer_semaphore = 0;
+
+		flush_logging();
+#endif	/* ASYNC_LOGGING */
+
 		end = thread_datas.end();
 
 		for (it = thread_datas.begin(); it != end; ++it)
@@ -391,6 +953,29 @@ namespace eternal_lands
 		log_levels = log_level;
 	}
 
+#ifdef	ASYNC_LOGGING
+	bool get_log_async()
+	{
+		return log_async;
+	}
+
+	void set_log_async(const bool async)
+	{
+		log_async = async;
+	}
+
+	void flush_logging()
+	{
+		std::string batch;
+
+		SDL_LockMutex(log_mutex);
+
+		drain_all_records(batch);
+
+		SDL_UnlockMutex(log_mutex);
+	}
+#endif	/* ASYNC_LOGGING */
+
 	void init_thread_log(const std::string &name)
 	{
 		SDL_LockMutex(log_mutex);
@@ -411,12 +996,30 @@ namespace eternal_lands
 			return;
 		}
 
+#ifdef	ASYNC_LOGGING
+		if (log_async)
+		{
+			ThreadData* thread_data = find_thread_data();
+
+			if (thread_data != 0)
+			{
+				push_log_message(log_level, message, file,
+					line, *thread_data);
+
+				return;
+			}
+		}
+#endif	/* ASYNC_LOGGING */
+
 		SDL_LockMutex(log_mutex);
 
 		found = thread_datas.find(SDL_ThreadID());
 
 		if (found != thread_datas.end())
 		{
+#ifdef	ASYNC_LOGGING
+			drain_records(found->second);
+#endif	/* ASYNC_LOGGING */
 			do_log_message(log_level, message, file, line,
 				found->second);
 		}
@@ -434,12 +1037,30 @@ namespace eternal_lands
 			return;
 		}
 
+#ifdef	ASYNC_LOGGING
+		if (log_async)
+		{
+			ThreadData* thread_data = find_thread_data();
+
+			if (thread_data != 0)
+			{
+				push_enter_debug_mark(name, file, line,
+					*thread_data);
+
+				return;
+			}
+		}
+#endif	/* ASYNC_LOGGING */
+
 		SDL_LockMutex(log_mutex);
 
 		found = thread_datas.find(SDL_ThreadID());
 
 		if (found != thread_datas.end())
 		{
+#ifdef	ASYNC_LOGGING
+			drain_records(found->second);
+#endif	/* ASYNC_LOGGING */
 			do_enter_debug_mark(name, file, line, found->second);
 		}
 
@@ -456,12 +1077,30 @@ namespace eternal_lands
 			return;
 		}
 
+#ifdef	ASYNC_LOGGING
+		if (log_async)
+		{
+			ThreadData* thread_data = find_thread_data();
+
+			if (thread_data != 0)
+			{
+				push_leave_debug_mark(name, file, line,
+					*thread_data);
+
+				return;
+			}
+		}
+#endif	/* ASYNC_LOGGING */
+
 		SDL_LockMutex(log_mutex);
 
 		found = thread_datas.find(SDL_ThreadID());
 
 		if (found != thread_datas.end())
 		{
+#ifdef	ASYNC_LOGGING
+			drain_records(found->second);
+#endif	/* ASYNC_LOGGING */
 			do_leave_debug_mark(name, file, line, found->second);
 		}
 
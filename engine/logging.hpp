@@ -34,6 +34,21 @@ namespace eternal_lands
 	void exit_logging();
 	LogLevelType get_log_level();
 	void set_log_level(const LogLevelType log_level);
+#ifdef	ASYNC_LOGGING
+	/**
+	 * Returns true if the messages are written by the writer thread.
+	 */
+	bool get_log_async();
+	/**
+	 * Switches between writing the messages directly and adding
+	 * them to a ring of each thread that the writer thread empties.
+	 */
+	void set_log_async(const bool async);
+	/**
+	 * Writes all messages that are still in the rings.
+	 */
+	void flush_logging();
+#endif	/* ASYNC_LOGGING */
 	void log_message(const LogLevelType log_level,
 		const std::string &message, const std::string &file,
 		const Uint32 line);
@@ -0,0 +1,513 @@
+/****************************************************************************
+ *            occlusionbuffer.cpp
+ *
+ * Copyright: See COPYING file that comes with this distribution
+ ****************************************************************************/
+
+#include "occlusionbuffer.hpp"
+#include <algorithm>
+#include <cmath>
+#ifdef	USE_SIMD
+#include <xmmintrin.h>
+#endif	/* USE_SIMD */
+
+namespace eternal_lands
+{
+
+	namespace
+	{
+
+		/**
+		 * Corners of the box faces, bit 0 is x, bit 1 is y and
+		 * bit 2 is z of the max corner.
+		 */
+		const Uint32 box_faces[6][4] =
+		{
+			{ 0, 2, 6, 4 },
+			{ 1, 5, 7, 3 },
+			{ 0, 4, 5, 1 },
+			{ 2, 3, 7, 6 },
+			{ 0, 1, 3, 2 },
+			{ 4, 6, 7, 5 }
+		};
+
+		const float min_w = 1e-4f;
+
+	}
+
+	OcclusionBuffer::OcclusionBuffer(const Uint32 width,
+		const Uint32 height): m_use_simd(false)
+	{
+		Uint32 i;
+
+		m_tiles_x = std::max((width + tile_size - 1) / tile_size, 1u);
+		m_tiles_y = std::max((height + tile_size - 1) / tile_size, 1u);
+		m_width = m_tiles_x * tile_size;
+		m_height = m_tiles_y * tile_size;
+
+		m_depth.resize(m_width * m_height);
+		m_tile_max.resize(m_tiles_x * m_tiles_y);
+
+		for (i = 0; i < 16; i++)
+		{
+			m_matrix[i] = ((i % 5) == 0) ? 1.0f : 0.0f;
+		}
+
+		clear();
+	}
+
+	OcclusionBuffer::~OcclusionBuffer() throw()
+	{
+	}
+
+	void OcclusionBuffer::clear()
+	{
+		std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+		std::fill(m_tile_max.begin(), m_tile_max.end(), 1.0f);
+		m_triangles.clear();
+	}
+
+	void OcclusionBuffer::set_view_projection_matrix(const float* matrix)
+	{
+		std::copy(matrix, matrix + 16, m_matrix);
+	}
+
+	bool OcclusionBuffer::project(const float* point, float* result) const
+	{
+		float clip[4];
+		Uint32 i;
+
+		for (i = 0; i < 4; i++)
+		{
+			clip[i] = m_matrix[i] * point[0] +
+				m_matrix[4 + i] * point[1] +
+				m_matrix[8 + i] * point[2] + m_matrix[12 + i];
+		}
+
+		if (clip[3] <= min_w)
+		{
+			return false;
+		}
+
+		result[0] = (clip[0] / clip[3] * 0.5f + 0.5f) * m_width;
+		result[1] = (clip[1] / clip[3] * 0.5f + 0.5f) * m_height;
+		result[2] = clip[2] / clip[3] * 0.5f + 0.5f;
+
+		return true;
+	}
+
+	bool OcclusionBuffer::project_box(const float* min, const float* max,
+		float corners[8][3]) const
+	{
+		float point[3];
+		Uint32 i;
+
+		for (i = 0; i < 8; i++)
+		{
+			point[0] = (i & 1) ? max[0] : min[0];
+			point[1] = (i & 2) ? max[1] : min[1];
+			point[2] = (i & 4) ? max[2] : min[2];
+
+			if (!project(point, corners[i]))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void OcclusionBuffer::add_occluder(const float* min, const float* max)
+	{
+		float corners[8][3];
+		Triangle triangle;
+		Uint32 i, j, k;
+		const Uint32 indices[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+
+		if (!project_box(min, max, corners))
+		{
+			return;
+		}
+
+		for (i = 0; i < 6; i++)
+		{
+			for (j = 0; j < 2; j++)
+			{
+				for (k = 0; k < 3; k++)
+				{
+					const float* corner;
+
+					corner = corners[box_faces[i][indices[j][k]]];
+					triangle.x[k] = corner[0];
+					triangle.y[k] = corner[1];
+					triangle.z[k] = corner[2];
+				}
+
+				m_triangles.push_back(triangle);
+			}
+		}
+	}
+
+	void OcclusionBuffer::rasterize_triangle(const Triangle &triangle,
+		const Uint32 min_row, const Uint32 max_row)
+	{
+		float x[3], y[3], z[3], a[3], b[3], c[3];
+		float area, dzdx, dzdy, px, py, depth;
+		Sint32 min_x, max_x, min_y, max_y, i, j;
+		Uint32 k;
+
+		std::copy(triangle.x, triangle.x + 3, x);
+		std::copy(triangle.y, triangle.y + 3, y);
+		std::copy(triangle.z, triangle.z + 3, z);
+
+		area = (x[1] - x[0]) * (y[2] - y[0]) -
+			(x[2] - x[0]) * (y[1] - y[0]);
+
+		if (std::abs(area) < 1e-6f)
+		{
+			return;
+		}
+
+		if (area < 0.0f)
+		{
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		min_x = std::max(static_cast<Sint32>(std::floor(std::min(x[0],
+			std::min(x[1], x[2])))), 0);
+		max_x = std::min(static_cast<Sint32>(std::ceil(std::max(x[0],
+			std::max(x[1], x[2])))), static_cast<Sint32>(m_width));
+		min_y = std::max(static_cast<Sint32>(std::floor(std::min(y[0],
+			std::min(y[1], y[2])))), static_cast<Sint32>(min_row));
+		max_y = std::min(static_cast<Sint32>(std::ceil(std::max(y[0],
+			std::max(y[1], y[2])))), static_cast<Sint32>(max_row));
+
+		if ((min_x >= max_x) || (min_y >= max_y))
+		{
+			return;
+		}
+
+		for (k = 0; k < 3; k++)
+		{
+			a[k] = y[k] - y[(k + 1) % 3];
+			b[k] = x[(k + 1) % 3] - x[k];
+			c[k] = -a[k] * x[k] - b[k] * y[k];
+		}
+
+		dzdx = ((z[1] - z[0]) * (y[2] - y[0]) -
+			(z[2] - z[0]) * (y[1] - y[0])) / area;
+		dzdy = ((z[2] - z[0]) * (x[1] - x[0]) -
+			(z[1] - z[0]) * (x[2] - x[0])) / area;
+
+		for (j = min_y; j < max_y; j++)
+		{
+			py = j + 0.5f;
+
+			for (i = min_x; i < max_x; i++)
+			{
+				px = i + 0.5f;
+
+				if (((a[0] * px + b[0] * py + c[0]) < 0.0f) ||
+					((a[1] * px + b[1] * py + c[1]) < 0.0f) ||
+					((a[2] * px + b[2] * py + c[2]) < 0.0f))
+				{
+					continue;
+				}
+
+				depth = z[0] + dzdx * (px - x[0]) +
+					dzdy * (py - y[0]);
+
+				if (depth < m_depth[j * m_width + i])
+				{
+					m_depth[j * m_width + i] = depth;
+				}
+			}
+		}
+	}
+
+#ifdef	USE_SIMD
+	void OcclusionBuffer::rasterize_triangle_sse(const Triangle &triangle,
+		const Uint32 min_row, const Uint32 max_row)
+	{
+		__m128 a[3], row[3], edge[3], step, offset, zero;
+		__m128 px, mask, depth, old_depth, dx, z;
+		float x[3], y[3], zs[3], ea[3], eb[3], ec[3];
+		float area, dzdx, dzdy;
+		Sint32 min_x, max_x, min_y, max_y, i, j;
+		Uint32 k;
+
+		std::copy(triangle.x, triangle.x + 3, x);
+		std::copy(triangle.y, triangle.y + 3, y);
+		std::copy(triangle.z, triangle.z + 3, zs);
+
+		area = (x[1] - x[0]) * (y[2] - y[0]) -
+			(x[2] - x[0]) * (y[1] - y[0]);
+
+		if (std::abs(area) < 1e-6f)
+		{
+			return;
+		}
+
+		if (area < 0.0f)
+		{
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(zs[1], zs[2]);
+			area = -area;
+		}
+
+		min_x = std::max(static_cast<Sint32>(std::floor(std::min(x[0],
+			std::min(x[1], x[2])))), 0);
+		max_x = std::min(static_cast<Sint32>(std::ceil(std::max(x[0],
+			std::max(x[1], x[2])))), static_cast<Sint32>(m_width));
+		min_y = std::max(static_cast<Sint32>(std::floor(std::min(y[0],
+			std::min(y[1], y[2])))), static_cast<Sint32>(min_row));
+		max_y = std::min(static_cast<Sint32>(std::ceil(std::max(y[0],
+			std::max(y[1], y[2])))), static_cast<Sint32>(max_row));
+
+		if ((min_x >= max_x) || (min_y >= max_y))
+		{
+			return;
+		}
+
+		/* The width is a multiple of the tile size, so four pixels
+		 * starting at an aligned x are always inside the row. */
+		min_x &= ~3;
+
+		dzdx = ((zs[1] - zs[0]) * (y[2] - y[0]) -
+			(zs[2] - zs[0]) * (y[1] - y[0])) / area;
+		dzdy = ((zs[2] - zs[0]) * (x[1] - x[0]) -
+			(zs[1] - zs[0]) * (x[2] - x[0])) / area;
+
+		offset = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		step = _mm_set1_ps(4.0f);
+		zero = _mm_setzero_ps();
+		dx = _mm_set1_ps(dzdx);
+
+		for (k = 0; k < 3; k++)
+		{
+			ea[k] = y[k] - y[(k + 1) % 3];
+			eb[k] = x[(k + 1) % 3] - x[k];
+			ec[k] = -ea[k] * x[k] - eb[k] * y[k];
+			a[k] = _mm_set1_ps(ea[k]);
+		}
+
+		for (j = min_y; j < max_y; j++)
+		{
+			px = _mm_add_ps(_mm_set1_ps(min_x), offset);
+
+			for (k = 0; k < 3; k++)
+			{
+				row[k] = _mm_set1_ps(eb[k] * (j + 0.5f) + ec[k]);
+			}
+
+			z = _mm_set1_ps(zs[0] + dzdy * (j + 0.5f - y[0]) -
+				dzdx * x[0]);
+
+			for (i = min_x; i < max_x; i += 4)
+			{
+				for (k = 0; k < 3; k++)
+				{
+					edge[k] = _mm_add_ps(_mm_mul_ps(a[k], px),
+						row[k]);
+				}
+
+				mask = _mm_and_ps(_mm_cmpge_ps(edge[0], zero),
+					_mm_and_ps(_mm_cmpge_ps(edge[1], zero),
+					_mm_cmpge_ps(edge[2], zero)));
+
+				if (_mm_movemask_ps(mask) != 0)
+				{
+					depth = _mm_add_ps(_mm_mul_ps(dx, px), z);
+					old_depth = _mm_loadu_ps(
+						&m_depth[j * m_width + i]);
+					depth = _mm_min_ps(depth, old_depth);
+					depth = _mm_or_ps(_mm_and_ps(mask, depth),
+						_mm_andnot_ps(mask, old_depth));
+					_mm_storeu_ps(&m_depth[j * m_width + i],
+						depth);
+				}
+
+				px = _mm_add_ps(px, step);
+			}
+		}
+	}
+#endif	/* USE_SIMD */
+
+	void OcclusionBuffer::update_tiles(const Uint32 min_row,
+		const Uint32 max_row)
+	{
+		float value;
+		Uint32 x, y, tile_x, tile_y;
+
+		for (tile_y = min_row / tile_size; tile_y < max_row / tile_size;
+			tile_y++)
+		{
+			for (tile_x = 0; tile_x < m_tiles_x; tile_x++)
+			{
+				value = 0.0f;
+
+				for (y = 0; y < tile_size; y++)
+				{
+					for (x = 0; x < tile_size; x++)
+					{
+						value = std::max(value, m_depth[
+							(tile_y * tile_size + y) *
+							m_width + tile_x * tile_size +
+							x]);
+					}
+				}
+
+				m_tile_max[tile_y * m_tiles_x + tile_x] = value;
+			}
+		}
+	}
+
+	void OcclusionBuffer::rasterize(const Uint32 band,
+		const Uint32 band_count)
+	{
+		Uint32 rows, first, last, i;
+
+		rows = (m_tiles_y + band_count - 1) / band_count;
+		first = band * rows;
+		last = std::min(first + rows, m_tiles_y);
+
+		if (first >= last)
+		{
+			return;
+		}
+
+		first *= tile_size;
+		last *= tile_size;
+
+		for (i = 0; i < m_triangles.size(); i++)
+		{
+#ifdef	USE_SIMD
+			if (m_use_simd)
+			{
+				rasterize_triangle_sse(m_triangles[i], first,
+					last);
+				continue;
+			}
+#endif	/* USE_SIMD */
+			rasterize_triangle(m_triangles[i], first, last);
+		}
+
+		update_tiles(first, last);
+	}
+
+	float OcclusionBuffer::get_screen_area(const float* min,
+		const float* max) const
+	{
+		float corners[8][3];
+		float min_x, max_x, min_y, max_y;
+		Uint32 i;
+
+		if (!project_box(min, max, corners))
+		{
+			return 0.0f;
+		}
+
+		min_x = max_x = corners[0][0];
+		min_y = max_y = corners[0][1];
+
+		for (i = 1; i < 8; i++)
+		{
+			min_x = std::min(min_x, corners[i][0]);
+			max_x = std::max(max_x, corners[i][0]);
+			min_y = std::min(min_y, corners[i][1]);
+			max_y = std::max(max_y, corners[i][1]);
+		}
+
+		min_x = std::max(min_x, 0.0f);
+		max_x = std::min(max_x, static_cast<float>(m_width));
+		min_y = std::max(min_y, 0.0f);
+		max_y = std::min(max_y, static_cast<float>(m_height));
+
+		if ((min_x >= max_x) || (min_y >= max_y))
+		{
+			return 0.0f;
+		}
+
+		return (max_x - min_x) * (max_y - min_y);
+	}
+
+	bool OcclusionBuffer::is_visible(const float* min, const float* max)
+		const
+	{
+		float corners[8][3];
+		float min_x, max_x, min_y, max_y, min_z;
+		Sint32 x0, x1, y0, y1, tile_x, tile_y, x, y;
+		Uint32 i;
+
+		if (!project_box(min, max, corners))
+		{
+			return true;
+		}
+
+		min_x = max_x = corners[0][0];
+		min_y = max_y = corners[0][1];
+		min_z = corners[0][2];
+
+		for (i = 1; i < 8; i++)
+		{
+			min_x = std::min(min_x, corners[i][0]);
+			max_x = std::max(max_x, corners[i][0]);
+			min_y = std::min(min_y, corners[i][1]);
+			max_y = std::max(max_y, corners[i][1]);
+			min_z = std::min(min_z, corners[i][2]);
+		}
+
+		x0 = std::max(static_cast<Sint32>(std::floor(min_x)), 0);
+		x1 = std::min(static_cast<Sint32>(std::ceil(max_x)),
+			static_cast<Sint32>(m_width));
+		y0 = std::max(static_cast<Sint32>(std::floor(min_y)), 0);
+		y1 = std::min(static_cast<Sint32>(std::ceil(max_y)),
+			static_cast<Sint32>(m_height));
+
+		/* Outside of the screen is the job of the frustum culling. */
+		if ((x0 >= x1) || (y0 >= y1))
+		{
+			return true;
+		}
+
+		for (tile_y = y0 / tile_size; tile_y <= (y1 - 1) /
+			static_cast<Sint32>(tile_size); tile_y++)
+		{
+			for (tile_x = x0 / tile_size; tile_x <= (x1 - 1) /
+				static_cast<Sint32>(tile_size); tile_x++)
+			{
+				if (min_z > m_tile_max[tile_y * m_tiles_x +
+					tile_x])
+				{
+					continue;
+				}
+
+				for (y = std::max(y0, tile_y *
+					static_cast<Sint32>(tile_size));
+					y < std::min(y1, (tile_y + 1) *
+					static_cast<Sint32>(tile_size)); y++)
+				{
+					for (x = std::max(x0, tile_x *
+						static_cast<Sint32>(tile_size));
+						x < std::min(x1, (tile_x + 1) *
+						static_cast<Sint32>(tile_size));
+						x++)
+					{
+						if (min_z <= m_depth[y * m_width +
+							x])
+						{
+							return true;
+						}
+					}
+				}
+			}
+		}
+
+		return false;
+	}
+
+}
@@ -0,0 +1,221 @@
+/****************************************************************************
+ *            occlusionbuffer.hpp
+ *
+ * Copyright: See COPYING file that comes with this distribution
+ ****************************************************************************/
+
+#ifndef	UUID_5c1e7d0a_93b4_4f6e_a2d8_0e6b1f47c3a9
+#define	UUID_5c1e7d0a_93b4_4f6e_a2d8_0e6b1f47c3a9
+
+#ifndef	__cplusplus
+#error	"Including C++ header in C translation unit!"
+#endif	/* __cplusplus */
+
+#include "../platform.h"
+#include <vector>
+
+/**
+ * @file
+ * @brief The @c class OcclusionBuffer.
+ * This file contains the @c class OcclusionBuffer.
+ */
+namespace eternal_lands
+{
+
+	/**
+	 * @brief @c class for software occlusion culling.
+	 *
+	 * A coarse depth buffer the triangles of a few large occluder
+	 * boxes are rasterized to on the cpu. Bounding boxes can then be
+	 * tested against it, first against the maximum depth of each tile,
+	 * then against the pixels. Rasterization can be split into bands of
+	 * tile rows, so every thread works on its own part of the buffer.
+	 * All matrices are in OpenGL order (column major) and all boxes
+	 * are given as min and max vectors.
+	 */
+	class OcclusionBuffer
+	{
+		private:
+			/**
+			 * A triangle in screen space.
+			 */
+			struct Triangle
+			{
+				float x[3];
+				float y[3];
+				float z[3];
+			};
+
+			/**
+			 * The depth buffer, one float per pixel.
+			 */
+			std::vector<float> m_depth;
+
+			/**
+			 * The maximum depth of each tile.
+			 */
+			std::vector<float> m_tile_max;
+
+			/**
+			 * The triangles of all occluders added since the last
+			 * clear.
+			 */
+			std::vector<Triangle> m_triangles;
+
+			/**
+			 * The view projection matrix.
+			 */
+			float m_matrix[16];
+
+			Uint32 m_width, m_height;
+			Uint32 m_tiles_x, m_tiles_y;
+			bool m_use_simd;
+
+			/**
+			 * Transforms the point to screen space.
+			 * @param point The point to transform.
+			 * @param result The x, y and depth value of the point.
+			 * @return Returns false if the point is behind the
+			 * camera, else true.
+			 */
+			bool project(const float* point, float* result) const;
+
+			/**
+			 * Projects the corners of a box.
+			 * @param min The minimum of the box.
+			 * @param max The maximum of the box.
+			 * @param corners The projected corners.
+			 * @return Returns false if one of the corners is
+			 * behind the camera, else true.
+			 */
+			bool project_box(const float* min, const float* max,
+				float corners[8][3]) const;
+
+			void rasterize_triangle(const Triangle &triangle,
+				const Uint32 min_row, const Uint32 max_row);
+
+#ifdef	USE_SIMD
+			void rasterize_triangle_sse(const Triangle &triangle,
+				const Uint32 min_row, const Uint32 max_row);
+#endif	/* USE_SIMD */
+
+			void update_tiles(const Uint32 min_row,
+				const Uint32 max_row);
+
+		public:
+			/**
+			 * The size of the tiles in pixel.
+			 */
+			static const Uint32 tile_size = 8;
+
+			/**
+			 * Default constructor.
+			 * @param width The width of the buffer, rounded up to
+			 * a multiple of the tile size.
+			 * @param height The height of the buffer, rounded up
+			 * to a multiple of the tile size.
+			 */
+			OcclusionBuffer(const Uint32 width, const Uint32 height);
+
+			/**
+			 * Default destructor.
+			 */
+			~OcclusionBuffer() throw();
+
+			/**
+			 * Clears the depth buffer and removes all occluders.
+			 */
+			void clear();
+
+			/**
+			 * Sets the view projection matrix used for the
+			 * occluders and the visibility tests.
+			 * @param matrix The view projection matrix.
+			 */
+			void set_view_projection_matrix(const float* matrix);
+
+			/**
+			 * Adds the triangles of the box as occluder. Boxes
+			 * crossing the near plane are ignored.
+			 * @param min The minimum of the box.
+			 * @param max The maximum of the box.
+			 */
+			void add_occluder(const float* min, const float* max);
+
+			/**
+			 * Rasterizes the occluders into one band of tile rows.
+			 * Different bands can be rasterized in parallel.
+			 * @param band The band to rasterize.
+			 * @param band_count The number of bands.
+			 */
+			void rasterize(const Uint32 band, const Uint32 band_count);
+
+			/**
+			 * Rasterizes the occluders into the whole buffer.
+			 */
+			inline void rasterize()
+			{
+				rasterize(0, 1);
+			}
+
+			/**
+			 * Tests if the box could be visible.
+			 * @param min The minimum of the box.
+			 * @param max The maximum of the box.
+			 * @return Returns false if the box is completely
+			 * hidden by the occluders, else true.
+			 */
+			bool is_visible(const float* min, const float* max) const;
+
+			/**
+			 * Calculates the screen area the box covers.
+			 * @param min The minimum of the box.
+			 * @param max The maximum of the box.
+			 * @return The area of the screen rectangle of the box
+			 * in pixel or zero if the box crosses the near plane.
+			 */
+			float get_screen_area(const float* min, const float* max)
+				const;
+
+			/**
+			 * Enables or disables the use of sse for
+			 * rasterization. Has no effect without USE_SIMD.
+			 * @param use_simd True to use sse.
+			 */
+			inline void set_use_simd(const bool use_simd)
+			{
+				m_use_simd = use_simd;
+			}
+
+			inline Uint32 get_width() const
+			{
+				return m_width;
+			}
+
+			inline Uint32 get_height() const
+			{
+				return m_height;
+			}
+
+			inline Uint32 get_triangle_count() const
+			{
+				return m_triangles.size();
+			}
+
+			inline float get_depth(const Uint32 x, const Uint32 y)
+				const
+			{
+				return m_depth[y * m_width + x];
+			}
+
+			inline float get_tile_max(const Uint32 x,
+				const Uint32 y) const
+			{
+				return m_tile_max[y * m_tiles_x + x];
+			}
+
+	};
+
+}
+
+#endif	/* UUID_5c1e7d0a_93b4_4f6e_a2d8_0e6b1f47c3a9 */
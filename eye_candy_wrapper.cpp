@@ -16,6 +16,9 @@
 #include "skeletons.h"
 #include "tiles.h"
 #include "weather.h"
+#ifdef	EC_REFERENCE_SLOTS
+#include <algorithm>
+#endif	/* EC_REFERENCE_SLOTS */
 // G L O B A L S //////////////////////////////////////////////////////////////
 
 #ifdef MAP_EDITOR
@@ -44,6 +47,26 @@ Uint64 ec_cur_time, ec_last_time;
 std::vector<ec_internal_reference*> references;
 int idle_cycles_this_second = 0;
 
+#ifdef	EC_REFERENCE_SLOTS
+// A slot of references and its generation, stale once the slot is reused.
+typedef struct
+{
+	Uint32 slot;
+	Uint32 generation;
+} ec_reference_key;
+
+typedef std::map<actor*, std::vector<ec_reference_key> > ec_actor_references;
+
+// The free slots of references are NULL. Dead references are released
+// where the loops find them and their slots are reused, so the loops never
+// erase from references.
+static std::vector<Uint32> reference_generations;
+static std::vector<Uint32> free_reference_slots;
+static std::vector<ec_reference_key> new_references;
+static ec_actor_references actor_references;
+static Uint32 used_references = 0;
+#endif	/* EC_REFERENCE_SLOTS */
+
 const float MAX_EFFECT_DISTANCE = 16.0;
 const float MAX_OBSTRUCT_DISTANCE_SQUARED = MAX_EFFECT_DISTANCE * MAX_EFFECT_DISTANCE;
 const float OBSTRUCTION_FORCE = 2.0;
@@ -240,6 +263,145 @@ extern "C" void get_staff_position(actor* _actor, ec::Vec3& tip)
 	tip.x = pos[0]; tip.y = pos[2]; tip.z = -pos[1];
 }
 #endif //!MAP_EDITOR
+#ifdef	EC_REFERENCE_SLOTS
+static ec_internal_reference* get_reference(const ec_reference_key& key)
+{
+	if ((key.slot >= references.size()) || (reference_generations[key.slot] != key.generation))
+		return NULL;
+	return references[key.slot];
+}
+
+static void index_reference_actor(ec_internal_reference* ref, actor* _actor)
+{
+	if (!_actor)
+		return;
+	if (std::find(ref->indexed_actors.begin(), ref->indexed_actors.end(), _actor) != ref->indexed_actors.end())
+		return;
+
+	ec_reference_key key = { ref->slot, ref->generation };
+	ref->indexed_actors.push_back(_actor);
+	actor_references[_actor].push_back(key);
+}
+
+// The effects set their actors after ec_create_generic(), so the new
+// references are added to the reverse index before it is used.
+static void index_new_references()
+{
+	for (std::vector<ec_reference_key>::iterator iter = new_references.begin(); iter != new_references.end(); iter++)
+	{
+		ec_internal_reference* ref = get_reference(*iter);
+		if (!ref || ref->indexed)
+			continue;
+
+		ref->indexed = true;
+		index_reference_actor(ref, ref->caster);
+		index_reference_actor(ref, ref->target);
+		for (int j = 0; j < (int)ref->target_actors.size(); j++)
+			index_reference_actor(ref, ref->target_actors[j]);
+	}
+	new_references.clear();
+}
+
+static void unindex_reference(ec_internal_reference* ref)
+{
+	for (std::vector<actor*>::iterator iter = ref->indexed_actors.begin(); iter != ref->indexed_actors.end(); iter++)
+	{
+		ec_actor_references::iterator found = actor_references.find(*iter);
+		if (found == actor_references.end())
+			continue;
+
+		std::vector<ec_reference_key>& keys = found->second;
+		for (int k = 0; k < (int)keys.size(); k++)
+		{
+			if ((keys[k].slot == ref->slot) && (keys[k].generation == ref->generation))
+			{
+				keys[k] = keys.back();
+				keys.pop_back();
+				break;
+			}
+		}
+		if (keys.empty())
+			actor_references.erase(found);
+	}
+	ref->indexed_actors.clear();
+}
+
+static void release_reference(const Uint32 slot)
+{
+	ec_internal_reference* ref = references[slot];
+
+	unindex_reference(ref);
+	references[slot] = NULL;
+	reference_generations[slot]++;
+	free_reference_slots.push_back(slot);
+	used_references--;
+	delete ref;
+}
+
+// Moves the references to the front once most slots are free. That
+// changes their slots, so the reverse index is built again.
+static void compact_references()
+{
+	if ((free_reference_slots.size() < 64) || (free_reference_slots.size() * 2 < references.size()))
+		return;
+
+	index_new_references();
+	actor_references.clear();
+
+	Uint32 used = 0;
+	for (Uint32 i = 0; i < references.size(); i++)
+	{
+		ec_internal_reference* ref = references[i];
+		if (!ref)
+			continue;
+
+		reference_generations[used]++;
+		ref->slot = used;
+		ref->generation = reference_generations[used];
+		references[used] = ref;
+
+		ec_reference_key key = { ref->slot, ref->generation };
+		for (std::vector<actor*>::iterator iter = ref->indexed_actors.begin(); iter != ref->indexed_actors.end(); iter++)
+			actor_references[*iter].push_back(key);
+		used++;
+	}
+	references.resize(used);
+	reference_generations.resize(used);
+	free_reference_slots.clear();
+}
+#endif	/* EC_REFERENCE_SLOTS */
+
+// Removes the reference at i if it is dead, true if there is no reference
+// to use at i.
+static bool skip_dead_reference(int& i)
+{
+#ifdef	EC_REFERENCE_SLOTS
+	if (references[i] && !references[i]->dead)
+		return false;
+
+	if (references[i])
+		release_reference(i);
+	i++;
+	return true;
+#else	/* EC_REFERENCE_SLOTS */
+	if (!references[i]->dead)
+		return false;
+
+	delete references[i];
+	references.erase(references.begin() + i);
+	return true;
+#endif	/* EC_REFERENCE_SLOTS */
+}
+
+static size_t count_references()
+{
+#ifdef	EC_REFERENCE_SLOTS
+	return used_references;
+#else	/* EC_REFERENCE_SLOTS */
+	return references.size();
+#endif	/* EC_REFERENCE_SLOTS */
+}
+
 extern "C" void ec_idle()
 {
 	if (idle_semaphore)
@@ -300,13 +462,9 @@ extern "C" void ec_idle()
 #endif
 	for (int i = 0; i < (int)references.size(); )
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		if (skip_dead_reference(i))
 			continue;
-		}
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		if (use_eye_candy)
 		{
@@ -434,6 +592,9 @@ extern "C" void ec_idle()
 		}
 		i++;
 	}
+#ifdef	EC_REFERENCE_SLOTS
+	compact_references();
+#endif	/* EC_REFERENCE_SLOTS */
 	if (is_day)
 		eye_candy.use_lights = false;
 	else
@@ -551,13 +712,9 @@ extern "C" void ec_draw()
 		// Update firefly activity.
 		for (int i = 0; i < (int)references.size(); )
 		{
-			std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-			if ((*iter)->dead)
-			{
-				delete *iter;
-				references.erase(iter);
+			if (skip_dead_reference(i))
 				continue;
-			}
+			std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 #ifdef MAP_EDITOR
 			//      if ((*iter)->effect->get_type() == ec::EC_FIREFLY)
@@ -587,15 +744,40 @@ extern "C" void ec_draw()
 extern "C" void ec_actor_delete(actor* _actor)
 {
 	force_idle = true;
-	for (int i = 0; i < (int)references.size(); )
+#ifdef	EC_REFERENCE_SLOTS
+	index_new_references();
+	ec_actor_references::iterator found = actor_references.find(_actor);
+	if (found != actor_references.end())
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
+		for (std::vector<ec_reference_key>::iterator key = found->second.begin(); key != found->second.end(); key++)
 		{
-			delete *iter;
-			references.erase(iter);
-			continue;
+			ec_internal_reference* ref = get_reference(*key);
+			if (!ref)
+				continue;
+
+			std::vector<actor*>::iterator indexed = std::find(ref->indexed_actors.begin(), ref->indexed_actors.end(), _actor);
+			if (indexed != ref->indexed_actors.end())
+				ref->indexed_actors.erase(indexed);
+			if (ref->dead)
+				continue;
+
+			if ((ref->caster == _actor) || (ref->target == _actor))
+			{
+				ref->effect->recall = true;
+				ref->caster = NULL;
+				ref->target = NULL;
+				continue;
+			}
+			std::replace(ref->target_actors.begin(), ref->target_actors.end(), _actor, (actor*)NULL);
 		}
+		actor_references.erase(found);
+	}
+#else	/* EC_REFERENCE_SLOTS */
+	for (int i = 0; i < (int)references.size(); )
+	{
+		if (skip_dead_reference(i))
+			continue;
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		i++;
 		if (((*iter)->caster == _actor) || ((*iter)->target == _actor))
@@ -612,6 +794,7 @@ extern "C" void ec_actor_delete(actor* _actor)
 				(*iter2) = NULL;
 		}
 	}
+#endif	/* EC_REFERENCE_SLOTS */
 	for (ec_actor_obstructions::iterator iter = actor_obstructions.begin(); iter != actor_obstructions.end(); iter++)
 	{
 		if ((*iter)->obstructing_actor == _actor)
@@ -649,13 +832,13 @@ extern "C" void ec_recall_effect(const ec_reference ref)
 extern "C" void ec_destroy_all_effects()
 {
 	// loop marking all active effects as done, cleaning up the dead till we're done
-	for (int i=0; !references.empty() && i<50; ++i)
+	for (int i=0; count_references() && i<50; ++i)
 	{
 		ec_delete_all_effects();
 		ec_idle();
 	}
-	if (!references.empty()) // unlikely to happen but just so we don't get stick on exit.
-		LOG_ERROR("%s: failed to clear up. references.size()=%lu", __PRETTY_FUNCTION__, references.size());
+	if (count_references()) // unlikely to happen but just so we don't get stick on exit.
+		LOG_ERROR("%s: failed to clear up. references.size()=%lu", __PRETTY_FUNCTION__, count_references());
 	delete self_actor.obstruction;
 }
 
@@ -665,13 +848,9 @@ extern "C" void ec_delete_all_effects()
 	force_idle = true;
 	for (int i = 0; i < (int)references.size(); )
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		if (skip_dead_reference(i))
 			continue;
-		}
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		if ((*iter)->effect)
 			(*iter)->effect->recall = true;
@@ -684,13 +863,9 @@ extern "C" void ec_delete_effect_loc(float x, float y)
 	force_idle = true;
 	for (int i = 0; i < (int)references.size(); )
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		if (skip_dead_reference(i))
 			continue;
-		}
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		i++;
 		if (((*iter)->position.x == x) && ((*iter)->position.z == -y))
@@ -706,13 +881,9 @@ extern "C" void ec_delete_effect_loc_type(float x, float y, ec_EffectEnum type)
 	force_idle = true;
 	for (int i = 0; i < (int)references.size(); )
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		if (skip_dead_reference(i))
 			continue;
-		}
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		i++;
 		if (((*iter)->position.x == x) && ((*iter)->position.z == -y) && (type == (ec_EffectEnum)(*iter)->effect->get_type()))
@@ -728,13 +899,9 @@ extern "C" void ec_delete_effect_type(ec_EffectEnum type)
 	force_idle = true;
 	for (int i = 0; i < (int)references.size(); )
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		if (skip_dead_reference(i))
 			continue;
-		}
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		i++;
 		if (type == (ec_EffectEnum)(*iter)->effect->get_type())
@@ -749,6 +916,13 @@ extern "C" void ec_delete_reference(ec_reference ref)
 {
 	force_idle = true;
 	ec_internal_reference* cast_reference = (ec_internal_reference*)ref;
+#ifdef	EC_REFERENCE_SLOTS
+	if ((cast_reference->slot < references.size()) && (references[cast_reference->slot] == cast_reference))
+	{
+		release_reference(cast_reference->slot);
+		return;
+	}
+#endif	/* EC_REFERENCE_SLOTS */
 	delete cast_reference;
 }
 
@@ -932,15 +1106,33 @@ extern "C" void ec_free_effects_list(ec_effects effects)
 extern "C" void ec_remove_weapon(actor* _actor)
 {
 	force_idle = true;
-	for (int i = 0; i < (int)references.size(); )
+#ifdef	EC_REFERENCE_SLOTS
+	index_new_references();
+	ec_actor_references::iterator found = actor_references.find(_actor);
+	if (found == actor_references.end())
+		return;
+
+	for (std::vector<ec_reference_key>::iterator key = found->second.begin(); key != found->second.end(); key++)
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		ec_internal_reference* ref = get_reference(*key);
+		if (!ref || ref->dead)
 			continue;
+
+		if ((ref->caster == _actor) &&
+			((ref->effect->get_type() == ec::EC_SWORD)
+			|| ref->effect->get_type() == ec::EC_STAFF))
+		{
+			ref->effect->recall = true;
+			ref->caster = NULL;
+			ref->target = NULL;
 		}
+	}
+#else	/* EC_REFERENCE_SLOTS */
+	for (int i = 0; i < (int)references.size(); )
+	{
+		if (skip_dead_reference(i))
+			continue;
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		i++;
 		if (((*iter)->caster == _actor) &&
@@ -953,6 +1145,7 @@ extern "C" void ec_remove_weapon(actor* _actor)
 			continue;
 		}
 	}
+#endif	/* EC_REFERENCE_SLOTS */
 }
 
 #ifndef MAP_EDITOR
@@ -961,13 +1154,9 @@ extern "C" void ec_remove_missile(int missile_id)
 	force_idle = true;
 	for (int i = 0; i < (int)references.size(); )
 	{
-		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
-		if ((*iter)->dead)
-		{
-			delete *iter;
-			references.erase(iter);
+		if (skip_dead_reference(i))
 			continue;
-		}
+		std::vector<ec_internal_reference*>::iterator iter = references.begin() + i;
 
 		i++;
 		if ((*iter)->effect->get_type() == ec::EC_MISSILE &&
@@ -995,6 +1184,10 @@ void ec_rename_missile(int old_id, int new_id)
 	std::vector<ec_internal_reference*>::iterator it;
 	for (it = references.begin(); it != references.end(); ++it)
 	{
+#ifdef	EC_REFERENCE_SLOTS
+		if (!(*it) || (*it)->dead)
+			continue;
+#endif	/* EC_REFERENCE_SLOTS */
 		if ((*it)->effect->get_type() == ec::EC_MISSILE && (*it)->missile_id == old_id)
 		{
 			(*it)->missile_id = new_id;
@@ -1020,12 +1213,38 @@ extern "C" int ec_in_range(float x, float y, float z, Uint64 effect_max_time)
 
 extern "C" ec_reference ec_create_generic()
 {
+#ifdef	EC_REFERENCE_SLOTS
+	ec_internal_reference* ref = new ec_internal_reference;
+	ref->casterbone = -1;
+	ref->targetbone = -1;
+	ref->caster = NULL;
+	ref->target = NULL;
+	if (free_reference_slots.empty())
+	{
+		ref->slot = references.size();
+		references.push_back(ref);
+		reference_generations.push_back(1);
+	}
+	else
+	{
+		ref->slot = free_reference_slots.back();
+		free_reference_slots.pop_back();
+		references[ref->slot] = ref;
+	}
+	ref->generation = reference_generations[ref->slot];
+	used_references++;
+
+	ec_reference_key key = { ref->slot, ref->generation };
+	new_references.push_back(key);
+	return (ec_reference)ref;
+#else	/* EC_REFERENCE_SLOTS */
 	references.push_back(new ec_internal_reference);
 	((ec_internal_reference*)(ec_reference)(references[references.size() - 1]))->casterbone = -1;
 	((ec_internal_reference*)(ec_reference)(references[references.size() - 1]))->targetbone = -1;
 	((ec_internal_reference*)(ec_reference)(references[references.size() - 1]))->caster = NULL;
 	((ec_internal_reference*)(ec_reference)(references[references.size() - 1]))->target = NULL;
 	return (ec_reference)(references[references.size() - 1]);
+#endif	/* EC_REFERENCE_SLOTS */
 }
 
 extern "C" void ec_add_target(ec_reference reference, float x, float y, float z)
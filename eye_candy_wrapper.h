@@ -93,6 +93,11 @@ extern "C"
 				caster = NULL;
 				target = NULL;
 				dead = false;
+#ifdef	EC_REFERENCE_SLOTS
+				slot = 0;
+				generation = 0;
+				indexed = false;
+#endif	/* EC_REFERENCE_SLOTS */
 			}
 			;
 			~ec_internal_reference()
@@ -112,6 +117,12 @@ extern "C"
 			int casterbone;
 			int targetbone;
 			int missile_id;
+#ifdef	EC_REFERENCE_SLOTS
+			Uint32 slot; // index in references
+			Uint32 generation; // generation of the slot when it was used
+			bool indexed; // added to the reverse index of the actors
+			std::vector<actor*> indexed_actors; // actors with this reference in the reverse index
+#endif	/* EC_REFERENCE_SLOTS */
 	} ec_internal_reference;
 
 	typedef struct ec_object_obstruction
@@ -8,6 +8,11 @@
 #include "translate.h"
 #include "errors.h"
 #include "io/elpathwrapper.h"
+#ifdef	FAST_CHAT_FILTER
+#include "aho_corasick.h"
+#include "hash.h"
+#include "text.h"
+#endif	/* FAST_CHAT_FILTER */
 
 #define MAX_FILTERS 1000
 
@@ -30,6 +35,14 @@ char storage_filter[128];
 
 unsigned char cached_storage_list[8192] = {0};
 
+#ifdef	FAST_CHAT_FILTER
+/* The automaton finds the words of all filters in one pass over a word. */
+static aho_corasick_t filter_automaton;
+static int filter_pattern_slots[MAX_FILTERS];
+static int filter_any_word = -1;	/* the slot of a "**" filter */
+static int filter_automaton_dirty = 1;
+#endif	/* FAST_CHAT_FILTER */
+
 //returns -1 if the name is already filtered, 1 on sucess, -2 if no more filter slots
 int add_to_filter_list (const char *name, char local, char save_name)
 {
@@ -98,6 +111,9 @@ int add_to_filter_list (const char *name, char local, char save_name)
 			filter_list[i].len = strlen(filter_list[i].name);//memorize the length
 			filter_list[i].rlen = strlen(filter_list[i].replacement);//memorize the length
 			filter_list[i].local = local;
+#ifdef	FAST_CHAT_FILTER
+			filter_automaton_dirty = 1;
+#endif	/* FAST_CHAT_FILTER */
 
 			filtered_so_far++;
 			return 1;
@@ -124,6 +140,9 @@ int remove_from_filter_list (const char *name)
 				local = filter_list[i].local;
 				filter_list[i].len = 0;
 				filtered_so_far--;
+#ifdef	FAST_CHAT_FILTER
+				filter_automaton_dirty = 1;
+#endif	/* FAST_CHAT_FILTER */
 				break;
 			}
 		}
@@ -164,8 +183,8 @@ void print_filter_list ()
 }
 #endif
 
-//returns length to be filtered, 0 if not filtered
-int check_if_filtered (const char *name)
+// compares the word with every filter
+static int scan_filters (const char *name)
 {
 	int t, i, l;
 
@@ -195,7 +214,7 @@ int check_if_filtered (const char *name)
 				l = filter_list[i].len;
 				if (t >= l-1)
 				{
-					if (my_strncompare (&(filter_list[i].name[1]), &name[t-l], l-1))
+					if (my_strncompare (&(filter_list[i].name[1]), &name[t-l+1], l-1))
 						return i;
 				}
 			}
@@ -221,6 +240,137 @@ int check_if_filtered (const char *name)
 	return -1;//nope
 }
 
+#ifdef	FAST_CHAT_FILTER
+static void build_filter_automaton ()
+{
+	const char *patterns[MAX_FILTERS];
+	Uint32 lengths[MAX_FILTERS];
+	int i, len, count;
+
+	count = 0;
+	filter_any_word = -1;
+
+	for (i = 0; i < MAX_FILTERS; i++)
+	{
+		if (filter_list[i].len <= 0)
+			continue;
+
+		/* the word without the wildcards */
+		switch (filter_list[i].wildcard_type)
+		{
+			case 0:
+				patterns[count] = filter_list[i].name;
+				len = filter_list[i].len;
+				break;
+			case 1:
+				patterns[count] = &(filter_list[i].name[1]);
+				len = filter_list[i].len - 1;
+				break;
+			case 2:
+				patterns[count] = filter_list[i].name;
+				len = filter_list[i].len - 1;
+				break;
+			default:
+				patterns[count] = &(filter_list[i].name[1]);
+				len = filter_list[i].len - 2;
+				break;
+		}
+
+		if (len == 0)
+		{
+			/* "**" filters every word */
+			if (filter_any_word < 0)
+				filter_any_word = i;
+		}
+		else if (len > 0)
+		{
+			lengths[count] = len;
+			filter_pattern_slots[count] = i;
+			count++;
+		}
+	}
+
+	aho_corasick_build (&filter_automaton, patterns, lengths, count);
+	filter_automaton_dirty = 0;
+}
+
+// finds all filters in the word with the automaton, same result as scan_filters()
+static int match_filters (const char *name)
+{
+	const Uint8 *text = (const Uint8 *)name;
+	Uint32 i, j, state, start, end, pattern;
+	int best, slot, found;
+
+	if (filter_automaton_dirty)
+		build_filter_automaton ();
+
+	best = -1;
+
+	if (filter_any_word >= 0 && (use_global_filters || filter_list[filter_any_word].local))
+		best = filter_any_word;
+
+	for (end = 0; isalpha (text[end]); end++) ;
+
+	state = 0;
+
+	for (i = 0; text[i] != '\0'; i++)
+	{
+		state = aho_corasick_next (&filter_automaton, state, text[i]);
+
+		/* past the word and no match in progress started in it */
+		if (i >= end && filter_automaton.depths[state] + end <= i + 1)
+			break;
+
+		for (j = filter_automaton.match_offsets[state]; j < filter_automaton.match_offsets[state + 1]; j++)
+		{
+			pattern = filter_automaton.matches[j];
+			slot = filter_pattern_slots[pattern];
+
+			// the first filter in the list wins, like in scan_filters()
+			if ((best >= 0 && slot >= best) || !(use_global_filters || filter_list[slot].local))
+				continue;
+
+			start = i + 1 - filter_automaton.pattern_lengths[pattern];
+
+			switch (filter_list[slot].wildcard_type)
+			{
+				case 0:
+					/* word, must fill the start of the text up to the end of a word */
+					found = start == 0 && !isalpha (text[i + 1]);
+					break;
+				case 1:
+					/* *word, must end with the word */
+					found = i + 1 == end;
+					break;
+				case 2:
+					/* word*, must start with the word */
+					found = start == 0;
+					break;
+				default:
+					/* *word*, must start in the word */
+					found = start < end;
+					break;
+			}
+
+			if (found)
+				best = slot;
+		}
+	}
+
+	return best;
+}
+#endif	/* FAST_CHAT_FILTER */
+
+//returns the filter slot, -1 if not filtered
+int check_if_filtered (const char *name)
+{
+#ifdef	FAST_CHAT_FILTER
+	if (use_compiled_filters)
+		return match_filters (name);
+#endif	/* FAST_CHAT_FILTER */
+	return scan_filters (name);
+}
+
 // Filter the lines that contain the desired string from the inventory listing
 int filter_storage_text (char * input_text, int len, int size) {
 	int istart, iline, ic, diff;
@@ -463,6 +613,9 @@ void clear_filter_list ()
 	for (i = 0; i < MAX_FILTERS; i++)
 		filter_list[i].len = 0;
 	filtered_so_far = 0;
+#ifdef	FAST_CHAT_FILTER
+	filter_automaton_dirty = 1;
+#endif	/* FAST_CHAT_FILTER */
 }
 
 
@@ -517,3 +670,94 @@ int list_filters()
 	free (str);
 	return 1;
 }
+
+#ifdef	FAST_CHAT_FILTER
+// filters and checks the ignores of every line of the log, returns a hash of the results
+static Uint32 replay_chat_log (char **lines, int count)
+{
+	char buffer[1024];
+	char name[MAX_USERNAME_LENGTH];
+	Uint32 result;
+	int i, len;
+
+	result = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		safe_strncpy (buffer, lines[i], sizeof (buffer));
+		len = strlen (buffer);
+
+		get_name_from_text (buffer, len, 3, 0, name);
+		result = result * 31 + check_if_ignored (name);
+
+		len = filter_text (buffer, len, sizeof (buffer));
+		result = result * 31 + mem_hash (buffer, len);
+	}
+
+	return result;
+}
+
+int command_filter_benchmark (char *text, int len)
+{
+	char file_name[256];
+	char str[256];
+	char *log_mem, *line;
+	char **lines;
+	FILE *f;
+	int f_size, count, i, mode;
+	Uint32 start, times[2], results[2];
+
+	if (sscanf (text, " %255s", file_name) != 1)
+		safe_strncpy (file_name, "chat_log.txt", sizeof (file_name));
+
+	f = open_file_config (file_name, "rb");
+	if (f == NULL)
+	{
+		safe_snprintf (str, sizeof (str), "%s: %s", cant_open_file, file_name);
+		LOG_TO_CONSOLE (c_red1, str);
+		return 1;
+	}
+
+	fseek (f, 0, SEEK_END);
+	f_size = ftell (f);
+	fseek (f, 0, SEEK_SET);
+
+	log_mem = calloc (f_size + 1, 1);
+	if (fread (log_mem, 1, f_size, f) != f_size)
+		f_size = 0;
+	fclose (f);
+	log_mem[f_size] = '\0';
+
+	// split the log into lines, without the time stamps
+	lines = malloc ((f_size / 2 + 1) * sizeof (char *));
+	count = 0;
+
+	for (line = strtok (log_mem, "\r\n"); line != NULL; line = strtok (NULL, "\r\n"))
+	{
+		if (line[0] == '[' && strlen (line) > 11 && line[9] == ']')
+			line += 11;
+		lines[count++] = line;
+	}
+
+	for (mode = 0; mode < 2; mode++)
+	{
+		use_compiled_filters = mode;
+		start = SDL_GetTicks ();
+
+		for (i = 0; i < 10; i++)
+			results[mode] = replay_chat_log (lines, count);
+
+		times[mode] = SDL_GetTicks () - start;
+	}
+
+	use_compiled_filters = 1;
+
+	safe_snprintf (str, sizeof (str), "%d lines ten times: %d ms scanning, %d ms compiled%s",
+		count, times[0], times[1], (results[0] == results[1]) ? "" : ", results differ!");
+	LOG_TO_CONSOLE ((results[0] == results[1]) ? c_green1 : c_red1, str);
+
+	free (lines);
+	free (log_mem);
+	return 1;
+}
+#endif	/* FAST_CHAT_FILTER */
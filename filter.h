@@ -105,6 +105,21 @@ int list_filters();
 void print_filter_list ();
 #endif
 
+#ifdef	FAST_CHAT_FILTER
+/*!
+ * \ingroup actors_utils
+ * \brief   replays a chat log through the filters and ignores.
+ *
+ *      Filters every line of the chat log in the config dir and checks if its sender is ignored, once with the
+ *      filter automaton and the ignore hash and once with the old scans, and prints the times.
+ *
+ * \param text          the name of the log, chat_log.txt if empty
+ * \param len           the length of \a text
+ * \retval int
+ */
+int command_filter_benchmark (char *text, int len);
+#endif	/* FAST_CHAT_FILTER */
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -243,6 +243,449 @@ int	draw_char_scaled(unsigned char cur_char, int cur_x, int cur_y, float display
 	return(displayed_font_x_width);	// return how far to move for the next character
 }
 
+#ifdef	GLYPH_RUN_CACHE
+/* Glyph runs are the quads of a string laid out at the origin, together
+ * with the color changes inside the string. They are kept in a hash table
+ * keyed by the text, the font, the size and the wrapping parameters, so a
+ * string that is drawn every frame is only laid out once. The least
+ * recently used runs are dropped when the cache is full. */
+#define	GLYPH_RUN_CACHE_SIZE	1024
+#define	GLYPH_RUN_HASH_SIZE	2048
+
+typedef enum
+{
+	GLYPH_RUN_STRING = 0,	/* draw_string_zoomed_width */
+	GLYPH_RUN_CHAT_LINE,	/* one line of draw_messages */
+	GLYPH_RUN_INGAME	/* draw_ingame_string */
+} glyph_run_type;
+
+typedef struct
+{
+	int quad;
+	unsigned char color;
+} glyph_run_color;
+
+typedef struct glyph_run
+{
+	struct glyph_run *hash_next;
+	struct glyph_run *lru_prev, *lru_next;
+	Uint32 hash;
+	glyph_run_type type;
+	int font_num;
+	float x_size, y_size;
+	int max_width, max_lines;
+	int text_len;
+	unsigned char *text;
+	GLfloat *vertices;	// GL_T2F_V3F
+	int quads_count, quads_size;
+	glyph_run_color *colors;
+	int colors_count, colors_size;
+	int lines;
+	unsigned char last_color;
+	GLuint vbo;
+} glyph_run;
+
+int use_glyph_run_cache = 1;
+static glyph_run *glyph_run_hash[GLYPH_RUN_HASH_SIZE];
+static glyph_run *glyph_run_lru_first = NULL;
+static glyph_run *glyph_run_lru_last = NULL;
+static int glyph_run_count = 0;
+static Uint32 glyph_run_hits = 0;
+static Uint32 glyph_run_misses = 0;
+
+static Uint32 hash_glyph_run(glyph_run_type type, const unsigned char *text, int len,
+	float x_size, float y_size, int max_width, int max_lines)
+{
+	Uint32 hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < len; i++)
+		hash = (hash ^ text[i]) * 16777619u;
+
+	hash = (hash ^ type) * 16777619u;
+	hash = (hash ^ cur_font_num) * 16777619u;
+	hash = (hash ^ (Uint32)(x_size * 1024.0f)) * 16777619u;
+	hash = (hash ^ (Uint32)(y_size * 1024.0f)) * 16777619u;
+	hash = (hash ^ max_width) * 16777619u;
+	hash = (hash ^ max_lines) * 16777619u;
+
+	return hash;
+}
+
+static void unlink_glyph_run_lru(glyph_run *run)
+{
+	if (run->lru_prev) run->lru_prev->lru_next = run->lru_next;
+	else glyph_run_lru_first = run->lru_next;
+	if (run->lru_next) run->lru_next->lru_prev = run->lru_prev;
+	else glyph_run_lru_last = run->lru_prev;
+	run->lru_prev = run->lru_next = NULL;
+}
+
+static void link_glyph_run_lru(glyph_run *run)
+{
+	run->lru_prev = NULL;
+	run->lru_next = glyph_run_lru_first;
+	if (glyph_run_lru_first) glyph_run_lru_first->lru_prev = run;
+	else glyph_run_lru_last = run;
+	glyph_run_lru_first = run;
+}
+
+static void free_glyph_run(glyph_run *run)
+{
+	glyph_run **ptr = &glyph_run_hash[run->hash % GLYPH_RUN_HASH_SIZE];
+
+	while (*ptr != run)
+		ptr = &(*ptr)->hash_next;
+	*ptr = run->hash_next;
+
+	unlink_glyph_run_lru(run);
+	if (run->vbo != 0)
+		ELglDeleteBuffersARB(1, &run->vbo);
+	free(run->text);
+	free(run->vertices);
+	free(run->colors);
+	free(run);
+	glyph_run_count--;
+}
+
+void clear_glyph_run_cache()
+{
+	while (glyph_run_lru_first != NULL)
+		free_glyph_run(glyph_run_lru_first);
+}
+
+static void add_glyph_run_color(glyph_run *run, unsigned char color)
+{
+	if (run->colors_count >= run->colors_size)
+	{
+		run->colors_size = run->colors_size ? run->colors_size * 2 : 4;
+		run->colors = realloc(run->colors, run->colors_size * sizeof(glyph_run_color));
+	}
+	run->colors[run->colors_count].quad = run->quads_count;
+	run->colors[run->colors_count].color = color;
+	run->colors_count++;
+}
+
+static GLfloat *add_glyph_run_quad(glyph_run *run)
+{
+	if (run->quads_count >= run->quads_size)
+	{
+		run->quads_size = run->quads_size ? run->quads_size * 2 : 16;
+		run->vertices = realloc(run->vertices, run->quads_size * 4 * 5 * sizeof(GLfloat));
+	}
+	return &run->vertices[(run->quads_count++) * 4 * 5];
+}
+
+static __inline__ void set_glyph_vertex(GLfloat *v, float u, float t, float x, float y, float z)
+{
+	v[0] = u;
+	v[1] = t;
+	v[2] = x;
+	v[3] = y;
+	v[4] = z;
+}
+
+/* Adds the character the same way draw_char_scaled draws it and returns
+ * how far to move for the next character. */
+static int add_glyph_run_char(glyph_run *run, unsigned char cur_char, int cur_x, int cur_y)
+{
+	float u_start,u_end,v_start,v_end;
+	int chr,col,row;
+	int displayed_font_x_width, displayed_font_y_height;
+	int	font_bit_width, ignored_bits;
+	GLfloat *v;
+
+	if (is_color (cur_char))
+	{
+		add_glyph_run_color(run, cur_char);
+		return 0;
+	}
+	chr= get_font_char(cur_char);
+	if(chr < 0)
+		return 0;
+
+	col= chr/FONT_CHARS_PER_LINE;
+	row= chr%FONT_CHARS_PER_LINE;
+
+	font_bit_width= get_font_width(chr);
+	displayed_font_x_width= (int)(0.5f+((float)font_bit_width)*run->x_size/12.0);
+	displayed_font_y_height= (int)(run->y_size+1);
+	ignored_bits= (12-font_bit_width)/2;
+
+	u_start= (float)(row*FONT_X_SPACING+ignored_bits)/256.0f;
+	u_end= (float)(row*FONT_X_SPACING+FONT_X_SPACING-7-ignored_bits)/256.0f;
+#ifdef NEW_TEXTURES
+	v_start= (float)(1+col*FONT_Y_SPACING)/256.0f;
+	v_end= (float)(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
+#else
+	v_start= (float)1.0f-(1+col*FONT_Y_SPACING)/256.0f;
+	v_end= (float)1.0f-(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
+#endif //NEW_TEXTURES
+
+	v = add_glyph_run_quad(run);
+	set_glyph_vertex(v, u_start, v_start, cur_x, cur_y, 0.0f);
+	set_glyph_vertex(v+5, u_start, v_end, cur_x, cur_y+displayed_font_y_height, 0.0f);
+	set_glyph_vertex(v+10, u_end, v_end, cur_x+displayed_font_x_width, cur_y+displayed_font_y_height, 0.0f);
+	set_glyph_vertex(v+15, u_end, v_start, cur_x+displayed_font_x_width, cur_y, 0.0f);
+
+	return displayed_font_x_width;
+}
+
+// same layout as draw_string_zoomed_width
+static void layout_glyph_run_string(glyph_run *run)
+{
+	int i, cur_x = 0, cur_y = 0;
+
+	run->lines = 1;
+	for (i = 0; i < run->text_len; i++)
+	{
+		unsigned char cur_char = run->text[i];
+
+		if (cur_char == '\n' || cur_char == '\r')
+		{
+			cur_y+=run->y_size;
+			cur_x=0;
+			run->lines++;
+			if(run->lines>run->max_lines)break;
+			continue;
+		}
+		else if (cur_x+run->x_size>=run->max_width)
+		{
+			cur_y+=run->y_size;
+			cur_x=0;
+			run->lines++;
+			if(run->lines>run->max_lines)break;
+		}
+		cur_x+=add_glyph_run_char(run, cur_char, cur_x, cur_y);
+	}
+}
+
+// same layout as one line of draw_messages without a selection
+static void layout_glyph_run_chat_line(glyph_run *run)
+{
+	int i, cur_x = 0;
+
+	run->last_color = 0;
+	for (i = 0; i < run->text_len; i++)
+	{
+		unsigned char cur_char = run->text[i];
+
+		if (is_color (cur_char))
+			run->last_color = cur_char;
+		cur_x += add_glyph_run_char(run, cur_char, cur_x, 0);
+		if (cur_x > run->max_width - run->x_size)
+		{
+			// the rest of the line is not drawn, but the colors count
+			for (i++; i < run->text_len; i++)
+			{
+				if (is_color (run->text[i]))
+					run->last_color = run->text[i];
+			}
+			break;
+		}
+	}
+}
+
+// same layout as draw_ingame_string
+static void layout_glyph_run_ingame(glyph_run *run)
+{
+	float u_start,u_end,v_start,v_end;
+	float displayed_font_x_width, cur_x = 0.0f, cur_y = 0.0f;
+	int i, chr, col, row, font_bit_width, ignored_bits;
+	GLfloat *v;
+
+	run->lines = 0;
+	for (i = 0; i < run->text_len; i++)
+	{
+		unsigned char cur_char = run->text[i];
+
+		if (cur_char == '\n')
+		{
+			cur_y+=run->y_size;
+			cur_x=0.0f;
+			run->lines++;
+			if(run->lines>=run->max_lines)break;
+			continue;
+		}
+		if (is_color (cur_char))
+		{
+			add_glyph_run_color(run, cur_char);
+			continue;
+		}
+		chr=get_font_char(cur_char);
+		if (chr < 0)
+			continue;
+
+		col=chr/FONT_CHARS_PER_LINE;
+		row=chr%FONT_CHARS_PER_LINE;
+
+		font_bit_width=get_font_width(chr);
+		displayed_font_x_width=((float)font_bit_width)*run->x_size/12.0;
+		ignored_bits=(12-font_bit_width)/2;
+		if(ignored_bits < 0)ignored_bits=0;
+
+		u_start=(float)(row*FONT_X_SPACING+ignored_bits)/256.0f;
+		u_end=(float)(row*FONT_X_SPACING+FONT_X_SPACING-7-ignored_bits)/256.0f;
+#ifdef NEW_TEXTURES
+		v_start=(float)(1+col*FONT_Y_SPACING)/256.0f;
+		v_end=(float)(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
+#else
+		v_start=(float)1.0f-(1+col*FONT_Y_SPACING)/256.0f;
+		v_end=(float)1.0f-(col*FONT_Y_SPACING+FONT_Y_SPACING-1)/256.0f;
+#endif //NEW_TEXTURES
+
+		v = add_glyph_run_quad(run);
+#ifndef SKY_FPV_OPTIONAL
+		// the names are drawn in the x-z plane
+		set_glyph_vertex(v, u_start, v_start, cur_x, 0.0f, cur_y+run->y_size);
+		set_glyph_vertex(v+5, u_start, v_end, cur_x, 0.0f, cur_y);
+		set_glyph_vertex(v+10, u_end, v_end, cur_x+displayed_font_x_width, 0.0f, cur_y);
+		set_glyph_vertex(v+15, u_end, v_start, cur_x+displayed_font_x_width, 0.0f, cur_y+run->y_size);
+#else // SKY_FPV_OPTIONAL
+		set_glyph_vertex(v, u_start, v_start, cur_x, cur_y+run->y_size, 0.0f);
+		set_glyph_vertex(v+5, u_start, v_end, cur_x, cur_y, 0.0f);
+		set_glyph_vertex(v+10, u_end, v_end, cur_x+displayed_font_x_width, cur_y, 0.0f);
+		set_glyph_vertex(v+15, u_end, v_start, cur_x+displayed_font_x_width, cur_y+run->y_size, 0.0f);
+#endif // SKY_FPV_OPTIONAL
+
+		cur_x+=displayed_font_x_width;
+	}
+}
+
+static glyph_run *get_glyph_run(glyph_run_type type, const unsigned char *text, int len,
+	float x_size, float y_size, int max_width, int max_lines)
+{
+	glyph_run *run;
+	Uint32 hash;
+
+	hash = hash_glyph_run(type, text, len, x_size, y_size, max_width, max_lines);
+
+	for (run = glyph_run_hash[hash % GLYPH_RUN_HASH_SIZE]; run != NULL; run = run->hash_next)
+	{
+		if ((run->hash == hash) && (run->type == type) &&
+			(run->font_num == cur_font_num) && (run->text_len == len) &&
+			(run->x_size == x_size) && (run->y_size == y_size) &&
+			(run->max_width == max_width) && (run->max_lines == max_lines) &&
+			(memcmp(run->text, text, len) == 0))
+		{
+			unlink_glyph_run_lru(run);
+			link_glyph_run_lru(run);
+			glyph_run_hits++;
+			return run;
+		}
+	}
+
+	glyph_run_misses++;
+
+	if (glyph_run_count >= GLYPH_RUN_CACHE_SIZE)
+		free_glyph_run(glyph_run_lru_last);
+
+	run = calloc(1, sizeof(glyph_run));
+	run->hash = hash;
+	run->type = type;
+	run->font_num = cur_font_num;
+	run->x_size = x_size;
+	run->y_size = y_size;
+	run->max_width = max_width;
+	run->max_lines = max_lines;
+	run->text_len = len;
+	run->text = malloc(len + 1);
+	memcpy(run->text, text, len);
+	run->text[len] = '\0';
+
+	switch (type)
+	{
+		case GLYPH_RUN_STRING:
+			layout_glyph_run_string(run);
+			break;
+		case GLYPH_RUN_CHAT_LINE:
+			layout_glyph_run_chat_line(run);
+			break;
+		case GLYPH_RUN_INGAME:
+			layout_glyph_run_ingame(run);
+			break;
+	}
+
+	if (use_vertex_buffers && (run->quads_count > 0))
+	{
+		ELglGenBuffersARB(1, &run->vbo);
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, run->vbo);
+		ELglBufferDataARB(GL_ARRAY_BUFFER_ARB, run->quads_count * 4 * 5 * sizeof(GLfloat),
+			run->vertices, GL_STATIC_DRAW_ARB);
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	}
+
+	run->hash_next = glyph_run_hash[hash % GLYPH_RUN_HASH_SIZE];
+	glyph_run_hash[hash % GLYPH_RUN_HASH_SIZE] = run;
+	link_glyph_run_lru(run);
+	glyph_run_count++;
+
+	return run;
+}
+
+/* Draws the run at the given position. Must be called outside of
+ * glBegin/glEnd with the font texture bound and the modelview matrix
+ * selected. */
+static void draw_glyph_run(const glyph_run *run, float x, float y, float z)
+{
+	int i, first;
+
+	if (run->quads_count == 0)
+	{
+		// only the color changes
+		for (i = 0; i < run->colors_count; i++)
+			find_font_char(run->colors[i].color);
+		return;
+	}
+
+	glPushMatrix();
+	glTranslatef(x, y, z);
+
+	if (run->vbo != 0)
+	{
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, run->vbo);
+		glInterleavedArrays(GL_T2F_V3F, 0, 0);
+	}
+	else
+	{
+		glInterleavedArrays(GL_T2F_V3F, 0, run->vertices);
+	}
+
+	first = 0;
+	for (i = 0; i < run->colors_count; i++)
+	{
+		if (run->colors[i].quad > first)
+		{
+			glDrawArrays(GL_QUADS, first * 4, (run->colors[i].quad - first) * 4);
+			first = run->colors[i].quad;
+		}
+		find_font_char(run->colors[i].color);
+	}
+	if (run->quads_count > first)
+		glDrawArrays(GL_QUADS, first * 4, (run->quads_count - first) * 4);
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	if (run->vbo != 0)
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+	glPopMatrix();
+}
+
+int command_glyph_run_stats(char *text, int len)
+{
+	char str[200];
+
+	safe_snprintf(str, sizeof(str), "Glyph runs: %d cached, %d hits, %d misses",
+		glyph_run_count, glyph_run_hits, glyph_run_misses);
+	LOG_TO_CONSOLE(c_green1, str);
+	glyph_run_hits = 0;
+	glyph_run_misses = 0;
+
+	return 1;
+}
+#endif	/* GLYPH_RUN_CACHE */
+
 #ifndef MAP_EDITOR2
 void recolour_message(text_message *msg){
 	if (msg->chan_idx >= CHAT_CHANNEL1 && msg->chan_idx <= CHAT_CHANNEL3 && msg->len > 0 && msg->data[0] && !msg->deleted)
@@ -415,6 +858,31 @@ void draw_messages (int x, int y, text_message *msgs, int msgs_size, Uint8 filte
 			continue;
 		}
 
+#ifdef	GLYPH_RUN_CACHE
+		// draw whole lines from the cache, unless the cursor or a selection is in them
+		if (use_glyph_run_cache && (cur_x == x) && !in_select &&
+			((select == NULL) || TEXT_FIELD_SELECTION_EMPTY(select)))
+		{
+			int len = strcspn (&msgs[imsg].data[ichar], "\n\r");
+
+			if ((cursor < i) || (cursor > i + len))
+			{
+				const glyph_run *run = get_glyph_run (GLYPH_RUN_CHAT_LINE,
+					(const unsigned char*)&msgs[imsg].data[ichar], len,
+					displayed_font_x_size, displayed_font_y_size, width, 0);
+
+				glEnd ();
+				draw_glyph_run (run, cur_x, cur_y, 0.0f);
+				glBegin (GL_QUADS);
+				if (run->last_color)
+					last_color_char = run->last_color;
+				ichar += len;
+				i += len;
+				continue;
+			}
+		}
+#endif	/* GLYPH_RUN_CACHE */
+
 		if (pos_selected(imsg, ichar, select))
 		{
 			if (!in_select)
@@ -551,6 +1019,19 @@ CHECK_GL_ERRORS();
 	get_and_set_texture_id(font_text);
 #endif	/* NEW_TEXTURES */
 
+#ifdef	GLYPH_RUN_CACHE
+	if (use_glyph_run_cache)
+	{
+		const glyph_run *run = get_glyph_run(GLYPH_RUN_STRING, our_string,
+			strlen((const char*)our_string), displayed_font_x_size,
+			displayed_font_y_size, max_width, max_lines);
+
+		draw_glyph_run(run, x, y, 0.0f);
+		glDisable(GL_ALPHA_TEST);
+		return run->lines;
+	}
+#endif	/* GLYPH_RUN_CACHE */
+
 	i=0;
 	cur_x=x;
 	cur_y=y;
@@ -695,79 +1176,44 @@ void print_string_escaped (const char *str)
 }
 #endif
 
-int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int *cursor, float *max_line_width)
+/* breaks the text in src, which has no soft breaks, into lines that fit
+   in width. The text with the breaks is written to buf if buf is not NULL,
+   otherwise the lines are only counted. The text after the last break is
+   the same in src and buf, so the search for a space always looks at src. */
+static int wrap_soft_breaks (const char *src, int len, int size, float zoom, int width, char *buf, const int *cursor, int *dcursor, float *max_line_width)
 {
-	char *buf;
 	int ibuf;
 	int nchar;
 	int font_bit_width;
 	int nlines;
 	float line_width;
-	int isrc, idst;
+	int isrc;
 	int lastline;
-	int dcursor = 0;
-	/* the generic special text window code needs to know the
-	   maximum line length in pixels.  This information is used
-	   but was previously throw away in this function.  Others
-	   may fine it useful for setting the winow size, so pass back
-	   to the caller if they provide somewhere to store it. */
 	float local_max_line_width = 0;
 
-	// error checking
-	if (str == NULL || width <= 0 || size <= 0) {
-		return 0;
-	}
-
-	/* strip existing soft breaks before we start,
-		to avoid complicated code later */
-	for (isrc=0, idst=0; isrc<len; isrc++)
-	{
-		if (str[isrc] == '\r')
-		{
-			/* move the cursor back if after this point */
-			if ((cursor != NULL) && (isrc < *cursor))
-				dcursor--;
-		}
-		else
-			str[idst++] = str[isrc];
-	}
-	len = idst;
-	str[len] = 0;
-
-	/* allocate the working buffer so it can hold the maximum
-	   the source string can take.  Previously, the fixed length
-	   buffer was sometimes not big enough.  The code looked
-	   to attempt to cope but was floored.  When ever the wrap
-	   caused more characters to be in the output, some of the
-	   source would be lost.  This is still possable if the source
-	   size cannot take the extra characters.  For example, try
-	   #glinfo and watch as the end characters are lost.  At least
-	   characters are no longer lost wrap process. If you make
-	   size large enough for no character will be lost.  Twice
-	   the actual string length is probably enough */
-	buf = (char *)calloc(size, sizeof(char));
-
 	nlines = 1;
-	isrc = ibuf = idst = 0;
+	isrc = ibuf = 0;
 	line_width = 0;
 	lastline = 0;
 
 	// fill the buffer
-	while (isrc < len && str[isrc] != '\0')
+	while (isrc < len && src[isrc] != '\0')
 	{
 		// see if it's an explicit line break
-		if (str[isrc] == '\n') {
+		if (src[isrc] == '\n') {
 			nlines++;
 			if (line_width > local_max_line_width)
 				local_max_line_width = line_width;
 			line_width = 0;
+			// never search back past the line break for a space
+			lastline = ibuf;
 		} else {
-			font_bit_width = (int) (0.5f + get_char_width (str[isrc]) * 11.0f * zoom / 12.0f);
+			font_bit_width = (int) (0.5f + get_char_width (src[isrc]) * 11.0f * zoom / 12.0f);
 			if (line_width + font_bit_width > width)
 			{
 				// search back for a space
 				for (nchar = 0; ibuf-nchar-1 > lastline; nchar++) {
-					if (buf[ibuf-nchar-1] == ' ') {
+					if (src[isrc-nchar-1] == ' ') {
 						break;
 					}
 				}
@@ -780,10 +1226,11 @@ int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int
 				ibuf -= nchar;
 				isrc -= nchar;
 
-				buf[ibuf] = '\r';
+				if (buf != NULL)
+					buf[ibuf] = '\r';
 				nlines++; ibuf++;
 				if (cursor && isrc < *cursor) {
-					dcursor++;
+					(*dcursor)++;
 				}
 				if (ibuf >= size - 1) {
 					break;
@@ -800,7 +1247,8 @@ int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int
 		}
 
 		// copy the character into the buffer
-		buf[ibuf] = str[isrc];
+		if (buf != NULL)
+			buf[ibuf] = src[isrc];
 		isrc++; ibuf++;
 
 		if (ibuf >= size - 1) {
@@ -808,6 +1256,62 @@ int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int
 		}
 	}
 
+	if (line_width > local_max_line_width)
+		local_max_line_width = line_width;
+	if (max_line_width != NULL)
+		*max_line_width = local_max_line_width;
+	return nlines;
+}
+
+int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int *cursor, float *max_line_width)
+{
+	char *buf;
+	int nlines;
+	int isrc, idst;
+	int dcursor = 0;
+	/* the generic special text window code needs to know the
+	   maximum line length in pixels.  This information is used
+	   but was previously throw away in this function.  Others
+	   may fine it useful for setting the winow size, so pass back
+	   to the caller if they provide somewhere to store it. */
+	float local_max_line_width = 0;
+
+	// error checking
+	if (str == NULL || width <= 0 || size <= 0) {
+		return 0;
+	}
+
+	/* strip existing soft breaks before we start,
+		to avoid complicated code later */
+	for (isrc=0, idst=0; isrc<len; isrc++)
+	{
+		if (str[isrc] == '\r')
+		{
+			/* move the cursor back if after this point */
+			if ((cursor != NULL) && (isrc < *cursor))
+				dcursor--;
+		}
+		else
+			str[idst++] = str[isrc];
+	}
+	len = idst;
+	str[len] = 0;
+
+	/* allocate the working buffer so it can hold the maximum
+	   the source string can take.  Previously, the fixed length
+	   buffer was sometimes not big enough.  The code looked
+	   to attempt to cope but was floored.  When ever the wrap
+	   caused more characters to be in the output, some of the
+	   source would be lost.  This is still possable if the source
+	   size cannot take the extra characters.  For example, try
+	   #glinfo and watch as the end characters are lost.  At least
+	   characters are no longer lost wrap process. If you make
+	   size large enough for no character will be lost.  Twice
+	   the actual string length is probably enough */
+	buf = (char *)calloc(size, sizeof(char));
+
+	nlines = wrap_soft_breaks (str, len, size, zoom, width, buf, cursor, &dcursor, &local_max_line_width);
+
 	safe_strncpy(str, buf, size * sizeof(char));
 	str[size-1] = '\0';
 
@@ -819,13 +1323,47 @@ int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int
 		}
 	}
 	free(buf);
-	if (line_width > local_max_line_width)
-		local_max_line_width = line_width;
 	if (max_line_width!=NULL)
 		*max_line_width = local_max_line_width;
 	return nlines;
 }
 
+#ifdef	CHAT_LINE_INDEX
+int count_soft_breaks (const char *str, int len, int size, float zoom, int width)
+{
+	char small_buf[512];
+	char *src;
+	int src_len;
+	int isrc;
+	int nlines;
+
+	// error checking
+	if (str == NULL || width <= 0 || size <= 0) {
+		return 0;
+	}
+
+	/* the same text as reset_soft_breaks() works on */
+	if (len < sizeof (small_buf))
+		src = small_buf;
+	else
+		src = (char *)malloc (len + 1);
+
+	for (isrc=0, src_len=0; isrc<len; isrc++)
+	{
+		if (str[isrc] != '\r')
+			src[src_len++] = str[isrc];
+	}
+	src[src_len] = 0;
+
+	nlines = wrap_soft_breaks (src, src_len, size, zoom, width, NULL, NULL, NULL, NULL);
+
+	if (src != small_buf)
+		free (src);
+
+	return nlines;
+}
+#endif	/* CHAT_LINE_INDEX */
+
 void draw_string_small_shadowed(int x, int y,const unsigned char * our_string,int max_lines, float fr, float fg, float fb, float br, float bg, float bb)
 {
  	 int px,py;
@@ -1132,6 +1670,29 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 	get_and_set_texture_id(font_text);
 #endif	/* NEW_TEXTURES */
 
+#ifdef	GLYPH_RUN_CACHE
+	if (use_glyph_run_cache)
+	{
+		const glyph_run *run = get_glyph_run(GLYPH_RUN_INGAME, our_string,
+			strlen((const char*)our_string), displayed_font_x_size,
+			displayed_font_y_size, 0, max_lines);
+
+#ifndef SKY_FPV_OPTIONAL
+		draw_glyph_run(run, x, 0.0f, y);
+		glDisable(GL_ALPHA_TEST);
+#else // SKY_FPV_OPTIONAL
+		glMatrixMode(GL_MODELVIEW);
+		draw_glyph_run(run, hx, hy, 0.0f);
+		glDisable(GL_ALPHA_TEST);
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
+		glMatrixMode(GL_MODELVIEW);
+		glPopMatrix();
+#endif // SKY_FPV_OPTIONAL
+		return;
+	}
+#endif	/* GLYPH_RUN_CACHE */
+
 	i=0;
 #ifndef SKY_FPV_OPTIONAL
 	cur_x=x;
@@ -1278,6 +1839,47 @@ void draw_ingame_string(float x, float y,const unsigned char * our_string,
 
 #endif // SKY_FPV_OPTIONAL
 }
+
+#ifdef	GLYPH_RUN_CACHE
+int command_glyph_run_benchmark(char *text, int len)
+{
+	static const unsigned char name[] = "Some Player Name";
+	Uint32 start, times[2][2];
+	int use_cache_save = use_glyph_run_cache;
+	int i, j, pass;
+	char str[256];
+
+	// draws a full chat window and a crowded scene of name tags with
+	// and without the cache, the frame is cleared before it is shown
+	for (pass = 0; pass < 2; pass++)
+	{
+		use_glyph_run_cache = pass;
+
+		glFinish();
+		start = SDL_GetTicks();
+		for (i = 0; i < 100; i++)
+			draw_messages(0, 0, display_text_buffer, DISPLAY_TEXT_BUFFER_SIZE, FILTER_ALL,
+				0, 0, -1, window_width, window_height, 1.0f, NULL);
+		glFinish();
+		times[pass][0] = SDL_GetTicks() - start;
+
+		start = SDL_GetTicks();
+		for (i = 0; i < 100; i++)
+			for (j = 0; j < 200; j++)
+				draw_ingame_string(0.0f, 0.0f, name, 1, SMALL_INGAME_FONT_X_LEN, SMALL_INGAME_FONT_Y_LEN);
+		glFinish();
+		times[pass][1] = SDL_GetTicks() - start;
+	}
+
+	use_glyph_run_cache = use_cache_save;
+
+	safe_snprintf(str, sizeof(str), "Chat window: %.2f ms uncached, %.2f ms cached. 200 name tags: %.2f ms uncached, %.2f ms cached",
+		times[0][0] / 100.0f, times[1][0] / 100.0f, times[0][1] / 100.0f, times[1][1] / 100.0f);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* GLYPH_RUN_CACHE */
 #endif //!MAP_EDITOR_2
 #endif	//ELC
 
@@ -1340,6 +1942,9 @@ void cleanup_fonts(void)
 {
 	int i;
 
+#ifdef	GLYPH_RUN_CACHE
+	clear_glyph_run_cache();
+#endif	/* GLYPH_RUN_CACHE */
 	for(i = 0; i < FONTS_ARRAY_SIZE; i++) {
 		if(fonts[i] != NULL) {
 			free(fonts[i]);
@@ -37,6 +37,43 @@ void recolour_message(text_message *msg);
 
 void recolour_messages(text_message *msgs);
 
+#ifdef	GLYPH_RUN_CACHE
+extern int use_glyph_run_cache; /*!< draw strings from cached glyph runs */
+
+/*!
+ * \ingroup text_font
+ * \brief Frees all cached glyph runs.
+ *
+ *      Frees all cached glyph runs and their vertex buffers. Must be called
+ *      before the OpenGL context is destroyed.
+ *
+ * \callgraph
+ */
+void clear_glyph_run_cache();
+
+/*!
+ * \ingroup text_font
+ * \brief Prints the number of cached glyph runs, hits and misses.
+ *
+ * \param text	unused
+ * \param len	unused
+ * \retval int	always 1
+ * \callgraph
+ */
+int command_glyph_run_stats(char *text, int len);
+
+/*!
+ * \ingroup text_font
+ * \brief Prints the time needed to draw the chat and name tags with and without the cache.
+ *
+ * \param text	unused
+ * \param len	unused
+ * \retval int	always 1
+ * \callgraph
+ */
+int command_glyph_run_benchmark(char *text, int len);
+#endif	/* GLYPH_RUN_CACHE */
+
 
 /*!
  * \ingroup text_font
@@ -153,6 +190,24 @@ void draw_window_string (int x, int y, const unsigned char *str, int width, int
  */
 int reset_soft_breaks (char *str, int len, int size, float zoom, int width, int *cursor, float *max_line_width);
 
+#ifdef	CHAT_LINE_INDEX
+/*!
+ * \ingroup	text_font
+ * \brief   count the lines of a string without breaking it
+ *
+ *      Returns the number of lines that reset_soft_breaks() would give the string, but leaves the string as it is.
+ *
+ * \param str		the string
+ * \param len		the length of the string
+ * \param size		the size of the string buffer
+ * \param zoom		the scale factor for the text
+ * \param width		the width of the text window
+ *
+ * \retval int the number of window lines the string will use
+ */
+int count_soft_breaks (const char *str, int len, int size, float zoom, int width);
+#endif	/* CHAT_LINE_INDEX */
+
 /*!
  * \ingroup text_font
  * \brief   draws the given string \a our_string at the desired position (\a x, \a y) using a small font.
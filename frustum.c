@@ -19,6 +19,9 @@
 #include "elconfig.h"
 #include "gl_init.h"
 #include "tiles.h"
+#ifdef	OCCLUSION_CULLING
+#include "occlusion_culling.h"
+#endif	/* OCCLUSION_CULLING */
 
 // We create an enum of the sides so we don't have to call each side 0 or 1.
 // This way it makes it more understandable and readable when dealing with frustum sides.
@@ -559,6 +562,55 @@ void calculate_shadow_frustum()
 	set_cur_intersect_type(main_bbox_tree, cur_intersect_type);
 }
 
+#ifdef	SHADOW_MAP_CACHE
+/* Sets the shadow frustum from the current light view. The cached shadow
+ * map is reused while the camera moves, so the casters are not limited to
+ * the ones whose shadows fall into the view frustum. */
+void calculate_static_shadow_frustum(int check_items)
+{
+	MATRIX4x4 proj;
+	MATRIX4x4 modl;
+	MATRIX4x4 clip;
+	unsigned int cur_intersect_type;
+
+	glGetFloatv(GL_PROJECTION_MATRIX, proj);
+	glGetFloatv(GL_MODELVIEW_MATRIX, modl);
+
+	clip[ 0] = modl[ 0] * proj[ 0] + modl[ 1] * proj[ 4] + modl[ 2] * proj[ 8] + modl[ 3] * proj[12];
+	clip[ 1] = modl[ 0] * proj[ 1] + modl[ 1] * proj[ 5] + modl[ 2] * proj[ 9] + modl[ 3] * proj[13];
+	clip[ 2] = modl[ 0] * proj[ 2] + modl[ 1] * proj[ 6] + modl[ 2] * proj[10] + modl[ 3] * proj[14];
+	clip[ 3] = modl[ 0] * proj[ 3] + modl[ 1] * proj[ 7] + modl[ 2] * proj[11] + modl[ 3] * proj[15];
+
+	clip[ 4] = modl[ 4] * proj[ 0] + modl[ 5] * proj[ 4] + modl[ 6] * proj[ 8] + modl[ 7] * proj[12];
+	clip[ 5] = modl[ 4] * proj[ 1] + modl[ 5] * proj[ 5] + modl[ 6] * proj[ 9] + modl[ 7] * proj[13];
+	clip[ 6] = modl[ 4] * proj[ 2] + modl[ 5] * proj[ 6] + modl[ 6] * proj[10] + modl[ 7] * proj[14];
+	clip[ 7] = modl[ 4] * proj[ 3] + modl[ 5] * proj[ 7] + modl[ 6] * proj[11] + modl[ 7] * proj[15];
+
+	clip[ 8] = modl[ 8] * proj[ 0] + modl[ 9] * proj[ 4] + modl[10] * proj[ 8] + modl[11] * proj[12];
+	clip[ 9] = modl[ 8] * proj[ 1] + modl[ 9] * proj[ 5] + modl[10] * proj[ 9] + modl[11] * proj[13];
+	clip[10] = modl[ 8] * proj[ 2] + modl[ 9] * proj[ 6] + modl[10] * proj[10] + modl[11] * proj[14];
+	clip[11] = modl[ 8] * proj[ 3] + modl[ 9] * proj[ 7] + modl[10] * proj[11] + modl[11] * proj[15];
+
+	clip[12] = modl[12] * proj[ 0] + modl[13] * proj[ 4] + modl[14] * proj[ 8] + modl[15] * proj[12];
+	clip[13] = modl[12] * proj[ 1] + modl[13] * proj[ 5] + modl[14] * proj[ 9] + modl[15] * proj[13];
+	clip[14] = modl[12] * proj[ 2] + modl[13] * proj[ 6] + modl[14] * proj[10] + modl[15] * proj[14];
+	clip[15] = modl[12] * proj[ 3] + modl[13] * proj[ 7] + modl[14] * proj[11] + modl[15] * proj[15];
+
+	calculate_frustum_from_clip_matrix(shadow_frustum, clip);
+	cur_intersect_type = get_cur_intersect_type(main_bbox_tree);
+	set_cur_intersect_type(main_bbox_tree, INTERSECTION_TYPE_SHADOW);
+	set_frustum(main_bbox_tree, shadow_frustum, 63);
+	if (check_items)
+	{
+		main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed = 1;
+		check_bbox_tree(main_bbox_tree);
+	}
+	// calculate_shadow_frustum() has to rebuild the list for the view frustum
+	main_bbox_tree->intersect[INTERSECTION_TYPE_SHADOW].intersect_update_needed = 1;
+	set_cur_intersect_type(main_bbox_tree, cur_intersect_type);
+}
+#endif	/* SHADOW_MAP_CACHE */
+
 void calculate_light_frustum(double* modl, double* proj)
 {
 	MATRIX4x4 clip;
@@ -639,5 +691,8 @@ void CalculateFrustum()
 	set_cur_intersect_type(main_bbox_tree, INTERSECTION_TYPE_DEFAULT);
 	set_frustum(main_bbox_tree, main_frustum, 63);
 	check_bbox_tree(main_bbox_tree);
+#ifdef	OCCLUSION_CULLING
+	cull_occluded_items(main_bbox_tree, clip);
+#endif	/* OCCLUSION_CULLING */
 	set_cur_intersect_type(main_bbox_tree, cur_intersect_type);
 }
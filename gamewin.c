@@ -1087,6 +1087,7 @@ int display_game_handler (window_info *win)
 			skybox_update_colors();
 		if (skybox_show_sky)
         {
+			GL_STATE_PASS(gl_pass_sky);
 			skybox_compute_z_position();
             glPushMatrix();
             glTranslatef(0.0, 0.0, skybox_get_z_position());
@@ -1107,12 +1108,14 @@ int display_game_handler (window_info *win)
 
 		if (!dungeon && shadows_on && (is_day || lightning_falling))
 		{
+			GL_STATE_PASS(gl_pass_shadow_map);
 			render_light_view();
 			CHECK_GL_ERRORS ();
 		}
 
 		if (any_reflection > 1) // there are water tiles to display
 		{
+			GL_STATE_PASS(gl_pass_reflection);
 			draw_water_background();
 			CHECK_GL_ERRORS ();
 			if (show_reflection) display_3d_reflection ();
@@ -1135,21 +1138,28 @@ int display_game_handler (window_info *win)
 		{
 			glNormal3f (0.0f,0.0f,1.0f);
 			if (any_reflection) {
+				GL_STATE_PASS(gl_pass_reflection);
 				blend_reflection_fog();
 				draw_lake_tiles ();
 			}
 			
+			GL_STATE_PASS(gl_pass_terrain);
 			draw_tile_map();
 			CHECK_GL_ERRORS ();
+			GL_STATE_PASS(gl_pass_2d_objects);
 			display_2d_objects();
 			CHECK_GL_ERRORS();
 			anything_under_the_mouse(0, UNDER_MOUSE_NOTHING);
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_objects();
 			display_ground_objects();	
+			GL_STATE_PASS(gl_pass_actors);
 			display_actors(1, DEFAULT_RENDER_PASS);
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_alpha_objects();
 			display_blended_objects();
 		}
+		GL_STATE_PASS(gl_pass_effects);
 
 		glMatrixMode(GL_PROJECTION);
 		glPushMatrix();
@@ -1216,6 +1226,7 @@ int display_game_handler (window_info *win)
 	display_map_marks();
 
 	Enter2DMode ();
+	GL_STATE_PASS(gl_pass_ui);
 	//get the FPS, etc
 
 	if (next_fps_time<cur_time){
@@ -1314,6 +1325,13 @@ int display_game_handler (window_info *win)
 		e3d_count= e3d_total= 0;
 #endif //DEBUG
 	}
+#ifdef	GL_STATE_CACHE
+	if (show_gl_stats)
+	{
+		glColor3f (1.0f, 1.0f, 1.0f);
+		gl_state_draw_stats (win->len_x-hud_x-360, 64);
+	}
+#endif	/* GL_STATE_CACHE */
 	draw_spell_icon_strings();
 
 	CHECK_GL_ERRORS ();
@@ -2224,13 +2242,16 @@ int keypress_game_handler (window_info *win, int mx, int my, Uint32 key, Uint32
 #ifdef PAWN
 	else if (keysym == SDLK_F8)
 	{
+		static pawn_call play_with_object_pos = PAWN_MAP_CALL ("play_with_object_pos", "ii");
+		static pawn_call pawn_test = PAWN_SERVER_CALL ("pawn_test", "s");
+
 		if (object_under_mouse != -1 && thing_under_the_mouse == UNDER_MOUSE_3D_OBJ && objects_list[object_under_mouse])
 		{
-			run_pawn_map_function ("play_with_object_pos", "ii", object_under_mouse, key & ELW_SHIFT ? 1: 0);
+			run_pawn_call (&play_with_object_pos, object_under_mouse, key & ELW_SHIFT ? 1: 0);
 		}
 		else
 		{
-			run_pawn_server_function ("pawn_test", "s", "meep!");
+			run_pawn_call (&pawn_test, "meep!");
 		}
 	}
 #endif
@@ -9,6 +9,7 @@
 #include "e3d.h"
 #include "elconfig.h"
 #include "errors.h"
+#include "font.h"
 #include "framebuffer.h"
 #include "hud.h"
 #include "init.h"
@@ -64,7 +65,9 @@ struct list {
 
 void APIENTRY Emul_glDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const GLvoid *indices)
 {
-	glDrawElements(mode, count, type, indices);
+	// the parentheses bypass the draw call counting of GL_STATE_CACHE,
+	// ELglDrawRangeElementsEXT was already counted
+	(glDrawElements)(mode, count, type, indices);
 }
 
 void setup_video_mode(int fs, int mode)
@@ -450,6 +453,10 @@ void init_video()
 	}
 #endif
 
+#ifdef	GL_STATE_CACHE
+	// the context is new, nothing of the shadowed state is valid
+	gl_state_invalidate();
+#endif	/* GL_STATE_CACHE */
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
 	//glDepthFunc(GL_LEQUAL);
@@ -1078,6 +1085,10 @@ void set_new_video_mode(int fs,int mode)
 #endif
 #endif	/* NEW_TEXTURES */
 
+#ifdef	GLYPH_RUN_CACHE
+	clear_glyph_run_cache();
+#endif	/* GLYPH_RUN_CACHE */
+
 	if (use_vertex_buffers)
 	{
 		e3d_object * obj;
@@ -0,0 +1,610 @@
+#define	GL_STATE_CACHE_IMPLEMENTATION
+#include <string.h>
+#include "platform.h"
+#include "gl_state.h"
+#include "asc.h"
+#include "font.h"
+#include "load_gl_extensions.h"
+
+#define	STATE_UNKNOWN	-1
+#define	MAX_TEXTURE_UNITS	8
+
+typedef enum
+{
+	cap_alpha_test = 0,
+	cap_blend,
+	cap_color_material,
+	cap_cull_face,
+	cap_depth_test,
+	cap_fog,
+	cap_lighting,
+	cap_light0,
+	cap_light1,
+	cap_light2,
+	cap_light3,
+	cap_light4,
+	cap_light5,
+	cap_light6,
+	cap_light7,
+	cap_normalize,
+	cap_polygon_offset_fill,
+	cap_scissor_test,
+	cap_stencil_test,
+	cap_count
+} cap_index;
+
+typedef enum
+{
+	texture_cap_2d = 0,
+	texture_cap_gen_s,
+	texture_cap_gen_t,
+	texture_cap_gen_r,
+	texture_cap_gen_q,
+	texture_cap_count
+} texture_cap_index;
+
+typedef enum
+{
+	client_vertex_array = 0,
+	client_normal_array,
+	client_color_array,
+	client_count
+} client_index;
+
+typedef struct
+{
+	Sint8 caps[cap_count];
+	Sint8 texture_caps[MAX_TEXTURE_UNITS][texture_cap_count];
+	Sint8 client_states[client_count];
+	Sint8 texture_coord_arrays[MAX_TEXTURE_UNITS];
+	Sint32 active_texture;
+	Sint32 client_active_texture;
+	Sint64 textures[MAX_TEXTURE_UNITS];
+	Sint64 array_buffer;
+	Sint64 element_array_buffer;
+	Sint32 alpha_func;
+	GLclampf alpha_ref;
+	Sint32 blend_src;
+	Sint32 blend_dst;
+	Uint32 recording_list;
+} gl_shadow_state;
+
+static gl_shadow_state state;
+static gl_pass_stats stats[gl_pass_count];
+static gl_pass_stats last_frame_stats[gl_pass_count];
+static gl_render_pass cur_pass = gl_pass_other;
+int show_gl_stats = 0;
+
+static const char* pass_names[gl_pass_count] =
+{
+	"other", "sky", "shadow map", "reflection", "terrain", "2d objects",
+	"3d objects", "actors", "effects", "ui"
+};
+
+static __inline__ int get_cap_index(const GLenum cap)
+{
+	switch (cap)
+	{
+		case GL_ALPHA_TEST: return cap_alpha_test;
+		case GL_BLEND: return cap_blend;
+		case GL_COLOR_MATERIAL: return cap_color_material;
+		case GL_CULL_FACE: return cap_cull_face;
+		case GL_DEPTH_TEST: return cap_depth_test;
+		case GL_FOG: return cap_fog;
+		case GL_LIGHTING: return cap_lighting;
+		case GL_LIGHT0: return cap_light0;
+		case GL_LIGHT1: return cap_light1;
+		case GL_LIGHT2: return cap_light2;
+		case GL_LIGHT3: return cap_light3;
+		case GL_LIGHT4: return cap_light4;
+		case GL_LIGHT5: return cap_light5;
+		case GL_LIGHT6: return cap_light6;
+		case GL_LIGHT7: return cap_light7;
+		case GL_NORMALIZE: return cap_normalize;
+		case GL_POLYGON_OFFSET_FILL: return cap_polygon_offset_fill;
+		case GL_SCISSOR_TEST: return cap_scissor_test;
+		case GL_STENCIL_TEST: return cap_stencil_test;
+		default: return -1;
+	}
+}
+
+static __inline__ int get_texture_cap_index(const GLenum cap)
+{
+	switch (cap)
+	{
+		case GL_TEXTURE_2D: return texture_cap_2d;
+		case GL_TEXTURE_GEN_S: return texture_cap_gen_s;
+		case GL_TEXTURE_GEN_T: return texture_cap_gen_t;
+		case GL_TEXTURE_GEN_R: return texture_cap_gen_r;
+		case GL_TEXTURE_GEN_Q: return texture_cap_gen_q;
+		default: return -1;
+	}
+}
+
+static __inline__ int get_client_index(const GLenum array)
+{
+	switch (array)
+	{
+		case GL_VERTEX_ARRAY: return client_vertex_array;
+		case GL_NORMAL_ARRAY: return client_normal_array;
+		case GL_COLOR_ARRAY: return client_color_array;
+		default: return -1;
+	}
+}
+
+static __inline__ void invalidate_client_state()
+{
+	memset(state.client_states, STATE_UNKNOWN, sizeof(state.client_states));
+	memset(state.texture_coord_arrays, STATE_UNKNOWN,
+		sizeof(state.texture_coord_arrays));
+	state.client_active_texture = STATE_UNKNOWN;
+}
+
+static __inline__ void invalidate_server_state()
+{
+	Uint32 i;
+
+	memset(state.caps, STATE_UNKNOWN, sizeof(state.caps));
+	memset(state.texture_caps, STATE_UNKNOWN, sizeof(state.texture_caps));
+	state.active_texture = STATE_UNKNOWN;
+	state.alpha_func = STATE_UNKNOWN;
+	state.blend_src = STATE_UNKNOWN;
+	state.blend_dst = STATE_UNKNOWN;
+
+	for (i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		state.textures[i] = STATE_UNKNOWN;
+	}
+}
+
+static __inline__ void invalidate_buffers()
+{
+	state.array_buffer = STATE_UNKNOWN;
+	state.element_array_buffer = STATE_UNKNOWN;
+}
+
+void gl_state_invalidate()
+{
+	invalidate_server_state();
+	invalidate_client_state();
+	invalidate_buffers();
+}
+
+void gl_state_set_pass(const gl_render_pass pass)
+{
+	if (pass < gl_pass_count)
+	{
+		cur_pass = pass;
+	}
+}
+
+void gl_state_end_frame()
+{
+	memcpy(last_frame_stats, stats, sizeof(stats));
+	memset(stats, 0, sizeof(stats));
+	cur_pass = gl_pass_other;
+	gl_state_invalidate();
+}
+
+const gl_pass_stats* gl_state_get_stats(const gl_render_pass pass)
+{
+	if (pass >= gl_pass_count)
+	{
+		return 0;
+	}
+
+	return &last_frame_stats[pass];
+}
+
+const char* gl_state_get_pass_name(const gl_render_pass pass)
+{
+	if (pass >= gl_pass_count)
+	{
+		return "";
+	}
+
+	return pass_names[pass];
+}
+
+void gl_state_draw_stats(const int x, const int y)
+{
+	gl_pass_stats total;
+	char str[128];
+	Uint32 i, line;
+
+	memset(&total, 0, sizeof(total));
+
+	draw_string_small(x, y, (const unsigned char*)"pass: states/requested binds buffers draws", 1);
+
+	line = 1;
+
+	for (i = 0; i < gl_pass_count; i++)
+	{
+		total.state_calls += last_frame_stats[i].state_calls;
+		total.state_changes += last_frame_stats[i].state_changes;
+		total.texture_binds += last_frame_stats[i].texture_binds;
+		total.buffer_binds += last_frame_stats[i].buffer_binds;
+		total.draw_calls += last_frame_stats[i].draw_calls;
+
+		if (last_frame_stats[i].state_calls == 0)
+		{
+			continue;
+		}
+
+		safe_snprintf(str, sizeof(str), "%s: %d/%d %d %d %d", pass_names[i],
+			last_frame_stats[i].state_changes,
+			last_frame_stats[i].state_calls,
+			last_frame_stats[i].texture_binds,
+			last_frame_stats[i].buffer_binds,
+			last_frame_stats[i].draw_calls);
+		draw_string_small(x, y + line * SMALL_FONT_Y_LEN, (const unsigned char*)str, 1);
+		line++;
+	}
+
+	safe_snprintf(str, sizeof(str), "total: %d/%d %d %d %d",
+		total.state_changes, total.state_calls, total.texture_binds,
+		total.buffer_binds, total.draw_calls);
+	draw_string_small(x, y + line * SMALL_FONT_Y_LEN, (const unsigned char*)str, 1);
+}
+
+static __inline__ Sint8* get_cap_state(const GLenum cap)
+{
+	int idx;
+
+	idx = get_cap_index(cap);
+
+	if (idx >= 0)
+	{
+		return &state.caps[idx];
+	}
+
+	idx = get_texture_cap_index(cap);
+
+	if ((idx >= 0) && (state.active_texture >= 0))
+	{
+		return &state.texture_caps[state.active_texture][idx];
+	}
+
+	return 0;
+}
+
+/* While a display list is compiled nothing is executed, so the shadowed
+ * state is only updated outside of glNewList/glEndList. */
+static __inline__ void set_cap(const GLenum cap, const Sint8 value)
+{
+	Sint8* cur;
+
+	stats[cur_pass].state_calls++;
+
+	cur = get_cap_state(cap);
+
+	if (state.recording_list == 0)
+	{
+		if (cur != 0)
+		{
+			if (*cur == value)
+			{
+				return;
+			}
+
+			*cur = value;
+		}
+	}
+
+	stats[cur_pass].state_changes++;
+
+	if (value)
+	{
+		glEnable(cap);
+	}
+	else
+	{
+		glDisable(cap);
+	}
+}
+
+void gl_state_enable(const GLenum cap)
+{
+	set_cap(cap, 1);
+}
+
+void gl_state_disable(const GLenum cap)
+{
+	set_cap(cap, 0);
+}
+
+void gl_state_alpha_func(const GLenum func, const GLclampf ref)
+{
+	stats[cur_pass].state_calls++;
+
+	if (state.recording_list == 0)
+	{
+		if ((state.alpha_func == func) && (state.alpha_ref == ref))
+		{
+			return;
+		}
+
+		state.alpha_func = func;
+		state.alpha_ref = ref;
+	}
+
+	stats[cur_pass].state_changes++;
+	glAlphaFunc(func, ref);
+}
+
+void gl_state_blend_func(const GLenum sfactor, const GLenum dfactor)
+{
+	stats[cur_pass].state_calls++;
+
+	if (state.recording_list == 0)
+	{
+		if ((state.blend_src == sfactor) && (state.blend_dst == dfactor))
+		{
+			return;
+		}
+
+		state.blend_src = sfactor;
+		state.blend_dst = dfactor;
+	}
+
+	stats[cur_pass].state_changes++;
+	glBlendFunc(sfactor, dfactor);
+}
+
+static __inline__ Sint8* get_client_state(const GLenum array)
+{
+	int idx;
+
+	idx = get_client_index(array);
+
+	if (idx >= 0)
+	{
+		return &state.client_states[idx];
+	}
+
+	if ((array == GL_TEXTURE_COORD_ARRAY) &&
+		(state.client_active_texture >= 0))
+	{
+		return &state.texture_coord_arrays[state.client_active_texture];
+	}
+
+	return 0;
+}
+
+static __inline__ void set_client_state(const GLenum array, const Sint8 value)
+{
+	Sint8* cur;
+
+	stats[cur_pass].state_calls++;
+
+	cur = get_client_state(array);
+
+	if (cur != 0)
+	{
+		if (*cur == value)
+		{
+			return;
+		}
+
+		*cur = value;
+	}
+
+	stats[cur_pass].state_changes++;
+
+	if (value)
+	{
+		glEnableClientState(array);
+	}
+	else
+	{
+		glDisableClientState(array);
+	}
+}
+
+void gl_state_enable_client_state(const GLenum array)
+{
+	set_client_state(array, 1);
+}
+
+void gl_state_disable_client_state(const GLenum array)
+{
+	set_client_state(array, 0);
+}
+
+void gl_state_interleaved_arrays(const GLenum format, const GLsizei stride,
+	const GLvoid* pointer)
+{
+	/* glInterleavedArrays enables and disables client arrays depending
+	 * on the format, so we don't know their state afterwards. */
+	stats[cur_pass].state_calls++;
+	stats[cur_pass].state_changes++;
+	glInterleavedArrays(format, stride, pointer);
+	memset(state.client_states, STATE_UNKNOWN, sizeof(state.client_states));
+	memset(state.texture_coord_arrays, STATE_UNKNOWN,
+		sizeof(state.texture_coord_arrays));
+}
+
+static __inline__ Sint32 get_texture_unit(const GLenum texture)
+{
+	if ((texture >= GL_TEXTURE0_ARB) &&
+		(texture < (GL_TEXTURE0_ARB + MAX_TEXTURE_UNITS)))
+	{
+		return texture - GL_TEXTURE0_ARB;
+	}
+
+	return STATE_UNKNOWN;
+}
+
+void gl_state_active_texture(const GLenum texture)
+{
+	Sint32 unit;
+
+	stats[cur_pass].state_calls++;
+
+	unit = get_texture_unit(texture);
+
+	if (state.recording_list == 0)
+	{
+		if ((unit >= 0) && (state.active_texture == unit))
+		{
+			return;
+		}
+
+		state.active_texture = unit;
+	}
+
+	stats[cur_pass].state_changes++;
+	ELglActiveTextureARB(texture);
+}
+
+void gl_state_client_active_texture(const GLenum texture)
+{
+	Sint32 unit;
+
+	stats[cur_pass].state_calls++;
+
+	unit = get_texture_unit(texture);
+
+	if ((unit >= 0) && (state.client_active_texture == unit))
+	{
+		return;
+	}
+
+	state.client_active_texture = unit;
+	stats[cur_pass].state_changes++;
+	ELglClientActiveTextureARB(texture);
+}
+
+void gl_state_bind_texture(const GLenum target, const GLuint texture)
+{
+	if ((target == GL_TEXTURE_2D) && (state.recording_list == 0) &&
+		(state.active_texture >= 0))
+	{
+		if (state.textures[state.active_texture] == texture)
+		{
+			return;
+		}
+
+		state.textures[state.active_texture] = texture;
+	}
+
+	stats[cur_pass].texture_binds++;
+	glBindTexture(target, texture);
+}
+
+void gl_state_delete_textures(const GLsizei n, const GLuint* textures)
+{
+	Uint32 i;
+
+	/* deleting a bound texture binds zero, a new texture can get the
+	 * same name afterwards */
+	for (i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		state.textures[i] = STATE_UNKNOWN;
+	}
+
+	glDeleteTextures(n, textures);
+}
+
+void gl_state_bind_buffer(const GLenum target, const GLuint buffer)
+{
+	Sint64* cur;
+
+	switch (target)
+	{
+		case GL_ARRAY_BUFFER_ARB:
+			cur = &state.array_buffer;
+			break;
+		case GL_ELEMENT_ARRAY_BUFFER_ARB:
+			cur = &state.element_array_buffer;
+			break;
+		default:
+			cur = 0;
+			break;
+	}
+
+	if (cur != 0)
+	{
+		if (*cur == buffer)
+		{
+			return;
+		}
+
+		*cur = buffer;
+	}
+
+	stats[cur_pass].buffer_binds++;
+	ELglBindBufferARB(target, buffer);
+}
+
+void gl_state_delete_buffers(const GLsizei n, const GLuint* buffers)
+{
+	invalidate_buffers();
+	ELglDeleteBuffersARB(n, buffers);
+}
+
+void gl_state_draw_arrays(const GLenum mode, const GLint first,
+	const GLsizei count)
+{
+	stats[cur_pass].draw_calls++;
+	glDrawArrays(mode, first, count);
+}
+
+void gl_state_draw_elements(const GLenum mode, const GLsizei count,
+	const GLenum type, const GLvoid* indices)
+{
+	stats[cur_pass].draw_calls++;
+	glDrawElements(mode, count, type, indices);
+}
+
+void gl_state_draw_range_elements(const GLenum mode, const GLuint start,
+	const GLuint end, const GLsizei count, const GLenum type,
+	const GLvoid* indices)
+{
+	stats[cur_pass].draw_calls++;
+	ELglDrawRangeElementsEXT(mode, start, end, count, type, indices);
+}
+
+void gl_state_begin(const GLenum mode)
+{
+	if (state.recording_list == 0)
+	{
+		stats[cur_pass].draw_calls++;
+	}
+
+	glBegin(mode);
+}
+
+void gl_state_pop_attrib()
+{
+	glPopAttrib();
+	invalidate_server_state();
+}
+
+void gl_state_pop_client_attrib()
+{
+	glPopClientAttrib();
+	invalidate_client_state();
+	invalidate_buffers();
+}
+
+void gl_state_new_list(const GLuint list, const GLenum mode)
+{
+	glNewList(list, mode);
+	state.recording_list = 1;
+}
+
+void gl_state_end_list()
+{
+	glEndList();
+	state.recording_list = 0;
+	/* a list compiled with GL_COMPILE_AND_EXECUTE changed the state */
+	invalidate_server_state();
+}
+
+void gl_state_call_list(const GLuint list)
+{
+	stats[cur_pass].draw_calls++;
+	glCallList(list);
+	invalidate_server_state();
+}
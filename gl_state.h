@@ -0,0 +1,177 @@
+/*!
+ * \file
+ * \ingroup video
+ * \brief Shadowed OpenGL state to drop redundant state changes.
+ *
+ * With GL_STATE_CACHE defined, the commonly used state functions are
+ * redirected to functions that remember the last value set and only call
+ * OpenGL when it really changes. The number of state changes, texture and
+ * buffer binds and draw calls is counted per render pass.
+ */
+#ifndef	__GL_STATE_H__
+#define	__GL_STATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ * The render passes the statistics are split into.
+ */
+typedef enum
+{
+	gl_pass_other = 0,
+	gl_pass_sky,
+	gl_pass_shadow_map,
+	gl_pass_reflection,
+	gl_pass_terrain,
+	gl_pass_2d_objects,
+	gl_pass_3d_objects,
+	gl_pass_actors,
+	gl_pass_effects,
+	gl_pass_ui,
+	gl_pass_count
+} gl_render_pass;
+
+#ifdef	GL_STATE_CACHE
+
+/*!
+ * The counters of one render pass.
+ */
+typedef struct
+{
+	Uint32 state_calls;	/*!< state changes requested */
+	Uint32 state_changes;	/*!< state changes passed to OpenGL */
+	Uint32 texture_binds;	/*!< textures bound */
+	Uint32 buffer_binds;	/*!< buffer objects bound */
+	Uint32 draw_calls;	/*!< glDrawArrays, glDrawElements and glBegin calls */
+} gl_pass_stats;
+
+extern int show_gl_stats; /*!< show the state statistics of the last frame */
+
+/*!
+ * \ingroup video
+ * \brief Forgets all shadowed state.
+ *
+ *      Marks all shadowed state as unknown, so the next call for each
+ *      state is passed to OpenGL. Must be called when the context is
+ *      recreated.
+ *
+ * \callgraph
+ */
+void gl_state_invalidate();
+
+/*!
+ * \ingroup video
+ * \brief Sets the render pass the following calls are counted for.
+ *
+ * \param pass	the render pass
+ */
+void gl_state_set_pass(const gl_render_pass pass);
+
+/*!
+ * \ingroup video
+ * \brief Ends the current frame.
+ *
+ *      Saves the counters of this frame for display, resets them and
+ *      invalidates the shadowed state, so state changed outside of the
+ *      client code can't stay out of sync for longer than one frame.
+ *
+ * \callgraph
+ */
+void gl_state_end_frame();
+
+/*!
+ * \ingroup video
+ * \brief Gets the counters of the last frame.
+ *
+ * \param pass	the render pass
+ * \retval gl_pass_stats*	the counters of the pass
+ */
+const gl_pass_stats* gl_state_get_stats(const gl_render_pass pass);
+
+/*!
+ * \ingroup video
+ * \brief Gets the name of a render pass.
+ *
+ * \param pass	the render pass
+ * \retval char*	the name of the pass
+ */
+const char* gl_state_get_pass_name(const gl_render_pass pass);
+
+/*!
+ * \ingroup video
+ * \brief Draws the state statistics of the last frame.
+ *
+ * \param x	the x position of the first line
+ * \param y	the y position of the first line
+ * \callgraph
+ */
+void gl_state_draw_stats(const int x, const int y);
+
+void gl_state_enable(const GLenum cap);
+void gl_state_disable(const GLenum cap);
+void gl_state_alpha_func(const GLenum func, const GLclampf ref);
+void gl_state_blend_func(const GLenum sfactor, const GLenum dfactor);
+void gl_state_enable_client_state(const GLenum array);
+void gl_state_disable_client_state(const GLenum array);
+void gl_state_interleaved_arrays(const GLenum format, const GLsizei stride,
+	const GLvoid* pointer);
+void gl_state_active_texture(const GLenum texture);
+void gl_state_client_active_texture(const GLenum texture);
+void gl_state_bind_texture(const GLenum target, const GLuint texture);
+void gl_state_delete_textures(const GLsizei n, const GLuint* textures);
+void gl_state_bind_buffer(const GLenum target, const GLuint buffer);
+void gl_state_delete_buffers(const GLsizei n, const GLuint* buffers);
+void gl_state_draw_arrays(const GLenum mode, const GLint first,
+	const GLsizei count);
+void gl_state_draw_elements(const GLenum mode, const GLsizei count,
+	const GLenum type, const GLvoid* indices);
+void gl_state_draw_range_elements(const GLenum mode, const GLuint start,
+	const GLuint end, const GLsizei count, const GLenum type,
+	const GLvoid* indices);
+void gl_state_begin(const GLenum mode);
+void gl_state_pop_attrib();
+void gl_state_pop_client_attrib();
+void gl_state_new_list(const GLuint list, const GLenum mode);
+void gl_state_end_list();
+void gl_state_call_list(const GLuint list);
+
+#define	GL_STATE_PASS(pass) gl_state_set_pass(pass)
+
+#ifndef	GL_STATE_CACHE_IMPLEMENTATION
+#define	glEnable(cap) gl_state_enable(cap)
+#define	glDisable(cap) gl_state_disable(cap)
+#define	glAlphaFunc(func, ref) gl_state_alpha_func(func, ref)
+#define	glBlendFunc(sfactor, dfactor) gl_state_blend_func(sfactor, dfactor)
+#define	glEnableClientState(array) gl_state_enable_client_state(array)
+#define	glDisableClientState(array) gl_state_disable_client_state(array)
+#define	glInterleavedArrays(format, stride, pointer) gl_state_interleaved_arrays(format, stride, pointer)
+#define	glBindTexture(target, texture) gl_state_bind_texture(target, texture)
+#define	glDeleteTextures(n, textures) gl_state_delete_textures(n, textures)
+#define	glDrawArrays(mode, first, count) gl_state_draw_arrays(mode, first, count)
+#define	glDrawElements(mode, count, type, indices) gl_state_draw_elements(mode, count, type, indices)
+#define	glBegin(mode) gl_state_begin(mode)
+#define	glPopAttrib() gl_state_pop_attrib()
+#define	glPopClientAttrib() gl_state_pop_client_attrib()
+#define	glNewList(list, mode) gl_state_new_list(list, mode)
+#define	glEndList() gl_state_end_list()
+#define	glCallList(list) gl_state_call_list(list)
+#define	ELglActiveTextureARB(texture) gl_state_active_texture(texture)
+#define	ELglClientActiveTextureARB(texture) gl_state_client_active_texture(texture)
+#define	ELglBindBufferARB(target, buffer) gl_state_bind_buffer(target, buffer)
+#define	ELglDeleteBuffersARB(n, buffers) gl_state_delete_buffers(n, buffers)
+#define	ELglDrawRangeElementsEXT(mode, start, end, count, type, indices) gl_state_draw_range_elements(mode, start, end, count, type, indices)
+#endif	/* GL_STATE_CACHE_IMPLEMENTATION */
+
+#else	/* GL_STATE_CACHE */
+
+#define	GL_STATE_PASS(pass)
+
+#endif	/* GL_STATE_CACHE */
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif	/* __GL_STATE_H__ */
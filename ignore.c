@@ -10,11 +10,49 @@
 #include "translate.h"
 #include "errors.h"
 #include "io/elpathwrapper.h"
+#ifdef	ACTOR_SOCIAL_FLAGS
+#include "actors.h"
+#endif	/* ACTOR_SOCIAL_FLAGS */
+#ifdef	FAST_CHAT_FILTER
+#include "hash.h"
+#endif	/* FAST_CHAT_FILTER */
 
 ignore_slot ignore_list[MAX_IGNORES];
 int ignored_so_far=0;
 int save_ignores=1;
 int use_global_ignores=1;
+#ifdef	FAST_CHAT_FILTER
+int use_compiled_filters=1;
+
+/* The names of ignore_list, the case of the letters doesn't matter */
+static hash_table *ignore_names=NULL;
+
+static unsigned long int hash_fn_name(void *key)
+{
+	unsigned long int hash = 5381;
+	char c;
+	char *k=(char*)key;
+
+	while ( (c=*k++) )
+	{
+		if(c>=65 && c<=90)c+=32;//make lowercase
+		hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+	}
+
+	return hash;
+}
+
+static int cmp_fn_name(void *key1, void *key2)
+{
+	return my_strcompare((char*)key1, (char*)key2);
+}
+
+/* The items are the slots of ignore_list, but destroy_hash_table() only
+ * frees the entries if there is a free function. */
+static void free_fn_name(void *item)
+{
+}
+#endif	/* FAST_CHAT_FILTER */
 
 //returns -1 if the name is already ignored, 1 on sucess, -2 if no more ignore slots
 int add_to_ignore_list(char *name, char save_name)
@@ -53,6 +91,14 @@ int add_to_ignore_list(char *name, char save_name)
 						}
 					ignore_list[i].used=1;//mark as used
 					ignored_so_far++;
+#ifdef	FAST_CHAT_FILTER
+					if(!ignore_names)
+						ignore_names=create_hash_table(2*MAX_IGNORES,hash_fn_name,cmp_fn_name,free_fn_name);
+					hash_add(ignore_names,ignore_list[i].name,&ignore_list[i]);
+#endif	/* FAST_CHAT_FILTER */
+#ifdef	ACTOR_SOCIAL_FLAGS
+					invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 					return 1;
 				}
 		}
@@ -75,6 +121,12 @@ int remove_from_ignore_list(char *name)
 						ignore_list[i].used=0;
 						found = 1;
 						ignored_so_far--;
+#ifdef	FAST_CHAT_FILTER
+						hash_delete(ignore_names,ignore_list[i].name);
+#endif	/* FAST_CHAT_FILTER */
+#ifdef	ACTOR_SOCIAL_FLAGS
+						invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 					}
 		}
 	if(found)
@@ -105,6 +157,11 @@ int check_if_ignored (const char *name)
 {
 	int i;
 
+#ifdef	FAST_CHAT_FILTER
+	if (use_compiled_filters)
+		return (ignore_names && hash_get(ignore_names, (void*)name)) ? 1 : 0;
+#endif	/* FAST_CHAT_FILTER */
+
 	for (i = 0; i < MAX_IGNORES; i++)
 	{
 		if (ignore_list[i].used && my_strcompare(ignore_list[i].name, name))
@@ -332,6 +389,13 @@ void clear_ignore_list()
 	//see if this name is already on the list
 	for(i=0;i<MAX_IGNORES;i++)
 		ignore_list[i].used=0;
+#ifdef	FAST_CHAT_FILTER
+	destroy_hash_table(ignore_names);
+	ignore_names=NULL;
+#endif	/* FAST_CHAT_FILTER */
+#ifdef	ACTOR_SOCIAL_FLAGS
+	invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 }
 
 
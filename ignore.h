@@ -30,6 +30,9 @@ extern ignore_slot ignore_list[MAX_IGNORES]; /*!< global array of names to ignor
 
 extern int save_ignores; /*!< flag, inidicating whether the ignores should be persisted between different executions. */
 extern int use_global_ignores; /*!< flag, indicating whether to use global ignores file or not */
+#ifdef	FAST_CHAT_FILTER
+extern int use_compiled_filters; /*!< flag, indicating whether to use the filter automaton and the ignore hash, only #filter_bench turns it off */
+#endif	/* FAST_CHAT_FILTER */
 
 /*!
  * \ingroup actors_utils
@@ -69,6 +72,22 @@ int remove_from_ignore_list(char *name);
 int check_if_ignored (const char *name);
 
 
+/*!
+ * \ingroup actors_utils
+ * \brief   Copies the name at \a offset of \a input_text.
+ *
+ *      Copies the name at \a offset of \a input_text up to the first character that ends a name of this \a type.
+ *
+ * \param input_text    the message with the name
+ * \param len		the length of \a input_text
+ * \param type          0 for ':' or ' ', 1 for ':', ' ' or a color, 2 for spaces, 3 for ':', ' ' or ']', 4 for ':', '-' or ' '
+ * \param offset        the start of the name in \a input_text
+ * \param name          the buffer for the name, MAX_USERNAME_LENGTH chars
+ * \retval int          the length of the name
+ */
+int get_name_from_text(const char * input_text, int len, int type, int offset, char * name);
+
+
 /*!
  * \ingroup actors_utils
  * \brief   Checks if the sender of \a input_text is already ignored.
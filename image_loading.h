@@ -79,6 +79,22 @@ typedef struct
  */
 Uint32 check_image_name(const char* file_name, const Uint32 size, char* buffer);
 
+/**
+ * @ingroup textures
+ * @brief Checks for an alpha map image
+ *
+ * Replaces the file extension of the file_name with "_alpha" and the supported
+ * file extensions and then checks if the file exists. If so, copy the name of
+ * the file into buffer and returns 1, else returns 0.
+ * @param file_name The file name of the image.
+ * @param size The size of the buffer.
+ * @param buffer The buffer for the found file name.
+ * @return Zero if the file was not found or the buffer is too small, else one.
+ * @callgraph
+ */
+Uint32 check_alpha_image_name(const char* file_name, const Uint32 size,
+	char* buffer);
+
 /**
  * @ingroup textures
  * @brief Returns the length of a filename without file extension.
@@ -86,6 +86,9 @@
 #include "image_loading.h"
 #endif	/* NEW_TEXTURES */
 #include "io/fileutil.h"
+#ifdef	PARALLEL_XZ
+#include "io/xz_blocks.h"
+#endif	/* PARALLEL_XZ */
 #ifdef  CUSTOM_UPDATE
 #include "custom_update.h"
 #endif  //CUSTOM_UPDATE
@@ -724,6 +727,9 @@ void init_stuff()
 	}
 
 	init_crc_tables();
+#ifdef	PARALLEL_XZ
+	init_xz_threads();
+#endif	/* PARALLEL_XZ */
 	init_zip_archives();
 
 	// initialize the text buffers - needed early for logging
@@ -764,6 +770,9 @@ void init_stuff()
 
 	// load the named colours for the elgl-Colour-() functions
 	init_named_colours();
+#ifdef	ACTOR_SOCIAL_FLAGS
+	invalidate_actor_social_flags();
+#endif	/* ACTOR_SOCIAL_FLAGS */
 
 	// initialize the fonts, but don't load the textures yet. Do that here
 	// because the messages need the font widths.
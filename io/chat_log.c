@@ -0,0 +1,1034 @@
+#include "chat_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef	WINDOWS
+#include <io.h>
+#else	/* WINDOWS */
+#include <unistd.h>
+#endif	/* WINDOWS */
+#ifdef	ELC
+#include <SDL.h>
+#include "elpathwrapper.h"
+#include "../asc.h"
+#include "../client_serv.h"
+#include "../elconfig.h"
+#include "../errors.h"
+#include "../misc.h"
+#include "../text.h"
+#include "../translate.h"
+#endif	/* ELC */
+
+#define CHAT_LOG_SEARCH_RECORDS	1024
+
+static Uint8 lower_case(const Uint8 ch)
+{
+	if ((ch >= 'A') && (ch <= 'Z'))
+	{
+		return ch + 32;
+	}
+
+	return ch;
+}
+
+static void write_index_record(Uint8* record, const chat_log_line_t* line)
+{
+	Uint32 i;
+
+	for (i = 0; i < 4; i++)
+	{
+		record[i] = line->time >> (i * 8);
+		record[i + 4] = line->sender >> (i * 8);
+		record[i + 8] = line->length >> (i * 8);
+	}
+
+	for (i = 0; i < 8; i++)
+	{
+		record[i + 12] = line->offset >> (i * 8);
+	}
+
+	record[20] = line->channel;
+	record[21] = 0;
+	record[22] = 0;
+	record[23] = 0;
+}
+
+static void read_index_record(const Uint8* record, chat_log_line_t* line)
+{
+	Uint32 i;
+
+	memset(line, 0, sizeof(chat_log_line_t));
+
+	for (i = 0; i < 4; i++)
+	{
+		line->time |= (Uint32)record[i] << (i * 8);
+		line->sender |= (Uint32)record[i + 4] << (i * 8);
+		line->length |= (Uint32)record[i + 8] << (i * 8);
+	}
+
+	for (i = 0; i < 8; i++)
+	{
+		line->offset |= (Uint64)record[i + 12] << (i * 8);
+	}
+
+	line->channel = record[20];
+}
+
+static int read_index(FILE* index, const Uint32 number,
+	chat_log_line_t* line)
+{
+	Uint8 record[CHAT_LOG_INDEX_RECORD_SIZE];
+
+	if ((fseek(index, (long)number * CHAT_LOG_INDEX_RECORD_SIZE,
+		SEEK_SET) != 0) || (fread(record, sizeof(record), 1, index) != 1))
+	{
+		return -1;
+	}
+
+	read_index_record(record, line);
+
+	return 0;
+}
+
+static Uint64 get_stream_size(FILE* file)
+{
+	long size;
+
+	if (fseek(file, 0, SEEK_END) != 0)
+	{
+		return 0;
+	}
+
+	size = ftell(file);
+
+	if (size < 0)
+	{
+		return 0;
+	}
+
+	return size;
+}
+
+static int truncate_file(FILE* file, const Uint64 size)
+{
+	fflush(file);
+
+#ifdef	WINDOWS
+	return _chsize(_fileno(file), size);
+#else	/* WINDOWS */
+	return ftruncate(fileno(file), size);
+#endif	/* WINDOWS */
+}
+
+Uint32 chat_log_sender_hash(const char* name, const Uint32 length)
+{
+	Uint32 i, hash;
+
+	hash = 2166136261U;
+
+	for (i = 0; i < length; i++)
+	{
+		hash = (hash ^ lower_case(name[i])) * 16777619U;
+	}
+
+	return hash;
+}
+
+char* chat_log_batch_reserve(chat_log_batch_t* batch, const Uint32 size)
+{
+	if ((batch->text_used + size) > batch->text_size)
+	{
+		batch->text_size = (batch->text_used + size) * 2 + 4096;
+		batch->text = realloc(batch->text, batch->text_size);
+	}
+
+	return batch->text + batch->text_used;
+}
+
+void chat_log_batch_add_line(chat_log_batch_t* batch, const Uint32 length,
+	const Uint32 time, const Uint8 channel, const Uint32 sender)
+{
+	chat_log_line_t* line;
+
+	if (batch->line_count >= batch->line_size)
+	{
+		batch->line_size = batch->line_size * 2 + 64;
+		batch->lines = realloc(batch->lines, batch->line_size *
+			sizeof(chat_log_line_t));
+	}
+
+	line = &batch->lines[batch->line_count];
+	line->offset = batch->text_used;
+	line->length = length + 1;
+	line->time = time;
+	line->sender = sender;
+	line->channel = channel;
+
+	batch->text[batch->text_used + length] = '\n';
+	batch->text_used += length + 1;
+	batch->line_count++;
+}
+
+void chat_log_batch_add_text(chat_log_batch_t* batch, const char* text,
+	const Uint32 length)
+{
+	memcpy(chat_log_batch_reserve(batch, length), text, length);
+	batch->text_used += length;
+}
+
+void chat_log_batch_free(chat_log_batch_t* batch)
+{
+	free(batch->text);
+	free(batch->lines);
+
+	memset(batch, 0, sizeof(chat_log_batch_t));
+}
+
+int chat_log_store_open(chat_log_store_t* store, FILE* log, FILE* index)
+{
+	chat_log_line_t line;
+	Uint64 index_size;
+	Uint32 count;
+
+	memset(store, 0, sizeof(chat_log_store_t));
+
+	store->log = log;
+	store->index = index;
+	store->log_size = get_stream_size(log);
+
+	if (store->log_size > 0)
+	{
+		fseek(log, store->log_size - 1, SEEK_SET);
+		store->needs_new_line = fgetc(log) != '\n';
+	}
+
+	index_size = get_stream_size(index);
+	count = index_size / CHAT_LOG_INDEX_RECORD_SIZE;
+
+	/*
+	 * Only the last records can be missing in the log, because the log is
+	 * always written first.
+	 */
+	while (count > 0)
+	{
+		if (read_index(index, count - 1, &line) != 0)
+		{
+			chat_log_store_close(store);
+
+			return -1;
+		}
+
+		if ((line.length > 0) &&
+			((line.offset + line.length) <= store->log_size))
+		{
+			fseek(log, line.offset + line.length - 1, SEEK_SET);
+
+			if (fgetc(log) == '\n')
+			{
+				store->last_time = line.time;
+				break;
+			}
+		}
+
+		count--;
+	}
+
+	if ((count * CHAT_LOG_INDEX_RECORD_SIZE) != index_size)
+	{
+		if (truncate_file(index, count * CHAT_LOG_INDEX_RECORD_SIZE)
+			!= 0)
+		{
+			chat_log_store_close(store);
+
+			return -1;
+		}
+	}
+
+	store->line_count = count;
+
+	fseek(log, 0, SEEK_END);
+
+	return 0;
+}
+
+int chat_log_store_commit(chat_log_store_t* store, chat_log_batch_t* batch)
+{
+	Uint8* records;
+	Uint64 offset;
+	Uint32 i;
+	int result;
+
+	if (batch->text_used == 0)
+	{
+		return 0;
+	}
+
+	result = 0;
+	offset = store->log_size;
+
+	fseek(store->log, 0, SEEK_END);
+
+	if (store->needs_new_line)
+	{
+		fputc('\n', store->log);
+		offset++;
+	}
+
+	if ((fwrite(batch->text, batch->text_used, 1, store->log) != 1) ||
+		(fflush(store->log) != 0))
+	{
+		store->log_size = get_stream_size(store->log);
+		store->needs_new_line = 1;
+		batch->text_used = 0;
+		batch->line_count = 0;
+
+		return -1;
+	}
+
+	store->log_size = offset + batch->text_used;
+	store->needs_new_line = batch->text[batch->text_used - 1] != '\n';
+
+	if (batch->line_count > 0)
+	{
+		records = malloc(batch->line_count *
+			CHAT_LOG_INDEX_RECORD_SIZE);
+
+		/* The index is sorted by time, even if the clock goes back */
+		for (i = 0; i < batch->line_count; i++)
+		{
+			batch->lines[i].offset += offset;
+
+			if (batch->lines[i].time < store->last_time)
+			{
+				batch->lines[i].time = store->last_time;
+			}
+
+			store->last_time = batch->lines[i].time;
+
+			write_index_record(records + i *
+				CHAT_LOG_INDEX_RECORD_SIZE, &batch->lines[i]);
+		}
+
+		if ((fseek(store->index, (long)store->line_count *
+			CHAT_LOG_INDEX_RECORD_SIZE, SEEK_SET) != 0) ||
+			(fwrite(records, batch->line_count *
+			CHAT_LOG_INDEX_RECORD_SIZE, 1, store->index) != 1) ||
+			(fflush(store->index) != 0))
+		{
+			result = -1;
+		}
+		else
+		{
+			store->line_count += batch->line_count;
+		}
+
+		free(records);
+	}
+
+	batch->text_used = 0;
+	batch->line_count = 0;
+
+	return result;
+}
+
+void chat_log_store_close(chat_log_store_t* store)
+{
+	if (store->log != 0)
+	{
+		fclose(store->log);
+	}
+
+	if (store->index != 0)
+	{
+		fclose(store->index);
+	}
+
+	memset(store, 0, sizeof(chat_log_store_t));
+}
+
+static int find_text(const char* line, const Uint32 length,
+	const char* text, const Uint32 text_length)
+{
+	Uint32 i, j;
+
+	for (i = 0; (i + text_length) <= length; i++)
+	{
+		for (j = 0; j < text_length; j++)
+		{
+			if (lower_case(line[i + j]) != lower_case(text[j]))
+			{
+				break;
+			}
+		}
+
+		if (j == text_length)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int chat_log_search(FILE* log, FILE* index, const chat_log_query_t* query,
+	chat_log_found_t found, void* data)
+{
+	Uint8 records[CHAT_LOG_SEARCH_RECORDS * CHAT_LOG_INDEX_RECORD_SIZE];
+	chat_log_line_t line;
+	char* text;
+	Uint64 log_size, position;
+	Uint32 count, low, high, middle, i, j, size, text_size, text_length;
+	int result;
+
+	log_size = get_stream_size(log);
+	count = get_stream_size(index) / CHAT_LOG_INDEX_RECORD_SIZE;
+
+	/* The first record that is not older than from_time */
+	low = 0;
+	high = count;
+
+	while (low < high)
+	{
+		middle = low + (high - low) / 2;
+
+		if (read_index(index, middle, &line) != 0)
+		{
+			return -1;
+		}
+
+		if (line.time < query->from_time)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	if (query->text != 0)
+	{
+		text_length = strlen(query->text);
+	}
+	else
+	{
+		text_length = 0;
+	}
+
+	text = 0;
+	text_size = 0;
+	position = log_size;
+	result = 0;
+
+	for (i = low; i < count; i += size)
+	{
+		size = count - i;
+
+		if (size > CHAT_LOG_SEARCH_RECORDS)
+		{
+			size = CHAT_LOG_SEARCH_RECORDS;
+		}
+
+		if ((fseek(index, (long)i * CHAT_LOG_INDEX_RECORD_SIZE,
+			SEEK_SET) != 0) || (fread(records, size *
+			CHAT_LOG_INDEX_RECORD_SIZE, 1, index) != 1))
+		{
+			result = -1;
+			break;
+		}
+
+		for (j = 0; j < size; j++)
+		{
+			read_index_record(records + j *
+				CHAT_LOG_INDEX_RECORD_SIZE, &line);
+
+			if ((query->use_channel != 0) &&
+				(line.channel != query->channel))
+			{
+				continue;
+			}
+
+			if ((query->use_sender != 0) &&
+				(line.sender != query->sender))
+			{
+				continue;
+			}
+
+			if ((line.length == 0) ||
+				((line.offset + line.length) > log_size))
+			{
+				continue;
+			}
+
+			if (line.length > text_size)
+			{
+				text_size = line.length * 2;
+				text = realloc(text, text_size);
+			}
+
+			/* Lines that follow each other are read without seeking */
+			if ((position != line.offset) &&
+				(fseek(log, line.offset, SEEK_SET) != 0))
+			{
+				position = log_size;
+				continue;
+			}
+
+			if (fread(text, line.length, 1, log) != 1)
+			{
+				position = log_size;
+				continue;
+			}
+
+			position = line.offset + line.length;
+
+			if (!find_text(text, line.length - 1, query->text,
+				text_length))
+			{
+				continue;
+			}
+
+			found(text, line.length - 1, line.time, line.channel,
+				data);
+			result++;
+		}
+	}
+
+	free(text);
+
+	return result;
+}
+
+#ifdef	ELC
+#define CHAT_LOG_COMMIT_INTERVAL	500
+#define CHAT_LOG_COMMIT_SIZE	32768
+#define CHAT_LOG_SEARCH_RESULTS	50
+
+static SDL_Thread* chat_log_thread = 0;
+static SDL_mutex* chat_log_mutex = 0;
+static SDL_mutex* chat_log_io_mutex = 0;
+static SDL_cond* chat_log_condition = 0;
+static chat_log_store_t chat_log_stores[2];
+static chat_log_batch_t chat_log_pending[2];
+static chat_log_batch_t chat_log_writing[2];
+static Uint32 chat_log_quit = 0;
+static time_t chat_log_stamp_time = 0;
+static char chat_log_stamp[16];
+static Uint32 chat_log_stamp_length = 0;
+
+static int open_store(chat_log_store_t* store, const char* name)
+{
+	char index_name[256];
+	FILE *log, *index;
+
+	safe_snprintf(index_name, sizeof(index_name), "%s.idx", name);
+
+	log = open_file_config(name, "a+b");
+
+	if (log == 0)
+	{
+		return -1;
+	}
+
+	index = open_file_config(index_name, "r+b");
+
+	if (index == 0)
+	{
+		index = open_file_config(index_name, "w+b");
+	}
+
+	if (index == 0)
+	{
+		fclose(log);
+
+		return -1;
+	}
+
+	if (chat_log_store_open(store, log, index) != 0)
+	{
+		LOG_ERROR("Can't read the chat log index '%s'", index_name);
+
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * Writes the pending batches. The main thread only waits for the swap of
+ * the batches, never for the disk.
+ */
+static void commit_chat_logs()
+{
+	chat_log_batch_t batch;
+	Uint32 i;
+
+	SDL_LockMutex(chat_log_io_mutex);
+	SDL_LockMutex(chat_log_mutex);
+
+	for (i = 0; i < 2; i++)
+	{
+		batch = chat_log_writing[i];
+		chat_log_writing[i] = chat_log_pending[i];
+		chat_log_pending[i] = batch;
+	}
+
+	SDL_UnlockMutex(chat_log_mutex);
+
+	for (i = 0; i < 2; i++)
+	{
+		if (chat_log_stores[i].log == 0)
+		{
+			chat_log_writing[i].text_used = 0;
+			chat_log_writing[i].line_count = 0;
+		}
+		else if (chat_log_store_commit(&chat_log_stores[i],
+			&chat_log_writing[i]) != 0)
+		{
+			LOG_ERROR("Can't write the chat log");
+		}
+	}
+
+	SDL_UnlockMutex(chat_log_io_mutex);
+}
+
+static int chat_log_writer(void* data)
+{
+	SDL_LockMutex(chat_log_mutex);
+
+	while (chat_log_quit == 0)
+	{
+		SDL_CondWaitTimeout(chat_log_condition, chat_log_mutex,
+			CHAT_LOG_COMMIT_INTERVAL);
+
+		SDL_UnlockMutex(chat_log_mutex);
+		commit_chat_logs();
+		SDL_LockMutex(chat_log_mutex);
+	}
+
+	SDL_UnlockMutex(chat_log_mutex);
+
+	commit_chat_logs();
+
+	return 0;
+}
+
+int start_chat_log_writer(const char* chat_log_name,
+	const char* server_log_name)
+{
+	int result;
+
+	if (open_store(&chat_log_stores[0], chat_log_name) != 0)
+	{
+		return -1;
+	}
+
+	result = 0;
+
+	if ((server_log_name != 0) &&
+		(open_store(&chat_log_stores[1], server_log_name) != 0))
+	{
+		result = 1;
+	}
+
+	chat_log_mutex = SDL_CreateMutex();
+	chat_log_io_mutex = SDL_CreateMutex();
+	chat_log_condition = SDL_CreateCond();
+	chat_log_quit = 0;
+	chat_log_thread = SDL_CreateThread(chat_log_writer, 0);
+
+	if (chat_log_thread == 0)
+	{
+		LOG_ERROR("Can't start the chat log thread, writing every line");
+	}
+
+	return result;
+}
+
+void stop_chat_log_writer()
+{
+	Uint32 i;
+
+	if (chat_log_stores[0].log == 0)
+	{
+		return;
+	}
+
+	if (chat_log_thread != 0)
+	{
+		SDL_LockMutex(chat_log_mutex);
+		chat_log_quit = 1;
+		SDL_CondSignal(chat_log_condition);
+		SDL_UnlockMutex(chat_log_mutex);
+
+		SDL_WaitThread(chat_log_thread, 0);
+		chat_log_thread = 0;
+	}
+	else
+	{
+		commit_chat_logs();
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		chat_log_store_close(&chat_log_stores[i]);
+		chat_log_batch_free(&chat_log_pending[i]);
+		chat_log_batch_free(&chat_log_writing[i]);
+	}
+
+	SDL_DestroyCond(chat_log_condition);
+	SDL_DestroyMutex(chat_log_io_mutex);
+	SDL_DestroyMutex(chat_log_mutex);
+	chat_log_condition = 0;
+	chat_log_io_mutex = 0;
+	chat_log_mutex = 0;
+}
+
+int chat_log_writer_running()
+{
+	return chat_log_stores[0].log != 0;
+}
+
+/*!
+ * Gets the name at the start of a line, after the time stamp and the
+ * "[PM from" or the '[' of a channel.
+ */
+static Uint32 get_sender(const char* line, const Uint32 length,
+	Uint32* start)
+{
+	Uint32 i, pm_length, mod_pm_length;
+
+	i = 0;
+
+	if ((length > 11) && (line[0] == '[') && (line[9] == ']') &&
+		(line[10] == ' '))
+	{
+		i = 11;
+	}
+
+	pm_length = strlen(pm_from_str);
+	mod_pm_length = strlen(mod_pm_from_str);
+
+	if (((i + pm_length) < length) &&
+		(strncmp(line + i, pm_from_str, pm_length) == 0))
+	{
+		i += pm_length;
+	}
+	else if (((i + mod_pm_length) < length) &&
+		(strncmp(line + i, mod_pm_from_str, mod_pm_length) == 0))
+	{
+		i += mod_pm_length;
+	}
+	else if ((i < length) && (line[i] == '['))
+	{
+		i++;
+	}
+
+	while ((i < length) && (line[i] == ' '))
+	{
+		i++;
+	}
+
+	*start = i;
+
+	while ((i < length) && (((line[i] >= 'a') && (line[i] <= 'z')) ||
+		((line[i] >= 'A') && (line[i] <= 'Z')) ||
+		((line[i] >= '0') && (line[i] <= '9')) || (line[i] == '_')))
+	{
+		i++;
+	}
+
+	return i - *start;
+}
+
+static void add_line(chat_log_batch_t* batch, const Uint8 channel,
+	const Uint8* data, const Uint32 length, const Uint32 add_time_stamp)
+{
+	char* line;
+	time_t now;
+	Uint32 i, j, start, sender_length;
+
+	time(&now);
+
+	if ((add_time_stamp != 0) && (now != chat_log_stamp_time))
+	{
+		chat_log_stamp_time = now;
+		chat_log_stamp_length = strftime(chat_log_stamp,
+			sizeof(chat_log_stamp), "[%H:%M:%S] ", localtime(&now));
+	}
+
+	line = chat_log_batch_reserve(batch, chat_log_stamp_length + length +
+		1);
+
+	j = 0;
+
+	if (add_time_stamp != 0)
+	{
+		memcpy(line, chat_log_stamp, chat_log_stamp_length);
+		j = chat_log_stamp_length;
+	}
+
+	// remove colorization and soft wrapping characters when
+	// writing to the chat log
+	for (i = 0; i < length; i++)
+	{
+		if (!is_color(data[i]) && (data[i] != '\r'))
+		{
+			line[j++] = data[i];
+		}
+	}
+
+	sender_length = get_sender(line, j, &start);
+
+	chat_log_batch_add_line(batch, j, now, channel,
+		chat_log_sender_hash(line + start, sender_length));
+}
+
+void chat_log_write(const Uint32 server, const Uint8 channel,
+	const Uint8* data, const Uint32 length, const Uint32 add_time_stamp)
+{
+	Uint32 log;
+
+	log = ((server != 0) && (chat_log_stores[1].log != 0)) ? 1 : 0;
+
+	SDL_LockMutex(chat_log_mutex);
+
+	add_line(&chat_log_pending[log], channel, data, length,
+		add_time_stamp);
+
+	if (chat_log_pending[log].text_used >= CHAT_LOG_COMMIT_SIZE)
+	{
+		SDL_CondSignal(chat_log_condition);
+	}
+
+	SDL_UnlockMutex(chat_log_mutex);
+
+	if (chat_log_thread == 0)
+	{
+		commit_chat_logs();
+	}
+}
+
+void chat_log_write_text(const char* text, const Uint32 length)
+{
+	SDL_LockMutex(chat_log_mutex);
+
+	chat_log_batch_add_text(&chat_log_pending[0], text, length);
+
+	SDL_UnlockMutex(chat_log_mutex);
+
+	if (chat_log_thread == 0)
+	{
+		commit_chat_logs();
+	}
+}
+
+typedef struct
+{
+	char lines[CHAT_LOG_SEARCH_RESULTS][256];
+	Uint32 count;
+	const char* sender;
+	Uint32 sender_length;
+} search_results_t;
+
+static void add_search_result(const char* line, const Uint32 length,
+	const Uint32 time, const Uint8 channel, void* data)
+{
+	search_results_t* results;
+	Uint32 start, sender_length;
+
+	results = data;
+
+	/* Different names can have the same hash */
+	if (results->sender != 0)
+	{
+		sender_length = get_sender(line, length, &start);
+
+		if ((sender_length != results->sender_length) ||
+			(my_strncompare(line + start, results->sender,
+			sender_length) == 0))
+		{
+			return;
+		}
+	}
+
+	safe_strncpy2(results->lines[results->count % CHAT_LOG_SEARCH_RESULTS],
+		line, 256, length);
+	results->count++;
+}
+
+static void search_log_file(const char* name,
+	const chat_log_query_t* query, search_results_t* results)
+{
+	char index_name[256];
+	FILE *log, *index;
+
+	safe_snprintf(index_name, sizeof(index_name), "%s.idx", name);
+
+	log = open_file_config(name, "rb");
+	index = open_file_config(index_name, "rb");
+
+	if ((log != 0) && (index != 0))
+	{
+		chat_log_search(log, index, query, add_search_result, results);
+	}
+
+	if (log != 0)
+	{
+		fclose(log);
+	}
+
+	if (index != 0)
+	{
+		fclose(index);
+	}
+}
+
+static Uint32 get_channel(const char* name)
+{
+	static const char* names[] = { "local", "pm", "gm", "server", "mod",
+		"channel1", "channel2", "channel3", "modpm" };
+	Uint32 i;
+
+	for (i = 0; i < (sizeof(names) / sizeof(names[0])); i++)
+	{
+		if (my_strcompare(name, names[i]))
+		{
+			return i;
+		}
+	}
+
+	return atoi(name);
+}
+
+int command_search_log(char *text, int len)
+{
+	char name[64];
+	char str[256];
+	char base_name[16];
+	search_results_t* results;
+	chat_log_query_t query;
+	struct tm* l_time;
+	time_t now;
+	Uint32 i, start, days, year, month, last_year, last_month;
+	int count;
+
+	memset(&query, 0, sizeof(query));
+	results = calloc(1, sizeof(search_results_t));
+	days = 365;
+
+	while (sscanf(text, " %63s%n", name, &count) == 1)
+	{
+		if (strncmp(name, "from=", 5) == 0)
+		{
+			safe_strncpy(str, name + 5, sizeof(str));
+			query.sender = chat_log_sender_hash(str, strlen(str));
+			query.use_sender = 1;
+		}
+		else if (strncmp(name, "days=", 5) == 0)
+		{
+			days = atoi(name + 5);
+		}
+		else if (strncmp(name, "channel=", 8) == 0)
+		{
+			query.channel = get_channel(name + 8);
+			query.use_channel = 1;
+		}
+		else
+		{
+			break;
+		}
+
+		text += count;
+	}
+
+	while (*text == ' ')
+	{
+		text++;
+	}
+
+	query.text = text;
+
+	if (query.use_sender != 0)
+	{
+		results->sender = str;
+		results->sender_length = strlen(str);
+	}
+
+	// everything that is written so far must be in the files
+	if (chat_log_writer_running())
+	{
+		commit_chat_logs();
+	}
+
+	start = SDL_GetTicks();
+	time(&now);
+	query.from_time = (days < (now / 86400)) ? now - days * 86400 : 0;
+
+	if ((query.use_channel != 0) && (query.channel == CHAT_SERVER) &&
+		(log_chat == LOG_SERVER_SEPERATE))
+	{
+		safe_strncpy(base_name, "srv_log", sizeof(base_name));
+	}
+	else
+	{
+		safe_strncpy(base_name, "chat_log", sizeof(base_name));
+	}
+
+	if (get_rotate_chat_log())
+	{
+		now = query.from_time;
+		l_time = localtime(&now);
+		year = l_time->tm_year + 1900;
+		month = l_time->tm_mon + 1;
+
+		time(&now);
+		l_time = localtime(&now);
+		last_year = l_time->tm_year + 1900;
+		last_month = l_time->tm_mon + 1;
+
+		while ((year * 12 + month) <= (last_year * 12 + last_month))
+		{
+			safe_snprintf(name, sizeof(name), "%s_%04d%02d.txt",
+				base_name, year, month);
+
+			search_log_file(name, &query, results);
+
+			month++;
+
+			if (month > 12)
+			{
+				month = 1;
+				year++;
+			}
+		}
+	}
+	else
+	{
+		safe_snprintf(name, sizeof(name), "%s.txt", base_name);
+
+		search_log_file(name, &query, results);
+	}
+
+	i = 0;
+
+	if (results->count > CHAT_LOG_SEARCH_RESULTS)
+	{
+		i = results->count - CHAT_LOG_SEARCH_RESULTS;
+	}
+
+	for (; i < results->count; i++)
+	{
+		LOG_TO_CONSOLE(c_grey1,
+			results->lines[i % CHAT_LOG_SEARCH_RESULTS]);
+	}
+
+	safe_snprintf(str, sizeof(str), "%d lines found in %d ms",
+		results->count, SDL_GetTicks() - start);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	free(results);
+
+	return 1;
+}
+#endif	/* ELC */
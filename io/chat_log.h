@@ -0,0 +1,236 @@
+/*!
+ * \file
+ * \ingroup io
+ * \brief buffered chat log with an index for searching the history
+ *
+ * The lines of the chat log are collected in a batch and written together
+ * by a thread, instead of a flush for every line. Every line gets a record
+ * in an index file next to the log, with the time, channel and sender of
+ * the line, so the logs can be searched without reading all of them.
+ *
+ * The log data is always written and flushed before the index records, so
+ * after a crash the index can only have records at its end that are not
+ * in the log. They are removed when the log is opened again.
+ */
+#ifndef UUID_a61f0c3d_8e27_4b95_9d14_5b2e7c0f83a9
+#define UUID_a61f0c3d_8e27_4b95_9d14_5b2e7c0f83a9
+
+#include <stdio.h>
+#include "../platform.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CHAT_LOG_INDEX_RECORD_SIZE	24
+
+/*!
+ * A line of a batch. The offset is from the start of the batch until the
+ * batch is written, then from the start of the log.
+ */
+typedef struct
+{
+	Uint64 offset;	/*!< the position of the line */
+	Uint32 length;	/*!< the length of the line with its new line */
+	Uint32 time;	/*!< the time the line was added */
+	Uint32 sender;	/*!< the hash of the name of the sender */
+	Uint8 channel;	/*!< the channel of the line */
+} chat_log_line_t;
+
+/*!
+ * Text and lines that are not written yet.
+ */
+typedef struct
+{
+	char* text;
+	chat_log_line_t* lines;
+	Uint32 text_used;
+	Uint32 text_size;
+	Uint32 line_count;
+	Uint32 line_size;
+} chat_log_batch_t;
+
+/*!
+ * An open log and its index.
+ */
+typedef struct
+{
+	FILE* log;
+	FILE* index;
+	Uint64 log_size;	/*!< the size of the log */
+	Uint32 line_count;	/*!< the number of records in the index */
+	Uint32 last_time;	/*!< the time of the last record */
+	Uint32 needs_new_line;	/*!< the log ends in a partial line */
+} chat_log_store_t;
+
+/*!
+ * What to search for. A line is found if all of the given parts match.
+ */
+typedef struct
+{
+	const char* text;	/*!< a part of the line, upper and lower case are the same, all lines if empty */
+	Uint32 from_time;	/*!< the oldest time */
+	Uint32 sender;	/*!< the hash of the name of the sender */
+	Uint32 use_sender;	/*!< only the lines of the sender if not zero */
+	Uint32 use_channel;	/*!< only the lines of the channel if not zero */
+	Uint8 channel;	/*!< the channel */
+} chat_log_query_t;
+
+/*!
+ * Called for each line that is found, the line is without its new line.
+ */
+typedef void (*chat_log_found_t)(const char* line, const Uint32 length,
+	const Uint32 time, const Uint8 channel, void* data);
+
+/*!
+ * \brief Hashes the name of a sender.
+ *
+ * Upper and lower case letters give the same hash.
+ * \param name The name.
+ * \param length The length of the name.
+ * \retval Uint32 The hash.
+ */
+Uint32 chat_log_sender_hash(const char* name, const Uint32 length);
+
+/*!
+ * \brief Gets space for text at the end of a batch.
+ *
+ * The text is added with chat_log_batch_add_line().
+ * \param batch The batch.
+ * \param size The size of the text, with one more for the new line.
+ * \retval char* The space for the text.
+ */
+char* chat_log_batch_reserve(chat_log_batch_t* batch, const Uint32 size);
+
+/*!
+ * \brief Adds a line to the index of a batch.
+ *
+ * The text of the line must be at the position that
+ * chat_log_batch_reserve() returned, the new line is added here.
+ * \param batch The batch.
+ * \param length The length of the text.
+ * \param time The time of the line.
+ * \param channel The channel of the line.
+ * \param sender The hash of the name of the sender.
+ */
+void chat_log_batch_add_line(chat_log_batch_t* batch, const Uint32 length,
+	const Uint32 time, const Uint8 channel, const Uint32 sender);
+
+/*!
+ * \brief Adds text that is not in the index to a batch.
+ * \param batch The batch.
+ * \param text The text.
+ * \param length The length of the text.
+ */
+void chat_log_batch_add_text(chat_log_batch_t* batch, const char* text,
+	const Uint32 length);
+
+/*!
+ * \brief Frees a batch.
+ * \param batch The batch.
+ */
+void chat_log_batch_free(chat_log_batch_t* batch);
+
+/*!
+ * \brief Opens a log and its index.
+ *
+ * Removes the records at the end of the index that are not in the log.
+ * \param store The store to open.
+ * \param log The log, opened with "a+b".
+ * \param index The index, opened with "r+b" or "w+b".
+ * \retval int Returns zero on success, else -1 and the files are closed.
+ */
+int chat_log_store_open(chat_log_store_t* store, FILE* log, FILE* index);
+
+/*!
+ * \brief Writes a batch to a log and its index.
+ *
+ * The batch is empty afterwards, also if the writing failed.
+ * \param store The store.
+ * \param batch The batch to write.
+ * \retval int Returns zero on success, else -1.
+ */
+int chat_log_store_commit(chat_log_store_t* store, chat_log_batch_t* batch);
+
+/*!
+ * \brief Closes a log and its index.
+ * \param store The store to close.
+ */
+void chat_log_store_close(chat_log_store_t* store);
+
+/*!
+ * \brief Searches a log with its index.
+ *
+ * Only the lines in the index are found, in the order they were written.
+ * \param log The log.
+ * \param index The index.
+ * \param query What to search for.
+ * \param found Called for each line that is found.
+ * \param data Passed to found.
+ * \retval int The number of lines found, or -1 if the files can't be read.
+ */
+int chat_log_search(FILE* log, FILE* index, const chat_log_query_t* query,
+	chat_log_found_t found, void* data);
+
+#ifdef	ELC
+/*!
+ * \brief Opens the logs and starts the thread that writes them.
+ * \param chat_log_name The name of the chat log.
+ * \param server_log_name The name of the server log, or NULL if the server
+ * messages go to the chat log.
+ * \retval int Returns zero on success, one if the server log can't be
+ * opened and -1 if the chat log can't be opened.
+ */
+int start_chat_log_writer(const char* chat_log_name,
+	const char* server_log_name);
+
+/*!
+ * \brief Writes everything and stops the thread that writes the logs.
+ */
+void stop_chat_log_writer();
+
+/*!
+ * \brief Checks if the logs are open.
+ * \retval int Returns one if the logs are open, else zero.
+ */
+int chat_log_writer_running();
+
+/*!
+ * \brief Adds a line to a log.
+ *
+ * Removes the colors and soft wraps of the text.
+ * \param server Adds the line to the server log if not zero.
+ * \param channel The channel of the line.
+ * \param data The text of the line.
+ * \param length The length of the text.
+ * \param add_time_stamp Starts the line with the time if not zero.
+ */
+void chat_log_write(const Uint32 server, const Uint8 channel,
+	const Uint8* data, const Uint32 length, const Uint32 add_time_stamp);
+
+/*!
+ * \brief Adds text that is not searched, like the time stamps, to the chat
+ * log.
+ * \param text The text.
+ * \param length The length of the text.
+ */
+void chat_log_write_text(const char* text, const Uint32 length);
+
+/*!
+ * \brief Searches the chat logs.
+ *
+ * The text is "[from=<name>] [days=<days>] [channel=<channel>] [text]" and
+ * the newest matching lines are printed.
+ * \param text The search.
+ * \param len The length of the text.
+ * \retval int Always returns 1.
+ */
+int command_search_log(char *text, int len);
+#endif	/* ELC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UUID_a61f0c3d_8e27_4b95_9d14_5b2e7c0f83a9 */
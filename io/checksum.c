@@ -0,0 +1,977 @@
+#include "checksum.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../xz/7zCrc.h"
+#include "../xz/XzCrc64.h"
+#ifdef	ELC
+#include <SDL.h>
+#include "elfilewrapper.h"
+#include "elpathwrapper.h"
+#include "ziputil.h"
+#include "../asc.h"
+#include "../init.h"
+#include "../interface.h"
+#include "../map.h"
+#include "../misc.h"
+#include "../text.h"
+#endif	/* ELC */
+
+#if	defined(USE_SIMD) && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define	CHECKSUM_SIMD
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif	/* USE_SIMD && __GNUC__ && x86 */
+
+#define CRC32_POLY	0xEDB88320
+#define CRC64_POLY	0xC96C5795D7870F42ULL
+
+/* Shorter data is faster with the tables */
+#define CRC_FOLD_MIN_SIZE	256
+
+static CRC_FUNC crc32_table_update = 0;
+static CRC64_FUNC crc64_table_update = 0;
+static Uint32 use_clmul = 0;
+static Uint32 use_sse2 = 0;
+
+#ifdef	CHECKSUM_SIMD
+/*
+ * Multipliers to fold 128 bits of the state over the next 128 or 512 bits
+ * of data. The low 64 bits of the state are multiplied with x^(n+63) mod P
+ * and the high 64 bits with x^(n-1) mod P, both bit reflected like the crc.
+ */
+typedef struct
+{
+	Uint64 k128[2];
+	Uint64 k512[2];
+} fold_constants_t;
+
+static fold_constants_t crc32_constants;
+static fold_constants_t crc64_constants;
+
+/* x^exponent mod poly, bit reflected, in the high bits of 64 bits */
+static Uint64 x_pow_mod(const Uint64 poly, const Uint32 width,
+	const Uint32 exponent)
+{
+	Uint64 result;
+	Uint32 i;
+
+	result = 1ULL << (width - 1);
+
+	for (i = 0; i < exponent; i++)
+	{
+		result = (result >> 1) ^ (poly & (0 - (result & 1)));
+	}
+
+	return result << (64 - width);
+}
+
+static void init_fold_constants(fold_constants_t* constants,
+	const Uint64 poly, const Uint32 width)
+{
+	constants->k128[0] = x_pow_mod(poly, width, 128 + 63);
+	constants->k128[1] = x_pow_mod(poly, width, 128 - 1);
+	constants->k512[0] = x_pow_mod(poly, width, 512 + 63);
+	constants->k512[1] = x_pow_mod(poly, width, 512 - 1);
+}
+
+__attribute__((target("sse2,pclmul")))
+static inline __m128i fold_128(const __m128i state, const __m128i k)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(state, k, 0x00),
+		_mm_clmulepi64_si128(state, k, 0x11));
+}
+
+/*
+ * Folds the 16 byte blocks of the data into 16 bytes with the same crc.
+ * The crc register is xored into the first bytes, so the crc of the
+ * result must be calculated with a zero register. Four states are folded
+ * in parallel while there are 64 bytes left.
+ */
+__attribute__((target("sse2,pclmul")))
+static void fold_data(const Uint8* data, size_t size, const Uint64 crc,
+	const fold_constants_t* constants, Uint8* result)
+{
+	__m128i x0, x1, x2, x3, k;
+
+	x0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)data),
+		_mm_loadl_epi64((const __m128i*)&crc));
+	data += 16;
+	size -= 16;
+
+	if (size >= 48)
+	{
+		x1 = _mm_loadu_si128((const __m128i*)data);
+		x2 = _mm_loadu_si128((const __m128i*)(data + 16));
+		x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+		data += 48;
+		size -= 48;
+
+		k = _mm_loadu_si128((const __m128i*)constants->k512);
+
+		while (size >= 64)
+		{
+			x0 = _mm_xor_si128(fold_128(x0, k),
+				_mm_loadu_si128((const __m128i*)data));
+			x1 = _mm_xor_si128(fold_128(x1, k),
+				_mm_loadu_si128((const __m128i*)(data + 16)));
+			x2 = _mm_xor_si128(fold_128(x2, k),
+				_mm_loadu_si128((const __m128i*)(data + 32)));
+			x3 = _mm_xor_si128(fold_128(x3, k),
+				_mm_loadu_si128((const __m128i*)(data + 48)));
+			data += 64;
+			size -= 64;
+		}
+
+		k = _mm_loadu_si128((const __m128i*)constants->k128);
+
+		x0 = _mm_xor_si128(fold_128(x0, k), x1);
+		x0 = _mm_xor_si128(fold_128(x0, k), x2);
+		x0 = _mm_xor_si128(fold_128(x0, k), x3);
+	}
+
+	k = _mm_loadu_si128((const __m128i*)constants->k128);
+
+	while (size >= 16)
+	{
+		x0 = _mm_xor_si128(fold_128(x0, k),
+			_mm_loadu_si128((const __m128i*)data));
+		data += 16;
+		size -= 16;
+	}
+
+	_mm_storeu_si128((__m128i*)result, x0);
+}
+
+static UInt32 MY_FAST_CALL crc32_fold_update(UInt32 v, const void* data,
+	size_t size, const UInt32* table)
+{
+	Uint8 state[16];
+	size_t folded;
+
+	if (size < CRC_FOLD_MIN_SIZE)
+	{
+		return crc32_table_update(v, data, size, table);
+	}
+
+	folded = size & ~((size_t)15);
+
+	fold_data(data, size, v, &crc32_constants, state);
+
+	v = crc32_table_update(0, state, 16, table);
+
+	return crc32_table_update(v, (const Uint8*)data + folded,
+		size - folded, table);
+}
+
+static UInt64 MY_FAST_CALL crc64_fold_update(UInt64 v, const void* data,
+	size_t size, const UInt64* table)
+{
+	Uint8 state[16];
+	size_t folded;
+
+	if (size < CRC_FOLD_MIN_SIZE)
+	{
+		return crc64_table_update(v, data, size, table);
+	}
+
+	folded = size & ~((size_t)15);
+
+	fold_data(data, size, v, &crc64_constants, state);
+
+	v = crc64_table_update(0, state, 16, table);
+
+	return crc64_table_update(v, (const Uint8*)data + folded,
+		size - folded, table);
+}
+
+#define S11 7
+#define S12 12
+#define S13 17
+#define S14 22
+#define S21 5
+#define S22 9
+#define S23 14
+#define S24 20
+#define S31 4
+#define S32 11
+#define S33 16
+#define S34 23
+#define S41 6
+#define S42 10
+#define S43 15
+#define S44 21
+
+/* The md5 functions of md5.c on four lanes */
+#define MD5_F_4(x, y, z) _mm_or_si128(_mm_and_si128(x, y), \
+	_mm_andnot_si128(x, z))
+#define MD5_G_4(x, y, z) _mm_or_si128(_mm_and_si128(x, z), \
+	_mm_andnot_si128(z, y))
+#define MD5_H_4(x, y, z) _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define MD5_I_4(x, y, z) _mm_xor_si128(y, _mm_or_si128(x, \
+	_mm_xor_si128(z, ones)))
+
+#define MD5_STEP_4(f, a, b, c, d, x, s, ac) { \
+	(a) = _mm_add_epi32(_mm_add_epi32((a), f((b), (c), (d))), \
+		_mm_add_epi32((x), _mm_set1_epi32((int)(ac)))); \
+	(a) = _mm_or_si128(_mm_slli_epi32((a), (s)), \
+		_mm_srli_epi32((a), 32 - (s))); \
+	(a) = _mm_add_epi32((a), (b)); \
+	}
+
+#define MD5_FF_4(a, b, c, d, x, s, ac) MD5_STEP_4(MD5_F_4, a, b, c, d, x, s, ac)
+#define MD5_GG_4(a, b, c, d, x, s, ac) MD5_STEP_4(MD5_G_4, a, b, c, d, x, s, ac)
+#define MD5_HH_4(a, b, c, d, x, s, ac) MD5_STEP_4(MD5_H_4, a, b, c, d, x, s, ac)
+#define MD5_II_4(a, b, c, d, x, s, ac) MD5_STEP_4(MD5_I_4, a, b, c, d, x, s, ac)
+
+/*
+ * Transforms the states of four md5 with count blocks each. The blocks of
+ * a lane with a step of zero are hashed, but the state is not stored.
+ */
+__attribute__((target("sse2")))
+static void md5_transform_4(MD5** md5, const Uint8** blocks,
+	const Uint32* steps, const Uint32 count)
+{
+	__m128i state[4], x[16];
+	__m128i a, b, c, d, t0, t1, t2, t3, ones;
+	Uint32 lanes[4][4], offsets[4], i, j;
+
+	for (i = 0; i < 4; i++)
+	{
+		state[i] = _mm_set_epi32(md5[3]->state[i], md5[2]->state[i],
+			md5[1]->state[i], md5[0]->state[i]);
+		offsets[i] = 0;
+	}
+
+	ones = _mm_set1_epi32(-1);
+
+	for (i = 0; i < count; i++)
+	{
+		/* Transpose the words, so each vector holds a word of each lane */
+		for (j = 0; j < 4; j++)
+		{
+			a = _mm_loadu_si128((const __m128i*)(blocks[0] +
+				offsets[0] + j * 16));
+			b = _mm_loadu_si128((const __m128i*)(blocks[1] +
+				offsets[1] + j * 16));
+			c = _mm_loadu_si128((const __m128i*)(blocks[2] +
+				offsets[2] + j * 16));
+			d = _mm_loadu_si128((const __m128i*)(blocks[3] +
+				offsets[3] + j * 16));
+
+			t0 = _mm_unpacklo_epi32(a, b);
+			t1 = _mm_unpacklo_epi32(c, d);
+			t2 = _mm_unpackhi_epi32(a, b);
+			t3 = _mm_unpackhi_epi32(c, d);
+
+			x[j * 4 + 0] = _mm_unpacklo_epi64(t0, t1);
+			x[j * 4 + 1] = _mm_unpackhi_epi64(t0, t1);
+			x[j * 4 + 2] = _mm_unpacklo_epi64(t2, t3);
+			x[j * 4 + 3] = _mm_unpackhi_epi64(t2, t3);
+		}
+
+		for (j = 0; j < 4; j++)
+		{
+			offsets[j] += steps[j];
+		}
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+
+		/* Round 1 */
+		MD5_FF_4(a, b, c, d, x[ 0], S11, 0xd76aa478);
+		MD5_FF_4(d, a, b, c, x[ 1], S12, 0xe8c7b756);
+		MD5_FF_4(c, d, a, b, x[ 2], S13, 0x242070db);
+		MD5_FF_4(b, c, d, a, x[ 3], S14, 0xc1bdceee);
+		MD5_FF_4(a, b, c, d, x[ 4], S11, 0xf57c0faf);
+		MD5_FF_4(d, a, b, c, x[ 5], S12, 0x4787c62a);
+		MD5_FF_4(c, d, a, b, x[ 6], S13, 0xa8304613);
+		MD5_FF_4(b, c, d, a, x[ 7], S14, 0xfd469501);
+		MD5_FF_4(a, b, c, d, x[ 8], S11, 0x698098d8);
+		MD5_FF_4(d, a, b, c, x[ 9], S12, 0x8b44f7af);
+		MD5_FF_4(c, d, a, b, x[10], S13, 0xffff5bb1);
+		MD5_FF_4(b, c, d, a, x[11], S14, 0x895cd7be);
+		MD5_FF_4(a, b, c, d, x[12], S11, 0x6b901122);
+		MD5_FF_4(d, a, b, c, x[13], S12, 0xfd987193);
+		MD5_FF_4(c, d, a, b, x[14], S13, 0xa679438e);
+		MD5_FF_4(b, c, d, a, x[15], S14, 0x49b40821);
+		/* Round 2 */
+		MD5_GG_4(a, b, c, d, x[ 1], S21, 0xf61e2562);
+		MD5_GG_4(d, a, b, c, x[ 6], S22, 0xc040b340);
+		MD5_GG_4(c, d, a, b, x[11], S23, 0x265e5a51);
+		MD5_GG_4(b, c, d, a, x[ 0], S24, 0xe9b6c7aa);
+		MD5_GG_4(a, b, c, d, x[ 5], S21, 0xd62f105d);
+		MD5_GG_4(d, a, b, c, x[10], S22,  0x2441453);
+		MD5_GG_4(c, d, a, b, x[15], S23, 0xd8a1e681);
+		MD5_GG_4(b, c, d, a, x[ 4], S24, 0xe7d3fbc8);
+		MD5_GG_4(a, b, c, d, x[ 9], S21, 0x21e1cde6);
+		MD5_GG_4(d, a, b, c, x[14], S22, 0xc33707d6);
+		MD5_GG_4(c, d, a, b, x[ 3], S23, 0xf4d50d87);
+		MD5_GG_4(b, c, d, a, x[ 8], S24, 0x455a14ed);
+		MD5_GG_4(a, b, c, d, x[13], S21, 0xa9e3e905);
+		MD5_GG_4(d, a, b, c, x[ 2], S22, 0xfcefa3f8);
+		MD5_GG_4(c, d, a, b, x[ 7], S23, 0x676f02d9);
+		MD5_GG_4(b, c, d, a, x[12], S24, 0x8d2a4c8a);
+		/* Round 3 */
+		MD5_HH_4(a, b, c, d, x[ 5], S31, 0xfffa3942);
+		MD5_HH_4(d, a, b, c, x[ 8], S32, 0x8771f681);
+		MD5_HH_4(c, d, a, b, x[11], S33, 0x6d9d6122);
+		MD5_HH_4(b, c, d, a, x[14], S34, 0xfde5380c);
+		MD5_HH_4(a, b, c, d, x[ 1], S31, 0xa4beea44);
+		MD5_HH_4(d, a, b, c, x[ 4], S32, 0x4bdecfa9);
+		MD5_HH_4(c, d, a, b, x[ 7], S33, 0xf6bb4b60);
+		MD5_HH_4(b, c, d, a, x[10], S34, 0xbebfbc70);
+		MD5_HH_4(a, b, c, d, x[13], S31, 0x289b7ec6);
+		MD5_HH_4(d, a, b, c, x[ 0], S32, 0xeaa127fa);
+		MD5_HH_4(c, d, a, b, x[ 3], S33, 0xd4ef3085);
+		MD5_HH_4(b, c, d, a, x[ 6], S34,  0x4881d05);
+		MD5_HH_4(a, b, c, d, x[ 9], S31, 0xd9d4d039);
+		MD5_HH_4(d, a, b, c, x[12], S32, 0xe6db99e5);
+		MD5_HH_4(c, d, a, b, x[15], S33, 0x1fa27cf8);
+		MD5_HH_4(b, c, d, a, x[ 2], S34, 0xc4ac5665);
+		/* Round 4 */
+		MD5_II_4(a, b, c, d, x[ 0], S41, 0xf4292244);
+		MD5_II_4(d, a, b, c, x[ 7], S42, 0x432aff97);
+		MD5_II_4(c, d, a, b, x[14], S43, 0xab9423a7);
+		MD5_II_4(b, c, d, a, x[ 5], S44, 0xfc93a039);
+		MD5_II_4(a, b, c, d, x[12], S41, 0x655b59c3);
+		MD5_II_4(d, a, b, c, x[ 3], S42, 0x8f0ccc92);
+		MD5_II_4(c, d, a, b, x[10], S43, 0xffeff47d);
+		MD5_II_4(b, c, d, a, x[ 1], S44, 0x85845dd1);
+		MD5_II_4(a, b, c, d, x[ 8], S41, 0x6fa87e4f);
+		MD5_II_4(d, a, b, c, x[15], S42, 0xfe2ce6e0);
+		MD5_II_4(c, d, a, b, x[ 6], S43, 0xa3014314);
+		MD5_II_4(b, c, d, a, x[13], S44, 0x4e0811a1);
+		MD5_II_4(a, b, c, d, x[ 4], S41, 0xf7537e82);
+		MD5_II_4(d, a, b, c, x[11], S42, 0xbd3af235);
+		MD5_II_4(c, d, a, b, x[ 2], S43, 0x2ad7d2bb);
+		MD5_II_4(b, c, d, a, x[ 9], S44, 0xeb86d391);
+		state[0] = _mm_add_epi32(state[0], a);
+		state[1] = _mm_add_epi32(state[1], b);
+		state[2] = _mm_add_epi32(state[2], c);
+		state[3] = _mm_add_epi32(state[3], d);
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		_mm_storeu_si128((__m128i*)lanes[i], state[i]);
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		if (steps[i] == 0)
+		{
+			continue;
+		}
+
+		for (j = 0; j < 4; j++)
+		{
+			md5[i]->state[j] = lanes[j][i];
+		}
+	}
+}
+
+static void md5_add_count(MD5* md5, const Uint32 size)
+{
+	UINT4 bits;
+
+	bits = size << 3;
+
+	md5->count[0] += bits;
+
+	if (md5->count[0] < bits)
+	{
+		md5->count[1]++;
+	}
+
+	md5->count[1] += size >> 29;
+}
+#endif	/* CHECKSUM_SIMD */
+
+void init_checksums(const Uint32 use_simd)
+{
+#ifdef	CHECKSUM_SIMD
+	unsigned int eax, ebx, ecx, edx;
+
+	if (g_CrcUpdate != crc32_fold_update)
+	{
+		crc32_table_update = g_CrcUpdate;
+	}
+
+	if (g_Crc64Update != crc64_fold_update)
+	{
+		crc64_table_update = g_Crc64Update;
+	}
+
+	g_CrcUpdate = crc32_table_update;
+	g_Crc64Update = crc64_table_update;
+	use_clmul = 0;
+	use_sse2 = 0;
+
+	if ((use_simd == 0) || (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0))
+	{
+		return;
+	}
+
+	use_sse2 = (edx & bit_SSE2) != 0;
+	use_clmul = use_sse2 && ((ecx & bit_PCLMUL) != 0);
+
+	if (use_clmul != 0)
+	{
+		init_fold_constants(&crc32_constants, CRC32_POLY, 32);
+		init_fold_constants(&crc64_constants, CRC64_POLY, 64);
+
+		g_CrcUpdate = crc32_fold_update;
+		g_Crc64Update = crc64_fold_update;
+	}
+#else	/* CHECKSUM_SIMD */
+	crc32_table_update = g_CrcUpdate;
+	crc64_table_update = g_Crc64Update;
+#endif	/* CHECKSUM_SIMD */
+}
+
+Uint32 checksum_use_simd()
+{
+	return use_sse2 | use_clmul;
+}
+
+void md5_multi(const void** data, const Uint32* sizes, const Uint32 count,
+	MD5_DIGEST* digests)
+{
+	MD5 md5;
+	Uint32 i;
+#ifdef	CHECKSUM_SIMD
+	static const Uint8 empty[64] = { 0 };
+	MD5 lanes[4], unused;
+	MD5* lane_md5[4];
+	const Uint8* blocks[4];
+	Uint32 steps[4], lane_blocks[4], lane_index[4];
+	Uint32 j, next, active, min_blocks, done;
+
+	if (use_sse2 != 0)
+	{
+		memset(lane_blocks, 0, sizeof(lane_blocks));
+		next = 0;
+
+		while (1)
+		{
+			/* Give the free lanes the next buffers */
+			active = 0;
+
+			for (i = 0; i < 4; i++)
+			{
+				while ((lane_blocks[i] == 0) && (next < count))
+				{
+					if (sizes[next] < 64)
+					{
+						MD5Open(&md5);
+						MD5Digest(&md5, data[next],
+							sizes[next]);
+						MD5Close(&md5, digests[next]);
+					}
+					else
+					{
+						MD5Open(&lanes[i]);
+						blocks[i] = data[next];
+						lane_blocks[i] = sizes[next] / 64;
+						lane_index[i] = next;
+					}
+
+					next++;
+				}
+
+				if (lane_blocks[i] != 0)
+				{
+					active++;
+				}
+			}
+
+			if (active < 2)
+			{
+				break;
+			}
+
+			min_blocks = 0xFFFFFFFF;
+
+			for (i = 0; i < 4; i++)
+			{
+				if (lane_blocks[i] == 0)
+				{
+					lane_md5[i] = &unused;
+					blocks[i] = empty;
+					steps[i] = 0;
+				}
+				else
+				{
+					lane_md5[i] = &lanes[i];
+					steps[i] = 64;
+
+					if (lane_blocks[i] < min_blocks)
+					{
+						min_blocks = lane_blocks[i];
+					}
+				}
+			}
+
+			memset(&unused, 0, sizeof(unused));
+
+			md5_transform_4(lane_md5, blocks, steps, min_blocks);
+
+			/* Finish the buffers that have only the tail left */
+			for (i = 0; i < 4; i++)
+			{
+				if (lane_blocks[i] == 0)
+				{
+					continue;
+				}
+
+				done = min_blocks * 64;
+
+				md5_add_count(&lanes[i], done);
+				blocks[i] += done;
+				lane_blocks[i] -= min_blocks;
+
+				if (lane_blocks[i] == 0)
+				{
+					j = lane_index[i];
+
+					MD5Digest(&lanes[i], blocks[i],
+						sizes[j] % 64);
+					MD5Close(&lanes[i], digests[j]);
+				}
+			}
+		}
+
+		/* At most one buffer is left in a lane */
+		for (i = 0; i < 4; i++)
+		{
+			if (lane_blocks[i] != 0)
+			{
+				j = lane_index[i];
+
+				MD5Digest(&lanes[i], blocks[i],
+					sizes[j] - (blocks[i] -
+					(const Uint8*)data[j]));
+				MD5Close(&lanes[i], digests[j]);
+			}
+		}
+
+		return;
+	}
+#endif	/* CHECKSUM_SIMD */
+
+	for (i = 0; i < count; i++)
+	{
+		MD5Open(&md5);
+		MD5Digest(&md5, data[i], sizes[i]);
+		MD5Close(&md5, digests[i]);
+	}
+}
+
+#ifdef	ELC
+#define CHECKSUM_BATCH_SIZE	16
+
+typedef struct
+{
+	const char** file_names;
+	const MD5_DIGEST* digests;
+	Uint32* results;
+	Uint32 count;
+	Uint32 next;
+	SDL_mutex* mutex;
+} checksum_job_t;
+
+static void* read_file(const char* file_name, Uint32* size)
+{
+	FILE* file;
+	void* data;
+	long len;
+
+	file = fopen(file_name, "rb");
+
+	if (file == 0)
+	{
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data = malloc(len + 1);
+
+	if ((len < 0) || (data == 0) ||
+		(fread(data, 1, len, file) != (size_t)len))
+	{
+		fclose(file);
+		free(data);
+
+		return 0;
+	}
+
+	fclose(file);
+
+	*size = len;
+
+	return data;
+}
+
+static void check_batch(checksum_job_t* job, const Uint32 first,
+	const Uint32 count)
+{
+	MD5_DIGEST digests[CHECKSUM_BATCH_SIZE];
+	const void* data[CHECKSUM_BATCH_SIZE];
+	Uint32 sizes[CHECKSUM_BATCH_SIZE] = { 0 };
+	Uint32 index[CHECKSUM_BATCH_SIZE];
+	Uint32 i, used;
+	void* buffer;
+
+	used = 0;
+
+	for (i = first; i < (first + count); i++)
+	{
+		buffer = read_file(job->file_names[i], &sizes[used]);
+
+		if (buffer == 0)
+		{
+			job->results[i] = 2;
+			continue;
+		}
+
+		data[used] = buffer;
+		index[used] = i;
+		used++;
+	}
+
+	md5_multi(data, sizes, used, digests);
+
+	for (i = 0; i < used; i++)
+	{
+		job->results[index[i]] = memcmp(digests[i],
+			job->digests[index[i]], sizeof(MD5_DIGEST)) != 0;
+
+		free((void*)data[i]);
+	}
+}
+
+static int checksum_thread(void* data)
+{
+	checksum_job_t* job;
+	Uint32 first, count;
+
+	job = data;
+
+	while (1)
+	{
+		SDL_LockMutex(job->mutex);
+
+		first = job->next;
+		count = min2u(CHECKSUM_BATCH_SIZE, job->count - first);
+		job->next += count;
+
+		SDL_UnlockMutex(job->mutex);
+
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		check_batch(job, first, count);
+	}
+}
+
+Uint32 checksum_check_files(const char** file_names,
+	const MD5_DIGEST* digests, const Uint32 count, Uint32* results)
+{
+	SDL_Thread* threads[CHECKSUM_THREAD_COUNT - 1];
+	checksum_job_t job;
+	Uint32 i, errors;
+
+	job.file_names = file_names;
+	job.digests = digests;
+	job.results = results;
+	job.count = count;
+	job.next = 0;
+	job.mutex = SDL_CreateMutex();
+
+	for (i = 0; i < (CHECKSUM_THREAD_COUNT - 1); i++)
+	{
+		threads[i] = SDL_CreateThread(checksum_thread, &job);
+	}
+
+	checksum_thread(&job);
+
+	for (i = 0; i < (CHECKSUM_THREAD_COUNT - 1); i++)
+	{
+		if (threads[i] != 0)
+		{
+			SDL_WaitThread(threads[i], 0);
+		}
+	}
+
+	SDL_DestroyMutex(job.mutex);
+
+	errors = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		if (results[i] != 0)
+		{
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+int command_verify_data(char *text, int len)
+{
+	char buffer[1024];
+	char file_name[256];
+	char md5[256];
+	char str[512];
+	char** file_names;
+	MD5_DIGEST* digests;
+	Uint32* results;
+	Uint32 i, count, size, errors, start;
+	gzFile file;
+
+	safe_snprintf(buffer, sizeof(buffer), "%sfiles.lst",
+		get_path_updates());
+
+	file = my_gzopen(buffer, "rb");
+
+	if (file == 0)
+	{
+		safe_snprintf(str, sizeof(str), "Can't open '%s'", buffer);
+		LOG_TO_CONSOLE(c_red1, str);
+
+		return 1;
+	}
+
+	file_names = 0;
+	digests = 0;
+	count = 0;
+	size = 0;
+
+	while (gzgets(file, buffer, sizeof(buffer)) != Z_NULL)
+	{
+		file_name[0] = 0;
+		md5[0] = 0;
+
+		sscanf(buffer, "%*[^(](%250[^)])%*[^0-9a-zA-Z]%32s", file_name,
+			md5);
+
+		if ((file_name[0] == 0) || (md5[0] == 0) ||
+			(strstr(file_name, "..") != 0) || (file_name[0] == '/') ||
+			(file_name[0] == '\\') || (file_name[1] == ':') ||
+			(strcasecmp(md5, "none") == 0))
+		{
+			continue;
+		}
+
+		if (count >= size)
+		{
+			size = size * 2 + 256;
+			file_names = realloc(file_names, size * sizeof(char*));
+			digests = realloc(digests, size * sizeof(MD5_DIGEST));
+		}
+
+		if (convert_string_to_md5_digest(md5, digests[count]) != 0)
+		{
+			continue;
+		}
+
+		/* The updated file is used if there is one */
+		safe_snprintf(buffer, sizeof(buffer), "%s%s",
+			get_path_updates(), file_name);
+
+		if (file_exists(buffer) != 1)
+		{
+			safe_snprintf(buffer, sizeof(buffer), "%s%s", datadir,
+				file_name);
+		}
+
+		file_names[count] = strdup(buffer);
+		count++;
+	}
+
+	gzclose(file);
+
+	results = calloc(count + 1, sizeof(Uint32));
+
+	start = SDL_GetTicks();
+
+	errors = checksum_check_files((const char**)file_names, digests,
+		count, results);
+
+	safe_snprintf(str, sizeof(str), "%d files checked in %d ms, %d wrong "
+		"or missing", count, SDL_GetTicks() - start, errors);
+	LOG_TO_CONSOLE((errors == 0) ? c_green1 : c_red1, str);
+
+	for (i = 0; i < count; i++)
+	{
+		if (results[i] != 0)
+		{
+			safe_snprintf(str, sizeof(str), "%s: %s", file_names[i],
+				(results[i] == 1) ? "wrong md5" : "can't read");
+			LOG_TO_CONSOLE(c_red1, str);
+		}
+
+		free(file_names[i]);
+	}
+
+	free(file_names);
+	free(digests);
+	free(results);
+
+	return 1;
+}
+
+typedef struct
+{
+	const void** data;
+	Uint32* sizes;
+	MD5_DIGEST* digests;
+	Uint32 count;
+	Uint64 total_size;
+} benchmark_data_t;
+
+static void add_benchmark_file(benchmark_data_t* data, const char* file_name)
+{
+	char str[256];
+	el_file_ptr file;
+	void* buffer;
+
+	file = el_open(file_name);
+
+	if (file == 0)
+	{
+		safe_snprintf(str, sizeof(str), "Can't open '%s'", file_name);
+		LOG_TO_CONSOLE(c_red1, str);
+
+		return;
+	}
+
+	buffer = malloc(el_get_size(file));
+	memcpy(buffer, el_get_pointer(file), el_get_size(file));
+
+	data->data = realloc(data->data, (data->count + 1) * sizeof(void*));
+	data->sizes = realloc(data->sizes, (data->count + 1) *
+		sizeof(Uint32));
+	data->data[data->count] = buffer;
+	data->sizes[data->count] = el_get_size(file);
+	data->total_size += el_get_size(file);
+	data->count++;
+
+	el_close(file);
+}
+
+/* Measures ten crc32, crc64 and md5 runs over all files */
+static void time_checksums(benchmark_data_t* data, Uint32* times)
+{
+	Uint32 i, j, start;
+
+	start = SDL_GetTicks();
+
+	for (i = 0; i < 10; i++)
+	{
+		for (j = 0; j < data->count; j++)
+		{
+			CrcCalc(data->data[j], data->sizes[j]);
+		}
+	}
+
+	times[0] = SDL_GetTicks() - start + 1;
+	start = SDL_GetTicks();
+
+	for (i = 0; i < 10; i++)
+	{
+		for (j = 0; j < data->count; j++)
+		{
+			Crc64Calc(data->data[j], data->sizes[j]);
+		}
+	}
+
+	times[1] = SDL_GetTicks() - start + 1;
+	start = SDL_GetTicks();
+
+	for (i = 0; i < 10; i++)
+	{
+		md5_multi(data->data, data->sizes, data->count,
+			data->digests);
+	}
+
+	times[2] = SDL_GetTicks() - start + 1;
+}
+
+int command_checksum_benchmark(char *text, int len)
+{
+	char str[256];
+	char file_name[256];
+	benchmark_data_t data;
+	Uint32 table_times[3], simd_times[3];
+	Uint32 i, use_simd;
+	Uint64 size;
+	int pos;
+
+	memset(&data, 0, sizeof(data));
+
+	while (sscanf(text, " %255s%n", file_name, &pos) == 1)
+	{
+		add_benchmark_file(&data, file_name);
+		text += pos;
+	}
+
+	if (data.count == 0)
+	{
+		for (i = 0; continent_maps[i].name != NULL; i++)
+		{
+			if (el_file_exists(continent_maps[i].name))
+			{
+				add_benchmark_file(&data,
+					continent_maps[i].name);
+			}
+		}
+	}
+
+	if (data.count == 0)
+	{
+		return 1;
+	}
+
+	data.digests = malloc(data.count * sizeof(MD5_DIGEST));
+
+	use_simd = checksum_use_simd();
+
+	init_checksums(0);
+	time_checksums(&data, table_times);
+	init_checksums(1);
+	time_checksums(&data, simd_times);
+	init_checksums(use_simd);
+
+	size = data.total_size * 10 * 1000 / (1024 * 1024);
+
+	safe_snprintf(str, sizeof(str), "%d files, %d kb: crc32 %d/%d MB/s, "
+		"crc64 %d/%d MB/s, md5 %d/%d MB/s (tables/simd)", data.count,
+		(int)(data.total_size / 1024),
+		(int)(size / table_times[0]), (int)(size / simd_times[0]),
+		(int)(size / table_times[1]), (int)(size / simd_times[1]),
+		(int)(size / table_times[2]), (int)(size / simd_times[2]));
+	LOG_TO_CONSOLE(c_green1, str);
+
+	for (i = 0; i < data.count; i++)
+	{
+		free((void*)data.data[i]);
+	}
+
+	free(data.data);
+	free(data.sizes);
+	free(data.digests);
+
+	return 1;
+}
+#endif	/* ELC */
@@ -0,0 +1,96 @@
+/*!
+ * \file
+ * \ingroup io
+ * \brief fast crc32, crc64 and md5 checksums of the data files
+ *
+ * The crc32 and crc64 of the xz code are replaced with versions that fold
+ * the data with carry-less multiplications if the cpu supports them. The
+ * md5 of several buffers is calculated four at a time with sse2, which is
+ * used to check all the data files against the update list on threads.
+ */
+#ifndef UUID_3c9a51e7_0b84_4f2d_a6e3_71d5c8f2b046
+#define UUID_3c9a51e7_0b84_4f2d_a6e3_71d5c8f2b046
+
+#include "../platform.h"
+#include "../md5.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CHECKSUM_THREAD_COUNT	4
+
+/*!
+ * \brief Selects the crc and md5 functions.
+ *
+ * Must be called after the crc tables are generated. Installs the folding
+ * crc32 and crc64 functions if use_simd is not zero and the cpu supports
+ * them, else the table driven ones.
+ * \param use_simd Use the simd functions if not zero.
+ */
+void init_checksums(const Uint32 use_simd);
+
+/*!
+ * \brief Checks if the simd functions are used.
+ * \retval Uint32 Returns one if the simd functions are used, else zero.
+ */
+Uint32 checksum_use_simd();
+
+/*!
+ * \brief Calculates the md5 of several buffers.
+ *
+ * Four buffers are hashed at the same time with sse2, a buffer is
+ * finished on its own when only its last block is left and the next
+ * buffer takes its place.
+ * \param data The buffers.
+ * \param sizes The sizes of the buffers.
+ * \param count The number of buffers.
+ * \param digests The md5 digest of each buffer.
+ */
+void md5_multi(const void** data, const Uint32* sizes, const Uint32 count,
+	MD5_DIGEST* digests);
+
+#ifdef	ELC
+/*!
+ * \brief Checks files against their md5.
+ *
+ * The files are read and hashed on several threads. The result of a file
+ * is zero if it matches, one if it doesn't and two if it can't be read.
+ * \param file_names The names of the files.
+ * \param digests The md5 that each file should have.
+ * \param count The number of files.
+ * \param results The result of each file.
+ * \retval Uint32 Returns the number of files that don't match or can't be
+ * read.
+ */
+Uint32 checksum_check_files(const char** file_names,
+	const MD5_DIGEST* digests, const Uint32 count, Uint32* results);
+
+/*!
+ * \brief Checks all data files listed in files.lst.
+ *
+ * The file in the updates directory is checked if there is one, else the
+ * file in the data directory. Prints the files that don't match.
+ * \param text Unused.
+ * \param len Unused.
+ * \retval int Always returns 1.
+ */
+int command_verify_data(char *text, int len);
+
+/*!
+ * \brief Compares the speed of the table and simd checksums.
+ *
+ * Uses the given files, or every continent map if none is given.
+ * \param text The names of the files, separated by spaces.
+ * \param len The length of the text.
+ * \retval int Always returns 1.
+ */
+int command_checksum_benchmark(char *text, int len);
+#endif	/* ELC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UUID_3c9a51e7_0b84_4f2d_a6e3_71d5c8f2b046 */
@@ -0,0 +1,532 @@
+#include "delta.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DELTA_PATCH_VERSION	1
+#define DELTA_BLOCK_SIZE	16
+#define DELTA_HASH_BASE	0x01000193
+#define DELTA_MAX_TARGET_SIZE	0x40000000
+
+typedef enum
+{
+	dps_header = 0,
+	dps_tag,
+	dps_offset,
+	dps_data,
+	dps_done,
+	dps_error
+} delta_patch_state_t;
+
+static Uint32 read_le32(const Uint8* data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) |
+		((Uint32)data[3] << 24);
+}
+
+static Uint64 read_le64(const Uint8* data)
+{
+	return read_le32(data) | ((Uint64)read_le32(data + 4) << 32);
+}
+
+static void write_le32(Uint8* data, const Uint32 value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+static void write_le64(Uint8* data, const Uint64 value)
+{
+	write_le32(data, value & 0xFFFFFFFF);
+	write_le32(data + 4, value >> 32);
+}
+
+void delta_patch_init(delta_patch_t* patch, const void* source,
+	const Uint64 source_size)
+{
+	memset(patch, 0, sizeof(delta_patch_t));
+
+	patch->source = source;
+	patch->source_size = source_size;
+	patch->state = dps_header;
+}
+
+static Uint32 check_header(delta_patch_t* patch)
+{
+	MD5 md5;
+	MD5_DIGEST digest;
+
+	if ((memcmp(patch->header, "ELDP", 4) != 0) ||
+		(read_le32(patch->header + 4) != DELTA_PATCH_VERSION) ||
+		(read_le64(patch->header + 8) != patch->source_size))
+	{
+		return 1;
+	}
+
+	MD5Open(&md5);
+	MD5Digest(&md5, patch->source, patch->source_size);
+	MD5Close(&md5, digest);
+
+	if (memcmp(patch->header + 16, digest, sizeof(MD5_DIGEST)) != 0)
+	{
+		return 1;
+	}
+
+	patch->target_size = read_le64(patch->header + 32);
+	memcpy(patch->target_digest, patch->header + 40, sizeof(MD5_DIGEST));
+
+	if (patch->target_size > DELTA_MAX_TARGET_SIZE)
+	{
+		return 1;
+	}
+
+	patch->data = malloc(patch->target_size + 1);
+
+	if (patch->data == 0)
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Reads the next byte of a varint, returns one when it is complete. */
+static Uint32 read_varint(delta_patch_t* patch, const Uint8 value)
+{
+	if (patch->shift > 56)
+	{
+		patch->state = dps_error;
+
+		return 0;
+	}
+
+	patch->value |= (Uint64)(value & 0x7F) << patch->shift;
+	patch->shift += 7;
+
+	return (value & 0x80) == 0;
+}
+
+static Uint32 start_operation(delta_patch_t* patch)
+{
+	if ((patch->length == 0) ||
+		(patch->length > (patch->target_size - patch->size)))
+	{
+		return 1;
+	}
+
+	if (patch->copy == 0)
+	{
+		patch->state = dps_data;
+
+		return 0;
+	}
+
+	patch->state = dps_offset;
+
+	return 0;
+}
+
+static Uint32 copy_source(delta_patch_t* patch)
+{
+	Sint64 offset;
+
+	offset = (patch->value >> 1) ^ -(Sint64)(patch->value & 1);
+
+	if ((offset < -(Sint64)patch->source_pos) || ((patch->source_pos +
+		offset + patch->length) > patch->source_size))
+	{
+		return 1;
+	}
+
+	patch->source_pos += offset;
+
+	memcpy(patch->data + patch->size, patch->source + patch->source_pos,
+		patch->length);
+
+	patch->source_pos += patch->length;
+	patch->size += patch->length;
+
+	return 0;
+}
+
+static void end_operation(delta_patch_t* patch)
+{
+	patch->value = 0;
+	patch->shift = 0;
+
+	if (patch->size == patch->target_size)
+	{
+		patch->state = dps_done;
+	}
+	else
+	{
+		patch->state = dps_tag;
+	}
+}
+
+Uint32 delta_patch_apply(delta_patch_t* patch, const void* buffer,
+	const Uint32 size)
+{
+	const Uint8* bytes;
+	Uint64 count;
+	Uint32 pos;
+
+	bytes = buffer;
+	pos = 0;
+
+	while ((pos < size) && (patch->state != dps_error))
+	{
+		switch (patch->state)
+		{
+			case dps_header:
+				count = DELTA_PATCH_HEADER_SIZE -
+					patch->header_size;
+
+				if (count > (size - pos))
+				{
+					count = size - pos;
+				}
+
+				memcpy(patch->header + patch->header_size,
+					bytes + pos, count);
+				patch->header_size += count;
+				pos += count;
+
+				if (patch->header_size <
+					DELTA_PATCH_HEADER_SIZE)
+				{
+					break;
+				}
+
+				if (check_header(patch) != 0)
+				{
+					patch->state = dps_error;
+					break;
+				}
+
+				end_operation(patch);
+				break;
+			case dps_tag:
+				if (read_varint(patch, bytes[pos++]) == 0)
+				{
+					break;
+				}
+
+				patch->copy = patch->value & 1;
+				patch->length = patch->value >> 1;
+				patch->value = 0;
+				patch->shift = 0;
+
+				if (start_operation(patch) != 0)
+				{
+					patch->state = dps_error;
+				}
+				break;
+			case dps_offset:
+				if (read_varint(patch, bytes[pos++]) == 0)
+				{
+					break;
+				}
+
+				if (copy_source(patch) != 0)
+				{
+					patch->state = dps_error;
+					break;
+				}
+
+				end_operation(patch);
+				break;
+			case dps_data:
+				count = patch->length;
+
+				if (count > (size - pos))
+				{
+					count = size - pos;
+				}
+
+				memcpy(patch->data + patch->size, bytes + pos,
+					count);
+				patch->size += count;
+				patch->length -= count;
+				pos += count;
+
+				if (patch->length == 0)
+				{
+					end_operation(patch);
+				}
+				break;
+			case dps_done:
+				/* bytes after the end of the target */
+				patch->state = dps_error;
+				break;
+			case dps_error:
+				break;
+		}
+	}
+
+	return patch->state == dps_error;
+}
+
+Uint32 delta_patch_finish(delta_patch_t* patch)
+{
+	MD5 md5;
+	MD5_DIGEST digest;
+
+	if (patch->state != dps_done)
+	{
+		return 1;
+	}
+
+	MD5Open(&md5);
+	MD5Digest(&md5, patch->data, patch->size);
+	MD5Close(&md5, digest);
+
+	if (memcmp(digest, patch->target_digest, sizeof(MD5_DIGEST)) != 0)
+	{
+		return 1;
+	}
+
+	patch->data[patch->size] = 0;
+
+	return 0;
+}
+
+void delta_patch_free(delta_patch_t* patch)
+{
+	free(patch->data);
+
+	patch->data = 0;
+	patch->size = 0;
+}
+
+typedef struct
+{
+	Uint8* data;
+	Uint64 size;
+	Uint64 capacity;
+} delta_buffer_t;
+
+static void reserve(delta_buffer_t* buffer, const Uint64 size)
+{
+	if ((buffer->size + size) <= buffer->capacity)
+	{
+		return;
+	}
+
+	while ((buffer->size + size) > buffer->capacity)
+	{
+		buffer->capacity = buffer->capacity * 2 + 4096;
+	}
+
+	buffer->data = realloc(buffer->data, buffer->capacity);
+}
+
+static void write_bytes(delta_buffer_t* buffer, const void* data,
+	const Uint64 size)
+{
+	reserve(buffer, size);
+
+	memcpy(buffer->data + buffer->size, data, size);
+	buffer->size += size;
+}
+
+static void write_varint(delta_buffer_t* buffer, Uint64 value)
+{
+	Uint8 byte;
+
+	do
+	{
+		byte = value & 0x7F;
+		value >>= 7;
+
+		if (value != 0)
+		{
+			byte |= 0x80;
+		}
+
+		write_bytes(buffer, &byte, 1);
+	}
+	while (value != 0);
+}
+
+static void write_add(delta_buffer_t* buffer, const Uint8* data,
+	const Uint64 size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	write_varint(buffer, size << 1);
+	write_bytes(buffer, data, size);
+}
+
+static void write_copy(delta_buffer_t* buffer, const Sint64 offset,
+	const Uint64 size)
+{
+	write_varint(buffer, (size << 1) | 1);
+	write_varint(buffer, ((Uint64)offset << 1) ^ (Uint64)(offset >> 63));
+}
+
+static Uint32 hash_block(const Uint8* data)
+{
+	Uint32 i, hash;
+
+	hash = 0;
+
+	for (i = 0; i < DELTA_BLOCK_SIZE; i++)
+	{
+		hash = hash * DELTA_HASH_BASE + data[i];
+	}
+
+	return hash;
+}
+
+static void write_header(delta_buffer_t* buffer, const void* source,
+	const Uint64 source_size, const void* target,
+	const Uint64 target_size)
+{
+	Uint8 header[DELTA_PATCH_HEADER_SIZE];
+	MD5 md5;
+
+	memcpy(header, "ELDP", 4);
+	write_le32(header + 4, DELTA_PATCH_VERSION);
+	write_le64(header + 8, source_size);
+
+	MD5Open(&md5);
+	MD5Digest(&md5, source, source_size);
+	MD5Close(&md5, header + 16);
+
+	write_le64(header + 32, target_size);
+
+	MD5Open(&md5);
+	MD5Digest(&md5, target, target_size);
+	MD5Close(&md5, header + 40);
+
+	write_bytes(buffer, header, sizeof(header));
+}
+
+/* The source is indexed at every block boundary, the target is searched
+ * at every byte with a rolling hash and matches are grown in both
+ * directions. */
+Uint32 delta_patch_create(const void* source, const Uint64 source_size,
+	const void* target, const Uint64 target_size, void** patch,
+	Uint64* patch_size)
+{
+	delta_buffer_t buffer;
+	const Uint8* src;
+	const Uint8* dst;
+	Uint32* table;
+	Uint64 i, j, start, len, last;
+	Uint32 hash, power, mask, size;
+
+	src = source;
+	dst = target;
+
+	if ((source_size > 0xFFFFFFF0) ||
+		(target_size > DELTA_MAX_TARGET_SIZE))
+	{
+		return 1;
+	}
+
+	size = 1024;
+
+	while (size < (source_size / DELTA_BLOCK_SIZE * 2))
+	{
+		size *= 2;
+	}
+
+	mask = size - 1;
+	table = calloc(size, sizeof(Uint32));
+
+	if (table == 0)
+	{
+		return 1;
+	}
+
+	for (i = 0; (i + DELTA_BLOCK_SIZE) <= source_size;
+		i += DELTA_BLOCK_SIZE)
+	{
+		table[hash_block(src + i) & mask] = i + 1;
+	}
+
+	power = 1;
+
+	for (i = 1; i < DELTA_BLOCK_SIZE; i++)
+	{
+		power *= DELTA_HASH_BASE;
+	}
+
+	memset(&buffer, 0, sizeof(buffer));
+
+	write_header(&buffer, source, source_size, target, target_size);
+
+	start = 0;
+	last = 0;
+	i = 0;
+	hash = 0;
+
+	if (target_size >= DELTA_BLOCK_SIZE)
+	{
+		hash = hash_block(dst);
+	}
+
+	while ((i + DELTA_BLOCK_SIZE) <= target_size)
+	{
+		j = table[hash & mask];
+
+		if ((j != 0) && (memcmp(src + j - 1, dst + i,
+			DELTA_BLOCK_SIZE) == 0))
+		{
+			j--;
+
+			while ((i > start) && (j > 0) &&
+				(src[j - 1] == dst[i - 1]))
+			{
+				i--;
+				j--;
+			}
+
+			len = DELTA_BLOCK_SIZE;
+
+			while (((i + len) < target_size) &&
+				((j + len) < source_size) &&
+				(src[j + len] == dst[i + len]))
+			{
+				len++;
+			}
+
+			write_add(&buffer, dst + start, i - start);
+			write_copy(&buffer, (Sint64)j - (Sint64)last, len);
+
+			i += len;
+			last = j + len;
+			start = i;
+
+			if ((i + DELTA_BLOCK_SIZE) <= target_size)
+			{
+				hash = hash_block(dst + i);
+			}
+
+			continue;
+		}
+
+		if ((i + DELTA_BLOCK_SIZE) < target_size)
+		{
+			hash = (hash - dst[i] * power) * DELTA_HASH_BASE +
+				dst[i + DELTA_BLOCK_SIZE];
+		}
+
+		i++;
+	}
+
+	write_add(&buffer, dst + start, target_size - start);
+
+	free(table);
+
+	*patch = buffer.data;
+	*patch_size = buffer.size;
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*!
+ * \file
+ * \ingroup io
+ * \brief binary delta patches for the update files
+ *
+ * A patch starts with the magic "ELDP", the version, the size and md5
+ * digest of the source and the size and md5 digest of the target, all
+ * numbers in little endian. It is followed by a list of operations that
+ * build the target in order. Each operation starts with a varint of the
+ * length shifted left by one, the lowest bit set for a copy from the
+ * source. A copy is followed by a zigzag varint of the source offset
+ * relative to the end of the previous copy, any other operation by the
+ * bytes to add.
+ */
+#ifndef UUID_8c41a9f2_6e0d_4d35_b7f1_2a9e5c7d3b60
+#define UUID_8c41a9f2_6e0d_4d35_b7f1_2a9e5c7d3b60
+
+#include <SDL_types.h>
+#include "../md5.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define DELTA_PATCH_HEADER_SIZE	56
+
+/*!
+ * The state of a patch that is applied while its bytes arrive.
+ */
+typedef struct
+{
+	const Uint8* source;
+	Uint64 source_size;
+	Uint64 source_pos;
+	Uint8 header[DELTA_PATCH_HEADER_SIZE];
+	Uint32 header_size;
+	Uint32 state;
+	Uint32 copy;
+	Uint32 shift;
+	Uint64 value;
+	Uint64 length;
+	MD5_DIGEST target_digest;
+	Uint8* data;
+	Uint64 size;
+	Uint64 target_size;
+} delta_patch_t;
+
+/*!
+ * \brief Starts applying a patch.
+ * \param patch The patch state to initialize.
+ * \param source The data of the file to patch, must be valid until the
+ * patch is finished.
+ * \param source_size The size of the file to patch.
+ */
+void delta_patch_init(delta_patch_t* patch, const void* source,
+	const Uint64 source_size);
+
+/*!
+ * \brief Applies the next bytes of a patch.
+ *
+ * The header is checked against the source as soon as it is complete and
+ * the operations are applied to the target as they arrive.
+ * \param patch The patch state.
+ * \param buffer The next bytes of the patch.
+ * \param size The number of bytes.
+ * \retval Uint32 Returns zero if everything is ok, else one.
+ */
+Uint32 delta_patch_apply(delta_patch_t* patch, const void* buffer,
+	const Uint32 size);
+
+/*!
+ * \brief Finishes a patch.
+ *
+ * Checks that the target is complete and has the md5 digest of the
+ * patch header. On success the target data is in data and size, owned
+ * by the caller.
+ * \param patch The patch state.
+ * \retval Uint32 Returns zero if the target is ok, else one.
+ */
+Uint32 delta_patch_finish(delta_patch_t* patch);
+
+/*!
+ * \brief Frees the target data of a patch.
+ * \param patch The patch state.
+ */
+void delta_patch_free(delta_patch_t* patch);
+
+/*!
+ * \brief Creates a patch.
+ *
+ * Creates a patch that turns the source into the target, copying every
+ * run of at least 16 bytes that is found in the source.
+ * \param source The old file.
+ * \param source_size The size of the old file.
+ * \param target The new file.
+ * \param target_size The size of the new file.
+ * \param patch The pointer to the var where the patch should be stored.
+ * \param patch_size The pointer to the var where the size of the patch
+ * should be stored.
+ * \retval Uint32 Returns zero if everything is ok, else one.
+ */
+Uint32 delta_patch_create(const void* source, const Uint64 source_size,
+	const void* target, const Uint64 target_size, void** patch,
+	Uint64* patch_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UUID_8c41a9f2_6e0d_4d35_b7f1_2a9e5c7d3b60 */
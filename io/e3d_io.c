@@ -13,6 +13,11 @@
 #include "elfilewrapper.h"
 #include "normal.h"
 #include "half.h"
+#ifdef	PACKED_VERTICES
+#include "../cache.h"
+#include "../e3d.h"
+#include "../text.h"
+#endif	/* PACKED_VERTICES */
 
 static Uint32 has_normal(const Uint32 options)
 {
@@ -278,6 +283,370 @@ static void read_vertex_buffer(el_file_ptr file, float* buffer, const Uint32 ver
 	}
 }
 
+#ifdef	PACKED_VERTICES
+/*!
+ * How the vertices are loaded. The benchmark uses all of them, else the
+ * vertices are always packed if the hardware can draw them.
+ */
+typedef enum
+{
+	vm_read = 0,	/*!< read each vertex from the file, as floats */
+	vm_decode,	/*!< decode all vertices in memory, as floats */
+	vm_packed	/*!< keep half floats and upload unchanged vertices */
+} vertex_mode;
+
+static vertex_mode e3d_vertex_mode = vm_packed;
+
+/*!
+ * The offsets of the vertex attributes in the file.
+ */
+typedef struct
+{
+	Uint32 uv;
+	Uint32 normal;
+	Uint32 position;
+	Uint32 color;
+} vertex_offsets;
+
+static void get_vertex_offsets(vertex_offsets* offsets, const Uint32 options,
+	const Uint32 format)
+{
+	Uint32 offset;
+
+	offset = 0;
+
+	offsets->uv = offset;
+
+	if (half_uv(format))
+	{
+		offset += 2 * sizeof(Uint16);
+	}
+	else
+	{
+		offset += 2 * sizeof(float);
+	}
+
+	if (has_secondary_texture_coordinate(options))
+	{
+		if (half_extra_uv(format))
+		{
+			offset += 2 * sizeof(Uint16);
+		}
+		else
+		{
+			offset += 2 * sizeof(float);
+		}
+	}
+
+	offsets->normal = offset;
+
+	if (has_normal(options))
+	{
+		if (compressed_normal(format))
+		{
+			offset += sizeof(Uint16);
+		}
+		else
+		{
+			offset += 3 * sizeof(float);
+		}
+	}
+
+	if (has_tangent(options))
+	{
+		if (compressed_normal(format))
+		{
+			offset += sizeof(Uint16);
+		}
+		else
+		{
+			offset += 3 * sizeof(float);
+		}
+	}
+
+	offsets->position = offset;
+
+	if (half_position(format))
+	{
+		offset += 3 * sizeof(Uint16);
+	}
+	else
+	{
+		offset += 3 * sizeof(float);
+	}
+
+	offsets->color = offset;
+}
+
+static Uint32 use_packed_vertices(const Uint32 format)
+{
+#if	SDL_BYTEORDER == SDL_LIL_ENDIAN
+	if (e3d_vertex_mode != vm_packed)
+	{
+		return 0;
+	}
+
+	if ((half_position(format) || half_uv(format)) &&
+		!have_extension(arb_half_float_vertex))
+	{
+		return 0;
+	}
+
+	return 1;
+#else	/* SDL_BYTEORDER == SDL_LIL_ENDIAN */
+	return 0;
+#endif	/* SDL_BYTEORDER == SDL_LIL_ENDIAN */
+}
+
+/*!
+ * The layout of the packed vertices: the uv and the position as in the
+ * file, the normal as in the file or as normalized shorts if it is
+ * compressed, and the color. Tangents and extra uvs are not drawn, so they
+ * are dropped.
+ */
+static void set_packed_layout(e3d_vertex_data* layout, const Uint32 options,
+	const Uint32 format)
+{
+	Uint32 offset;
+
+	memset(layout, 0, sizeof(e3d_vertex_data));
+
+	layout->texture_type = GL_FLOAT;
+	layout->normal_type = GL_FLOAT;
+	layout->position_type = GL_FLOAT;
+	layout->color_type = GL_UNSIGNED_BYTE;
+
+	offset = 0;
+
+	layout->texture_offset = offset;
+	layout->texture_count = 2;
+
+	if (half_uv(format))
+	{
+		layout->texture_type = GL_HALF_FLOAT_ARB;
+		offset += 2 * sizeof(Uint16);
+	}
+	else
+	{
+		offset += 2 * sizeof(float);
+	}
+
+	if (has_normal(options))
+	{
+		layout->normal_offset = offset;
+		layout->normal_count = 3;
+
+		if (compressed_normal(format))
+		{
+			layout->normal_type = GL_SHORT;
+			offset += 4 * sizeof(Sint16);
+		}
+		else
+		{
+			offset += 3 * sizeof(float);
+		}
+	}
+
+	layout->position_offset = offset;
+	layout->position_count = 3;
+
+	if (half_position(format))
+	{
+		layout->position_type = GL_HALF_FLOAT_ARB;
+		offset += 3 * sizeof(Uint16);
+	}
+	else
+	{
+		offset += 3 * sizeof(float);
+	}
+
+	if (has_color(options))
+	{
+		layout->color_offset = offset;
+		layout->color_count = 4;
+		offset += 4 * sizeof(Uint8);
+	}
+
+	layout->size = offset;
+}
+
+/*!
+ * Checks if the vertices of the file have the packed layout already.
+ */
+static Uint32 is_packed_layout(const e3d_vertex_data* layout,
+	const Uint32 vertex_size, const Uint32 options, const Uint32 format)
+{
+	if (has_normal(options) && compressed_normal(format))
+	{
+		return 0;
+	}
+
+	return (!has_tangent(options)) &&
+		(!has_secondary_texture_coordinate(options)) &&
+		(layout->size == vertex_size);
+}
+
+static void pack_vertex_buffer(const Uint8* src, Uint8* dst,
+	const Uint32 vertex_count, const Uint32 vertex_size,
+	const Uint32 options, const Uint32 format,
+	const e3d_vertex_data* layout)
+{
+	vertex_offsets offsets;
+	float normal[3];
+	Sint16 packed_normal[4];
+	Uint32 i, uv_size, position_size;
+	Uint16 tmp;
+
+	get_vertex_offsets(&offsets, options, format);
+
+	if (half_uv(format))
+	{
+		uv_size = 2 * sizeof(Uint16);
+	}
+	else
+	{
+		uv_size = 2 * sizeof(float);
+	}
+
+	if (half_position(format))
+	{
+		position_size = 3 * sizeof(Uint16);
+	}
+	else
+	{
+		position_size = 3 * sizeof(float);
+	}
+
+	packed_normal[3] = 0;
+
+	for (i = 0; i < vertex_count; i++)
+	{
+		memcpy(dst + layout->texture_offset, src + offsets.uv, uv_size);
+
+		if (has_normal(options))
+		{
+			if (compressed_normal(format))
+			{
+				memcpy(&tmp, src + offsets.normal, sizeof(Uint16));
+
+				uncompress_normal(SDL_SwapLE16(tmp), normal);
+
+				packed_normal[0] = normal[0] * 32767.0f;
+				packed_normal[1] = normal[1] * 32767.0f;
+				packed_normal[2] = normal[2] * 32767.0f;
+
+				memcpy(dst + layout->normal_offset, packed_normal,
+					4 * sizeof(Sint16));
+			}
+			else
+			{
+				memcpy(dst + layout->normal_offset,
+					src + offsets.normal, 3 * sizeof(float));
+			}
+		}
+
+		memcpy(dst + layout->position_offset, src + offsets.position,
+			position_size);
+
+		if (has_color(options))
+		{
+			memcpy(dst + layout->color_offset, src + offsets.color,
+				4 * sizeof(Uint8));
+		}
+
+		src += vertex_size;
+		dst += layout->size;
+	}
+}
+
+static void decode_halfs(const Uint8* src, float* dst, const Uint32 count)
+{
+	Uint32 i;
+	Uint16 tmp;
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy(&tmp, src + i * sizeof(Uint16), sizeof(Uint16));
+		dst[i] = half_to_float(SDL_SwapLE16(tmp));
+	}
+}
+
+static void decode_floats(const Uint8* src, float* dst, const Uint32 count)
+{
+	Uint32 i;
+	float tmp;
+
+	for (i = 0; i < count; i++)
+	{
+		memcpy(&tmp, src + i * sizeof(float), sizeof(float));
+		dst[i] = SwapLEFloat(tmp);
+	}
+}
+
+/*!
+ * Decodes the vertices to floats like read_vertex_buffer, but from the
+ * vertex block of the file in memory.
+ */
+static void decode_vertex_buffer(const Uint8* src, float* buffer,
+	const Uint32 vertex_count, const Uint32 vertex_size,
+	const Uint32 options, const Uint32 format)
+{
+	vertex_offsets offsets;
+	Uint32 i;
+	Uint16 tmp;
+
+	get_vertex_offsets(&offsets, options, format);
+
+	for (i = 0; i < vertex_count; i++)
+	{
+		if (half_uv(format))
+		{
+			decode_halfs(src + offsets.uv, buffer, 2);
+		}
+		else
+		{
+			decode_floats(src + offsets.uv, buffer, 2);
+		}
+
+		buffer += 2;
+
+		if (has_normal(options))
+		{
+			if (compressed_normal(format))
+			{
+				memcpy(&tmp, src + offsets.normal, sizeof(Uint16));
+				uncompress_normal(SDL_SwapLE16(tmp), buffer);
+			}
+			else
+			{
+				decode_floats(src + offsets.normal, buffer, 3);
+			}
+
+			buffer += 3;
+		}
+
+		if (half_position(format))
+		{
+			decode_halfs(src + offsets.position, buffer, 3);
+		}
+		else
+		{
+			decode_floats(src + offsets.position, buffer, 3);
+		}
+
+		buffer += 3;
+
+		if (has_color(options))
+		{
+			memcpy(buffer, src + offsets.color, 4 * sizeof(Uint8));
+			buffer += 1;
+		}
+
+		src += vertex_size;
+	}
+}
+#endif	/* PACKED_VERTICES */
+
 static void free_e3d_pointer(e3d_object* cur_object)
 {
 	if (cur_object != 0)
@@ -331,6 +700,10 @@ static e3d_object* do_load_e3d_detail(e3d_object* cur_object)
 	Uint8* index_pointer;
 	el_file_ptr file;
 	version_number version;
+#ifdef	PACKED_VERTICES
+	Uint8* vertex_pointer;
+	const void* vertex_source;
+#endif	/* PACKED_VERTICES */
 	
 	if (cur_object == 0) return 0;
 
@@ -500,12 +873,73 @@ static e3d_object* do_load_e3d_detail(e3d_object* cur_object)
 	// Now reading the vertices
 	el_seek(file, SDL_SwapLE32(header.vertex_offset), SEEK_SET);
 
+#ifdef	PACKED_VERTICES
+	if (((Uint64)SDL_SwapLE32(header.vertex_offset) +
+		(Uint64)cur_object->vertex_no * vertex_size) > el_get_size(file))
+	{
+		LOG_ERROR("File '%s' is too short for its vertices!", cur_object->file_name);
+
+		free_e3d_pointer(cur_object);
+		el_close(file);
+
+		return 0;
+	}
+
+	vertex_pointer = (Uint8*)el_get_pointer(file) + SDL_SwapLE32(header.vertex_offset);
+
+	if (use_packed_vertices(header.vertex_format))
+	{
+		set_packed_layout(&cur_object->packed_layout,
+			header.vertex_options, header.vertex_format);
+		cur_object->vertex_layout = &cur_object->packed_layout;
+	}
+
+	mem_size = cur_object->vertex_no * cur_object->vertex_layout->size;
+
+	// The vertices of the file are uploaded unchanged if they are packed
+	// already, the file is closed after the upload
+	if ((cur_object->vertex_layout == &cur_object->packed_layout) &&
+		is_packed_layout(cur_object->vertex_layout, vertex_size,
+			header.vertex_options, header.vertex_format) &&
+		use_vertex_buffers)
+	{
+		cur_object->vertex_data = 0;
+		vertex_source = vertex_pointer;
+	}
+	else
+	{
+		cur_object->vertex_data = malloc(mem_size);
+		if (!CHECK_POINTER(cur_object->vertex_data, "vertex data")) return 0;
+		vertex_source = cur_object->vertex_data;
+
+		if (cur_object->vertex_layout == &cur_object->packed_layout)
+		{
+			pack_vertex_buffer(vertex_pointer, cur_object->vertex_data,
+				cur_object->vertex_no, vertex_size,
+				header.vertex_options, header.vertex_format,
+				cur_object->vertex_layout);
+		}
+		else if (e3d_vertex_mode == vm_read)
+		{
+			read_vertex_buffer(file, (float*)(cur_object->vertex_data),
+				cur_object->vertex_no, vertex_size,
+				header.vertex_options, header.vertex_format);
+		}
+		else
+		{
+			decode_vertex_buffer(vertex_pointer, (float*)(cur_object->vertex_data),
+				cur_object->vertex_no, vertex_size,
+				header.vertex_options, header.vertex_format);
+		}
+	}
+#else	/* PACKED_VERTICES */
 	cur_object->vertex_data = malloc(cur_object->vertex_no * cur_object->vertex_layout->size);
 	mem_size = cur_object->vertex_no * cur_object->vertex_layout->size;
 	if (!CHECK_POINTER(cur_object->vertex_data, "vertex data")) return 0;
 
 	read_vertex_buffer(file, (float*)(cur_object->vertex_data), cur_object->vertex_no,
 		vertex_size, header.vertex_options, header.vertex_format);
+#endif	/* PACKED_VERTICES */
 
 	LOG_DEBUG("Reading indices at %d from e3d file '%s'.",
 		SDL_SwapLE32(header.index_offset), cur_object->file_name);
@@ -635,7 +1069,9 @@ static e3d_object* do_load_e3d_detail(e3d_object* cur_object)
 		el_seek(file, file_pos, SEEK_SET);
 
 	}
+#ifndef	PACKED_VERTICES
 	el_close(file);
+#endif	/* PACKED_VERTICES */
 
 	LOG_DEBUG("Building vertex buffers (%d) for e3d file '%s'.",
 		use_vertex_buffers, cur_object->file_name);
@@ -648,7 +1084,12 @@ static e3d_object* do_load_e3d_detail(e3d_object* cur_object)
 			cur_object->vertex_vbo);
 		ELglBufferDataARB(GL_ARRAY_BUFFER_ARB,
 			cur_object->vertex_no * cur_object->vertex_layout->size,
-			cur_object->vertex_data, GL_STATIC_DRAW_ARB);
+#ifdef	PACKED_VERTICES
+			vertex_source,
+#else	/* PACKED_VERTICES */
+			cur_object->vertex_data,
+#endif	/* PACKED_VERTICES */
+			GL_STATIC_DRAW_ARB);
 #ifndef	MAP_EDITOR
 		free(cur_object->vertex_data);
 		cur_object->vertex_data = 0;
@@ -673,6 +1114,9 @@ static e3d_object* do_load_e3d_detail(e3d_object* cur_object)
 		cur_object->vertex_vbo = 0;
 		cur_object->indices_vbo = 0;
 	}
+#ifdef	PACKED_VERTICES
+	el_close(file);
+#endif	/* PACKED_VERTICES */
 
 #ifndef	MAP_EDITOR
 	LOG_DEBUG("Adding e3d file '%s' to cache.",
@@ -696,3 +1140,67 @@ e3d_object* load_e3d_detail(e3d_object* cur_object)
 	return result;
 }
 
+
+#if	defined(PACKED_VERTICES) && !defined(MAP_EDITOR)
+int command_e3d_benchmark(char *text, int len)
+{
+	static const char* mode_names[] = { "read", "decoded", "packed" };
+	e3d_object* e3d;
+	char str[256];
+	Uint32 start, time, size, count, vertices;
+	int i, mode;
+
+	for (mode = vm_read; mode <= vm_packed; mode++)
+	{
+		e3d_vertex_mode = mode;
+
+		count = 0;
+		vertices = 0;
+		size = 0;
+
+		start = SDL_GetTicks();
+
+#ifdef FASTER_MAP_LOAD
+		for (i = 0; i < cache_e3d->num_items; i++)
+#else
+		for (i = 0; i < cache_e3d->max_item; i++)
+#endif
+		{
+			if (!cache_e3d->cached_items[i])
+			{
+				continue;
+			}
+
+			e3d = cache_e3d->cached_items[i]->cache_item;
+
+			free_e3d_va(e3d);
+
+			if (load_e3d_detail(e3d) == 0)
+			{
+				continue;
+			}
+
+			count++;
+			vertices += e3d->vertex_no;
+			size += e3d->vertex_no * e3d->vertex_layout->size;
+		}
+
+		time = SDL_GetTicks() - start;
+
+		safe_snprintf(str, sizeof(str), "%s: %d objects, %d vertices in "
+			"%d ms, %d kb", mode_names[mode], count, vertices, time,
+			size / 1024);
+		LOG_TO_CONSOLE(c_green1, str);
+	}
+
+	e3d_vertex_mode = vm_packed;
+
+	if (!have_extension(arb_half_float_vertex))
+	{
+		LOG_TO_CONSOLE(c_green1, "No half float vertices, the packed "
+			"objects with half floats are decoded");
+	}
+
+	return 1;
+}
+#endif	/* PACKED_VERTICES && !MAP_EDITOR */
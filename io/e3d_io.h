@@ -87,6 +87,20 @@ typedef struct
 
 e3d_object* load_e3d_detail(e3d_object* cur_object);
 
+#if	defined(PACKED_VERTICES) && !defined(MAP_EDITOR)
+/*!
+ * \brief Times loading the vertices of all objects in the e3d cache.
+ *
+ * Loads the vertices of every cached object by reading each vertex from
+ * the file, by decoding them in memory and packed, and prints the time and
+ * the size of the vertices for each.
+ * \param text Unused.
+ * \param len Unused.
+ * \retval int Always returns 1.
+ */
+int command_e3d_benchmark(char *text, int len);
+#endif	/* PACKED_VERTICES && !MAP_EDITOR */
+
 static __inline void load_e3d_detail_if_needed(e3d_object* e3d_data)
 {
 	if (use_vertex_buffers)
@@ -2,6 +2,12 @@
 #include "../xz/Xz.h"
 #include "../xz/7zCrc.h"
 #include "../xz/XzCrc64.h"
+#ifdef	PARALLEL_XZ
+#include "xz_blocks.h"
+#endif	/* PARALLEL_XZ */
+#ifdef	FAST_CHECKSUMS
+#include "checksum.h"
+#endif	/* FAST_CHECKSUMS */
 
 static void *SzAlloc(void *p, size_t size) { p = p; return malloc(size); }
 static void SzFree(void *p, void *address) { p = p; free(address); }
@@ -11,10 +17,13 @@ void init_crc_tables()
 {
 	CrcGenerateTable();
 	Crc64GenerateTable();
+#ifdef	FAST_CHECKSUMS
+	init_checksums(1);
+#endif	/* FAST_CHECKSUMS */
 }
 
-static Uint32 xz_unpack_data(const void* file_buffer,
-	const Uint64 file_size, void** buffer, Uint64* size)
+Uint32 xz_unpack_data(const void* file_buffer, const Uint64 file_size,
+	void** buffer, Uint64* size)
 {
 	CXzUnpacker state;
 	Uint64 uncompressed_size, dst_idx, src_idx;
@@ -22,6 +31,15 @@ static Uint32 xz_unpack_data(const void* file_buffer,
 	Uint32 err;
 	ECoderStatus status;
 
+#ifdef	PARALLEL_XZ
+	err = xz_blocks_unpack(file_buffer, file_size, 1, buffer, size);
+
+	if (err != 2)
+	{
+		return err;
+	}
+#endif	/* PARALLEL_XZ */
+
 	err = XzUnpacker_Create(&state, &lzmaAlloc);
 
 	*buffer = NULL;
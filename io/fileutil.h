@@ -20,6 +20,22 @@ extern "C"
  */
 void init_crc_tables();
 
+/**
+ * @brief Uncompresses xz data in memory.
+ *
+ * Uncompresses the given xz data. A zero byte is added at the end of the
+ * uncompressed data.
+ * @param file_buffer The xz data.
+ * @param file_size The size of the xz data.
+ * @param buffer The pointer to the var where the memeory buffer should be
+ * placed.
+ * @param size The pointer to the var where the size of the memory buffer
+ * should be placed.
+ * @return Zero if no error, else the xz error code.
+ */
+Uint32 xz_unpack_data(const void* file_buffer, const Uint64 file_size,
+	void** buffer, Uint64* size);
+
 /**
  * @brief Reads a file to memory.
  *
@@ -0,0 +1,559 @@
+#include "http_response.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <strings.h>
+#include "../xz/Xz.h"
+
+static void *SzAlloc(void *p, size_t size) { p = p; return malloc(size); }
+static void SzFree(void *p, void *address) { p = p; free(address); }
+static ISzAlloc lzmaAlloc = { SzAlloc, SzFree };
+
+void http_response_init(http_response_t* response)
+{
+	if (response->unpacker != 0)
+	{
+		XzUnpacker_Free(response->unpacker);
+		free(response->unpacker);
+	}
+
+	response->state = hrs_header;
+	response->status = 0;
+	response->keep_alive = 1;
+	response->chunked = 0;
+	response->content_length = (Uint64)-1;
+	response->remaining = 0;
+	response->header_size = 0;
+	response->etag[0] = 0;
+	response->signature_size = 0;
+	response->xz = 0;
+	response->unpacker = 0;
+	response->size = 0;
+
+	MD5Open(&response->body_md5);
+	MD5Open(&response->data_md5);
+}
+
+void http_response_free(http_response_t* response)
+{
+	if (response->unpacker != 0)
+	{
+		XzUnpacker_Free(response->unpacker);
+		free(response->unpacker);
+	}
+
+	free(response->data);
+
+	response->unpacker = 0;
+	response->data = 0;
+	response->size = 0;
+	response->capacity = 0;
+}
+
+static Uint32 reserve_data(http_response_t* response, const Uint64 size)
+{
+	Uint64 capacity;
+	Uint8* data;
+
+	if ((response->size + size) <= response->capacity)
+	{
+		return 0;
+	}
+
+	capacity = response->capacity;
+
+	if (capacity < 0x40000)
+	{
+		capacity = 0x40000;
+	}
+
+	while (capacity < (response->size + size))
+	{
+		capacity *= 2;
+	}
+
+	data = realloc(response->data, capacity);
+
+	if (data == 0)
+	{
+		return 1;
+	}
+
+	response->data = data;
+	response->capacity = capacity;
+
+	return 0;
+}
+
+static Uint32 add_data(http_response_t* response, const Uint8* buffer,
+	const Uint32 size)
+{
+	if (reserve_data(response, size) != 0)
+	{
+		return 1;
+	}
+
+	memcpy(response->data + response->size, buffer, size);
+	MD5Digest(&response->data_md5, buffer, size);
+	response->size += size;
+
+	return 0;
+}
+
+static Uint32 unpack_data(http_response_t* response, const Uint8* buffer,
+	const Uint32 size, const Uint32 finish)
+{
+	SizeT dst_size, src_size, available;
+	Uint32 pos;
+	ECoderStatus status;
+
+	pos = 0;
+
+	do
+	{
+		if (reserve_data(response, 0x10000) != 0)
+		{
+			return 1;
+		}
+
+		available = response->capacity - response->size;
+		dst_size = available;
+		src_size = size - pos;
+
+		if (XzUnpacker_Code(response->unpacker, response->data +
+			response->size, &dst_size, buffer + pos, &src_size,
+			CODER_FINISH_ANY, &status) != SZ_OK)
+		{
+			return 1;
+		}
+
+		MD5Digest(&response->data_md5, response->data +
+			response->size, dst_size);
+		response->size += dst_size;
+		pos += src_size;
+
+		if ((src_size == 0) && (dst_size == 0))
+		{
+			break;
+		}
+	}
+	while ((pos < size) || (dst_size == available));
+
+	if (finish != 0)
+	{
+		if (!XzUnpacker_IsStreamWasFinished(response->unpacker))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static Uint32 start_xz(http_response_t* response)
+{
+	response->unpacker = malloc(sizeof(CXzUnpacker));
+
+	if (response->unpacker == 0)
+	{
+		return 1;
+	}
+
+	if (XzUnpacker_Create(response->unpacker, &lzmaAlloc) != SZ_OK)
+	{
+		free(response->unpacker);
+		response->unpacker = 0;
+
+		return 1;
+	}
+
+	response->xz = 1;
+
+	return 0;
+}
+
+/* The first bytes are held back until it is known if the body is a xz
+ * file. */
+static Uint32 add_body_data(http_response_t* response, const Uint8* buffer,
+	const Uint32 size)
+{
+	Uint32 count;
+
+	if (size == 0)
+	{
+		return 0;
+	}
+
+	if (response->signature_size < XZ_SIG_SIZE)
+	{
+		count = XZ_SIG_SIZE - response->signature_size;
+
+		if (count > size)
+		{
+			count = size;
+		}
+
+		memcpy(response->signature + response->signature_size, buffer,
+			count);
+		response->signature_size += count;
+
+		if (response->signature_size < XZ_SIG_SIZE)
+		{
+			return 0;
+		}
+
+		if (memcmp(response->signature, XZ_SIG, XZ_SIG_SIZE) == 0)
+		{
+			if ((start_xz(response) != 0) ||
+				(unpack_data(response, response->signature,
+					XZ_SIG_SIZE, 0) != 0))
+			{
+				return 1;
+			}
+		}
+		else
+		{
+			if (add_data(response, response->signature,
+				XZ_SIG_SIZE) != 0)
+			{
+				return 1;
+			}
+		}
+
+		return add_body_data(response, buffer + count, size - count);
+	}
+
+	if (response->xz != 0)
+	{
+		return unpack_data(response, buffer, size, 0);
+	}
+
+	return add_data(response, buffer, size);
+}
+
+static Uint32 add_body(http_response_t* response, const Uint8* buffer,
+	const Uint32 size)
+{
+	MD5Digest(&response->body_md5, buffer, size);
+
+	if (response->status != 200)
+	{
+		return 0;
+	}
+
+	return add_body_data(response, buffer, size);
+}
+
+static Uint32 finish_body(http_response_t* response)
+{
+	if (response->status == 200)
+	{
+		if (response->xz != 0)
+		{
+			if (unpack_data(response, 0, 0, 1) != 0)
+			{
+				return 1;
+			}
+		}
+		else if (response->signature_size < XZ_SIG_SIZE)
+		{
+			if (add_data(response, response->signature,
+				response->signature_size) != 0)
+			{
+				return 1;
+			}
+		}
+	}
+
+	MD5Close(&response->body_md5, response->body_digest);
+	MD5Close(&response->data_md5, response->data_digest);
+
+	response->state = hrs_done;
+
+	return 0;
+}
+
+static void parse_header_line(http_response_t* response, const char* line)
+{
+	const char* value;
+
+	value = strchr(line, ':');
+
+	if (value == 0)
+	{
+		return;
+	}
+
+	value++;
+
+	while ((*value == ' ') || (*value == '\t'))
+	{
+		value++;
+	}
+
+	if (strncasecmp(line, "Content-Length:", 15) == 0)
+	{
+		response->content_length = strtoull(value, 0, 10);
+	}
+	else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+	{
+		response->chunked = strncasecmp(value, "chunked", 7) == 0;
+	}
+	else if (strncasecmp(line, "Connection:", 11) == 0)
+	{
+		if (strncasecmp(value, "close", 5) == 0)
+		{
+			response->keep_alive = 0;
+		}
+		else if (strncasecmp(value, "keep-alive", 10) == 0)
+		{
+			response->keep_alive = 1;
+		}
+	}
+	else if (strncasecmp(line, "ETag:", 5) == 0)
+	{
+		sscanf(value, "\"%63[^\"]", response->etag);
+	}
+}
+
+static Uint32 parse_header(http_response_t* response)
+{
+	char* line;
+	char* end;
+	Uint32 major, minor;
+
+	if (sscanf(response->header, "HTTP/%u.%u %u", &major, &minor,
+		&response->status) != 3)
+	{
+		return 1;
+	}
+
+	if ((major == 1) && (minor == 0))
+	{
+		response->keep_alive = 0;
+	}
+
+	line = strstr(response->header, "\r\n");
+
+	while (line != 0)
+	{
+		line += 2;
+		end = strstr(line, "\r\n");
+
+		if (end != 0)
+		{
+			*end = 0;
+		}
+
+		parse_header_line(response, line);
+
+		line = end;
+	}
+
+	if (response->chunked != 0)
+	{
+		response->state = hrs_chunk_size;
+		response->header_size = 0;
+	}
+	else if ((response->status == 204) || (response->status == 304) ||
+		(response->content_length == 0))
+	{
+		return finish_body(response);
+	}
+	else
+	{
+		response->remaining = response->content_length;
+		response->state = hrs_body;
+
+		if (response->content_length == (Uint64)-1)
+		{
+			response->keep_alive = 0;
+		}
+	}
+
+	return 0;
+}
+
+/* Collects a line of the chunk framing in the header buffer, returns one
+ * when the line is complete. */
+static Uint32 read_line(http_response_t* response, const Uint8* buffer,
+	const Uint32 size, Uint32* pos)
+{
+	while (*pos < size)
+	{
+		if (response->header_size >= (sizeof(response->header) - 1))
+		{
+			response->state = hrs_error;
+
+			return 0;
+		}
+
+		response->header[response->header_size] = buffer[*pos];
+		response->header_size++;
+		(*pos)++;
+
+		if ((response->header_size >= 2) &&
+			(response->header[response->header_size - 2] == '\r') &&
+			(response->header[response->header_size - 1] == '\n'))
+		{
+			response->header[response->header_size - 2] = 0;
+			response->header_size = 0;
+
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+Sint32 http_response_parse(http_response_t* response, const Uint8* buffer,
+	const Uint32 size)
+{
+	Uint64 count;
+	Uint32 pos;
+
+	pos = 0;
+
+	while ((pos < size) && (response->state != hrs_done) &&
+		(response->state != hrs_error))
+	{
+		switch (response->state)
+		{
+			case hrs_header:
+				if (response->header_size >=
+					(sizeof(response->header) - 1))
+				{
+					response->state = hrs_error;
+					break;
+				}
+
+				response->header[response->header_size] =
+					buffer[pos];
+				response->header_size++;
+				pos++;
+
+				if ((response->header_size >= 4) &&
+					(memcmp(response->header +
+					response->header_size - 4,
+					"\r\n\r\n", 4) == 0))
+				{
+					response->header[response->header_size
+						- 2] = 0;
+
+					if (parse_header(response) != 0)
+					{
+						response->state = hrs_error;
+					}
+				}
+				break;
+			case hrs_body:
+			case hrs_chunk_data:
+				count = size - pos;
+
+				if (count > response->remaining)
+				{
+					count = response->remaining;
+				}
+
+				if (add_body(response, buffer + pos, count) !=
+					0)
+				{
+					response->state = hrs_error;
+					break;
+				}
+
+				pos += count;
+				response->remaining -= count;
+
+				if (response->remaining > 0)
+				{
+					break;
+				}
+
+				if (response->state == hrs_chunk_data)
+				{
+					response->state = hrs_chunk_end;
+				}
+				else if (finish_body(response) != 0)
+				{
+					response->state = hrs_error;
+				}
+				break;
+			case hrs_chunk_size:
+				if (read_line(response, buffer, size, &pos) ==
+					0)
+				{
+					break;
+				}
+
+				response->remaining = strtoull(
+					response->header, 0, 16);
+
+				if (response->remaining > 0)
+				{
+					response->state = hrs_chunk_data;
+				}
+				else
+				{
+					response->state = hrs_trailer;
+				}
+				break;
+			case hrs_chunk_end:
+				if (read_line(response, buffer, size, &pos) ==
+					0)
+				{
+					break;
+				}
+
+				if (response->header[0] != 0)
+				{
+					response->state = hrs_error;
+					break;
+				}
+
+				response->state = hrs_chunk_size;
+				break;
+			case hrs_trailer:
+				if (read_line(response, buffer, size, &pos) ==
+					0)
+				{
+					break;
+				}
+
+				if ((response->header[0] == 0) &&
+					(finish_body(response) != 0))
+				{
+					response->state = hrs_error;
+				}
+				break;
+			case hrs_done:
+			case hrs_error:
+				break;
+		}
+	}
+
+	if (response->state == hrs_error)
+	{
+		return -1;
+	}
+
+	return pos;
+}
+
+Uint32 http_response_close(http_response_t* response)
+{
+	if (response->state == hrs_done)
+	{
+		return 0;
+	}
+
+	if ((response->state == hrs_body) &&
+		(response->content_length == (Uint64)-1))
+	{
+		return finish_body(response);
+	}
+
+	response->state = hrs_error;
+
+	return 1;
+}
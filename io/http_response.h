@@ -0,0 +1,104 @@
+/*!
+ * \file
+ * \ingroup io
+ * \brief incremental http response parser with xz and md5 support
+ */
+#ifndef UUID_5d2f8e4a_93c1_4b7e_a6d0_1f3b2c8e9a47
+#define UUID_5d2f8e4a_93c1_4b7e_a6d0_1f3b2c8e9a47
+
+#include <SDL_types.h>
+#include "../md5.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define HTTP_RESPONSE_MAX_HEADER_SIZE	8192
+
+typedef enum
+{
+	hrs_header = 0,
+	hrs_body,
+	hrs_chunk_size,
+	hrs_chunk_data,
+	hrs_chunk_end,
+	hrs_trailer,
+	hrs_done,
+	hrs_error
+} http_response_state_t;
+
+/*!
+ * The state of one http response. The body is unpacked while it arrives,
+ * if it starts with the xz signature, and the md5 digests of the received
+ * and the unpacked bytes are updated with each part.
+ */
+typedef struct
+{
+	http_response_state_t state;
+	Uint32 status;
+	Uint32 keep_alive;
+	Uint32 chunked;
+	Uint64 content_length;
+	Uint64 remaining;
+	char header[HTTP_RESPONSE_MAX_HEADER_SIZE];
+	Uint32 header_size;
+	char etag[64];
+	Uint8 signature[8];
+	Uint32 signature_size;
+	Uint32 xz;
+	void* unpacker;
+	MD5 body_md5;
+	MD5 data_md5;
+	MD5_DIGEST body_digest;
+	MD5_DIGEST data_digest;
+	Uint8* data;
+	Uint64 size;
+	Uint64 capacity;
+} http_response_t;
+
+/*!
+ * \brief Initializes a http response.
+ *
+ * Initializes the response for the next request. The data buffer of a
+ * previous response is kept and reused. The response must be zeroed before
+ * it is initialized the first time.
+ * \param response The response to initialize.
+ */
+void http_response_init(http_response_t* response);
+
+/*!
+ * \brief Frees the data of a http response.
+ * \param response The response to free.
+ */
+void http_response_free(http_response_t* response);
+
+/*!
+ * \brief Parses received bytes of a http response.
+ *
+ * Parses the given bytes until the response is complete. Bytes after the
+ * end of the response belong to the next response on the same connection
+ * and are not used.
+ * \param response The response to update.
+ * \param buffer The received bytes.
+ * \param size The number of received bytes.
+ * \retval Sint32 Returns the number of used bytes or -1 on errors.
+ */
+Sint32 http_response_parse(http_response_t* response, const Uint8* buffer,
+	const Uint32 size);
+
+/*!
+ * \brief Signals that the connection was closed.
+ *
+ * A response without content length or chunks ends with the connection,
+ * every other response is incomplete if it is not done yet.
+ * \param response The response to update.
+ * \retval Uint32 Returns zero if the response is complete, else one.
+ */
+Uint32 http_response_close(http_response_t* response);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UUID_5d2f8e4a_93c1_4b7e_a6d0_1f3b2c8e9a47 */
@@ -0,0 +1,573 @@
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "map_cache.h"
+#include "map_io.h"
+#include "elpathwrapper.h"
+#include "../asc.h"
+#include "../errors.h"
+#include "../interface.h"
+#include "../map.h"
+#include "../text.h"
+#ifdef CLUSTER_INSIDES
+#include "../cluster.h"
+#endif
+
+#define	MAP_CACHE_VERSION	1
+#define	MAP_CACHE_BYTE_ORDER	0x01020304
+
+int use_map_cache = 1;
+
+/**
+ * The header of a cache file. All offsets are in bytes from the start of
+ * the file and aligned to eight bytes.
+ */
+typedef struct
+{
+	char magic[4];			/**< "elmc" */
+	Uint32 version;
+	Uint32 byte_order;		/**< MAP_CACHE_BYTE_ORDER in the byte order of the writer */
+	Uint32 node_size;		/**< sizeof(BBOX_TREE_NODE) of the writer */
+	Uint32 map_crc;			/**< crc32 of the map file */
+	Uint32 map_size;		/**< size of the map file */
+	Uint32 items_count;		/**< number of items the tree was built from */
+	Uint32 items_hash;		/**< hash of these items */
+	Uint32 nodes_count;
+	Uint32 nodes_offset;
+	Uint32 order_offset;		/**< index of each tree item in the loaded items */
+	Uint32 objects_count;		/**< number of object items the clusters were computed with */
+	Uint32 objects_hash;		/**< hash of these items */
+	Uint32 clusters_size;
+	Uint32 clusters_offset;
+	Uint32 pad;
+} map_cache_header;
+
+static char cache_file_name[256];
+static Uint32 cache_map_crc = 0;
+static Uint32 cache_map_size = 0;
+static map_cache_header cache_header;
+static char* cache_data = NULL;		/**< the whole cache file as read */
+static BBOX_TREE_NODE* cache_nodes = NULL;
+static Uint32* cache_order = NULL;
+static char* cache_clusters = NULL;
+static int cache_open = 0;
+static int cache_changed = 0;
+
+static Uint32 align_size(Uint32 size)
+{
+	return (size + 7) & ~7;
+}
+
+/* FNV-1a over the boxes, types and IDs of the items. */
+static Uint32 hash_items(const BBOX_ITEMS *bbox_items, Uint32 count)
+{
+	Uint32 hash, i, j;
+	const BBOX_ITEM* item;
+	const Uint8* data;
+
+	hash = 2166136261u;
+
+	for (i = 0; i < count; i++)
+	{
+		item = &bbox_items->items[i];
+
+		data = (const Uint8*)&item->bbox;
+		for (j = 0; j < sizeof(AABBOX); j++)
+		{
+			hash = (hash ^ data[j]) * 16777619u;
+		}
+		data = (const Uint8*)&item->ID;
+		for (j = 0; j < sizeof(Uint32); j++)
+		{
+			hash = (hash ^ data[j]) * 16777619u;
+		}
+		hash = (hash ^ item->type) * 16777619u;
+	}
+
+	return hash;
+}
+
+static const BBOX_ITEM* sort_items = NULL;
+
+static int compare_item_keys(const void* a, const void* b)
+{
+	const BBOX_ITEM* item_a = &sort_items[*(const Uint32*)a];
+	const BBOX_ITEM* item_b = &sort_items[*(const Uint32*)b];
+
+	if (item_a->type != item_b->type)
+		return item_a->type < item_b->type ? -1 : 1;
+	if (item_a->ID != item_b->ID)
+		return item_a->ID < item_b->ID ? -1 : 1;
+	return 0;
+}
+
+/* Finds the index in the loaded items of every item of the tree. Returns 0
+ * if an item can't be found or if type and ID don't identify the items. */
+static int find_item_order(const BBOX_TREE *bbox_tree, const BBOX_ITEMS *bbox_items, Uint32* order)
+{
+	Uint32* sorted;
+	Uint32 i, count, first, last, middle;
+	const BBOX_ITEM* item;
+	int result;
+
+	count = bbox_items->index;
+	sorted = malloc(count * sizeof(Uint32));
+
+	for (i = 0; i < count; i++)
+	{
+		sorted[i] = i;
+	}
+
+	sort_items = bbox_items->items;
+	qsort(sorted, count, sizeof(Uint32), compare_item_keys);
+
+	result = 1;
+
+	for (i = 1; i < count; i++)
+	{
+		if (compare_item_keys(&sorted[i - 1], &sorted[i]) == 0)
+		{
+			result = 0;
+			break;
+		}
+	}
+
+	for (i = 0; result && (i < bbox_tree->items_count); i++)
+	{
+		item = &bbox_tree->items[i];
+		first = 0;
+		last = count;
+
+		while (first < last)
+		{
+			middle = (first + last) / 2;
+
+			if ((sort_items[sorted[middle]].type < item->type) ||
+				((sort_items[sorted[middle]].type == item->type) &&
+				(sort_items[sorted[middle]].ID < item->ID)))
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+
+		if ((first >= count) || (sort_items[sorted[first]].type != item->type) ||
+			(sort_items[sorted[first]].ID != item->ID))
+		{
+			result = 0;
+		}
+		else
+		{
+			order[i] = sorted[first];
+		}
+	}
+
+	sort_items = NULL;
+	free(sorted);
+
+	return result;
+}
+
+static void free_cache_data()
+{
+	if (cache_data != NULL)
+	{
+		free(cache_data);
+		cache_data = NULL;
+	}
+	else
+	{
+		free(cache_nodes);
+		free(cache_order);
+		free(cache_clusters);
+	}
+	cache_nodes = NULL;
+	cache_order = NULL;
+	cache_clusters = NULL;
+}
+
+/* Copies the parts of a cache file read from disk, so they can be replaced
+ * one by one. */
+static void detach_cache_data()
+{
+	char* data;
+
+	if (cache_data == NULL)
+	{
+		return;
+	}
+
+	data = cache_data;
+	cache_data = NULL;
+
+	if (cache_nodes != NULL)
+	{
+		cache_nodes = malloc(cache_header.nodes_count * sizeof(BBOX_TREE_NODE));
+		memcpy(cache_nodes, data + cache_header.nodes_offset, cache_header.nodes_count * sizeof(BBOX_TREE_NODE));
+		cache_order = malloc(cache_header.items_count * sizeof(Uint32));
+		memcpy(cache_order, data + cache_header.order_offset, cache_header.items_count * sizeof(Uint32));
+	}
+	if (cache_clusters != NULL)
+	{
+		cache_clusters = malloc(cache_header.clusters_size);
+		memcpy(cache_clusters, data + cache_header.clusters_offset, cache_header.clusters_size);
+	}
+
+	free(data);
+}
+
+static int check_cache_data(Uint32 size)
+{
+	if ((memcmp(cache_header.magic, "elmc", 4) != 0) ||
+		(cache_header.version != MAP_CACHE_VERSION) ||
+		(cache_header.byte_order != MAP_CACHE_BYTE_ORDER) ||
+		(cache_header.node_size != sizeof(BBOX_TREE_NODE)) ||
+		(cache_header.map_crc != cache_map_crc) ||
+		(cache_header.map_size != cache_map_size))
+	{
+		return 0;
+	}
+
+	if ((cache_header.nodes_count > 0) &&
+		(((Uint64)cache_header.nodes_offset + cache_header.nodes_count * sizeof(BBOX_TREE_NODE) > size) ||
+		((Uint64)cache_header.order_offset + cache_header.items_count * sizeof(Uint32) > size)))
+	{
+		return 0;
+	}
+
+	if ((cache_header.clusters_size > 0) &&
+		((Uint64)cache_header.clusters_offset + cache_header.clusters_size > size))
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+void map_cache_open(const char *file_name, el_file_ptr file)
+{
+	const char* name;
+	FILE* cache_file;
+	long size;
+
+	free_cache_data();
+	memset(&cache_header, 0, sizeof(cache_header));
+	cache_open = 0;
+	cache_changed = 0;
+
+	if (!use_map_cache || (file == NULL))
+	{
+		return;
+	}
+
+	name = strrchr(file_name, '/');
+	name = (name == NULL) ? file_name : name + 1;
+	safe_snprintf(cache_file_name, sizeof(cache_file_name), "map_cache/%s.cache", name);
+
+	cache_map_crc = el_crc32(file);
+	cache_map_size = el_get_size(file);
+	cache_open = 1;
+
+	cache_file = open_file_config(cache_file_name, "rb");
+
+	if (cache_file == NULL)
+	{
+		return;
+	}
+
+	fseek(cache_file, 0, SEEK_END);
+	size = ftell(cache_file);
+	fseek(cache_file, 0, SEEK_SET);
+
+	if (size >= (long)sizeof(map_cache_header))
+	{
+		cache_data = malloc(size);
+
+		if (fread(cache_data, size, 1, cache_file) == 1)
+		{
+			memcpy(&cache_header, cache_data, sizeof(cache_header));
+		}
+	}
+
+	fclose(cache_file);
+
+	if ((cache_data == NULL) || !check_cache_data(size))
+	{
+		LOG_DEBUG("Map cache '%s' is outdated.", cache_file_name);
+		free_cache_data();
+		memset(&cache_header, 0, sizeof(cache_header));
+		return;
+	}
+
+	if (cache_header.nodes_count > 0)
+	{
+		cache_nodes = (BBOX_TREE_NODE*)(cache_data + cache_header.nodes_offset);
+		cache_order = (Uint32*)(cache_data + cache_header.order_offset);
+	}
+	if (cache_header.clusters_size > 0)
+	{
+		cache_clusters = cache_data + cache_header.clusters_offset;
+	}
+}
+
+void map_cache_init_bbox_tree(BBOX_TREE *bbox_tree, const BBOX_ITEMS *bbox_items)
+{
+	Uint32 i, count, hash;
+
+	count = bbox_items->index;
+
+	if (!cache_open || (count == 0))
+	{
+		init_bbox_tree(bbox_tree, bbox_items);
+		return;
+	}
+
+	hash = hash_items(bbox_items, count);
+
+	if ((cache_nodes != NULL) && (cache_header.items_count == count) &&
+		(cache_header.items_hash == hash))
+	{
+		bbox_tree->items_count = count;
+		bbox_tree->items = (BBOX_ITEM*)malloc(count * sizeof(BBOX_ITEM));
+
+		for (i = 0; i < count; i++)
+		{
+			if (cache_order[i] >= count)
+			{
+				break;
+			}
+			bbox_tree->items[i] = bbox_items->items[cache_order[i]];
+		}
+
+		if (i == count)
+		{
+			bbox_tree->nodes_count = cache_header.nodes_count;
+			bbox_tree->nodes = (BBOX_TREE_NODE*)malloc(cache_header.nodes_count * sizeof(BBOX_TREE_NODE));
+			memcpy(bbox_tree->nodes, cache_nodes, cache_header.nodes_count * sizeof(BBOX_TREE_NODE));
+			set_all_intersect_update_needed(bbox_tree);
+
+			LOG_DEBUG("Bbox tree of '%s' restored from the map cache.", cache_file_name);
+
+			return;
+		}
+
+		free(bbox_tree->items);
+		bbox_tree->items = NULL;
+		bbox_tree->items_count = 0;
+	}
+
+	init_bbox_tree(bbox_tree, bbox_items);
+
+	detach_cache_data();
+	free(cache_nodes);
+	free(cache_order);
+	cache_nodes = NULL;
+	cache_order = NULL;
+	cache_header.nodes_count = 0;
+	cache_header.items_count = 0;
+
+	cache_order = malloc(count * sizeof(Uint32));
+
+	if (!find_item_order(bbox_tree, bbox_items, cache_order))
+	{
+		LOG_DEBUG("Items of '%s' can't be cached.", cache_file_name);
+		free(cache_order);
+		cache_order = NULL;
+		return;
+	}
+
+	cache_nodes = malloc(bbox_tree->nodes_count * sizeof(BBOX_TREE_NODE));
+	memcpy(cache_nodes, bbox_tree->nodes, bbox_tree->nodes_count * sizeof(BBOX_TREE_NODE));
+
+	for (i = 0; i < bbox_tree->nodes_count; i++)
+	{
+		cache_nodes[i].dynamic_objects.size = 0;
+		cache_nodes[i].dynamic_objects.index = 0;
+		cache_nodes[i].dynamic_objects.items = NULL;
+	}
+
+	cache_header.nodes_count = bbox_tree->nodes_count;
+	cache_header.items_count = count;
+	cache_header.items_hash = hash;
+	cache_changed = 1;
+}
+
+#ifdef CLUSTER_INSIDES
+int map_cache_set_clusters(const BBOX_ITEMS *bbox_items)
+{
+	if (!cache_open || (cache_clusters == NULL) ||
+		(cache_header.clusters_size != tile_map_size_x * tile_map_size_y * 6 * 6 * sizeof(short)) ||
+		(cache_header.objects_count != bbox_items->index) ||
+		(cache_header.objects_hash != hash_items(bbox_items, bbox_items->index)))
+	{
+		return 0;
+	}
+
+	set_clusters(cache_clusters);
+
+	LOG_DEBUG("Clusters of '%s' restored from the map cache.", cache_file_name);
+
+	return 1;
+}
+
+void map_cache_store_clusters(const BBOX_ITEMS *bbox_items)
+{
+	char* data;
+	int size;
+
+	if (!cache_open)
+	{
+		return;
+	}
+
+	get_clusters(&data, &size);
+
+	if (data == NULL)
+	{
+		return;
+	}
+
+	detach_cache_data();
+	free(cache_clusters);
+
+	cache_clusters = data;
+	cache_header.clusters_size = size;
+	cache_header.objects_count = bbox_items->index;
+	cache_header.objects_hash = hash_items(bbox_items, bbox_items->index);
+	cache_changed = 1;
+}
+#endif
+
+static void write_cache_file()
+{
+	FILE* file;
+	char pad[8];
+	Uint32 offset;
+
+	memcpy(cache_header.magic, "elmc", 4);
+	cache_header.version = MAP_CACHE_VERSION;
+	cache_header.byte_order = MAP_CACHE_BYTE_ORDER;
+	cache_header.node_size = sizeof(BBOX_TREE_NODE);
+	cache_header.map_crc = cache_map_crc;
+	cache_header.map_size = cache_map_size;
+	cache_header.pad = 0;
+
+	if (cache_nodes == NULL)
+	{
+		cache_header.nodes_count = 0;
+		cache_header.items_count = 0;
+	}
+	if (cache_clusters == NULL)
+	{
+		cache_header.clusters_size = 0;
+	}
+
+	offset = align_size(sizeof(map_cache_header));
+	cache_header.nodes_offset = offset;
+	offset = align_size(offset + cache_header.nodes_count * sizeof(BBOX_TREE_NODE));
+	cache_header.order_offset = offset;
+	offset = align_size(offset + cache_header.items_count * sizeof(Uint32));
+	cache_header.clusters_offset = offset;
+
+	mkdir_config("map_cache");
+
+	file = open_file_config(cache_file_name, "wb");
+
+	if (file == NULL)
+	{
+		LOG_ERROR("Can't write map cache '%s'", cache_file_name);
+		return;
+	}
+
+	memset(pad, 0, sizeof(pad));
+
+	fwrite(&cache_header, sizeof(cache_header), 1, file);
+	fwrite(pad, cache_header.nodes_offset - sizeof(cache_header), 1, file);
+	fwrite(cache_nodes, sizeof(BBOX_TREE_NODE), cache_header.nodes_count, file);
+	fwrite(pad, cache_header.order_offset - cache_header.nodes_offset -
+		cache_header.nodes_count * sizeof(BBOX_TREE_NODE), 1, file);
+	fwrite(cache_order, sizeof(Uint32), cache_header.items_count, file);
+	fwrite(pad, cache_header.clusters_offset - cache_header.order_offset -
+		cache_header.items_count * sizeof(Uint32), 1, file);
+	fwrite(cache_clusters, 1, cache_header.clusters_size, file);
+
+	fclose(file);
+
+	LOG_DEBUG("Map cache '%s' written.", cache_file_name);
+}
+
+void map_cache_close(void)
+{
+	if (cache_open && cache_changed)
+	{
+		write_cache_file();
+	}
+
+	free_cache_data();
+	cache_open = 0;
+	cache_changed = 0;
+}
+
+int command_map_cache_benchmark(char *text, int len)
+{
+	char current_map[256];
+	char str[256];
+	const char* name;
+	Uint32 start, cold, warm, total_cold, total_warm;
+	int i, count, old_use_map_cache;
+
+	safe_strncpy(current_map, map_file_name, sizeof(current_map));
+	old_use_map_cache = use_map_cache;
+	use_map_cache = 1;
+
+	total_cold = 0;
+	total_warm = 0;
+	count = 0;
+
+	for (i = 0; continent_maps[i].name != NULL; i++)
+	{
+		if (!el_file_exists(continent_maps[i].name))
+		{
+			continue;
+		}
+
+		// Load the map once, so the textures and objects are cached
+		// for both loads
+		change_map(continent_maps[i].name);
+
+		name = strrchr(continent_maps[i].name, '/');
+		name = (name == NULL) ? continent_maps[i].name : name + 1;
+		safe_snprintf(cache_file_name, sizeof(cache_file_name), "map_cache/%s.cache", name);
+		file_remove_config(cache_file_name);
+
+		start = SDL_GetTicks();
+		change_map(continent_maps[i].name);
+		cold = SDL_GetTicks() - start;
+
+		start = SDL_GetTicks();
+		change_map(continent_maps[i].name);
+		warm = SDL_GetTicks() - start;
+
+		total_cold += cold;
+		total_warm += warm;
+		count++;
+
+		safe_snprintf(str, sizeof(str), "%s: %d ms cold, %d ms warm", name, cold, warm);
+		LOG_TO_CONSOLE(c_green1, str);
+	}
+
+	use_map_cache = old_use_map_cache;
+
+	if (current_map[0] != '\0')
+	{
+		change_map(current_map);
+	}
+
+	safe_snprintf(str, sizeof(str), "%d maps: %d ms cold, %d ms warm", count, total_cold, total_warm);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file
+ * @ingroup maps
+ * @brief Cache of the data derived from a map when it is loaded.
+ *
+ * Building the bbox tree of a map and computing the clusters of maps
+ * that don't store them take a noticable part of a map change, but the
+ * results only depend on the map and its objects. They are written to
+ * map_cache/\<map\>.cache in the config directory, tagged with the crc32
+ * and size of the map file, and read back on the next visit. The file is
+ * written in native byte order with the arrays at fixed offsets, so it can
+ * be read or mapped in one piece. The cached data is only used if a hash
+ * of the boxes, types and IDs of the items loaded from the map matches,
+ * the texture ids of the items are always the ones of the current session.
+ */
+#ifndef	_MAP_CACHE_H_
+#define	_MAP_CACHE_H_
+
+#include "../bbox_tree.h"
+#include "elfilewrapper.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int use_map_cache; /**< enables the map cache */
+
+/**
+ * @ingroup maps
+ * @brief Reads the cache file of a map.
+ *
+ * Reads the cache file of the map, if there is one and it was written
+ * for this version of the map file. Must be called before any of the other
+ * map cache functions and followed by a call to map_cache_close.
+ *
+ * @param file_name	the file name of the map
+ * @param file		the opened map file
+ */
+void map_cache_open(const char *file_name, el_file_ptr file);
+
+/**
+ * @ingroup maps
+ * @brief Builds the bbox tree, using the cached tree if possible.
+ *
+ * Restores the bbox tree from the cache if the cached tree was built from
+ * the same items. Otherwise the tree is built with init_bbox_tree and
+ * stored in the cache.
+ *
+ * @param bbox_tree	the bbox tree to initialize
+ * @param bbox_items	the items loaded from the map
+ */
+void map_cache_init_bbox_tree(BBOX_TREE *bbox_tree, const BBOX_ITEMS *bbox_items);
+
+#ifdef CLUSTER_INSIDES
+/**
+ * @ingroup maps
+ * @brief Sets the cached clusters of the map.
+ *
+ * Sets the clusters of the map from the cache, if they were computed for
+ * the same objects.
+ *
+ * @param bbox_items	the items of the objects loaded from the map
+ * @return Returns 1 if the clusters were set, else 0.
+ */
+int map_cache_set_clusters(const BBOX_ITEMS *bbox_items);
+
+/**
+ * @ingroup maps
+ * @brief Stores the computed clusters of the map in the cache.
+ *
+ * @param bbox_items	the items of the objects loaded from the map
+ */
+void map_cache_store_clusters(const BBOX_ITEMS *bbox_items);
+#endif
+
+/**
+ * @ingroup maps
+ * @brief Writes the cache file if needed and frees the cached data.
+ */
+void map_cache_close(void);
+
+/**
+ * @ingroup maps
+ * @brief Compares map changes with and without the cache.
+ *
+ * Loads every map of the continent maps once without and once with its
+ * cache file and prints both times. Changes back to the current map at
+ * the end.
+ *
+ * @param text	unused
+ * @param len	unused
+ * @return Always returns 1.
+ */
+int command_map_cache_benchmark(char *text, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _MAP_CACHE_H_ */
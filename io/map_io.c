@@ -17,6 +17,9 @@
 #ifdef CLUSTER_INSIDES
 #include "../cluster.h"
 #endif
+#ifdef MAP_CACHE
+#include "map_cache.h"
+#endif
 
 #ifndef SHOW_FLICKERING
 const float offset_2d_increment = (1.0f / 32768.0f);	// (1.0f / 8388608.0f) is the minimum for 32-bit floating point.
@@ -144,6 +147,10 @@ static int do_load_map(const char *file_name, update_func *update_function)
 		return 0;
 	}
 
+#ifdef MAP_CACHE
+	map_cache_open(file_name, file);
+#endif
+
 	update_function(load_map_str, 0);
 
 	//get the map size
@@ -423,7 +430,15 @@ static int do_load_map(const char *file_name, update_func *update_function)
 	// they'll be shown anyway.
 	if (!have_clusters)
 	{
+#ifdef MAP_CACHE
+		if (!map_cache_set_clusters(main_bbox_tree_items))
+		{
+			compute_clusters (occupied);
+			map_cache_store_clusters(main_bbox_tree_items);
+		}
+#else
 		compute_clusters (occupied);
+#endif
 		free (occupied);
 
 		// Ok, we have the clusters, now assign new IDs to each
@@ -618,7 +633,12 @@ static int do_load_map(const char *file_name, update_func *update_function)
 
 	LOG_DEBUG("Building bbox tree for map '%s'.", file_name);
 
+#ifdef MAP_CACHE
+	map_cache_init_bbox_tree(main_bbox_tree, main_bbox_tree_items);
+	map_cache_close();
+#else
 	init_bbox_tree(main_bbox_tree, main_bbox_tree_items);
+#endif
 	free_bbox_items(main_bbox_tree_items);
 	main_bbox_tree_items = 0;
 	update_function(init_done_str, 20.0f);
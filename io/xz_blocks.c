@@ -0,0 +1,925 @@
+#include "xz_blocks.h"
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "fileutil.h"
+#include "../xz/Xz.h"
+#include "../xz/XzEnc.h"
+#include "../xz/7zCrc.h"
+#include "../xz/CpuArch.h"
+#ifdef	ELC
+#include "elfilewrapper.h"
+#include "../asc.h"
+#include "../interface.h"
+#include "../map.h"
+#include "../text.h"
+#endif	/* ELC */
+
+#define XZ_CHECK_SIZE_MAX	64
+
+/* Not in the headers of the xz code */
+SRes Xz_WriteHeader(CXzStreamFlags f, ISeqOutStream *s);
+SRes XzBlock_WriteHeader(const CXzBlock *p, ISeqOutStream *s);
+SRes Xz_WriteFooter(CXzStream *p, ISeqOutStream *s);
+SRes Xz_AddIndexRecord(CXzStream *p, UInt64 unpackSize, UInt64 totalSize,
+	ISzAlloc *alloc);
+SRes XzDec_Init(CMixCoder *p, const CXzBlock *block);
+
+static void *SzAlloc(void *p, size_t size) { p = p; return malloc(size); }
+static void SzFree(void *p, void *address) { p = p; free(address); }
+static ISzAlloc lzmaAlloc = { SzAlloc, SzFree };
+
+typedef struct
+{
+	Uint64 offset;
+	Uint64 total_size;
+	Uint64 unpack_offset;
+	Uint64 unpack_size;
+	Uint8* packed;
+	Uint64 packed_size;
+} xz_block_t;
+
+typedef struct xz_job
+{
+	Uint32 (*run)(struct xz_job* job, const Uint32 index);
+	const Uint8* src;
+	Uint8* dst;
+	xz_block_t* blocks;
+	Uint32 count;
+	Uint32 next;
+	Uint32 finished;
+	Uint32 error;
+	Uint32 level;
+	CXzStreamFlags flags;
+	struct xz_job* next_job;
+} xz_job_t;
+
+/* The jobs with blocks that no thread has taken yet */
+static xz_job_t* xz_jobs = 0;
+static SDL_mutex* xz_mutex = 0;
+static SDL_cond* xz_condition = 0;
+static SDL_Thread* xz_threads[XZ_BLOCKS_THREAD_COUNT];
+static Uint32 xz_threads_done = 0;
+
+/* Takes the next block of the job, the mutex must be locked. */
+static Uint32 take_block(xz_job_t* job)
+{
+	xz_job_t** prev;
+	Uint32 index;
+
+	index = job->next;
+	job->next++;
+
+	if (job->next < job->count)
+	{
+		return index;
+	}
+
+	for (prev = &xz_jobs; *prev != 0; prev = &(*prev)->next_job)
+	{
+		if (*prev == job)
+		{
+			*prev = job->next_job;
+			break;
+		}
+	}
+
+	return index;
+}
+
+static void finish_block(xz_job_t* job, const Uint32 error)
+{
+	if (xz_mutex == 0)
+	{
+		job->error |= error;
+		job->finished++;
+
+		return;
+	}
+
+	SDL_LockMutex(xz_mutex);
+
+	job->error |= error;
+	job->finished++;
+
+	if (job->finished == job->count)
+	{
+		SDL_CondBroadcast(xz_condition);
+	}
+
+	SDL_UnlockMutex(xz_mutex);
+}
+
+static int xz_thread(void* data)
+{
+	xz_job_t* job;
+	Uint32 index;
+
+	SDL_LockMutex(xz_mutex);
+
+	while (xz_threads_done == 0)
+	{
+		job = xz_jobs;
+
+		if (job == 0)
+		{
+			SDL_CondWait(xz_condition, xz_mutex);
+			continue;
+		}
+
+		index = take_block(job);
+
+		SDL_UnlockMutex(xz_mutex);
+
+		finish_block(job, job->run(job, index));
+
+		SDL_LockMutex(xz_mutex);
+	}
+
+	SDL_UnlockMutex(xz_mutex);
+
+	return 0;
+}
+
+void init_xz_threads()
+{
+	Uint32 i;
+
+	if (xz_mutex != 0)
+	{
+		return;
+	}
+
+	xz_jobs = 0;
+	xz_threads_done = 0;
+	xz_mutex = SDL_CreateMutex();
+	xz_condition = SDL_CreateCond();
+
+	for (i = 0; i < XZ_BLOCKS_THREAD_COUNT; i++)
+	{
+		xz_threads[i] = SDL_CreateThread(xz_thread, 0);
+	}
+}
+
+void exit_xz_threads()
+{
+	Uint32 i;
+	int result;
+
+	if (xz_mutex == 0)
+	{
+		return;
+	}
+
+	SDL_LockMutex(xz_mutex);
+	xz_threads_done = 1;
+	SDL_CondBroadcast(xz_condition);
+	SDL_UnlockMutex(xz_mutex);
+
+	for (i = 0; i < XZ_BLOCKS_THREAD_COUNT; i++)
+	{
+		SDL_WaitThread(xz_threads[i], &result);
+	}
+
+	SDL_DestroyCond(xz_condition);
+	SDL_DestroyMutex(xz_mutex);
+
+	xz_condition = 0;
+	xz_mutex = 0;
+}
+
+/* The calling thread works on its own job until every block is taken and
+ * then waits for the threads to finish theirs. */
+static Uint32 run_job(xz_job_t* job, const Uint32 threaded)
+{
+	Uint32 index;
+
+	job->next = 0;
+	job->finished = 0;
+	job->error = 0;
+
+	if ((threaded == 0) || (xz_mutex == 0) || (job->count < 2))
+	{
+		for (index = 0; index < job->count; index++)
+		{
+			job->error |= job->run(job, index);
+		}
+
+		return job->error;
+	}
+
+	SDL_LockMutex(xz_mutex);
+
+	job->next_job = xz_jobs;
+	xz_jobs = job;
+
+	SDL_CondBroadcast(xz_condition);
+
+	while (job->next < job->count)
+	{
+		index = take_block(job);
+
+		SDL_UnlockMutex(xz_mutex);
+
+		finish_block(job, job->run(job, index));
+
+		SDL_LockMutex(xz_mutex);
+	}
+
+	while (job->finished < job->count)
+	{
+		SDL_CondWait(xz_condition, xz_mutex);
+	}
+
+	SDL_UnlockMutex(xz_mutex);
+
+	return job->error;
+}
+
+typedef struct
+{
+	ISeqInStream stream;
+	const Uint8* data;
+	Uint64 size;
+	Uint64 pos;
+} xz_in_stream_t;
+
+typedef struct
+{
+	ISeqOutStream stream;
+	Uint8* data;
+	Uint64 size;
+	Uint64 capacity;
+} xz_out_stream_t;
+
+static SRes read_in_stream(void* p, void* buf, size_t* size)
+{
+	xz_in_stream_t* in;
+
+	in = p;
+
+	if (*size > (in->size - in->pos))
+	{
+		*size = in->size - in->pos;
+	}
+
+	memcpy(buf, in->data + in->pos, *size);
+	in->pos += *size;
+
+	return SZ_OK;
+}
+
+static size_t write_out_stream(void* p, const void* buf, size_t size)
+{
+	xz_out_stream_t* out;
+	Uint8* data;
+	Uint64 capacity;
+
+	out = p;
+
+	if ((out->size + size) > out->capacity)
+	{
+		capacity = out->capacity * 2 + 0x10000;
+
+		while ((out->size + size) > capacity)
+		{
+			capacity *= 2;
+		}
+
+		data = realloc(out->data, capacity);
+
+		if (data == 0)
+		{
+			return 0;
+		}
+
+		out->data = data;
+		out->capacity = capacity;
+	}
+
+	memcpy(out->data + out->size, buf, size);
+	out->size += size;
+
+	return size;
+}
+
+static void init_out_stream(xz_out_stream_t* out)
+{
+	out->stream.Write = write_out_stream;
+	out->data = 0;
+	out->size = 0;
+	out->capacity = 0;
+}
+
+/* Packs one block with its header and check into block->packed. */
+static Uint32 pack_block(xz_job_t* job, const Uint32 index)
+{
+	CLzma2EncProps props;
+	CLzma2EncHandle encoder;
+	CXzBlock header;
+	CXzCheck check;
+	xz_in_stream_t in;
+	xz_out_stream_t data, out;
+	xz_block_t* block;
+	Byte buf[XZ_CHECK_SIZE_MAX + 4];
+	Uint32 pad, check_size;
+	SRes res;
+
+	block = &job->blocks[index];
+
+	Lzma2EncProps_Init(&props);
+	props.lzmaProps.level = job->level;
+	LzmaEncProps_Normalize(&props.lzmaProps);
+
+	// a bigger dictionary than the block only wastes memory
+	if (props.lzmaProps.dictSize > block->unpack_size)
+	{
+		props.lzmaProps.dictSize = block->unpack_size;
+
+		if (props.lzmaProps.dictSize < (1 << 12))
+		{
+			props.lzmaProps.dictSize = 1 << 12;
+		}
+	}
+
+	encoder = Lzma2Enc_Create(&lzmaAlloc, &lzmaAlloc);
+
+	if (encoder == 0)
+	{
+		return 1;
+	}
+
+	in.stream.Read = read_in_stream;
+	in.data = job->src + block->unpack_offset;
+	in.size = block->unpack_size;
+	in.pos = 0;
+
+	init_out_stream(&data);
+	init_out_stream(&out);
+
+	res = Lzma2Enc_SetProps(encoder, &props);
+
+	if (res == SZ_OK)
+	{
+		header.flags = XZ_BF_PACK_SIZE | XZ_BF_UNPACK_SIZE;
+		header.filters[0].id = XZ_ID_LZMA2;
+		header.filters[0].propsSize = 1;
+		header.filters[0].props[0] =
+			Lzma2Enc_WriteProperties(encoder);
+
+		res = Lzma2Enc_Encode(encoder, &data.stream, &in.stream, 0);
+	}
+
+	Lzma2Enc_Destroy(encoder);
+
+	if (res == SZ_OK)
+	{
+		header.packSize = data.size;
+		header.unpackSize = block->unpack_size;
+
+		res = XzBlock_WriteHeader(&header, &out.stream);
+	}
+
+	if ((res == SZ_OK) && (write_out_stream(&out, data.data, data.size) !=
+		data.size))
+	{
+		res = SZ_ERROR_WRITE;
+	}
+
+	free(data.data);
+
+	if (res != SZ_OK)
+	{
+		free(out.data);
+
+		return 1;
+	}
+
+	pad = 0;
+
+	while (((data.size + pad) & 3) != 0)
+	{
+		buf[pad] = 0;
+		pad++;
+	}
+
+	XzCheck_Init(&check, XzFlags_GetCheckType(job->flags));
+	XzCheck_Update(&check, in.data, in.size);
+	XzCheck_Final(&check, buf + pad);
+
+	check_size = XzFlags_GetCheckSize(job->flags);
+
+	if (write_out_stream(&out, buf, pad + check_size) != (pad + check_size))
+	{
+		free(out.data);
+
+		return 1;
+	}
+
+	block->packed = out.data;
+	block->packed_size = out.size;
+	block->total_size = out.size - pad;
+
+	return 0;
+}
+
+Uint32 xz_blocks_pack(const void* data, const Uint64 size,
+	const Uint32 block_size, const Uint32 level, void** buffer,
+	Uint64* buffer_size)
+{
+	CXzStream xz;
+	xz_job_t job;
+	xz_out_stream_t out;
+	Uint32 i, result;
+
+	*buffer = 0;
+	*buffer_size = 0;
+
+	if ((block_size == 0) || (((size + block_size - 1) / block_size) >
+		0xFFFFFFFF))
+	{
+		return 1;
+	}
+
+	memset(&job, 0, sizeof(job));
+
+	job.run = pack_block;
+	job.src = data;
+	job.count = (size + block_size - 1) / block_size;
+	job.level = level;
+	job.flags = XZ_CHECK_CRC32;
+	job.blocks = calloc(job.count, sizeof(xz_block_t));
+
+	if ((job.count > 0) && (job.blocks == 0))
+	{
+		return 1;
+	}
+
+	for (i = 0; i < job.count; i++)
+	{
+		job.blocks[i].unpack_offset = (Uint64)i * block_size;
+		job.blocks[i].unpack_size = size - job.blocks[i].unpack_offset;
+
+		if (job.blocks[i].unpack_size > block_size)
+		{
+			job.blocks[i].unpack_size = block_size;
+		}
+	}
+
+	result = run_job(&job, 1);
+
+	Xz_Construct(&xz);
+	xz.flags = job.flags;
+	init_out_stream(&out);
+
+	// Xz_AddIndexRecord drops the old records when it grows the array
+	if (job.count > 0)
+	{
+		xz.blocks = calloc(job.count, sizeof(CXzBlockSizes));
+		xz.numBlocksAllocated = job.count;
+
+		if (xz.blocks == 0)
+		{
+			result = 1;
+		}
+	}
+
+	if ((result == 0) && (Xz_WriteHeader(xz.flags, &out.stream) != SZ_OK))
+	{
+		result = 1;
+	}
+
+	for (i = 0; i < job.count; i++)
+	{
+		if ((result == 0) && ((write_out_stream(&out,
+			job.blocks[i].packed, job.blocks[i].packed_size) !=
+			job.blocks[i].packed_size) ||
+			(Xz_AddIndexRecord(&xz, job.blocks[i].unpack_size,
+			job.blocks[i].total_size, &lzmaAlloc) != SZ_OK)))
+		{
+			result = 1;
+		}
+
+		free(job.blocks[i].packed);
+	}
+
+	if ((result == 0) && (Xz_WriteFooter(&xz, &out.stream) != SZ_OK))
+	{
+		result = 1;
+	}
+
+	Xz_Free(&xz, &lzmaAlloc);
+	free(job.blocks);
+
+	if (result != 0)
+	{
+		free(out.data);
+
+		return 1;
+	}
+
+	*buffer = out.data;
+	*buffer_size = out.size;
+
+	return 0;
+}
+
+static Uint32 unpack_block(xz_job_t* job, const Uint32 index)
+{
+	CMixCoder coder;
+	CXzBlock header;
+	CXzCheck check;
+	const xz_block_t* block;
+	const Uint8* src;
+	Byte digest[XZ_CHECK_SIZE_MAX];
+	SizeT src_size, dst_size;
+	Uint64 header_size, check_size, pack_size;
+	ECoderStatus status;
+	SRes res;
+
+	block = &job->blocks[index];
+	src = job->src + block->offset;
+
+	header_size = ((Uint32)src[0] << 2) + 4;
+	check_size = XzFlags_GetCheckSize(job->flags);
+
+	if ((src[0] == 0) || ((header_size + check_size) >= block->total_size))
+	{
+		return 1;
+	}
+
+	if (XzBlock_Parse(&header, src) != SZ_OK)
+	{
+		return 1;
+	}
+
+	pack_size = block->total_size - header_size - check_size;
+
+	if ((XzBlock_HasPackSize(&header) && (header.packSize != pack_size)) ||
+		(XzBlock_HasUnpackSize(&header) &&
+		(header.unpackSize != block->unpack_size)))
+	{
+		return 1;
+	}
+
+	MixCoder_Construct(&coder, &lzmaAlloc);
+
+	res = XzDec_Init(&coder, &header);
+
+	src_size = pack_size;
+	dst_size = block->unpack_size;
+
+	if (res == SZ_OK)
+	{
+		res = MixCoder_Code(&coder, job->dst + block->unpack_offset,
+			&dst_size, src + header_size, &src_size, True,
+			CODER_FINISH_END, &status);
+	}
+
+	MixCoder_Free(&coder);
+
+	if ((res != SZ_OK) || (status != CODER_STATUS_FINISHED_WITH_MARK) ||
+		(src_size != pack_size) || (dst_size != block->unpack_size))
+	{
+		return 1;
+	}
+
+	XzCheck_Init(&check, XzFlags_GetCheckType(job->flags));
+	XzCheck_Update(&check, job->dst + block->unpack_offset, dst_size);
+
+	if (XzCheck_Final(&check, digest) && (memcmp(digest, src +
+		header_size + ((pack_size + 3) & ~3), check_size) != 0))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Reads the block sizes from the index of a file that is one stream. */
+static Uint32 read_index(const Uint8* data, Uint64 size, xz_job_t* job,
+	Uint64* unpack_size)
+{
+	const Uint8* footer;
+	const Uint8* index;
+	CXzStreamFlags flags;
+	Uint64 index_size, count, pos, offset, total_size, block_size;
+	Uint32 i, len;
+
+	// stream padding
+	while ((size >= 4) && (GetUi32(data + size - 4) == 0))
+	{
+		size -= 4;
+	}
+
+	if ((size < (XZ_STREAM_HEADER_SIZE + XZ_STREAM_FOOTER_SIZE)) ||
+		(memcmp(data, XZ_SIG, XZ_SIG_SIZE) != 0) ||
+		(Xz_ParseHeader(&job->flags, data) != SZ_OK))
+	{
+		return 1;
+	}
+
+	footer = data + size - XZ_STREAM_FOOTER_SIZE;
+	flags = ((CXzStreamFlags)footer[8] << 8) | footer[9];
+
+	if ((memcmp(footer + 10, XZ_FOOTER_SIG, XZ_FOOTER_SIG_SIZE) != 0) ||
+		(CrcCalc(footer + 4, 6) != GetUi32(footer)))
+	{
+		return 1;
+	}
+
+	// the last of several concatenated streams can use other flags
+	if (flags != job->flags)
+	{
+		return 2;
+	}
+
+	index_size = ((Uint64)GetUi32(footer + 4) + 1) * 4;
+
+	if ((index_size + XZ_STREAM_HEADER_SIZE + XZ_STREAM_FOOTER_SIZE) >
+		size)
+	{
+		return 1;
+	}
+
+	index = footer - index_size;
+
+	if ((index[0] != 0) || (CrcCalc(index, index_size - 4) !=
+		GetUi32(index + index_size - 4)))
+	{
+		return 1;
+	}
+
+	pos = 1;
+	len = Xz_ReadVarInt(index + pos, index_size - 4 - pos, &count);
+
+	if ((len == 0) || (count > ((index_size - 4) / 2)))
+	{
+		return 1;
+	}
+
+	pos += len;
+
+	// a single block has nothing to share
+	if (count < 2)
+	{
+		return 2;
+	}
+
+	job->count = count;
+	job->blocks = calloc(count, sizeof(xz_block_t));
+
+	if (job->blocks == 0)
+	{
+		return 1;
+	}
+
+	offset = XZ_STREAM_HEADER_SIZE;
+	*unpack_size = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		len = Xz_ReadVarInt(index + pos, index_size - 4 - pos,
+			&total_size);
+		pos += len;
+
+		if (len == 0)
+		{
+			return 1;
+		}
+
+		len = Xz_ReadVarInt(index + pos, index_size - 4 - pos,
+			&block_size);
+		pos += len;
+
+		if ((len == 0) || (total_size == 0) ||
+			(total_size > (Uint64)(index - data)) ||
+			(block_size > ((Uint64)0x7FFFFFFF - *unpack_size)))
+		{
+			return 1;
+		}
+
+		job->blocks[i].offset = offset;
+		job->blocks[i].total_size = total_size;
+		job->blocks[i].unpack_offset = *unpack_size;
+		job->blocks[i].unpack_size = block_size;
+
+		offset += (total_size + 3) & ~3;
+		*unpack_size += block_size;
+
+		if (offset > (Uint64)(index - data))
+		{
+			return 1;
+		}
+	}
+
+	// concatenated streams are left to the stream unpacker
+	if (offset != (Uint64)(index - data))
+	{
+		return 2;
+	}
+
+	while (pos < (index_size - 4))
+	{
+		if (index[pos] != 0)
+		{
+			return 1;
+		}
+
+		pos++;
+	}
+
+	return 0;
+}
+
+Uint32 xz_blocks_unpack(const void* file_buffer, const Uint64 file_size,
+	const Uint32 threaded, void** buffer, Uint64* size)
+{
+	xz_job_t job;
+	Uint64 unpack_size;
+	Uint32 result;
+
+	*buffer = 0;
+	*size = 0;
+
+	memset(&job, 0, sizeof(job));
+
+	job.run = unpack_block;
+	job.src = file_buffer;
+
+	result = read_index(file_buffer, file_size, &job, &unpack_size);
+
+	if (result == 0)
+	{
+		job.dst = malloc(unpack_size + 1);
+
+		if (job.dst == 0)
+		{
+			result = 1;
+		}
+	}
+
+	if (result == 0)
+	{
+		result = run_job(&job, threaded) != 0;
+	}
+
+	free(job.blocks);
+
+	if (result != 0)
+	{
+		free(job.dst);
+
+		return result;
+	}
+
+	job.dst[unpack_size] = 0;
+
+	*buffer = job.dst;
+	*size = unpack_size;
+
+	return 0;
+}
+
+#ifdef	ELC
+static Uint32 time_unpack(const void* file_buffer, const Uint64 file_size,
+	const Uint32 mode, const void* data, const Uint64 size)
+{
+	void* buffer;
+	Uint64 buffer_size;
+	Uint32 i, start, result;
+
+	start = SDL_GetTicks();
+
+	for (i = 0; i < 10; i++)
+	{
+		if (mode == 0)
+		{
+			result = xz_unpack_data(file_buffer, file_size, &buffer,
+				&buffer_size);
+		}
+		else
+		{
+			result = xz_blocks_unpack(file_buffer, file_size,
+				mode - 1, &buffer, &buffer_size);
+		}
+
+		if ((result != 0) || (buffer_size != size) ||
+			(memcmp(buffer, data, size) != 0))
+		{
+			LOG_TO_CONSOLE(c_red1, "xz unpack failed");
+		}
+
+		free(buffer);
+	}
+
+	return SDL_GetTicks() - start;
+}
+
+static void benchmark_file(const char* file_name, Uint64* total_size,
+	Uint32* total_times)
+{
+	char str[256];
+	el_file_ptr file;
+	void* single;
+	void* blocks;
+	Uint64 single_size, blocks_size, size;
+	Uint32 times[3];
+	Uint32 i;
+
+	file = el_open(file_name);
+
+	if (file == 0)
+	{
+		safe_snprintf(str, sizeof(str), "Can't open '%s'", file_name);
+		LOG_TO_CONSOLE(c_red1, str);
+
+		return;
+	}
+
+	size = el_get_size(file);
+
+	if ((xz_blocks_pack(el_get_pointer(file), size, size + 1, 6, &single,
+		&single_size) != 0) || (xz_blocks_pack(el_get_pointer(file),
+		size, XZ_BLOCKS_DEFAULT_BLOCK_SIZE, 6, &blocks,
+		&blocks_size) != 0))
+	{
+		el_close(file);
+
+		return;
+	}
+
+	times[0] = time_unpack(single, single_size, 0, el_get_pointer(file),
+		size);
+	times[1] = time_unpack(blocks, blocks_size, 1, el_get_pointer(file),
+		size);
+	times[2] = time_unpack(blocks, blocks_size, 2, el_get_pointer(file),
+		size);
+
+	el_close(file);
+	free(single);
+	free(blocks);
+
+	safe_snprintf(str, sizeof(str), "%s: %d kb, %d kb packed, %d kb as "
+		"blocks, %d ms single, %d ms blocks, %d ms threads", file_name,
+		(int)(size / 1024), (int)(single_size / 1024),
+		(int)(blocks_size / 1024), times[0], times[1], times[2]);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	*total_size += size * 10;
+
+	for (i = 0; i < 3; i++)
+	{
+		total_times[i] += times[i];
+	}
+}
+
+int command_xz_benchmark(char *text, int len)
+{
+	char str[256];
+	char file_name[256];
+	Uint64 total_size;
+	Uint32 total_times[3];
+	Uint32 i;
+	int pos;
+
+	total_size = 0;
+	memset(total_times, 0, sizeof(total_times));
+
+	while (sscanf(text, " %255s%n", file_name, &pos) == 1)
+	{
+		benchmark_file(file_name, &total_size, total_times);
+		text += pos;
+	}
+
+	if (total_size == 0)
+	{
+		for (i = 0; continent_maps[i].name != NULL; i++)
+		{
+			if (el_file_exists(continent_maps[i].name))
+			{
+				benchmark_file(continent_maps[i].name,
+					&total_size, total_times);
+			}
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		if (total_times[i] == 0)
+		{
+			total_times[i] = 1;
+		}
+	}
+
+	safe_snprintf(str, sizeof(str), "%d MB unpacked: %d MB/s single, "
+		"%d MB/s blocks, %d MB/s threads",
+		(int)(total_size / (1024 * 1024)),
+		(int)(total_size * 1000 / total_times[0] / (1024 * 1024)),
+		(int)(total_size * 1000 / total_times[1] / (1024 * 1024)),
+		(int)(total_size * 1000 / total_times[2] / (1024 * 1024)));
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* ELC */
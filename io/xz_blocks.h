@@ -0,0 +1,89 @@
+/*!
+ * \file
+ * \ingroup io
+ * \brief xz files with independent blocks, packed and unpacked in parallel
+ *
+ * A xz file that is split into several blocks has the packed and unpacked
+ * size of every block in the index at its end. Each block is unpacked
+ * without the data of the others, so the blocks are unpacked in parallel
+ * straight into their place in the result.
+ */
+#ifndef UUID_b6f04d1e_57a2_4c3b_9e68_0d2f7a1c5e93
+#define UUID_b6f04d1e_57a2_4c3b_9e68_0d2f7a1c5e93
+
+#include "../platform.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define XZ_BLOCKS_DEFAULT_BLOCK_SIZE	0x100000
+#define XZ_BLOCKS_THREAD_COUNT	3
+
+/*!
+ * \brief Starts the threads that help unpacking.
+ *
+ * Without the threads all blocks are unpacked by the calling thread.
+ */
+void init_xz_threads();
+
+/*!
+ * \brief Stops the threads that help unpacking.
+ */
+void exit_xz_threads();
+
+/*!
+ * \brief Packs data into a xz file with several blocks.
+ * \param data The data to pack.
+ * \param size The size of the data.
+ * \param block_size The unpacked size of each block, the last block can be
+ * smaller.
+ * \param level The lzma compression level, 0 to 9.
+ * \param buffer The pointer to the var where the xz file should be stored.
+ * \param buffer_size The pointer to the var where the size of the xz file
+ * should be stored.
+ * \retval Uint32 Returns zero if everything is ok, else one.
+ */
+Uint32 xz_blocks_pack(const void* data, const Uint64 size,
+	const Uint32 block_size, const Uint32 level, void** buffer,
+	Uint64* buffer_size);
+
+/*!
+ * \brief Unpacks a xz file with several blocks.
+ *
+ * Reads the block sizes from the index and unpacks the blocks on the
+ * threads. A zero byte is added at the end of the data.
+ * \param file_buffer The xz file.
+ * \param file_size The size of the xz file.
+ * \param threaded Unpack the blocks on the threads if not zero, else on the
+ * calling thread only.
+ * \param buffer The pointer to the var where the data should be stored.
+ * \param size The pointer to the var where the size of the data should be
+ * stored.
+ * \retval Uint32 Returns zero if everything is ok, two if the file is not
+ * a single stream with at least two blocks, so it must be unpacked as a
+ * stream, else one.
+ */
+Uint32 xz_blocks_unpack(const void* file_buffer, const Uint64 file_size,
+	const Uint32 threaded, void** buffer, Uint64* size);
+
+#ifdef	ELC
+/*!
+ * \brief Compares unpacking with one block, several blocks and threads.
+ *
+ * Packs the given files, or every continent map if none is given, once as
+ * one block and once with several blocks. Prints the unpack speed of the
+ * single block, of the blocks on the calling thread and on the threads.
+ * \param text The names of the files, separated by spaces.
+ * \param len The length of the text.
+ * \retval int Always returns 1.
+ */
+int command_xz_benchmark(char *text, int len);
+#endif	/* ELC */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* UUID_b6f04d1e_57a2_4c3b_9e68_0d2f7a1c5e93 */
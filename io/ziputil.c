@@ -179,10 +179,9 @@ Uint32 check_crc_from_zip(unzFile source, const char* file_name)
 		file_info.crc);
 }
 
-Uint32 check_md5_from_zip(unzFile source, const char* file_name,
-	const MD5_DIGEST digest)
+static Uint32 locate_md5_file(unzFile source, const char* file_name,
+	const MD5_DIGEST digest, unz_file_info64* file_info)
 {
-	unz_file_info64 file_info;
 	char comment[256];
 	MD5_DIGEST tmp_digest;
 
@@ -191,13 +190,13 @@ Uint32 check_md5_from_zip(unzFile source, const char* file_name,
 		return 1;
 	}
 
-	if (unzGetCurrentFileInfo64(source, &file_info, 0, 0, 0, 0,
+	if (unzGetCurrentFileInfo64(source, file_info, 0, 0, 0, 0,
 		comment, sizeof(comment)) != UNZ_OK)
 	{
 		return 1;
 	}
 
-	if (file_info.size_file_comment < 37)
+	if (file_info->size_file_comment < 37)
 	{
 		return 1;
 	}
@@ -212,7 +211,78 @@ Uint32 check_md5_from_zip(unzFile source, const char* file_name,
 		return 1;
 	}
 
+	return 0;
+}
+
+Uint32 check_md5_from_zip(unzFile source, const char* file_name,
+	const MD5_DIGEST digest)
+{
+	unz_file_info64 file_info;
+
+	if (locate_md5_file(source, file_name, digest, &file_info) != 0)
+	{
+		return 1;
+	}
+
 	return check_crc_from_zip_current(source, file_info.uncompressed_size,
 		file_info.crc);
 }
 
+#ifdef	DELTA_UPDATES
+Uint32 locate_md5_file_in_zip(unzFile source, const char* file_name,
+	const MD5_DIGEST digest)
+{
+	unz_file_info64 file_info;
+
+	return locate_md5_file(source, file_name, digest, &file_info);
+}
+
+Uint32 read_md5_file_from_zip(unzFile source, const char* file_name,
+	const MD5_DIGEST digest, void** buffer, Uint64* size)
+{
+	unz_file_info64 file_info;
+	Uint8* data;
+
+	*buffer = 0;
+	*size = 0;
+
+	if (locate_md5_file(source, file_name, digest, &file_info) != 0)
+	{
+		return 1;
+	}
+
+	data = malloc(file_info.uncompressed_size + 1);
+
+	if (data == 0)
+	{
+		return 1;
+	}
+
+	unzOpenCurrentFile(source);
+
+	if (unzReadCurrentFile(source, data, file_info.uncompressed_size) !=
+		(int)file_info.uncompressed_size)
+	{
+		unzCloseCurrentFile(source);
+		free(data);
+
+		return 1;
+	}
+
+	unzCloseCurrentFile(source);
+
+	if (file_info.crc != CrcCalc(data, file_info.uncompressed_size))
+	{
+		free(data);
+
+		return 1;
+	}
+
+	data[file_info.uncompressed_size] = 0;
+
+	*buffer = data;
+	*size = file_info.uncompressed_size;
+
+	return 0;
+}
+#endif	/* DELTA_UPDATES */
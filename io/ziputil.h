@@ -84,6 +84,42 @@ Uint32 convert_md5_digest_to_comment_string(const MD5_DIGEST digest,
 Uint32 check_md5_from_zip(unzFile source, const char* file_name,
 	const MD5_DIGEST digest);
 
+#ifdef	DELTA_UPDATES
+/*!
+ * \ingroup 	misc
+ * \brief 	Looks for a file with the given md5 digest in a zip file.
+ *
+ * 		Checks the md5 digest in the comment of the file, the file
+ * 		itself is not read.
+ * \param   	source The zip file to look in.
+ * \param   	file_name The name of the file.
+ * \param   	digest The md5 digest of the wanted version of the file.
+ * \retval Uint32	Returns zero if the file is found, else one.
+ * \callgraph
+ */
+Uint32 locate_md5_file_in_zip(unzFile source, const char* file_name,
+	const MD5_DIGEST digest);
+
+/*!
+ * \ingroup 	misc
+ * \brief 	Reads a file with the given md5 digest from a zip file.
+ *
+ * 		Reads the file to memory, if the md5 digest in its comment
+ * 		is the given one and its crc is ok.
+ * \param   	source The zip file to read from.
+ * \param   	file_name The name of the file.
+ * \param   	digest The md5 digest of the wanted version of the file.
+ * \param   	buffer The pointer to the var where the data should be
+ * 		stored.
+ * \param   	size The pointer to the var where the size should be
+ * 		stored.
+ * \retval Uint32	Returns zero if everything is ok, else one.
+ * \callgraph
+ */
+Uint32 read_md5_file_from_zip(unzFile source, const char* file_name,
+	const MD5_DIGEST digest, void** buffer, Uint64* size);
+#endif	/* DELTA_UPDATES */
+
 #ifdef __cplusplus
 }
 #endif
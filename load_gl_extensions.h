@@ -58,7 +58,8 @@ typedef enum {
 	arb_texture_cube_map = 30,
 	arb_texture_float = 31,
 	ext_abgr = 32,
-	ext_gpu_program_parameters = 33
+	ext_gpu_program_parameters = 33,
+	arb_half_float_vertex = 34
 } extension_enum;
 
 /*	GL_VERSION_1_2		*/
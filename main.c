@@ -75,6 +75,15 @@
 #ifdef	FSAA
 #include "fsaa/fsaa.h"
 #endif	/* FSAA */
+#ifdef	OCCLUSION_CULLING
+#include "occlusion_culling.h"
+#endif	/* OCCLUSION_CULLING */
+#ifdef	PARALLEL_XZ
+#include "io/xz_blocks.h"
+#endif	/* PARALLEL_XZ */
+#ifdef	BUFFERED_CHAT_LOG
+#include "io/chat_log.h"
+#endif	/* BUFFERED_CHAT_LOG */
 
 Uint32 cur_time=0, last_time=0;//for FPS
 
@@ -258,6 +267,9 @@ int start_rendering()
 		destroy_map();
 		free_buffers();
 	}
+#ifdef	OCCLUSION_CULLING
+	free_occlusion_culling();
+#endif	/* OCCLUSION_CULLING */
 	unload_questlog();
 	save_item_lists();
 	free_emotes();
@@ -296,6 +308,12 @@ int start_rendering()
 	stopp_custom_update();
 #endif	/* CUSTOM_UPDATE */
 	clear_zip_archives();
+#ifdef	PARALLEL_XZ
+	exit_xz_threads();
+#endif	/* PARALLEL_XZ */
+#ifdef	BUFFERED_CHAT_LOG
+	stop_chat_log_writer();
+#endif	/* BUFFERED_CHAT_LOG */
 	clean_update();
 
 	cleanup_tcp();
@@ -425,6 +443,14 @@ void check_log_level_on_command_line()
 			set_log_level(llt_debug_verbose);
 			continue;
 		}
+#ifdef	ASYNC_LOGGING
+		if ((strcmp(gargv[i], "--log_async") == 0) ||
+			(strcmp(gargv[i], "-la") == 0))
+		{
+			set_log_async(1);
+			continue;
+		}
+#endif	/* ASYNC_LOGGING */
 	}
 }
 
@@ -42,6 +42,9 @@
 #include "sky.h"
 #include "mines.h"
 #include "highlight.h"
+#ifdef	OCCLUSION_CULLING
+#include "occlusion_culling.h"
+#endif	/* OCCLUSION_CULLING */
 
 int map_type=1;
 Uint32 map_flags=0;
@@ -58,6 +61,9 @@ void destroy_map()
 
 	have_a_map = 0;
 
+#ifdef	OCCLUSION_CULLING
+	clear_occluders();
+#endif	/* OCCLUSION_CULLING */
 	clear_bbox_tree(main_bbox_tree);
 	//kill the tile and height map
 	if(tile_map)
@@ -201,6 +207,9 @@ static int el_load_map(const char * file_name)
 	}
 	build_path_map();
 	init_buffers();
+#ifdef	OCCLUSION_CULLING
+	init_occluders(file_name);
+#endif	/* OCCLUSION_CULLING */
 	
 	// reset light levels in case we enter or leave an inside map
 	new_minute();
@@ -211,6 +220,9 @@ static int el_load_map(const char * file_name)
 
 void change_map (const char *mapname)
 {
+#ifdef PAWN
+	static pawn_call change_map_call = PAWN_MAP_CALL ("change_map", "s");
+#endif
 #ifndef	MAP_EDITOR
 	remove_all_bags();
 	remove_all_mines();
@@ -279,7 +291,7 @@ void change_map (const char *mapname)
 	change_minimap();
 
 #ifdef PAWN
-	run_pawn_map_function ("change_map", "s", mapname);
+	run_pawn_call (&change_map_call, mapname);
 #endif
 }
 
@@ -552,8 +564,7 @@ void free_buffers()
 {
 	if (water_tile_buffer)
 		free(water_tile_buffer);
-	if (terrain_tile_buffer)
-		free(terrain_tile_buffer);
+	free_terrain_buffers();
 	if (reflection_portals)
 		free(reflection_portals);
 }
@@ -112,6 +112,17 @@ void remove_3d_object_from_server (int id);
  */
 void init_terrain_buffers(int terrain_buffer_size);
 
+/**
+ * @ingroup maps
+ * @brief Frees the buffer used for terrain.
+ *
+ * Frees the buffer used for terrain and, if the static terrain buffer is
+ * used, the index list built from the culling results.
+ *
+ * @callgraph
+ */
+void free_terrain_buffers(void);
+
 /**
  * @ingroup maps
  * @brief Inits the buffer and the portals.
@@ -44,6 +44,10 @@ int pin_minimap = 0;
 int open_minimap_on_start = 0;
 
 static int enable_controls = 0;
+#ifdef	ACTOR_SOCIAL_FLAGS
+static elgl_colour_handle minimap_mine_colour = ELGL_COLOUR_HANDLE("minimap.mine");
+static elgl_colour_handle minimap_servermark_colour = ELGL_COLOUR_HANDLE("minimap.servermark");
+#endif	/* ACTOR_SOCIAL_FLAGS */
 
 GLuint compass_tex;
 GLuint minimap_texture = 0;
@@ -129,6 +133,9 @@ static __inline__ void draw_actor_points(float zoom_multip, float px, float py)
 	actor *a;
 	int i;
 	float x, y;
+#ifdef	ACTOR_SOCIAL_FLAGS
+	size_t colour;
+#endif	/* ACTOR_SOCIAL_FLAGS */
 
 	glPushMatrix();
 	glDisable(GL_TEXTURE_2D);
@@ -156,6 +163,18 @@ static __inline__ void draw_actor_points(float zoom_multip, float px, float py)
 			glColor3f(0.0f,0.0f,0.0f);
 			glVertex2f(x+2*zoom_multip, y+2*zoom_multip);
 
+#ifdef	ACTOR_SOCIAL_FLAGS
+			colour = get_actor_minimap_colour(a);
+			if (colour != ELGL_INVALID_COLOUR)
+				elglColourI(colour);
+			else
+			{	// Use the colour of their name. This gives purple bots, green demigods, etc.
+				int color = from_color_char (a->actor_name[0]);
+				glColor3ub (colors_list[color].r1,
+					colors_list[color].g1,
+					colors_list[color].b1);
+			}
+#else	/* ACTOR_SOCIAL_FLAGS */
 			if (a->kind_of_actor == NPC)
 				elglColourN("minimap.npc");
 			else if(a->actor_id == yourself)
@@ -185,6 +204,7 @@ static __inline__ void draw_actor_points(float zoom_multip, float px, float py)
 			}
 			else
 				elglColourN("minimap.otherplayer");
+#endif	/* ACTOR_SOCIAL_FLAGS */
 			// Draw it!
 			glVertex2f(x, y);
 		}
@@ -200,7 +220,11 @@ static __inline__ void draw_actor_points(float zoom_multip, float px, float py)
 			y = float_minimap_size - (m->y * size_y);
 			if(is_within_radius(x,y,px,py,zoom_multip*(minimap_size/2-15)))
 			{
+#ifdef	ACTOR_SOCIAL_FLAGS
+				elglColourH(&minimap_mine_colour);
+#else	/* ACTOR_SOCIAL_FLAGS */
 				elglColourN("minimap.mine");
+#endif	/* ACTOR_SOCIAL_FLAGS */
 				glVertex2f(x, y);
 			}
 		}
@@ -253,7 +277,11 @@ static __inline__ void draw_actor_points(float zoom_multip, float px, float py)
 				glDisable(GL_TEXTURE_2D);
 				rotate_actor_points(zoom_multip,px,py);
 				glBegin(GL_LINES);
+#ifdef	ACTOR_SOCIAL_FLAGS
+				elglColourH(&minimap_servermark_colour);
+#else	/* ACTOR_SOCIAL_FLAGS */
 				elglColourN("minimap.servermark");
+#endif	/* ACTOR_SOCIAL_FLAGS */
 				glVertex2f(x-diff, y-diff);
 				glVertex2f(x+diff, y+diff);
 				glVertex2f(x-diff, y+diff);
@@ -60,6 +60,9 @@ int anything_under_the_mouse(int object_id, int object_type);
 
 void calculate_reflection_frustum(float water_height);
 void calculate_shadow_frustum();
+#ifdef	SHADOW_MAP_CACHE
+void calculate_static_shadow_frustum(int check_items);
+#endif	/* SHADOW_MAP_CACHE */
 void enable_reflection_clip_planes();
 void disable_reflection_clip_planes();
 void set_current_frustum(unsigned int intersect_type);
@@ -50,8 +50,14 @@ namespace ELGL_Colour
 	class Colour_Container
 	{
 		public:
+#ifdef	ACTOR_SOCIAL_FLAGS
+			Colour_Container(void): generation(1) { add("null", Colour_Tuple(0.0f,0.0f,0.0f)); }
+			void load(void) { load_xml(); load_default(); generation++; }
+			size_t get(elgl_colour_handle *handle) const;
+#else	/* ACTOR_SOCIAL_FLAGS */
 			Colour_Container(void) { add("null", Colour_Tuple(0.0f,0.0f,0.0f)); }
 			void load(void) { load_xml(); load_default(); }
+#endif	/* ACTOR_SOCIAL_FLAGS */
 			void use(const char *name) const { use(get(name)); }
 			void use(size_t colour) const { colours_by_index[colour].use(); }
 			size_t get(const char *name) const;
@@ -63,6 +69,9 @@ namespace ELGL_Colour
 			void add(const char *name, Colour_Tuple colour);
 			std::map<const std::string, size_t> colours_by_name;
 			std::vector<Colour_Tuple> colours_by_index;
+#ifdef	ACTOR_SOCIAL_FLAGS
+			Uint32 generation;
+#endif	/* ACTOR_SOCIAL_FLAGS */
 	};
 
 
@@ -75,6 +84,22 @@ namespace ELGL_Colour
 	}
 
 
+#ifdef	ACTOR_SOCIAL_FLAGS
+	//	Get the colour id of a handle, the name is only looked up
+	//	again after the colours are loaded.
+	//
+	size_t Colour_Container::get(elgl_colour_handle *handle) const
+	{
+		if (handle->generation != generation)
+		{
+			handle->id = get(handle->name);
+			handle->generation = generation;
+		}
+		return handle->id;
+	}
+#endif	/* ACTOR_SOCIAL_FLAGS */
+
+
 	//	Add a new colour to the container, if it does not already exist.
 	//
 	void Colour_Container::add(const char *name, Colour_Tuple colour)
@@ -198,4 +223,8 @@ extern "C"
 	size_t elglGetColourId(const char *name) { return colours.get(name); }
 	void elglGetColour3v(const char *name, GLfloat *buf) { colours.get3v(name, buf); }
 	void elglGetColour4v(const char *name, GLfloat *buf) { colours.get4v(name, buf); }
+#ifdef	ACTOR_SOCIAL_FLAGS
+	size_t elglGetColourHandleId(elgl_colour_handle *handle) { return colours.get(handle); }
+	void elglColourH(elgl_colour_handle *handle) { colours.use(colours.get(handle)); }
+#endif	/* ACTOR_SOCIAL_FLAGS */
 }
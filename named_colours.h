@@ -36,6 +36,43 @@ size_t elglGetColourId(const char *name);
  */
 void elglColourI(size_t index);
 
+#ifdef	ACTOR_SOCIAL_FLAGS
+/*!
+ * A named colour that is looked up once. The id is resolved the first time
+ * the handle is used and again after the colours are loaded.
+ */
+typedef struct
+{
+	const char *name;	/*!< the name of the colour */
+	size_t id;		/*!< the id of the colour, valid if generation is current */
+	Uint32 generation;	/*!< the load of the colours the id was resolved for */
+} elgl_colour_handle;
+
+/*!
+ * Initialiser of a colour handle, the name must stay valid.
+ */
+#define ELGL_COLOUR_HANDLE(name) { name, 0, 0 }
+
+/*!
+ * \ingroup named_colours
+ * \brief Get the unique id of the colour of a handle.
+ *
+ * \param	The handle of the colour.
+ * \return	The unique id, ELGL_INVALID_COLOUR if not found.
+ * \callgraph
+ */
+size_t elglGetColourHandleId(elgl_colour_handle *handle);
+
+/*!
+ * \ingroup named_colours
+ * \brief Set the current GL colour, as fast as elglColourI().
+ *
+ * \param	The handle of the colour.
+ * \callgraph
+ */
+void elglColourH(elgl_colour_handle *handle);
+#endif	/* ACTOR_SOCIAL_FLAGS */
+
 /*!
  * \ingroup named_colours
  * \brief Set the current GL colour.
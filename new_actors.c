@@ -1125,6 +1125,9 @@ void add_enhanced_actor_from_server (const char *in_data, int len)
 			my_tolower(actors_list[i]->actor_name);
 		}
 	}
+#ifdef	ACTOR_SOCIAL_FLAGS
+	update_actor_social_flags(actors_list[i]);
+#endif	/* ACTOR_SOCIAL_FLAGS */
 
 
 	if (attachment_type >= 0 &&attachment_type < 255) //255 is not necessary, but it suppresses a warning in errorlog
@@ -16,9 +16,22 @@
 #include "queue.h"
 #include "misc.h"
 #include "asc.h"
+#ifdef	PIPELINED_UPDATES
+#include "io/http_response.h"
+#endif	/* PIPELINED_UPDATES */
+#ifdef	DELTA_UPDATES
+#include "io/delta.h"
+#endif	/* DELTA_UPDATES */
 
 #define MAX_OLD_UPDATE_FILES	5
 #define	UPDATE_DOWNLOAD_THREAD_COUNT 2
+#ifdef	PIPELINED_UPDATES
+#define	UPDATE_PIPELINE_DEPTH	4
+#define	UPDATE_RECV_BUFFER_SIZE	65536
+#endif	/* PIPELINED_UPDATES */
+#ifdef	DELTA_UPDATES
+#define	MAX_DELTA_SOURCES	4
+#endif	/* DELTA_UPDATES */
 
 typedef struct
 {
@@ -32,6 +45,9 @@ typedef struct
 	SDL_Thread* threads[UPDATE_DOWNLOAD_THREAD_COUNT];
 	SDL_mutex* mutex;
 	SDL_cond* condition;
+#ifdef	DELTA_UPDATES
+	SDL_mutex* sources_mutex;
+#endif	/* DELTA_UPDATES */
 	progress_fnc update_progress_function;
 	void* user_data;
 } download_files_thread_data_t;
@@ -40,8 +56,138 @@ typedef struct
 {
 	char file_name[256];
 	MD5_DIGEST digest;
+#ifdef	DELTA_UPDATES
+	MD5_DIGEST delta_sources[MAX_DELTA_SOURCES];
+	Uint32 delta_count;
+	char delta_name[256];
+	unzFile source;
+	Uint32 source_index;
+#endif	/* DELTA_UPDATES */
 } update_info_t;
 
+#ifdef	DELTA_UPDATES
+static const char* get_download_name(const update_info_t* info)
+{
+	if (info->delta_name[0] != 0)
+	{
+		return info->delta_name;
+	}
+
+	return info->file_name;
+}
+
+static void queue_full_download(download_files_thread_data_t *data,
+	update_info_t* info)
+{
+	LOG_ERROR("Can't update file '%s' using patch '%s', downloading the "
+		"whole file", info->file_name, info->delta_name);
+
+	info->source = 0;
+	info->delta_name[0] = 0;
+
+	CHECK_AND_LOCK_MUTEX(data->mutex);
+
+	queue_push(data->files, info);
+
+	CHECK_AND_UNLOCK_MUTEX(data->mutex);
+}
+
+/* Reads the old version of the file from its update file. The download
+ * threads read it just before the patch arrives, so only the sources of
+ * the patches in work are in memory. */
+static Uint32 start_delta(download_files_thread_data_t *data,
+	update_info_t* info, delta_patch_t* patch, void** source)
+{
+	char file_name[256];
+	Uint64 size;
+	Uint32 len, result;
+
+	memset(patch, 0, sizeof(delta_patch_t));
+
+	*source = 0;
+
+	len = strlen(info->file_name);
+
+	safe_snprintf(file_name, sizeof(file_name), "%s", info->file_name);
+
+	if (has_suffix(file_name, len, ".xz", 3))
+	{
+		file_name[len - 3] = 0;
+	}
+
+	CHECK_AND_LOCK_MUTEX(data->sources_mutex);
+
+	result = read_md5_file_from_zip(info->source, file_name,
+		info->delta_sources[info->source_index], source, &size);
+
+	CHECK_AND_UNLOCK_MUTEX(data->sources_mutex);
+
+	if (result != 0)
+	{
+		return 1;
+	}
+
+	delta_patch_init(patch, *source, size);
+
+	return 0;
+}
+
+/* Checks the patched file and frees the old version. The patch checks the
+ * md5 digests of the old and the new version. If anything fails, the file
+ * is queued again to be downloaded in full. */
+static Uint32 finish_delta(download_files_thread_data_t *data,
+	update_info_t* info, delta_patch_t* patch, void* source,
+	const Uint32 error)
+{
+	free(source);
+
+	if ((error == 0) && (delta_patch_finish(patch) == 0))
+	{
+		return 0;
+	}
+
+	delta_patch_free(patch);
+	queue_full_download(data, info);
+
+	return 1;
+}
+
+/* Looks for a version of the file in the old update files that the file
+ * list has a patch for. */
+static void find_delta_source(update_info_t* info, const char* file_name,
+	const Uint32 source_count, unzFile* sources)
+{
+	char comment[64];
+	Uint32 i, j;
+
+	for (i = 0; i < info->delta_count; i++)
+	{
+		for (j = 0; j < source_count; j++)
+		{
+			if (locate_md5_file_in_zip(sources[j], file_name,
+				info->delta_sources[i]) != 0)
+			{
+				continue;
+			}
+
+			info->source = sources[j];
+			info->source_index = i;
+
+			// the comment string is "MD5: " and the digest
+			convert_md5_digest_to_comment_string(
+				info->delta_sources[i], sizeof(comment),
+				comment);
+
+			safe_snprintf(info->delta_name,
+				sizeof(info->delta_name), "%s.%s.delta",
+				file_name, comment + 5);
+
+			return;
+		}
+	}
+}
+#endif	/* DELTA_UPDATES */
+
 static Uint32 download_file(const char* file_name, FILE* file,
 	const char* server, const char* path, Uint64* file_size,
 	const Uint32 size, char* buffer, const Uint32 etag_size,
@@ -204,6 +350,401 @@ static Uint32 download_file(const char* file_name, FILE* file,
 	return 0;  // finished
 }
 
+#ifdef	PIPELINED_UPDATES
+typedef struct
+{
+	IPaddress ip;
+	TCPsocket socket;
+	Uint8* buffer;
+	Uint32 pos;
+	Uint32 size;
+#ifdef	DELTA_UPDATES
+	delta_patch_t* patch;
+	Uint32 patch_error;
+#endif	/* DELTA_UPDATES */
+} update_connection_t;
+
+static void close_connection(update_connection_t* connection)
+{
+	if (connection->socket != 0)
+	{
+		SDLNet_TCP_Close(connection->socket);
+	}
+
+	connection->socket = 0;
+	connection->pos = 0;
+	connection->size = 0;
+}
+
+static Uint32 send_requests(update_connection_t* connection,
+	const char* server, const char* path, update_info_t** infos,
+	const Uint32 count)
+{
+	char request[1024];
+	char* buffer;
+	Uint32 i, len, size;
+
+	if (connection->socket == 0)
+	{
+		connection->socket = SDLNet_TCP_Open(&connection->ip);
+
+		if (connection->socket == 0)
+		{
+			return 2;  // failed to open the socket
+		}
+	}
+
+	buffer = 0;
+	size = 0;
+
+	// all requests are sent at once, the server answers them in order
+	for (i = 0; i < count; i++)
+	{
+		safe_snprintf(request, sizeof(request), "GET %s%s HTTP/1.1\r\n"
+			"Host: %s\r\nConnection: keep-alive\r\n"
+			"CACHE-CONTROL:NO-CACHE\r\nREFERER:%s\r\n"
+			"USER-AGENT:AUTOUPDATE\r\n\r\n", path,
+#ifdef	DELTA_UPDATES
+			get_download_name(infos[i]),
+#else	/* DELTA_UPDATES */
+			infos[i]->file_name,
+#endif	/* DELTA_UPDATES */
+			server, FILE_VERSION);
+
+		len = strlen(request);
+		buffer = realloc(buffer, size + len);
+		memcpy(buffer + size, request, len);
+		size += len;
+	}
+
+	if (SDLNet_TCP_Send(connection->socket, buffer, size) < (int)size)
+	{
+		free(buffer);
+		close_connection(connection);
+
+		return 3;  // error in sending the get request
+	}
+
+	free(buffer);
+
+	return 0;
+}
+
+static Uint32 receive_response(update_connection_t* connection,
+	http_response_t* response)
+{
+	Sint32 len;
+
+	http_response_init(response);
+
+	while (response->state != hrs_done)
+	{
+		if (connection->pos >= connection->size)
+		{
+			len = SDLNet_TCP_Recv(connection->socket,
+				connection->buffer, UPDATE_RECV_BUFFER_SIZE);
+
+			if (len <= 0)
+			{
+				close_connection(connection);
+
+				return http_response_close(response) == 0 ?
+					0 : 5;
+			}
+
+			connection->pos = 0;
+			connection->size = len;
+		}
+
+		len = http_response_parse(response, connection->buffer +
+			connection->pos, connection->size - connection->pos);
+
+		if (len < 0)
+		{
+			close_connection(connection);
+
+			return 6;
+		}
+
+		connection->pos += len;
+
+#ifdef	DELTA_UPDATES
+		// the patch is applied while it arrives, so only the last
+		// received part of it is kept
+		if ((connection->patch != 0) && (response->status == 200) &&
+			(response->size > 0))
+		{
+			if ((connection->patch_error == 0) &&
+				(delta_patch_apply(connection->patch,
+					response->data, response->size) != 0))
+			{
+				connection->patch_error = 1;
+			}
+
+			response->size = 0;
+		}
+#endif	/* DELTA_UPDATES */
+	}
+
+	if (response->keep_alive == 0)
+	{
+		close_connection(connection);
+	}
+
+	if (response->status != 200)
+	{
+		return response->status;
+	}
+
+	return 0;
+}
+
+static void store_file(download_files_thread_data_t *data,
+	const update_info_t* info, const Uint8* file_data,
+	const Uint64 file_size)
+{
+	char file_name[256];
+	char comment[64];
+	Uint32 len;
+
+	convert_md5_digest_to_comment_string(info->digest, sizeof(comment),
+		comment);
+
+	len = strlen(info->file_name);
+
+	safe_snprintf(file_name, sizeof(file_name), "%s", info->file_name);
+
+	if (has_suffix(file_name, len, ".xz", 3))
+	{
+		file_name[len - 3] = 0;
+	}
+
+	CHECK_AND_LOCK_MUTEX(data->mutex);
+
+	add_to_zip(file_name, file_size, file_data, data->dest, comment);
+	data->index++;
+
+	CHECK_AND_UNLOCK_MUTEX(data->mutex);
+}
+
+static Uint32 store_response(download_files_thread_data_t *data,
+	const update_info_t* info, const http_response_t* response)
+{
+	// the file list may hold the digest of the packed or the unpacked
+	// file
+	if ((memcmp(info->digest, response->body_digest,
+		sizeof(MD5_DIGEST)) != 0) && (memcmp(info->digest,
+		response->data_digest, sizeof(MD5_DIGEST)) != 0))
+	{
+		return 7;
+	}
+
+	store_file(data, info, response->data, response->size);
+
+	return 0;
+}
+
+#ifdef	DELTA_UPDATES
+/* Receives a patch and applies it to the old version of the file while it
+ * arrives. A missing patch, a missing old version or a failed patch queue
+ * the whole file, only errors of the connection are returned. */
+static Uint32 receive_delta(download_files_thread_data_t *data,
+	update_connection_t* connection, http_response_t* response,
+	update_info_t* info)
+{
+	delta_patch_t patch;
+	void* source;
+	Uint32 result;
+
+	// the response must be received even without the old version, the
+	// next responses follow it on the connection
+	connection->patch = &patch;
+	connection->patch_error = start_delta(data, info, &patch, &source);
+
+	result = receive_response(connection, response);
+
+	connection->patch = 0;
+
+	if ((result != 0) && (result < 100))
+	{
+		free(source);
+		delta_patch_free(&patch);
+
+		return result;
+	}
+
+	if (finish_delta(data, info, &patch, source, (result != 0) ||
+		(connection->patch_error != 0)) != 0)
+	{
+		return 0;
+	}
+
+	store_file(data, info, patch.data, patch.size);
+
+	delta_patch_free(&patch);
+
+	return 0;
+}
+#endif	/* DELTA_UPDATES */
+
+/* Each thread keeps its connection open between the files and has up to
+ * UPDATE_PIPELINE_DEPTH requests in flight on it. The files are unpacked
+ * and hashed while they are received. */
+static int download_files_thread(void* _data)
+{
+	download_files_thread_data_t *data = NULL;
+	update_info_t* infos[UPDATE_PIPELINE_DEPTH];
+	update_connection_t connection;
+	http_response_t* response;
+	Uint32 i, count, done, tries, result, error, index, running;
+
+	data = (download_files_thread_data_t*)_data;
+
+	init_thread_log("download_files");
+
+	error = 0;
+
+	memset(&connection, 0, sizeof(connection));
+
+	if (SDLNet_ResolveHost(&connection.ip, data->server, 80) < 0)
+	{
+		// caution, always port 80!
+		LOG_ERROR("Can't resolve server '%s'", data->server);
+
+		return 3;
+	}
+
+	connection.buffer = malloc(UPDATE_RECV_BUFFER_SIZE);
+	response = calloc(1, sizeof(http_response_t));
+
+	while (1)
+	{
+		CHECK_AND_LOCK_MUTEX(data->mutex);
+
+		do
+		{
+			infos[0] = queue_pop(data->files);
+
+			running = data->running;
+
+			if ((running == 1) && (infos[0] == 0))
+			{
+				SDL_CondWait(data->condition, data->mutex);
+			}
+		}
+		while ((data->running == 1) && (infos[0] == 0));
+
+		count = 0;
+
+		if (infos[0] != 0)
+		{
+			count = 1;
+
+			while ((count < UPDATE_PIPELINE_DEPTH) &&
+				((infos[count] = queue_pop(data->files)) != 0))
+			{
+				count++;
+			}
+		}
+
+		index = data->index;
+
+		CHECK_AND_UNLOCK_MUTEX(data->mutex);
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		if (data->update_progress_function("Downloading files",
+			data->count, index, data->user_data) != 1)
+		{
+			CHECK_AND_LOCK_MUTEX(data->mutex);
+
+			data->running = 0;
+
+			CHECK_AND_UNLOCK_MUTEX(data->mutex);
+
+			error = 2;
+
+			break;
+		}
+
+		done = 0;
+		tries = 0;
+		result = 0;
+
+		while ((done < count) && (tries < 5))
+		{
+			result = send_requests(&connection, data->server,
+				data->path, infos + done, count - done);
+
+			for (i = done; (result == 0) && (i < count); i++)
+			{
+#ifdef	DELTA_UPDATES
+				if (infos[i]->delta_name[0] != 0)
+				{
+					result = receive_delta(data,
+						&connection, response,
+						infos[i]);
+				}
+				else
+#endif	/* DELTA_UPDATES */
+				{
+					result = receive_response(&connection,
+						response);
+
+					if (result == 0)
+					{
+						result = store_response(data,
+							infos[i], response);
+					}
+				}
+
+				if (result != 0)
+				{
+					break;
+				}
+
+				done++;
+
+				// the server closed the connection, the
+				// remaining requests must be sent again
+				if (connection.socket == 0)
+				{
+					break;
+				}
+			}
+
+			if (result != 0)
+			{
+				LOG_ERROR("Download error %d while updating "
+					"file '%s' from server '%s', retrying"
+					" it", result, infos[done]->file_name,
+					data->server);
+
+				close_connection(&connection);
+				tries++;
+			}
+		}
+
+		if (done < count)
+		{
+			error = 3;
+
+			break;
+		}
+	}
+
+	close_connection(&connection);
+
+	http_response_free(response);
+	free(response);
+	free(connection.buffer);
+
+	return error;
+}
+#else	/* PIPELINED_UPDATES */
 static int download_files_thread(void* _data)
 {
 	char file_name[256];
@@ -216,6 +757,10 @@ static int download_files_thread(void* _data)
 	Uint64 file_size, size;
 	Uint32 i, len, result, error, count, index, running;
 	Uint32 download_buffer_size;
+#ifdef	DELTA_UPDATES
+	delta_patch_t patch;
+	void* source;
+#endif	/* DELTA_UPDATES */
 
 	data = (download_files_thread_data_t*)_data;
 
@@ -283,10 +828,26 @@ static int download_files_thread(void* _data)
 		{
 			fseek(file, 0, SEEK_SET);
 
+#ifdef	DELTA_UPDATES
+			result = download_file(get_download_name(info), file,
+				data->server, data->path, &size,
+				download_buffer_size,
+				download_buffer, 0, 0);
+
+			if ((result >= 100) && (info->delta_name[0] != 0))
+			{
+				// no patch on the server
+				queue_full_download(data, info);
+
+				error = 0;
+				break;
+			}
+#else	/* DELTA_UPDATES */
 			result = download_file(info->file_name, file,
 				data->server, data->path, &size,
 				download_buffer_size,
 				download_buffer, 0, 0);
+#endif	/* DELTA_UPDATES */
 
 			if (result != 0)
 			{
@@ -310,6 +871,35 @@ static int download_files_thread(void* _data)
 				continue;
 			}
 
+#ifdef	DELTA_UPDATES
+			// without the pipelined downloads the patch is in the
+			// temp file, so it is applied in one piece
+			if (info->delta_name[0] != 0)
+			{
+				error = start_delta(data, info, &patch, &source);
+
+				if (error == 0)
+				{
+					error = delta_patch_apply(&patch,
+						file_buffer, file_size);
+				}
+
+				if (finish_delta(data, info, &patch, source,
+					error) != 0)
+				{
+					free(file_buffer);
+
+					error = 0;
+					break;
+				}
+
+				free(file_buffer);
+
+				file_buffer = patch.data;
+				file_size = patch.size;
+			}
+#endif	/* DELTA_UPDATES */
+
 			convert_md5_digest_to_comment_string(info->digest,
 				sizeof(comment), comment);
 
@@ -349,6 +939,7 @@ static int download_files_thread(void* _data)
 
 	return error;
 }
+#endif	/* PIPELINED_UPDATES */
 
 static void init_threads(download_files_thread_data_t *data, const Uint32 count,
 	const char* server, const char* path, zipFile dest,
@@ -361,6 +952,9 @@ static void init_threads(download_files_thread_data_t *data, const Uint32 count,
 	queue_initialise(&(data->files));
 	data->mutex = SDL_CreateMutex();
 	data->condition = SDL_CreateCond();
+#ifdef	DELTA_UPDATES
+	data->sources_mutex = SDL_CreateMutex();
+#endif	/* DELTA_UPDATES */
 
 	data->server = server;
 	data->path = path;
@@ -409,6 +1003,9 @@ static void wait_for_threads(download_files_thread_data_t *data, Uint32* error)
 
 	SDL_DestroyMutex(data->mutex);
 	SDL_DestroyCond(data->condition);
+#ifdef	DELTA_UPDATES
+	SDL_DestroyMutex(data->sources_mutex);
+#endif	/* DELTA_UPDATES */
 
 	while (queue_pop(data->files) != 0);
 
@@ -470,6 +1067,12 @@ static Uint32 download_files(update_info_t* infos, const Uint32 count,
 			file_name[len - 3] = 0;
 		}
 
+#ifdef	DELTA_UPDATES
+		// the download threads read the old versions of the patched
+		// files from the same update files
+		CHECK_AND_LOCK_MUTEX(thread_data.sources_mutex);
+#endif	/* DELTA_UPDATES */
+
 		for (j = 0; j < source_count; j++)
 		{
 			if (check_md5_from_zip(sources[j], file_name,
@@ -488,6 +1091,16 @@ static Uint32 download_files(update_info_t* infos, const Uint32 count,
 			}
 		}
 
+#ifdef	DELTA_UPDATES
+		if (download == 1)
+		{
+			find_delta_source(&infos[i], file_name, source_count,
+				sources);
+		}
+
+		CHECK_AND_UNLOCK_MUTEX(thread_data.sources_mutex);
+#endif	/* DELTA_UPDATES */
+
 		if (download == 1)
 		{
 			queue_push(thread_data.files, &infos[i]);
@@ -543,6 +1156,91 @@ static Uint64 skip_line(const char** buffer, Uint64* size, Uint64* skip)
 	return *size;
 }
 
+#ifdef	DELTA_UPDATES
+typedef struct
+{
+	char file_name[256];
+	MD5_DIGEST source_digest;
+	MD5_DIGEST digest;
+} delta_info_t;
+
+/* A patch is listed as "DELTA (/name) = old_md5 new_md5". The slash makes
+ * older clients skip the line. */
+static void add_to_deltas(const char* buffer, delta_info_t** deltas,
+	Uint32* count, Uint32* size)
+{
+	char name[256];
+	char source_md5[33];
+	char md5[33];
+	delta_info_t* delta;
+
+	memset(name, 0, sizeof(name));
+	memset(source_md5, 0, sizeof(source_md5));
+	memset(md5, 0, sizeof(md5));
+
+	if (sscanf(buffer, "DELTA (/%250[^)]) = %32s %32s", name, source_md5,
+		md5) != 3)
+	{
+		return;
+	}
+
+	if (*count >= *size)
+	{
+		*size = *count + 256;
+		*deltas = realloc(*deltas, *size * sizeof(delta_info_t));
+	}
+
+	delta = &(*deltas)[*count];
+
+	if ((convert_string_to_md5_digest(source_md5,
+		delta->source_digest) != 0) ||
+		(convert_string_to_md5_digest(md5, delta->digest) != 0))
+	{
+		return;
+	}
+
+	if ((name[0] == '.') && (name[1] == '/'))
+	{
+		safe_strncpy(delta->file_name, name + 2,
+			sizeof(delta->file_name));
+	}
+	else
+	{
+		safe_strncpy(delta->file_name, name, sizeof(delta->file_name));
+	}
+
+	*count += 1;
+}
+
+static void add_delta_sources(update_info_t* infos, const Uint32 count,
+	const delta_info_t* deltas, const Uint32 delta_count)
+{
+	update_info_t* info;
+	Uint32 i, j;
+
+	for (i = 0; i < delta_count; i++)
+	{
+		for (j = 0; j < count; j++)
+		{
+			info = &infos[j];
+
+			if ((info->delta_count >= MAX_DELTA_SOURCES) ||
+				(memcmp(info->digest, deltas[i].digest,
+					sizeof(MD5_DIGEST)) != 0) ||
+				(strcmp(info->file_name,
+					deltas[i].file_name) != 0))
+			{
+				continue;
+			}
+
+			memcpy(info->delta_sources[info->delta_count],
+				deltas[i].source_digest, sizeof(MD5_DIGEST));
+			info->delta_count++;
+		}
+	}
+}
+#endif	/* DELTA_UPDATES */
+
 static Uint32 add_to_downloads(const char* buffer, const Uint64 buffer_size,
 	update_info_t** infos, Uint32* count,
 	progress_fnc update_progress_function, void* user_data)
@@ -553,6 +1251,14 @@ static Uint32 add_to_downloads(const char* buffer, const Uint64 buffer_size,
 	const char* line_buffer;
 	Uint64 line_size, line_buffer_size, skip;
 	Uint32 size;
+#ifdef	DELTA_UPDATES
+	delta_info_t* deltas;
+	Uint32 delta_count, delta_size;
+
+	deltas = 0;
+	delta_count = 0;
+	delta_size = 0;
+#endif	/* DELTA_UPDATES */
 
 	skip = 0;
 	line_buffer = buffer;
@@ -571,6 +1277,14 @@ static Uint32 add_to_downloads(const char* buffer, const Uint64 buffer_size,
 
 	while (line_buffer_size > 0)
 	{
+#ifdef	DELTA_UPDATES
+		if (strncmp(line_buffer, "DELTA (/", 8) == 0)
+		{
+			add_to_deltas(line_buffer, &deltas, &delta_count,
+				&delta_size);
+		}
+#endif	/* DELTA_UPDATES */
+
 		// parse the line
 		memset(name, 0, sizeof(name));
 		memset(md5, 0, sizeof(md5));
@@ -593,6 +1307,10 @@ static Uint32 add_to_downloads(const char* buffer, const Uint64 buffer_size,
 				*infos = realloc(*infos, size * sizeof(update_info_t));
 			}
 
+#ifdef	DELTA_UPDATES
+			memset(&(*infos)[*count], 0, sizeof(update_info_t));
+#endif	/* DELTA_UPDATES */
+
 			if ((name[0] == '.') && (name[1] == '/'))
 			{
 				memcpy((*infos)[*count].file_name, name + 2, sizeof(name) - 2);
@@ -610,6 +1328,12 @@ static Uint32 add_to_downloads(const char* buffer, const Uint64 buffer_size,
 		line_size = skip_line(&line_buffer, &line_buffer_size, &skip);
 	}
 
+#ifdef	DELTA_UPDATES
+	add_delta_sources(*infos, *count, deltas, delta_count);
+
+	free(deltas);
+#endif	/* DELTA_UPDATES */
+
 	return 1;
 }
 
@@ -0,0 +1,398 @@
+/****************************************************************************
+ *            occlusion_culling.cpp
+ *
+ * Copyright: See COPYING file that comes with this distribution
+ ****************************************************************************/
+
+#include "occlusion_culling.h"
+#include "engine/occlusionbuffer.hpp"
+#include "e3d.h"
+#include "tiles.h"
+#include "asc.h"
+#include "elloggingwrapper.h"
+#include "io/elfilewrapper.h"
+#include <SDL.h>
+#include <SDL_thread.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#define	OCCLUSION_CULLING_THREADS	3
+
+int use_occlusion_culling = 1;
+
+namespace
+{
+
+	using namespace eternal_lands;
+
+	const Uint32 buffer_width = 256;
+	const Uint32 buffer_height = 128;
+	const Uint32 max_occluders = 32;
+	/* The boxes of the objects are shrunk, so doorways, windows and the
+	 * like near the border of a box can't hide anything behind them. */
+	const float occluder_scale = 0.75f;
+	const float occluder_height_scale = 0.8f;
+	const float min_occluder_size = 2.0f;
+	const float min_occluder_height = 2.0f;
+	const float max_ground_distance = 0.5f;
+
+	struct Occluder
+	{
+		AABBOX bbox;
+		float area;
+	};
+
+	std::vector<Occluder> occluders;
+	OcclusionBuffer* occlusion_buffer = 0;
+	bool buffer_valid = false;
+
+	SDL_Thread* threads[OCCLUSION_CULLING_THREADS];
+	SDL_sem* start_semaphores[OCCLUSION_CULLING_THREADS];
+	SDL_sem* done_semaphore = 0;
+	Uint32 thread_bands[OCCLUSION_CULLING_THREADS];
+	volatile int threads_done = 0;
+
+	int rasterize_thread(void* data)
+	{
+		Uint32 band;
+
+		band = *static_cast<Uint32*>(data);
+
+		while (true)
+		{
+			SDL_SemWait(start_semaphores[band - 1]);
+
+			if (threads_done != 0)
+			{
+				break;
+			}
+
+			occlusion_buffer->rasterize(band,
+				OCCLUSION_CULLING_THREADS + 1);
+
+			SDL_SemPost(done_semaphore);
+		}
+
+		return 0;
+	}
+
+	void init_occlusion_buffer()
+	{
+		Uint32 i;
+
+		if (occlusion_buffer != 0)
+		{
+			return;
+		}
+
+		occlusion_buffer = new OcclusionBuffer(buffer_width,
+			buffer_height);
+#ifdef	USE_SIMD
+		occlusion_buffer->set_use_simd(SDL_HasSSE());
+#endif	/* USE_SIMD */
+
+		threads_done = 0;
+		done_semaphore = SDL_CreateSemaphore(0);
+
+		for (i = 0; i < OCCLUSION_CULLING_THREADS; i++)
+		{
+			thread_bands[i] = i + 1;
+			start_semaphores[i] = SDL_CreateSemaphore(0);
+			threads[i] = SDL_CreateThread(rasterize_thread,
+				&thread_bands[i]);
+		}
+	}
+
+	void rasterize_occluders()
+	{
+		Uint32 i;
+
+		for (i = 0; i < OCCLUSION_CULLING_THREADS; i++)
+		{
+			SDL_SemPost(start_semaphores[i]);
+		}
+
+		occlusion_buffer->rasterize(0, OCCLUSION_CULLING_THREADS + 1);
+
+		for (i = 0; i < OCCLUSION_CULLING_THREADS; i++)
+		{
+			SDL_SemWait(done_semaphore);
+		}
+	}
+
+	bool load_occluders(const char* file_name)
+	{
+		char name[256];
+		char* pos;
+		char* line;
+		el_file_ptr file;
+		Occluder occluder;
+		std::vector<char> data;
+
+		safe_strncpy(name, file_name, sizeof(name));
+
+		pos = strrchr(name, '.');
+
+		if ((pos != 0) && (strcasecmp(pos, ".elm") == 0))
+		{
+			*pos = 0;
+		}
+
+		safe_strcat(name, ".occ", sizeof(name));
+
+		if (!el_file_exists(name))
+		{
+			return false;
+		}
+
+		file = el_open(name);
+
+		if (file == 0)
+		{
+			return false;
+		}
+
+		data.resize(el_get_size(file) + 1, 0);
+		el_read(file, el_get_size(file), &data[0]);
+		el_close(file);
+
+		occluder.area = 0.0f;
+
+		for (line = strtok(&data[0], "\r\n"); line != 0;
+			line = strtok(0, "\r\n"))
+		{
+			if (sscanf(line, "%f %f %f %f %f %f",
+				&occluder.bbox.bbmin[X], &occluder.bbox.bbmin[Y],
+				&occluder.bbox.bbmin[Z], &occluder.bbox.bbmax[X],
+				&occluder.bbox.bbmax[Y], &occluder.bbox.bbmax[Z])
+				== 6)
+			{
+				occluders.push_back(occluder);
+			}
+		}
+
+		LOG_INFO("Loaded %d occluders from '%s'.",
+			static_cast<int>(occluders.size()), name);
+
+		return true;
+	}
+
+	bool is_axis_aligned(const object3d* object)
+	{
+		float angle;
+
+		if ((object->x_rot != 0.0f) || (object->y_rot != 0.0f))
+		{
+			return false;
+		}
+
+		angle = std::fmod(std::abs(object->z_rot), 90.0f);
+
+		return (angle < 1.0f) || (angle > 89.0f);
+	}
+
+	void select_occluders(const BBOX_TREE* bbox_tree)
+	{
+		Occluder occluder;
+		const object3d* object;
+		float center[3], half_size[3], ground;
+		Uint32 i, j;
+
+		occluder.area = 0.0f;
+
+		for (i = 0; i < bbox_tree->items_count; i++)
+		{
+			const BBOX_ITEM &item = bbox_tree->items[i];
+
+			if ((item.type !=
+				TYPE_3D_NO_BLEND_NO_GROUND_NO_ALPHA_SELF_LIT_OBJECT)
+				&& (item.type !=
+				TYPE_3D_NO_BLEND_NO_GROUND_NO_ALPHA_NO_SELF_LIT_OBJECT))
+			{
+				continue;
+			}
+
+			object = objects_list[get_3dobject_index(item.ID)];
+
+			if ((object == 0) || !is_axis_aligned(object))
+			{
+				continue;
+			}
+
+			if ((std::max(item.bbox.bbmax[X] - item.bbox.bbmin[X],
+				item.bbox.bbmax[Y] - item.bbox.bbmin[Y]) <
+				min_occluder_size) ||
+				((item.bbox.bbmax[Z] - item.bbox.bbmin[Z]) <
+				min_occluder_height))
+			{
+				continue;
+			}
+
+			for (j = 0; j < 3; j++)
+			{
+				center[j] = (item.bbox.bbmin[j] +
+					item.bbox.bbmax[j]) * 0.5f;
+				half_size[j] = (item.bbox.bbmax[j] -
+					item.bbox.bbmin[j]) * 0.5f;
+			}
+
+			ground = get_tile_height(center[X] * 2.0f,
+				center[Y] * 2.0f);
+
+			if (item.bbox.bbmin[Z] > (ground + max_ground_distance))
+			{
+				continue;
+			}
+
+			for (j = 0; j < 2; j++)
+			{
+				occluder.bbox.bbmin[j] = center[j] -
+					half_size[j] * occluder_scale;
+				occluder.bbox.bbmax[j] = center[j] +
+					half_size[j] * occluder_scale;
+			}
+
+			occluder.bbox.bbmin[Z] = item.bbox.bbmin[Z];
+			occluder.bbox.bbmax[Z] = item.bbox.bbmin[Z] +
+				half_size[Z] * 2.0f * occluder_height_scale;
+
+			occluders.push_back(occluder);
+		}
+
+		LOG_INFO("Selected %d occluders.",
+			static_cast<int>(occluders.size()));
+	}
+
+	bool larger_area(const Occluder &a, const Occluder &b)
+	{
+		return a.area > b.area;
+	}
+
+	int item_visible(const BBOX_ITEM* item)
+	{
+		/* Lights, terrain and water are never culled. */
+		if (item->type > TYPE_PARTICLE_SYSTEM)
+		{
+			return 1;
+		}
+
+		return occlusion_buffer->is_visible(item->bbox.bbmin,
+			item->bbox.bbmax) ? 1 : 0;
+	}
+
+}
+
+extern "C" void init_occluders(const char* file_name)
+{
+	clear_occluders();
+
+	if (!load_occluders(file_name))
+	{
+		select_occluders(main_bbox_tree);
+	}
+}
+
+extern "C" void clear_occluders()
+{
+	occluders.clear();
+	buffer_valid = false;
+}
+
+extern "C" void free_occlusion_culling()
+{
+	Uint32 i;
+
+	clear_occluders();
+
+	if (occlusion_buffer == 0)
+	{
+		return;
+	}
+
+	threads_done = 1;
+
+	for (i = 0; i < OCCLUSION_CULLING_THREADS; i++)
+	{
+		SDL_SemPost(start_semaphores[i]);
+		SDL_WaitThread(threads[i], 0);
+		SDL_DestroySemaphore(start_semaphores[i]);
+	}
+
+	SDL_DestroySemaphore(done_semaphore);
+
+	delete occlusion_buffer;
+	occlusion_buffer = 0;
+}
+
+extern "C" void cull_occluded_items(BBOX_TREE* bbox_tree,
+	const MATRIX4x4 clip)
+{
+	Uint32 i, count;
+
+	buffer_valid = false;
+
+	if ((use_occlusion_culling == 0) || occluders.empty())
+	{
+		return;
+	}
+
+	init_occlusion_buffer();
+
+	occlusion_buffer->clear();
+	occlusion_buffer->set_view_projection_matrix(clip);
+
+	count = 0;
+
+	/* Boxes outside of the screen or crossing the near plane get an
+	 * area of zero. */
+	for (i = 0; i < occluders.size(); i++)
+	{
+		occluders[i].area = occlusion_buffer->get_screen_area(
+			occluders[i].bbox.bbmin, occluders[i].bbox.bbmax);
+
+		if (occluders[i].area > 0.0f)
+		{
+			count++;
+		}
+	}
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	count = std::min(count, max_occluders);
+
+	std::partial_sort(occluders.begin(), occluders.begin() + count,
+		occluders.end(), larger_area);
+
+	for (i = 0; i < count; i++)
+	{
+		occlusion_buffer->add_occluder(occluders[i].bbox.bbmin,
+			occluders[i].bbox.bbmax);
+	}
+
+	if (occlusion_buffer->get_triangle_count() == 0)
+	{
+		return;
+	}
+
+	rasterize_occluders();
+
+	buffer_valid = true;
+
+	filter_intersect_items(bbox_tree, item_visible);
+}
+
+extern "C" int aabb_not_occluded(const AABBOX bbox)
+{
+	if (!buffer_valid)
+	{
+		return 1;
+	}
+
+	return occlusion_buffer->is_visible(bbox.bbmin, bbox.bbmax) ? 1 : 0;
+}
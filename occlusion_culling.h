@@ -0,0 +1,84 @@
+/*!
+ * \file
+ * \ingroup display
+ * \brief Software occlusion culling of the main intersection list.
+ *
+ * The occluders of a map are read from the file \<map\>.occ, a text file
+ * with one box per line given as min and max (x, y, z), if it exists.
+ * Otherwise the large opaque, axis aligned 3d objects standing on the
+ * ground are used. Every time the main frustum changes, the occluders in
+ * view with the largest screen area are rasterized into a coarse depth
+ * buffer and the 2d objects, 3d objects and particle systems hidden
+ * behind them are removed from the intersection list.
+ */
+#ifndef	__OCCLUSION_CULLING_H__
+#define	__OCCLUSION_CULLING_H__
+
+#include "platform.h"
+#include "bbox_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int use_occlusion_culling; /*!< enables the occlusion culling */
+
+/*!
+ * \ingroup display
+ * \brief Selects the occluders of a map.
+ *
+ *      Loads the occluders of the map or selects them from the 3d objects
+ *      of the bbox tree. Must be called after the map is loaded.
+ *
+ * \param file_name	the file name of the map
+ * \callgraph
+ */
+void init_occluders(const char* file_name);
+
+/*!
+ * \ingroup display
+ * \brief Removes the occluders of the current map.
+ *
+ * \callgraph
+ */
+void clear_occluders();
+
+/*!
+ * \ingroup display
+ * \brief Frees the depth buffer and stops the rasterizer threads.
+ *
+ * \callgraph
+ */
+void free_occlusion_culling();
+
+/*!
+ * \ingroup display
+ * \brief Removes the hidden items from the current intersection list.
+ *
+ *      Rasterizes the occluders using the given view projection matrix and
+ *      removes all items of the current intersection list of the bbox tree
+ *      that are completely hidden by them.
+ *
+ * \param bbox_tree	the bbox tree to use
+ * \param clip		the view projection matrix
+ * \callgraph
+ */
+void cull_occluded_items(BBOX_TREE* bbox_tree, const MATRIX4x4 clip);
+
+/*!
+ * \ingroup display
+ * \brief Tests a box against the occluders.
+ *
+ *      Tests the box against the occluders last rasterized by
+ *      cull_occluded_items.
+ *
+ * \param bbox	the box to test
+ * \retval int	0 if the box is completely hidden, else 1.
+ */
+int aabb_not_occluded(const AABBOX bbox);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif	/* __OCCLUSION_CULLING_H__ */
@@ -1867,7 +1867,14 @@ int AMXAPI amx_PushString(AMX *amx, cell *amx_addr, cell **phys_addr, const char
      * supports this too.
      */
 
-#define NEXT(cip)       goto **cip++
+#define NEXT(cip)       goto *(void *)(intptr_t)*cip++
+
+/* The opcodes are relocated to the label addresses and NEXT() jumps
+ * through a cell, so a pointer must fit in a cell (a 64-bit target needs
+ * PAWN_CELL_SIZE 64). assert_static() divides by zero, which GCC accepts
+ * in an enum, so a negative array size is used.
+ */
+typedef char amx_cell_holds_pointer[(sizeof(cell)>=sizeof(void *)) ? 1 : -1];
 
 int AMXAPI amx_Exec(AMX *amx, cell *retval, int index)
 {
@@ -0,0 +1,286 @@
+#ifdef PAWN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "amx.h"
+#include "amxprof.h"
+
+#define PROFILE_TAG AMX_USERTAG('P','R','O','F')
+
+// the debug information that follows the program in an .amx file
+#define DBG_MAGIC 0xf1ef
+#define DBG_HEADER_SIZE 22
+
+static int AMXAPI profile_hook (AMX *amx)
+{
+	amx_profile *prof;
+	ucell pos;
+
+	if (amx_GetUserData (amx, PROFILE_TAG, (void **) &prof) != AMX_ERR_NONE || prof == NULL)
+		return AMX_ERR_NONE;
+
+	// cip is just past the BREAK instruction
+	pos = (ucell) amx->cip / sizeof (cell) - 1;
+	if (pos < (ucell) prof->nr_cells)
+		prof->counts[pos]++;
+	if (prof->current >= 0)
+		prof->public_counts[prof->current]++;
+
+	return AMX_ERR_NONE;
+}
+
+static void free_line_table (amx_profile *prof)
+{
+	int i;
+
+	for (i = 0; i < prof->nr_files; i++)
+		free (prof->file_names[i]);
+	free (prof->file_names);
+	free (prof->line_addresses);
+	free (prof->line_numbers);
+	free (prof->line_files);
+
+	prof->file_names = NULL;
+	prof->line_addresses = NULL;
+	prof->line_numbers = NULL;
+	prof->line_files = NULL;
+	prof->nr_files = 0;
+	prof->nr_lines = 0;
+}
+
+// Reads the file and line tables of the debug information. The other
+// tables are not needed for the profile.
+static int read_line_table (amx_profile *prof, const unsigned char *data, int size, int nr_files, int nr_lines)
+{
+	ucell address, *file_addresses;
+	int32_t line;
+	int pos = 0, i, ifile, len, ok = 0;
+
+	file_addresses = calloc (nr_files + 1, sizeof (ucell));
+	prof->file_names = calloc (nr_files + 1, sizeof (char *));
+	prof->line_addresses = calloc (nr_lines + 1, sizeof (ucell));
+	prof->line_numbers = calloc (nr_lines + 1, sizeof (int));
+	prof->line_files = calloc (nr_lines + 1, sizeof (int));
+	if (file_addresses == NULL || prof->file_names == NULL || prof->line_addresses == NULL
+		|| prof->line_numbers == NULL || prof->line_files == NULL)
+		goto out;
+
+	// the files, with the address of the first code of each
+	for (i = 0; i < nr_files; i++)
+	{
+		if (pos + (int) sizeof (ucell) > size)
+			goto out;
+		memcpy (&address, data + pos, sizeof (ucell));
+		amx_AlignCell (&address);
+		file_addresses[i] = address;
+		pos += sizeof (ucell);
+
+		for (len = 0; pos + len < size && data[pos + len] != '\0'; len++) ;
+		if (pos + len >= size)
+			goto out;
+		prof->file_names[i] = malloc (len + 1);
+		if (prof->file_names[i] == NULL)
+			goto out;
+		memcpy (prof->file_names[i], data + pos, len + 1);
+		prof->nr_files++;
+		pos += len + 1;
+	}
+
+	// the lines, sorted on address like the files
+	ifile = -1;
+	for (i = 0; i < nr_lines; i++)
+	{
+		if (pos + (int) (sizeof (ucell) + sizeof (int32_t)) > size)
+			goto out;
+		memcpy (&address, data + pos, sizeof (ucell));
+		memcpy (&line, data + pos + sizeof (ucell), sizeof (int32_t));
+		amx_AlignCell (&address);
+		amx_Align32 ((uint32_t *) &line);
+		pos += sizeof (ucell) + sizeof (int32_t);
+
+		while (ifile + 1 < nr_files && file_addresses[ifile + 1] <= address)
+			ifile++;
+
+		prof->line_addresses[i] = address;
+		prof->line_numbers[i] = line;
+		prof->line_files[i] = ifile;
+	}
+	prof->nr_lines = nr_lines;
+	ok = 1;
+
+out:
+	free (file_addresses);
+	return ok;
+}
+
+static int load_line_table (amx_profile *prof, const char *filename)
+{
+	FILE *fp;
+	AMX_HEADER hdr;
+	unsigned char dbg[DBG_HEADER_SIZE];
+	unsigned char *data;
+	int32_t size;
+	uint32_t code_size;
+	uint16_t magic;
+	int16_t nr_files, nr_lines;
+	int ok;
+
+	if (filename == NULL || (fp = fopen (filename, "rb")) == NULL)
+		return 0;
+
+	if (fread (&hdr, sizeof (hdr), 1, fp) != 1)
+	{
+		fclose (fp);
+		return 0;
+	}
+	// hdr is packed, so align a copy of the size
+	code_size = hdr.size;
+	amx_Align32 (&code_size);
+
+	// the debug information is right after the program
+	if (fseek (fp, code_size, SEEK_SET) != 0 || fread (dbg, sizeof (dbg), 1, fp) != 1)
+	{
+		fclose (fp);
+		return 0;
+	}
+
+	memcpy (&size, dbg, 4);
+	memcpy (&magic, dbg + 4, 2);
+	memcpy (&nr_files, dbg + 10, 2);
+	memcpy (&nr_lines, dbg + 12, 2);
+	amx_Align32 ((uint32_t *) &size);
+	amx_Align16 (&magic);
+	amx_Align16 ((uint16_t *) &nr_files);
+	amx_Align16 ((uint16_t *) &nr_lines);
+
+	if (magic != DBG_MAGIC || size <= DBG_HEADER_SIZE || nr_files < 0 || nr_lines < 0)
+	{
+		fclose (fp);
+		return 0;
+	}
+
+	size -= DBG_HEADER_SIZE;
+	data = malloc (size);
+	if (data == NULL)
+	{
+		fclose (fp);
+		return 0;
+	}
+
+	ok = fread (data, 1, size, fp) == (size_t) size
+		&& read_line_table (prof, data, size, nr_files, nr_lines);
+
+	free (data);
+	fclose (fp);
+
+	if (!ok)
+		free_line_table (prof);
+
+	return ok;
+}
+
+int amx_ProfInit (amx_profile *prof, AMX *amx, const char *filename)
+{
+	AMX_HEADER *hdr = (AMX_HEADER *) amx->base;
+
+	memset (prof, 0, sizeof (*prof));
+	prof->amx = amx;
+	prof->current = -1;
+	prof->nr_cells = (hdr->dat - hdr->cod) / sizeof (cell);
+	amx_NumPublics (amx, &prof->nr_publics);
+
+	prof->counts = calloc (prof->nr_cells + 1, sizeof (Uint32));
+	prof->public_calls = calloc (prof->nr_publics + 1, sizeof (Uint32));
+	prof->public_counts = calloc (prof->nr_publics + 1, sizeof (Uint32));
+	if (prof->counts == NULL || prof->public_calls == NULL || prof->public_counts == NULL)
+	{
+		amx_ProfCleanup (prof);
+		return AMX_ERR_MEMORY;
+	}
+
+	load_line_table (prof, filename);
+
+	return AMX_ERR_NONE;
+}
+
+void amx_ProfCleanup (amx_profile *prof)
+{
+	if (prof->amx != NULL)
+		amx_ProfStop (prof);
+
+	free_line_table (prof);
+	free (prof->counts);
+	free (prof->public_calls);
+	free (prof->public_counts);
+	memset (prof, 0, sizeof (*prof));
+	prof->current = -1;
+}
+
+int amx_ProfStart (amx_profile *prof)
+{
+	int err;
+
+	err = amx_SetUserData (prof->amx, PROFILE_TAG, prof);
+	if (err != AMX_ERR_NONE)
+		return err;
+
+	return amx_SetDebugHook (prof->amx, profile_hook);
+}
+
+int amx_ProfStop (amx_profile *prof)
+{
+	amx_SetDebugHook (prof->amx, NULL);
+	return amx_SetUserData (prof->amx, PROFILE_TAG, NULL);
+}
+
+void amx_ProfClear (amx_profile *prof)
+{
+	memset (prof->counts, 0, (prof->nr_cells + 1) * sizeof (Uint32));
+	memset (prof->public_calls, 0, (prof->nr_publics + 1) * sizeof (Uint32));
+	memset (prof->public_counts, 0, (prof->nr_publics + 1) * sizeof (Uint32));
+}
+
+int amx_ProfEnter (amx_profile *prof, int index)
+{
+	int previous = prof->current;
+
+	if (index >= 0 && index < prof->nr_publics)
+	{
+		prof->current = index;
+		prof->public_calls[index]++;
+	}
+
+	return previous;
+}
+
+void amx_ProfLeave (amx_profile *prof, int previous)
+{
+	prof->current = previous;
+}
+
+int amx_ProfFindLine (const amx_profile *prof, ucell address, const char **file, int *line)
+{
+	int low = 0, high = prof->nr_lines - 1, middle;
+
+	if (prof->nr_lines <= 0 || address < prof->line_addresses[0])
+		return -1;
+
+	// the last entry at or before the address
+	while (low < high)
+	{
+		middle = (low + high + 1) / 2;
+		if (prof->line_addresses[middle] <= address)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	*line = prof->line_numbers[low];
+	*file = prof->line_files[low] >= 0 && prof->line_files[low] < prof->nr_files
+		? prof->file_names[prof->line_files[low]] : "?";
+
+	return low;
+}
+
+#endif // PAWN
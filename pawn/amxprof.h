@@ -0,0 +1,70 @@
+#ifdef PAWN
+
+#ifndef AMXPROF_H
+#define AMXPROF_H
+
+#include "amx.h"
+
+/*
+ * A profile of a Pawn machine. The machine calls the debug hook at every
+ * BREAK instruction, which the compiler puts before each statement unless
+ * the script is compiled with -d0, so every statement that is executed is
+ * counted at its position in the code. The lines of the statements are
+ * only known when the script is compiled with -d2 or -d3.
+ */
+typedef struct
+{
+	AMX *amx;
+	int nr_cells;           // the size of the code in cells
+	Uint32 *counts;         // the number of times the statement at each cell was executed
+	int nr_publics;         // the number of public functions
+	int current;            // the public function that is running, or -1
+	Uint32 *public_calls;   // the number of calls of each public function
+	Uint32 *public_counts;  // the number of statements executed by each public function
+	int nr_lines;           // the number of entries in the line table
+	ucell *line_addresses;  // the code address of each entry in the line table
+	int *line_numbers;      // the line of each entry in the line table
+	int *line_files;        // the file of each entry in the line table
+	int nr_files;           // the number of source files
+	char **file_names;      // the name of each source file
+} amx_profile;
+
+/*
+ * Set up the profile of a machine, and read the lines of the code from the
+ * debug information in the file the script was loaded from, if it has any.
+ * Returns AMX_ERR_NONE or AMX_ERR_MEMORY.
+ */
+int amx_ProfInit (amx_profile *prof, AMX *amx, const char *filename);
+
+/* Stop counting and free the profile */
+void amx_ProfCleanup (amx_profile *prof);
+
+/* Start counting the statements of the machine */
+int amx_ProfStart (amx_profile *prof);
+
+/* Stop counting the statements of the machine */
+int amx_ProfStop (amx_profile *prof);
+
+/* Set all counts to zero */
+void amx_ProfClear (amx_profile *prof);
+
+/*
+ * Mark the start of a call of the public function index, the statements
+ * until amx_ProfLeave() are counted for it. Returns the function that was
+ * running before, to pass to amx_ProfLeave().
+ */
+int amx_ProfEnter (amx_profile *prof, int index);
+
+/* Mark the end of a call started with amx_ProfEnter() */
+void amx_ProfLeave (amx_profile *prof, int previous);
+
+/*
+ * Find the source file and line of the statement at a code address.
+ * Returns the index of the entry in the line table, or -1 if the script
+ * has no line information.
+ */
+int amx_ProfFindLine (const amx_profile *prof, ucell address, const char **file, int *line);
+
+#endif // AMXPROF_H
+
+#endif // PAWN
@@ -5,9 +5,12 @@
 #include "elpawn.h"
 #include "amx.h"
 #include "amxaux.h"
+#include "amxprof.h"
 
+#include "../asc.h"
 #include "../errors.h"
 #include "../events.h"
+#include "../text.h"
 
 // includes for our native functions
 #include "amxcons.h"
@@ -15,35 +18,51 @@
 #include "amxstring.h"
 #include "amxel.h"
 
+// the most arguments a Pawn function can be called with
+#define MAX_PAWN_ARGS 16
+
 // Set up our own struct with the information we need. We might be able 
 // to divine this from the AMX structure itself, but this is easier.
 typedef struct 
 {
 	int initialized; // 1 if the machine was succesfully initialized
+	int load;        // increased every time a script is loaded
 	size_t buf_size; // size of the memory buffer
 	void *buffer;    // memory buffer for the machine
 	AMX amx;         // representation of the actual machine
+	const char* file_name; // the file the script was loaded from
+	int profiling;   // 1 if the statements are counted
+	amx_profile profile; // the counted statements, if profile.amx is set
 } pawn_machine;
 
-typedef struct _pawn_timer_queue
+// A timer on the map machine. The timers are kept in a binary heap on
+// their ticks, so the first one is always at the top.
+typedef struct
 {
 	Uint32 ticks;
-	char* function;
 	Uint32 interval;
-	struct _pawn_timer_queue *next;
-} pawn_timer_queue;
+	int index;       // the index of the public function
+	char* function;
+} pawn_timer;
 
 // the machines themselves
-static pawn_machine srv_amx = {0, 0, NULL};
-static pawn_machine map_amx = {0, 0, NULL};
+static pawn_machine srv_amx = {0, 0, 0, NULL};
+static pawn_machine map_amx = {0, 0, 0, NULL};
 
-static pawn_timer_queue *map_timer_queue = NULL;
+static pawn_timer *map_timers = NULL;
+static int nr_map_timers = 0;
+static int map_timers_size = 0;
+// increased by clear_map_timers(), so a timer that clears the timers
+// is not scheduled again
+static Uint32 map_timers_cleared = 0;
 
 static __inline__ int ticks_less (Uint32 ticks, Uint32 limit)
 {
 	// try to adjust for timer wrap around. We'll assume that no events are
-	// planned more than 2*31 ms (a bit more than 24 days) in advance.
-	return ticks < limit || (((Sint32) limit) >= 0 && ((Sint32) ticks) < 0);
+	// planned more than 2*31 ms (a bit more than 24 days) in advance, so
+	// the difference of the ticks gives the order, also when the ticks
+	// wrap around between them.
+	return ((Sint32) (ticks - limit)) < 0;
 }
 
 static __inline__ int ticks_less_equal (Uint32 ticks, Uint32 limit)
@@ -56,57 +75,56 @@ static __inline__ int ticks_greater_equal (Uint32 ticks, Uint32 limit)
 	return !ticks_less (ticks, limit);
 }
 
-void pop_timer_queue (pawn_timer_queue **queue)
+static void move_timer_up (int i)
 {
-	if (*queue)
+	pawn_timer timer = map_timers[i];
+
+	while (i > 0 && ticks_less (timer.ticks, map_timers[(i-1)/2].ticks))
 	{
-		pawn_timer_queue *head = *queue;
-		*queue = head->next;
-		free (head->function);
-		free (head);
+		map_timers[i] = map_timers[(i-1)/2];
+		i = (i-1) / 2;
 	}
+	map_timers[i] = timer;
 }
 
-void insert_timer_queue_node (pawn_timer_queue **queue, pawn_timer_queue *new_node)
+static void move_timer_down (int i)
 {
-	
-	if (*queue == NULL || ticks_less_equal (new_node->ticks, (*queue)->ticks))
-	{
-		new_node->next = *queue;
-		*queue = new_node;
-	}
-	else
+	pawn_timer timer = map_timers[i];
+	int child;
+
+	while ((child = 2*i + 1) < nr_map_timers)
 	{
-		pawn_timer_queue* node = *queue;
-		while (node->next && ticks_less (node->next->ticks, new_node->ticks))
-			node = node->next;
-		new_node->next = node->next;
-		node->next = new_node;
+		if (child+1 < nr_map_timers && ticks_less (map_timers[child+1].ticks, map_timers[child].ticks))
+			child++;
+		if (!ticks_less (map_timers[child].ticks, timer.ticks))
+			break;
+		map_timers[i] = map_timers[child];
+		i = child;
 	}
+	map_timers[i] = timer;
 }
 
-void reschedule_timer_queue_head (pawn_timer_queue **queue, Uint32 diff)
+static void push_timer (const pawn_timer *timer)
 {
-	pawn_timer_queue *head = *queue;
-	
-	if (head)
+	if (nr_map_timers >= map_timers_size)
 	{
-		head->ticks += diff;
-		if (head->next && ticks_less (head->next->ticks, head->ticks))
-		{
-			*queue = head->next;
-			insert_timer_queue_node (queue, head);
-		}
+		map_timers_size += 16;
+		map_timers = realloc (map_timers, map_timers_size * sizeof (pawn_timer));
 	}
+
+	map_timers[nr_map_timers++] = *timer;
+	move_timer_up (nr_map_timers-1);
 }
 
-void push_timer_queue (pawn_timer_queue **queue, Uint32 ticks, const char* function, Uint32 interval)
+// removes the first timer, the caller gets its function name
+static void pop_timer (pawn_timer *timer)
 {
-	pawn_timer_queue* new_node = calloc (1, sizeof (pawn_timer_queue));
-	new_node->ticks = ticks;
-	new_node->function = strdup (function);
-	new_node->interval = interval;
-	insert_timer_queue_node (queue, new_node);
+	*timer = map_timers[0];
+	if (--nr_map_timers > 0)
+	{
+		map_timers[0] = map_timers[nr_map_timers];
+		move_timer_down (0);
+	}
 }
 
 int initialize_pawn_machine (pawn_machine *machine, const char* fname)
@@ -120,14 +138,14 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	memsize = aux_ProgramSize (fname);
 	if (memsize == 0)
 	{
-		log_error ("Unable to determine memory size for Pawn file %s", fname);
+		LOG_ERROR ("Unable to determine memory size for Pawn file %s", fname);
 		return 0;
 	}
 
 	buffer = malloc (memsize);
 	if (buffer == NULL)
 	{
-		log_error ("unable to allocate memory for Pawn file %s", fname);
+		LOG_ERROR ("unable to allocate memory for Pawn file %s", fname);
 		return 0;
 	}
 
@@ -135,7 +153,7 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	if (err != AMX_ERR_NONE)
 	{
 		free (buffer);
-		log_error ("unable to load Pawn file %s", fname);
+		LOG_ERROR ("unable to load Pawn file %s", fname);
 		return 0;
 	}
 
@@ -149,13 +167,16 @@ int initialize_pawn_machine (pawn_machine *machine, const char* fname)
 	if (err != AMX_ERR_NONE)
 	{
 		free (buffer);
-		log_error ("Unable to initialize all native functions for Pawn file %s", fname);
+		LOG_ERROR ("Unable to initialize all native functions for Pawn file %s", fname);
 		return 0;
 	}
 
 	machine->buf_size = memsize;
 	machine->buffer = buffer;
+	machine->file_name = fname;
 	machine->initialized = 1;
+	// the indices of prepared calls are looked up again
+	machine->load++;
 
 	return 1;
 }
@@ -169,6 +190,10 @@ int initialize_pawn ()
 
 void cleanup_pawn_machine (pawn_machine *machine)
 {
+	if (machine->profile.amx)
+		amx_ProfCleanup (&(machine->profile));
+	machine->profiling = 0;
+
 	if (machine->initialized)
 	{
 		amx_ElCleanup (&(machine->amx));
@@ -189,103 +214,171 @@ void cleanup_pawn_machine (pawn_machine *machine)
 
 void cleanup_pawn ()
 {
+	clear_map_timers ();
+	free (map_timers);
+	map_timers = NULL;
+	map_timers_size = 0;
+
 	cleanup_pawn_machine (&srv_amx);
 	cleanup_pawn_machine (&map_amx);
 }
 
-int run_pawn_function (pawn_machine *machine, const char* fun, const char* fmt, va_list ap)
+// returns the number of arguments, or -1 if the format is wrong
+static int check_pawn_format (const char *fmt)
 {
-	int err = AMX_ERR_NONE, index=-1;
-	int nr_ref_args = 0, ref_args_size = 0;
-	cell *ref_args = NULL;
 	int nr_args;
 
+	if (fmt == NULL)
+		return 0;
+
+	for (nr_args = 0; fmt[nr_args] != '\0'; nr_args++)
+	{
+		if (nr_args >= MAX_PAWN_ARGS)
+		{
+			LOG_ERROR ("too many arguments in Pawn call");
+			return -1;
+		}
+		if (fmt[nr_args] != 'i' && fmt[nr_args] != 'f' && fmt[nr_args] != 's')
+		{
+			LOG_ERROR ("unknown format specifier '%c' in Pawn call", fmt[nr_args]);
+			return -1;
+		}
+	}
+
+	return nr_args;
+}
+
+static int find_pawn_function (pawn_machine *machine, const char* fun, int *index)
+{
 	if (!machine->initialized)
 	{
-		log_error ("Unable to execute Pawn function: machine not initialized");
+		LOG_ERROR ("Unable to execute Pawn function: machine not initialized");
 		return 0;
 	}
 
-	err = amx_FindPublic (&(machine->amx), fun, &index);
-	if (err != AMX_ERR_NONE)
+	if (amx_FindPublic (&(machine->amx), fun, index) != AMX_ERR_NONE)
 	{
-		log_error ("Unable to locate Pawn function %s", fun);
+		LOG_ERROR ("Unable to locate Pawn function %s", fun);
 		return 0;
 	}
 
-	if (fmt != NULL && (nr_args = strlen (fmt)) > 0)
+	return 1;
+}
+
+static void read_pawn_args (const char* fmt, int nr_args, va_list ap, cell *args, const char** strings)
+{
+	REAL f;
+	int iarg;
+
+	for (iarg = 0; iarg < nr_args; iarg++)
 	{
-		char c;
-		const char *s;
-		int i;
-		REAL f;
-		cell *phys;
-		int iarg;
-		cell *args = calloc (nr_args, sizeof (cell));
-		
-		// first store the arguments in the array
-		for (iarg = 0; iarg < nr_args; iarg++)
+		switch (fmt[iarg])
 		{
-			switch (fmt[iarg])
-			{
-				case 'i':
-					i = va_arg (ap, int);
-					args[iarg] = (cell) i;
-					break;
-				case 'f':
-					f = va_arg (ap, REAL);
-					args[iarg] = *((cell*) &f);
-					break;
-				case 's':
-					s = va_arg (ap, const char*);
-					args[iarg] = (cell) s;
-					break;
-				default:
-					log_error ("unknown format specifier '%c' in Pawn call", c);
-					free (args);
-					return 1;
-			}
+			case 'i':
+				args[iarg] = (cell) va_arg (ap, int);
+				break;
+			case 'f':
+				f = va_arg (ap, REAL);
+				args[iarg] = *((cell*) &f);
+				break;
+			case 's':
+				strings[iarg] = va_arg (ap, const char*);
+				break;
 		}
-		
-		// now push the arguments to Pawn, in reverse order
-		for (iarg = nr_args-1; iarg >= 0; iarg--)
+	}
+}
+
+static int exec_pawn_function (pawn_machine *machine, int index, const char* fun, const char* fmt, int nr_args, const cell *args, const char** strings)
+{
+	AMX *amx = &(machine->amx);
+	cell heap;
+	int iarg, err = AMX_ERR_NONE;
+
+	if (!machine->initialized)
+	{
+		LOG_ERROR ("Unable to execute Pawn function: machine not initialized");
+		return 0;
+	}
+
+	// The strings are put on the heap of the machine. Everything above
+	// this mark is released after the call, so every call uses the same
+	// heap space.
+	heap = amx->hea;
+
+	// now push the arguments to Pawn, in reverse order
+	for (iarg = nr_args-1; iarg >= 0 && err == AMX_ERR_NONE; iarg--)
+	{
+		if (fmt[iarg] == 's')
+			err = amx_PushString (amx, NULL, NULL, strings[iarg], 0, 0);
+		else
+			err = amx_Push (amx, args[iarg]);
+	}
+
+	if (err == AMX_ERR_NONE)
+	{
+		if (machine->profiling)
 		{
-			if (fmt[iarg] == 'i' || fmt[iarg] == 'f')
-			{			
-				amx_Push (&(machine->amx), args[iarg]);
-			}
-			else if (fmt[iarg] == 's')
-			{
-				if (nr_ref_args >= ref_args_size)
-				{
-					ref_args_size += 8;
-					ref_args = realloc (ref_args, ref_args_size * sizeof (cell));
-				}
-				amx_PushString (&(machine->amx), ref_args+nr_ref_args, &phys, (const char *)args[iarg], 0, 0);
-				nr_ref_args++;
-			}
+			int previous = amx_ProfEnter (&(machine->profile), index);
+			err = amx_Exec (amx, NULL, index);
+			amx_ProfLeave (&(machine->profile), previous);
+		}
+		else
+		{
+			err = amx_Exec (amx, NULL, index);
 		}
-		
-		// we're done with these
-		free (args);
 	}
+	else
+	{
+		// drop the arguments that were pushed
+		amx->stk += amx->paramcount * sizeof (cell);
+		amx->paramcount = 0;
+	}
+
+	amx_Release (amx, heap);
 
-	err = amx_Exec (&(machine->amx), NULL, index);
 	if (err != AMX_ERR_NONE)
 	{
-		log_error ("Error %d executing Pawn function %s", err, fun);
+		LOG_ERROR ("Error %d executing Pawn function %s", err, fun);
 		return 0;
 	}
 
-	if (ref_args)
+	return 1;
+}
+
+int run_pawn_function (pawn_machine *machine, const char* fun, const char* fmt, va_list ap)
+{
+	cell args[MAX_PAWN_ARGS];
+	const char* strings[MAX_PAWN_ARGS];
+	int index, nr_args;
+
+	nr_args = check_pawn_format (fmt);
+	if (nr_args < 0 || !find_pawn_function (machine, fun, &index))
+		return 0;
+
+	read_pawn_args (fmt, nr_args, ap, args, strings);
+	return exec_pawn_function (machine, index, fun, fmt, nr_args, args, strings);
+}
+
+int run_pawn_call (pawn_call *call, ...)
+{
+	pawn_machine *machine = call->map ? &map_amx : &srv_amx;
+	cell args[MAX_PAWN_ARGS];
+	const char* strings[MAX_PAWN_ARGS];
+	va_list ap;
+
+	if (call->load != machine->load || !machine->initialized)
 	{
-		int i;
-		for (i = 0; i < nr_ref_args; i++)
-			amx_Release (&(machine->amx), ref_args[i]);
-		free (ref_args);
+		call->nr_args = check_pawn_format (call->fmt);
+		if (call->nr_args < 0 || !find_pawn_function (machine, call->fun, &call->index))
+			return 0;
+		call->load = machine->load;
 	}
 
-	return 1;
+	va_start (ap, call);
+	read_pawn_args (call->fmt, call->nr_args, ap, args, strings);
+	va_end (ap);
+
+	return exec_pawn_function (machine, call->index, call->fun, call->fmt, call->nr_args, args, strings);
 }
 
 int run_pawn_server_function (const char *fun, const char* fmt, ...)
@@ -312,9 +405,228 @@ int run_pawn_map_function (const char* fun, const char* fmt, ...)
 	return res;
 }
 
+static int time_pawn_calls (int prepared, int count, Uint32 *time)
+{
+	static pawn_call call = PAWN_MAP_CALL ("benchmark", "is");
+	Uint32 start = SDL_GetTicks ();
+	int i, ok = 1;
+
+	for (i = 0; i < count && ok; i++)
+	{
+		if (prepared)
+			ok = run_pawn_call (&call, i, "benchmark");
+		else
+			ok = run_pawn_map_function ("benchmark", "is", i, "benchmark");
+	}
+
+	*time = SDL_GetTicks () - start;
+	if (*time == 0)
+		*time = 1;
+
+	return ok;
+}
+
+int command_pawn_benchmark (char *text, int len)
+{
+	static pawn_call primes = PAWN_MAP_CALL ("benchmark_primes", "i");
+	char str[256];
+	Uint32 times[2], start;
+	int count;
+
+	count = atoi (text);
+	if (count <= 0)
+		count = 100000;
+
+	if (!time_pawn_calls (0, count, &times[0]) || !time_pawn_calls (1, count, &times[1]))
+	{
+		LOG_TO_CONSOLE (c_red1, "The map script has no public benchmark (number, const name[]) function");
+		return 1;
+	}
+
+	safe_snprintf (str, sizeof (str), "%d calls: %.0f/s by name, %.0f/s prepared",
+		count, count * 1000.0 / times[0], count * 1000.0 / times[1]);
+	LOG_TO_CONSOLE (c_green1, str);
+
+	// a script that only runs in the interpreter, without natives
+	start = SDL_GetTicks ();
+	if (run_pawn_call (&primes, 100000))
+	{
+		safe_snprintf (str, sizeof (str), "primes below 100000: %d ms", SDL_GetTicks () - start);
+		LOG_TO_CONSOLE (c_green1, str);
+	}
+
+	return 1;
+}
+
+typedef struct
+{
+	Uint32 count;
+	int id;
+} pawn_profile_entry;
+
+static int compare_profile_entries (const void *a, const void *b)
+{
+	const pawn_profile_entry *ea = a, *eb = b;
+
+	if (ea->count != eb->count)
+		return ea->count < eb->count ? 1 : -1;
+	return ea->id - eb->id;
+}
+
+#define PROFILE_ENTRIES_SHOWN 10
+
+static void show_pawn_profile (pawn_machine *machine, const char *title)
+{
+	const amx_profile *prof = &(machine->profile);
+	pawn_profile_entry *entries;
+	char name[sNAMEMAX+1];
+	char str[256];
+	const char *file;
+	int i, nr_entries, nr_lines, line;
+	Uint32 total = 0;
+
+	for (i = 0; i < prof->nr_cells; i++)
+		total += prof->counts[i];
+
+	safe_snprintf (str, sizeof (str), "%s: %u statements", title, total);
+	LOG_TO_CONSOLE (c_green1, str);
+	if (total == 0)
+	{
+		// the compiler leaves the BREAK instructions out with -d0
+		LOG_TO_CONSOLE (c_red1, "No statements counted, the script may be compiled with -d0");
+		return;
+	}
+
+	// the public functions the statements were run from
+	nr_entries = prof->nr_publics > prof->nr_cells ? prof->nr_publics : prof->nr_cells;
+	entries = calloc (nr_entries + 1, sizeof (pawn_profile_entry));
+	if (entries == NULL)
+		return;
+
+	for (i = 0; i < prof->nr_publics; i++)
+	{
+		entries[i].count = prof->public_counts[i];
+		entries[i].id = i;
+	}
+	qsort (entries, prof->nr_publics, sizeof (pawn_profile_entry), compare_profile_entries);
+
+	for (i = 0; i < prof->nr_publics && i < PROFILE_ENTRIES_SHOWN && entries[i].count > 0; i++)
+	{
+		amx_GetPublic (prof->amx, entries[i].id, name);
+		safe_snprintf (str, sizeof (str), "  %s: %u calls, %u statements",
+			name, prof->public_calls[entries[i].id], entries[i].count);
+		LOG_TO_CONSOLE (c_grey1, str);
+	}
+
+	// the hottest lines, or code positions without line information
+	nr_lines = prof->nr_lines > 0 ? prof->nr_lines : prof->nr_cells;
+	memset (entries, 0, nr_entries * sizeof (pawn_profile_entry));
+	for (i = 0; i < nr_lines; i++)
+		entries[i].id = i;
+	for (i = 0; i < prof->nr_cells; i++)
+	{
+		if (prof->counts[i] == 0)
+			continue;
+		if (prof->nr_lines > 0)
+		{
+			int entry = amx_ProfFindLine (prof, i * sizeof (cell), &file, &line);
+			if (entry >= 0)
+				entries[entry].count += prof->counts[i];
+		}
+		else
+		{
+			entries[i].count = prof->counts[i];
+		}
+	}
+	qsort (entries, nr_lines, sizeof (pawn_profile_entry), compare_profile_entries);
+
+	for (i = 0; i < nr_lines && i < PROFILE_ENTRIES_SHOWN && entries[i].count > 0; i++)
+	{
+		if (prof->nr_lines > 0)
+		{
+			file = prof->line_files[entries[i].id] >= 0 ? prof->file_names[prof->line_files[entries[i].id]] : "?";
+			safe_snprintf (str, sizeof (str), "  %s:%d: %u (%.1f%%)", file,
+				prof->line_numbers[entries[i].id], entries[i].count, entries[i].count * 100.0 / total);
+		}
+		else
+		{
+			safe_snprintf (str, sizeof (str), "  code 0x%x: %u (%.1f%%)", (unsigned int) (entries[i].id * sizeof (cell)),
+				entries[i].count, entries[i].count * 100.0 / total);
+		}
+		LOG_TO_CONSOLE (c_grey1, str);
+	}
+	if (prof->nr_lines == 0)
+		LOG_TO_CONSOLE (c_grey1, "Compile the script with -d2 for the lines of the statements");
+
+	free (entries);
+}
+
+static void start_pawn_profile (pawn_machine *machine)
+{
+	if (!machine->initialized || machine->profiling)
+		return;
+
+	if (machine->profile.amx == NULL
+		&& amx_ProfInit (&(machine->profile), &(machine->amx), machine->file_name) != AMX_ERR_NONE)
+		return;
+
+	if (amx_ProfStart (&(machine->profile)) == AMX_ERR_NONE)
+		machine->profiling = 1;
+}
+
+static void stop_pawn_profile (pawn_machine *machine)
+{
+	if (machine->profiling)
+	{
+		amx_ProfStop (&(machine->profile));
+		machine->profiling = 0;
+	}
+}
+
+int command_pawn_profile (char *text, int len)
+{
+	char what[16];
+
+	if (sscanf (text, " %15s", what) != 1)
+		what[0] = '\0';
+
+	if (strcmp (what, "start") == 0)
+	{
+		start_pawn_profile (&srv_amx);
+		start_pawn_profile (&map_amx);
+		LOG_TO_CONSOLE (c_green1, "Counting the statements of the Pawn scripts");
+	}
+	else if (strcmp (what, "stop") == 0)
+	{
+		stop_pawn_profile (&srv_amx);
+		stop_pawn_profile (&map_amx);
+		LOG_TO_CONSOLE (c_green1, "Stopped counting the statements of the Pawn scripts");
+	}
+	else if (strcmp (what, "clear") == 0)
+	{
+		if (srv_amx.profile.amx)
+			amx_ProfClear (&(srv_amx.profile));
+		if (map_amx.profile.amx)
+			amx_ProfClear (&(map_amx.profile));
+	}
+	else if (srv_amx.profile.amx || map_amx.profile.amx)
+	{
+		if (srv_amx.profile.amx)
+			show_pawn_profile (&srv_amx, "Server script");
+		if (map_amx.profile.amx)
+			show_pawn_profile (&map_amx, "Map script");
+	}
+	else
+	{
+		LOG_TO_CONSOLE (c_red1, "Start the profile with #pawn_profile start");
+	}
+
+	return 1;
+}
+
 void check_pawn_timers ()
 {
-	if (map_timer_queue && ticks_less_equal (map_timer_queue->ticks, SDL_GetTicks ()))
+	if (nr_map_timers > 0 && ticks_less_equal (map_timers[0].ticks, SDL_GetTicks ()))
 	{
 		SDL_Event event;
 		event.type = SDL_USEREVENT;
@@ -326,25 +638,49 @@ void check_pawn_timers ()
 void handle_pawn_timers ()
 {
 	Uint32 now = SDL_GetTicks ();
-	while (map_timer_queue && ticks_less_equal (map_timer_queue->ticks, now))
+	Uint32 cleared;
+	pawn_timer timer;
+	int ok;
+
+	while (nr_map_timers > 0 && ticks_less_equal (map_timers[0].ticks, now))
 	{
-		int ok = run_pawn_map_function (map_timer_queue->function, NULL);
-		if (ok && map_timer_queue->interval)
-			reschedule_timer_queue_head (&map_timer_queue, map_timer_queue->interval);
+		// the function may add or clear timers itself, so take the
+		// timer from the queue first
+		pop_timer (&timer);
+		cleared = map_timers_cleared;
+
+		ok = exec_pawn_function (&map_amx, timer.index, timer.function, NULL, 0, NULL, NULL);
+		if (ok && timer.interval && cleared == map_timers_cleared)
+		{
+			timer.ticks += timer.interval;
+			push_timer (&timer);
+		}
 		else
-			pop_timer_queue (&map_timer_queue);
+		{
+			free (timer.function);
+		}
 	}
 }
 
 void add_map_timer (Uint32 offset, const char* name, Uint32 interval)
 {
-	push_timer_queue (&map_timer_queue, SDL_GetTicks () + offset, name, interval);
+	pawn_timer timer;
+
+	// look the function up once, not every time the timer fires
+	if (!find_pawn_function (&map_amx, name, &timer.index))
+		return;
+
+	timer.ticks = SDL_GetTicks () + offset;
+	timer.interval = interval;
+	timer.function = strdup (name);
+	push_timer (&timer);
 }
 
 void clear_map_timers ()
 {
-	while (map_timer_queue)
-		pop_timer_queue (&map_timer_queue);
+	while (nr_map_timers > 0)
+		free (map_timers[--nr_map_timers].function);
+	map_timers_cleared++;
 }
 
 #endif // PAWN
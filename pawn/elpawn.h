@@ -5,6 +5,24 @@
 
 #include <SDL_types.h>
 
+/*!
+ * A public Pawn function that is looked up when it is first run, and again
+ * only when a new script is loaded. Initialize it with PAWN_SERVER_CALL()
+ * or PAWN_MAP_CALL().
+ */
+typedef struct
+{
+	const char* fun; /*!< the name of the function */
+	const char* fmt; /*!< the types of the parameters, see run_pawn_server_function() */
+	int map;         /*!< 1 to run it on the map machine, 0 for the server machine */
+	int load;        /*!< the script load the index was looked up for */
+	int index;       /*!< the index of the public function */
+	int nr_args;     /*!< the number of parameters */
+} pawn_call;
+
+#define PAWN_SERVER_CALL(fun, fmt) { fun, fmt, 0, 0, -1, 0 }
+#define PAWN_MAP_CALL(fun, fmt) { fun, fmt, 1, 0, -1, 0 }
+
 /*!
  * \brief Initialize the Pawn Abstract Machines
  *
@@ -36,6 +54,7 @@ void cleanup_pawn ();
  * \li \c 'i' for an \c int parameter
  * \li \c 'f' for a floating point parameter (\c float on 32 bit systems, 
  *     \c double on 64 bit systems.
+ * \li \c 's' for a string parameter
  *
  * \param name The name of the function to run
  * \param fmt  A string describing the types of the parameters that follow
@@ -60,6 +79,44 @@ int run_pawn_server_function (const char* fun, const char* fmt, ...);
  */
 int run_pawn_map_function (const char* fun, const char* fmt, ...);
 
+/*!
+ * \brief Execute a prepared function
+ *
+ * Execute the Pawn public function of \a call on its machine. The function
+ * is only looked up by name the first time, and the parameters are
+ * pushed without allocating memory.
+ *
+ * \param call The function to run, with the parameters following it
+ * \retval int 1 on succes, 0 on failure
+ * \sa run_pawn_server_function(), run_pawn_map_function()
+ */
+int run_pawn_call (pawn_call *call, ...);
+
+/*!
+ * \brief Time Pawn calls
+ *
+ * Call the public function benchmark of the map script a number of times,
+ * both by name and prepared, and print the calls per second. Then time
+ * the public function benchmark_primes, which only runs Pawn code.
+ * \param text The number of calls, 100000 if it's empty
+ * \param len  The length of \a text
+ * \retval int Always 1
+ */
+int command_pawn_benchmark (char *text, int len);
+
+/*!
+ * \brief Profile the Pawn scripts
+ *
+ * With "start", count the statements the Pawn machines execute, with
+ * "stop" stop counting and with "clear" set the counts to zero. Without
+ * a parameter, print the public functions and the lines that executed the
+ * most statements.
+ * \param text What to do
+ * \param len  The length of \a text
+ * \retval int Always 1
+ */
+int command_pawn_profile (char *text, int len);
+
 /*!
  * \brief Checks the Pawn timer queue to see if a callback needs to be executed
  *
@@ -22,3 +22,33 @@ public play_with_object_pos (id, add)
 		rotate_object (id, 0.0, 12.0, 0.0)
 }
 
+// Does nothing, it is called by #pawn_bench to time the calls
+public benchmark (number, const name[])
+{
+	return number + name[0]
+}
+
+// Counts the primes below limit, it is timed by #pawn_bench
+public benchmark_primes (limit)
+{
+	new count = 0
+
+	for (new i = 2; i < limit; i++)
+	{
+		new bool:prime = true
+
+		for (new j = 2; j * j <= i; j++)
+		{
+			if (i % j == 0)
+			{
+				prime = false
+				break
+			}
+		}
+
+		if (prime)
+			count++
+	}
+
+	return count
+}
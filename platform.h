@@ -176,4 +176,6 @@ static __inline__ double trunc(const double d)
 } // extern "C"
 #endif
 
+#include "gl_state.h"
+
 #endif // PLATFORM_H
@@ -23,6 +23,12 @@
 #include "tiles.h"
 #include "weather.h"
 #include "io/e3d_io.h"
+#ifdef	SHADOW_MAP_CACHE
+#include "asc.h"
+#include "console.h"
+#include "errors.h"
+#include "misc.h"
+#endif	/* SHADOW_MAP_CACHE */
 
 #ifdef OSX
 #define GL_EXT_texture_env_combine 1
@@ -54,6 +60,25 @@ GLfloat light_view_bottom=-10.0;
 GLfloat light_view_near=-30.0;
 GLfloat light_view_far=6.0;
 
+#ifdef	SHADOW_MAP_CACHE
+/* The static objects are rendered into their own depth map, that is only
+ * rebuilt if the light direction changes by more than about one degree
+ * or the camera leaves the margin the light frustum was enlarged by. The
+ * actors are drawn on top of a copy of it every frame. */
+#define	SHADOW_CACHE_MARGIN	3.0f
+#define	SHADOW_CACHE_MIN_COS	0.99985f
+
+int use_shadow_map_cache = 1;
+static GLuint static_shadow_fbo = 0;
+static GLuint static_depth_map_id = 0;
+static int shadow_cache_valid = 0;
+static float shadow_cache_light_dir[3] = { 0.0f, 0.0f, 0.0f };
+static Uint32 shadow_time = 0;
+static Uint32 shadow_frames = 0;
+static Uint32 shadow_cache_rebuilds = 0;
+#endif	/* SHADOW_MAP_CACHE */
+static float shadow_anchor[3] = { 0.0f, 0.0f, 0.0f };
+
 #ifdef  DEBUG
 extern int e3d_count, e3d_total;    // LRNR:stats testing only
 extern int cur_e3d_count;
@@ -63,6 +88,10 @@ extern e3d_object   *cur_e3d;
 void free_shadow_framebuffer()
 {
 	free_depth_framebuffer(&shadow_fbo, &depth_map_id);
+#ifdef	SHADOW_MAP_CACHE
+	free_depth_framebuffer(&static_shadow_fbo, &static_depth_map_id);
+	shadow_cache_valid = 0;
+#endif	/* SHADOW_MAP_CACHE */
 }
 
 void make_shadow_framebuffer()
@@ -73,7 +102,43 @@ void make_shadow_framebuffer()
 void change_shadow_framebuffer_size()
 {
 	change_depth_framebuffer_size(shadow_map_size, shadow_map_size, &shadow_fbo, &depth_map_id);
+#ifdef	SHADOW_MAP_CACHE
+	if (static_shadow_fbo != 0)
+	{
+		change_depth_framebuffer_size(shadow_map_size, shadow_map_size, &static_shadow_fbo, &static_depth_map_id);
+	}
+	shadow_cache_valid = 0;
+#endif	/* SHADOW_MAP_CACHE */
+}
+
+#ifdef	SHADOW_MAP_CACHE
+void invalidate_shadow_cache()
+{
+	shadow_cache_valid = 0;
+}
+
+int command_shadow_stats(char *text, int len)
+{
+	char str[200];
+
+	if (shadow_frames == 0)
+	{
+		LOG_TO_CONSOLE(c_green1, "No shadow maps rendered yet.");
+		return 1;
+	}
+
+	safe_snprintf(str, sizeof(str), "Shadow map: %.2f ms per frame over %d frames, cache %s, %d rebuilds",
+		(float)shadow_time / shadow_frames, shadow_frames,
+		(use_shadow_map_cache && use_frame_buffer) ? "on" : "off", shadow_cache_rebuilds);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	shadow_time = 0;
+	shadow_frames = 0;
+	shadow_cache_rebuilds = 0;
+
+	return 1;
 }
+#endif	/* SHADOW_MAP_CACHE */
 
 void calc_light_frustum(float light_xrot)
 {
@@ -102,6 +167,17 @@ void calc_light_frustum(float light_xrot)
 	x=100.0f*slight;  // A bit better than the real value (infinity)
 	y=max_height*clight;
 	light_view_near=-sqrt(x*x+y*y);
+#ifdef	SHADOW_MAP_CACHE
+	if (use_shadow_map_cache && use_frame_buffer)
+	{
+		// the camera can move this far before the cached map gets rebuilt
+		light_view_hscale+=SHADOW_CACHE_MARGIN;
+		light_view_top+=SHADOW_CACHE_MARGIN;
+		light_view_bottom-=SHADOW_CACHE_MARGIN;
+		light_view_near-=SHADOW_CACHE_MARGIN;
+		light_view_far+=SHADOW_CACHE_MARGIN;
+	}
+#endif	/* SHADOW_MAP_CACHE */
 }
 
 void calc_shadow_matrix()
@@ -133,6 +209,20 @@ void calc_shadow_matrix()
 #else
 			zrot=-90.0f-atan2f(light_pos[1],light_pos[0])*180.0f/(float)M_PI;
 #endif
+#ifdef	SHADOW_MAP_CACHE
+			if (use_shadow_map_cache && use_frame_buffer)
+			{
+				// keep the matrices of the cached map for small movements of the sun
+				if (shadow_cache_valid && (light_pos[0]*shadow_cache_light_dir[0]+
+					light_pos[1]*shadow_cache_light_dir[1]+
+					light_pos[2]*shadow_cache_light_dir[2] > SHADOW_CACHE_MIN_COS))
+				{
+					return;
+				}
+				memcpy(shadow_cache_light_dir, light_pos, 3*sizeof(float));
+				shadow_cache_valid = 0;
+			}
+#endif	/* SHADOW_MAP_CACHE */
 
 			glPushMatrix();
 			glLoadIdentity();
@@ -287,10 +377,8 @@ void draw_3d_object_shadows(unsigned int object_type)
 	cur_e3d= NULL;
 }
 
-void display_shadows()
+static void display_static_shadows()
 {
-	glEnable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(1.05f, 2.0f);
 	glEnable(GL_CULL_FACE);
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glDisable(GL_COLOR_MATERIAL);
@@ -313,6 +401,10 @@ void display_shadows()
 	glDisableClientState(GL_COLOR_ARRAY);
 	glDisableClientState(GL_NORMAL_ARRAY);
 	glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+static void display_dynamic_shadows()
+{
 	glDisable(GL_CULL_FACE);
 	glCullFace(GL_FRONT);
 
@@ -320,6 +412,14 @@ void display_shadows()
 	display_actors(0, DEPTH_RENDER_PASS);
 #endif
 	glCullFace(GL_BACK);
+}
+
+void display_shadows()
+{
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.05f, 2.0f);
+	display_static_shadows();
+	display_dynamic_shadows();
 	glDisable(GL_POLYGON_OFFSET_FILL);
 #ifdef OPENGL_TRACE
 CHECK_GL_ERRORS();
@@ -417,9 +517,125 @@ CHECK_GL_ERRORS();
 #endif //OPENGL_TRACE
 }
 
+#ifdef	SHADOW_MAP_CACHE
+static void begin_light_view(GLuint fbo, GLuint texture, int clear)
+{
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+	ELglFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_TEXTURE_2D, texture, 0);
+	if (clear) glClear(GL_DEPTH_BUFFER_BIT);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	CHECK_GL_ERRORS();
+	CHECK_FBO_ERRORS();
+
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+
+	glViewport(0,0,shadow_map_size,shadow_map_size);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(1, 1, shadow_map_size-2, shadow_map_size-2);
+
+	glDisable(GL_LIGHTING);
+	glEnable(GL_DEPTH_TEST);
+#ifndef MAP_EDITOR2
+	if (use_fog) glDisable(GL_FOG);
+#endif
+	glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.05f, 2.0f);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadMatrixd(light_proj_mat);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadMatrixd(light_view_mat);
+	glTranslatef(shadow_anchor[0], shadow_anchor[1], shadow_anchor[2]);
+	CHECK_GL_ERRORS();
+}
+
+static void end_light_view()
+{
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+	glBindTexture(GL_TEXTURE_2D,0);
+	last_texture=-1;
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+	glDrawBuffer(GL_BACK);
+	glReadBuffer(GL_BACK);
+	CHECK_GL_ERRORS();
+	CHECK_FBO_ERRORS();
+}
+
+static void render_cached_light_view()
+{
+	unsigned int cur_intersect_type;
+	float dx, dy, dz;
+
+	if (static_shadow_fbo == 0)
+	{
+		make_depth_framebuffer(shadow_map_size, shadow_map_size, &static_shadow_fbo, &static_depth_map_id);
+		shadow_cache_valid = 0;
+	}
+
+	dx = camera_x-shadow_anchor[0];
+	dy = camera_y-shadow_anchor[1];
+	dz = camera_z-shadow_anchor[2];
+
+	// the light view is rotated, so the camera may move as far as the
+	// margin in any direction, not on each axis
+	if ((dx*dx+dy*dy+dz*dz) > (SHADOW_CACHE_MARGIN*SHADOW_CACHE_MARGIN))
+	{
+		shadow_cache_valid = 0;
+	}
+
+	cur_intersect_type = get_cur_intersect_type(main_bbox_tree);
+	set_cur_intersect_type(main_bbox_tree, INTERSECTION_TYPE_SHADOW);
+
+	if (!shadow_cache_valid)
+	{
+		shadow_anchor[0] = (int)camera_x;
+		shadow_anchor[1] = (int)camera_y;
+		shadow_anchor[2] = (int)camera_z;
+
+		begin_light_view(static_shadow_fbo, static_depth_map_id, 1);
+		calculate_static_shadow_frustum(1);
+		display_static_shadows();
+		end_light_view();
+
+		shadow_cache_valid = 1;
+		shadow_cache_rebuilds++;
+	}
+
+	// start with a copy of the static objects and add the actors
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, static_shadow_fbo);
+	glBindTexture(depth_texture_target, depth_map_id);
+	glCopyTexSubImage2D(depth_texture_target, 0, 0, 0, 0, 0, shadow_map_size, shadow_map_size);
+
+	begin_light_view(shadow_fbo, depth_map_id, 0);
+	calculate_static_shadow_frustum(0);
+	display_dynamic_shadows();
+	end_light_view();
+
+	set_cur_intersect_type(main_bbox_tree, cur_intersect_type);
+}
+#endif	/* SHADOW_MAP_CACHE */
+
 void render_light_view()
 {
 	unsigned int cur_intersect_type;
+#ifdef	SHADOW_MAP_CACHE
+	Uint32 start_time = SDL_GetTicks();
+
+	if (use_shadow_mapping && use_shadow_map_cache && use_frame_buffer)
+	{
+		render_cached_light_view();
+		shadow_time += SDL_GetTicks() - start_time;
+		shadow_frames++;
+		return;
+	}
+#endif	/* SHADOW_MAP_CACHE */
 	if(use_shadow_mapping)
 		{
 			if (!use_frame_buffer && !depth_map_id)
@@ -484,7 +700,10 @@ void render_light_view()
 			glMatrixMode(GL_MODELVIEW);
 			glPushMatrix();
 			glLoadMatrixd(light_view_mat);
-			glTranslatef((int)camera_x,(int)camera_y,(int)camera_z);
+			shadow_anchor[0] = (int)camera_x;
+			shadow_anchor[1] = (int)camera_y;
+			shadow_anchor[2] = (int)camera_z;
+			glTranslatef(shadow_anchor[0], shadow_anchor[1], shadow_anchor[2]);
 			cur_intersect_type = get_cur_intersect_type(main_bbox_tree);
 			set_cur_intersect_type(main_bbox_tree, INTERSECTION_TYPE_SHADOW);
 			calculate_shadow_frustum();
@@ -518,6 +737,10 @@ void render_light_view()
 				CHECK_FBO_ERRORS();
 			}
 			CHECK_GL_ERRORS();
+#ifdef	SHADOW_MAP_CACHE
+			shadow_time += SDL_GetTicks() - start_time;
+			shadow_frames++;
+#endif	/* SHADOW_MAP_CACHE */
 		}
 }
 
@@ -586,7 +809,7 @@ void setup_shadow_mapping()
 		glTranslatef(head_pos[0], head_pos[1], 0.0);
 	}
 	glRotatef(rz, 0.0f, 0.0f, 1.0f);
-	glTranslatef(camera_x-(int)camera_x,camera_y-(int)camera_y,camera_z-(int)camera_z);
+	glTranslatef(camera_x-shadow_anchor[0],camera_y-shadow_anchor[1],camera_z-shadow_anchor[2]);
 
 	glBindTexture(depth_texture_target,depth_map_id);
 	setup_2d_texgen();
@@ -656,22 +879,28 @@ void draw_sun_shadowed_scene(int any_reflection)
 			if (use_fog) glEnable(GL_FOG);
 #endif
 			glNormal3f(0.0f,0.0f,1.0f);
+			GL_STATE_PASS(gl_pass_reflection);
 			if(any_reflection)draw_lake_tiles();
+			GL_STATE_PASS(gl_pass_terrain);
 			draw_tile_map();
 #ifdef MAP_EDITOR2
 			get_world_x_y ();
 			display_mode();
 #endif
 			CHECK_GL_ERRORS();
+			GL_STATE_PASS(gl_pass_2d_objects);
 			display_2d_objects();
 			CHECK_GL_ERRORS();
 			anything_under_the_mouse(0, UNDER_MOUSE_NOTHING);
 
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_objects();
 			display_ground_objects();
 #ifndef MAP_EDITOR2
+			GL_STATE_PASS(gl_pass_actors);
 			display_actors(1, SHADOW_RENDER_PASS);  // Affects other textures ????????? (FPS etc., unless there's a particle system...)
 #endif
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_alpha_objects();
 			display_blended_objects();
 
@@ -710,17 +939,21 @@ void draw_sun_shadowed_scene(int any_reflection)
 		{
 
 			glNormal3f(0.0f,0.0f,1.0f);
+			GL_STATE_PASS(gl_pass_reflection);
 			if(any_reflection)draw_lake_tiles();
 
+			GL_STATE_PASS(gl_pass_terrain);
 			draw_tile_map();
 #ifdef MAP_EDITOR2
 			get_world_x_y ();
 			display_mode();
 #endif
 			CHECK_GL_ERRORS();
+			GL_STATE_PASS(gl_pass_2d_objects);
 			display_2d_objects();
 			CHECK_GL_ERRORS();
 			anything_under_the_mouse(0, UNDER_MOUSE_NOTHING);
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_3d_ground_objects();
 			// turning off writing to the color buffer and depth buffer
 			glDisable(GL_DEPTH_TEST);
@@ -734,6 +967,7 @@ void draw_sun_shadowed_scene(int any_reflection)
 			// this is to always pass a one to the stencil buffer where we draw
 			glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
+			GL_STATE_PASS(gl_pass_shadow_map);
 			display_shadows();
 
 			glStencilFunc(GL_EQUAL, 1, 0xFFFFFFFF);
@@ -775,10 +1009,13 @@ void draw_sun_shadowed_scene(int any_reflection)
 			glEnable(GL_LIGHTING);
 			glDisable(GL_STENCIL_TEST);
 
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_3d_non_ground_objects();
 #ifndef MAP_EDITOR2
+			GL_STATE_PASS(gl_pass_actors);
 			display_actors(1, DEFAULT_RENDER_PASS);
 #endif
+			GL_STATE_PASS(gl_pass_3d_objects);
 			display_blended_objects();
 
 		}
@@ -21,6 +21,9 @@ extern int use_shadow_mapping; /*!< flag whether to use shadow mapping or not */
 extern GLuint depth_map_id;
 extern GLenum depth_texture_target;
 extern int shadow_map_size; /*!< max. size of the shadow maps in byte */
+#ifdef	SHADOW_MAP_CACHE
+extern int use_shadow_map_cache; /*!< flag whether to keep the shadows of the static objects in their own shadow map */
+#endif	/* SHADOW_MAP_CACHE */
 
 /*!
  * \ingroup shadows
@@ -93,6 +96,33 @@ void make_shadow_framebuffer();
  */
 void change_shadow_framebuffer_size();
 
+#ifdef	SHADOW_MAP_CACHE
+/*!
+ * \ingroup shadows
+ * \brief Forces a rebuild of the cached shadow map.
+ *
+ *      Must be called whenever a 3d object is added, removed or changed, so
+ *      the shadows of the static objects get rendered again.
+ *
+ * \callgraph
+ */
+void invalidate_shadow_cache();
+
+/*!
+ * \ingroup shadows
+ * \brief Prints the shadow map timing to the console.
+ *
+ *      Prints the average time needed to render the shadow map and the
+ *      number of cache rebuilds since the last call.
+ *
+ * \param text	unused
+ * \param len	unused
+ * \retval int	always 1
+ * \callgraph
+ */
+int command_shadow_stats(char *text, int len);
+#endif	/* SHADOW_MAP_CACHE */
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
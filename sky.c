@@ -20,6 +20,9 @@
 #include "textures.h"
 #include "vmath.h"
 #include "weather.h"
+#ifdef	USE_SIMD
+#include <xmmintrin.h>
+#endif	/* USE_SIMD */
 
 float skybox_clouds[360][4];
 float skybox_clouds_detail[360][4];
@@ -637,15 +640,233 @@ static __inline__ float get_moonlight2(const GLfloat normal[3])
         return 0.0;
 }
 
+/* Computes the colors of the vertices start to end-1 of a dome. The sky
+ * color is blended to the sun color depending on the angle to the sun, the
+ * weather color and lightning are applied and the light of the moons is
+ * added. If colors_bis is not NULL, the color without moonlight is stored
+ * there too. If components is 4, alpha and alpha_bis are stored as the
+ * fourth component. */
+static void compute_dome_colors(const sky_dome *dome, int start, int end,
+	GLfloat *colors, GLfloat *colors_bis, int components,
+	const GLfloat color_sky[4], const GLfloat color_sun[4], float sun_bias,
+	float moon1_scale, float moon2_scale, float alpha, float alpha_bis)
+{
+	GLfloat color[4], weather[3];
+	const GLfloat *normal;
+	float sunlight, ml1, ml2, x, y, lg;
+	int i, j, idx;
+
+	for (j = 0; j < 3; ++j)
+		weather[j] = (1.0 - rain_coef) + rain_coef*weather_color[j];
+
+	for (i = start; i < end; ++i)
+	{
+		normal = &dome->normals[i*3];
+
+		sunlight = 0.0;
+		if (skybox_show_sun && !skybox_no_sun)
+		{
+			GLfloat dot = normal[0]*sun_position[0]+normal[1]*sun_position[1]+normal[2]*sun_position[2];
+			if (dot > sun_bias)
+				sunlight = (dot-sun_bias)/(1.0-sun_bias);
+		}
+
+		blend_colors(color, (float*)color_sky, (float*)color_sun, sunlight, 3);
+
+		color[0] *= weather[0];
+		color[1] *= weather[1];
+		color[2] *= weather[2];
+
+		if (lightning_falling) {
+			skybox_vertex_to_ground_coords((sky_dome*)dome, i, &x, &y);
+			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
+			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
+			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
+			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
+		}
+
+		idx = i*components;
+
+		if (colors_bis)
+		{
+			colors_bis[idx+0] = color[0];
+			colors_bis[idx+1] = color[1];
+			colors_bis[idx+2] = color[2];
+			if (components == 4)
+				colors_bis[idx+3] = alpha_bis;
+		}
+
+		if (moon1_scale > 0.0 || moon2_scale > 0.0)
+		{
+			ml1 = get_moonlight1(normal)*moon1_scale*day_alpha;
+			ml2 = get_moonlight2(normal)*moon2_scale*day_alpha;
+			color[0] += ml1*moon1_color[0] + ml2*moon2_color[0];
+			color[1] += ml1*moon1_color[1] + ml2*moon2_color[1];
+			color[2] += ml1*moon1_color[2] + ml2*moon2_color[2];
+		}
+
+		colors[idx+0] = color[0];
+		colors[idx+1] = color[1];
+		colors[idx+2] = color[2];
+		if (components == 4)
+			colors[idx+3] = alpha;
+	}
+}
+
+#ifdef	USE_SIMD
+/* Same as compute_dome_colors, four vertices at a time. Lightning is not
+ * supported, so this must only be used while no lightning is falling. */
+static void compute_dome_colors_sse(const sky_dome *dome, int start, int end,
+	GLfloat *colors, GLfloat *colors_bis, int components,
+	const GLfloat color_sky[4], const GLfloat color_sun[4], float sun_bias,
+	float moon1_scale, float moon2_scale, float alpha, float alpha_bis)
+{
+	__m128 nx, ny, nz, t, sunlight, ml1, ml2, zero;
+	__m128 r, g, b, a, a_bis, res[3], rows[4];
+	__m128 sun_dir[3], moon1_dir[3], moon2_dir[3];
+	__m128 sky[3], sun_delta[3], moon1_col[3], moon2_col[3];
+	__m128 sun_bias_v, sun_scale, moon1_bias, moon1_factor, moon2_bias, moon2_factor;
+	const GLfloat *normal;
+	float moon1_phase, moon2_phase, tmp[4][4];
+	int use_sun, use_moons, i, j, k;
+
+	use_sun = skybox_show_sun && !skybox_no_sun;
+	use_moons = skybox_show_moons && !skybox_no_moons &&
+		(moon1_scale > 0.0 || moon2_scale > 0.0);
+
+	moon1_phase = -(sun_position[0]*moon1_direction[0]+sun_position[1]*moon1_direction[1]+sun_position[2]*moon1_direction[2])*0.5+0.5;
+	moon2_phase = -(sun_position[0]*moon2_direction[0]+sun_position[1]*moon2_direction[1]+sun_position[2]*moon2_direction[2])*0.5+0.5;
+
+	zero = _mm_setzero_ps();
+	sun_bias_v = _mm_set1_ps(sun_bias);
+	sun_scale = _mm_set1_ps(1.0/(1.0-sun_bias));
+	moon1_bias = _mm_set1_ps(skybox_moonlight1_bias);
+	moon2_bias = _mm_set1_ps(skybox_moonlight2_bias);
+	moon1_factor = _mm_set1_ps(moon1_phase*moon1_scale*day_alpha/(1.0-skybox_moonlight1_bias));
+	moon2_factor = _mm_set1_ps(moon2_phase*moon2_scale*day_alpha/(1.0-skybox_moonlight2_bias));
+	a = _mm_set1_ps(alpha);
+	a_bis = _mm_set1_ps(alpha_bis);
+
+	for (j = 0; j < 3; ++j)
+	{
+		float weather = (1.0 - rain_coef) + rain_coef*weather_color[j];
+
+		sun_dir[j] = _mm_set1_ps(sun_position[j]);
+		moon1_dir[j] = _mm_set1_ps(moon1_direction[j]);
+		moon2_dir[j] = _mm_set1_ps(moon2_direction[j]);
+		sky[j] = _mm_set1_ps(color_sky[j]*weather);
+		sun_delta[j] = _mm_set1_ps((color_sun[j]-color_sky[j])*weather);
+		moon1_col[j] = _mm_set1_ps(moon1_color[j]);
+		moon2_col[j] = _mm_set1_ps(moon2_color[j]);
+	}
+
+	for (i = start; i + 4 <= end; i += 4)
+	{
+		normal = &dome->normals[i*3];
+		nx = _mm_set_ps(normal[9], normal[6], normal[3], normal[0]);
+		ny = _mm_set_ps(normal[10], normal[7], normal[4], normal[1]);
+		nz = _mm_set_ps(normal[11], normal[8], normal[5], normal[2]);
+
+		if (use_sun)
+		{
+			t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, sun_dir[0]),
+				_mm_mul_ps(ny, sun_dir[1])), _mm_mul_ps(nz, sun_dir[2]));
+			sunlight = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(t, sun_bias_v), zero), sun_scale);
+		}
+		else
+			sunlight = zero;
+
+		r = _mm_add_ps(sky[0], _mm_mul_ps(sun_delta[0], sunlight));
+		g = _mm_add_ps(sky[1], _mm_mul_ps(sun_delta[1], sunlight));
+		b = _mm_add_ps(sky[2], _mm_mul_ps(sun_delta[2], sunlight));
+
+		res[0] = r;
+		res[1] = g;
+		res[2] = b;
+
+		if (use_moons)
+		{
+			t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, moon1_dir[0]),
+				_mm_mul_ps(ny, moon1_dir[1])), _mm_mul_ps(nz, moon1_dir[2]));
+			ml1 = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(t, moon1_bias), zero), moon1_factor);
+			t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, moon2_dir[0]),
+				_mm_mul_ps(ny, moon2_dir[1])), _mm_mul_ps(nz, moon2_dir[2]));
+			ml2 = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(t, moon2_bias), zero), moon2_factor);
+
+			for (j = 0; j < 3; ++j)
+				res[j] = _mm_add_ps(res[j], _mm_add_ps(_mm_mul_ps(ml1, moon1_col[j]), _mm_mul_ps(ml2, moon2_col[j])));
+		}
+
+		if (components == 4)
+		{
+			rows[0] = res[0];
+			rows[1] = res[1];
+			rows[2] = res[2];
+			rows[3] = a;
+			_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+			for (k = 0; k < 4; ++k)
+				_mm_storeu_ps(&colors[(i+k)*4], rows[k]);
+
+			if (colors_bis)
+			{
+				rows[0] = r;
+				rows[1] = g;
+				rows[2] = b;
+				rows[3] = a_bis;
+				_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+				for (k = 0; k < 4; ++k)
+					_mm_storeu_ps(&colors_bis[(i+k)*4], rows[k]);
+			}
+		}
+		else
+		{
+			_mm_storeu_ps(tmp[0], res[0]);
+			_mm_storeu_ps(tmp[1], res[1]);
+			_mm_storeu_ps(tmp[2], res[2]);
+			for (k = 0; k < 4; ++k)
+				for (j = 0; j < 3; ++j)
+					colors[(i+k)*3+j] = tmp[j][k];
+
+			if (colors_bis)
+			{
+				_mm_storeu_ps(tmp[0], r);
+				_mm_storeu_ps(tmp[1], g);
+				_mm_storeu_ps(tmp[2], b);
+				for (k = 0; k < 4; ++k)
+					for (j = 0; j < 3; ++j)
+						colors_bis[(i+k)*3+j] = tmp[j][k];
+			}
+		}
+	}
+
+	compute_dome_colors(dome, i, end, colors, colors_bis, components,
+		color_sky, color_sun, sun_bias, moon1_scale, moon2_scale, alpha, alpha_bis);
+}
+#endif	/* USE_SIMD */
+
+static void update_dome_colors(const sky_dome *dome, int start, int end,
+	GLfloat *colors, GLfloat *colors_bis, int components,
+	const GLfloat color_sky[4], const GLfloat color_sun[4], float sun_bias,
+	float moon1_scale, float moon2_scale, float alpha, float alpha_bis)
+{
+#ifdef	USE_SIMD
+	if (!lightning_falling && SDL_HasSSE())
+	{
+		compute_dome_colors_sse(dome, start, end, colors, colors_bis, components,
+			color_sky, color_sun, sun_bias, moon1_scale, moon2_scale, alpha, alpha_bis);
+		return;
+	}
+#endif	/* USE_SIMD */
+	compute_dome_colors(dome, start, end, colors, colors_bis, components,
+		color_sky, color_sun, sun_bias, moon1_scale, moon2_scale, alpha, alpha_bis);
+}
+
 void update_cloudy_sky_colors()
 {
-    int i, idx, end;
+    int i, end;
 	GLfloat color_sun[4];
 	GLfloat color_sky[4];
-	GLfloat color[4];
 	float abs_light;
-	float *normal, ml1, ml2;
-	float x, y, lg;
 
 	abs_light = light_level;
 	if(light_level > 59)
@@ -678,8 +899,6 @@ void update_cloudy_sky_colors()
 	skybox_blend_current_colors(skybox_light_ambient_color, skybox_light_ambient, skybox_light_ambient_rainy, rain_coef);
 	skybox_blend_current_colors(skybox_light_diffuse_color, skybox_light_diffuse, skybox_light_diffuse_rainy, rain_coef);
 
-	idx = 0;
-
     // we compute the color and the density of the fog
 	skybox_blend_current_colors(skybox_fog_color, skybox_fog, skybox_fog_rainy, rain_coef);
 	if (rain_coef > 0.0)
@@ -696,317 +915,106 @@ void update_cloudy_sky_colors()
 
     // we compute the colors of the fog around the dome according to the sun and moons positions
     skybox_blend_current_colors(color_sun, skybox_fog_sunny, skybox_fog_rainy, rain_coef);
-    for (i = 0; i < dome_sky.slices_count; ++i)
-    {
-		normal = &dome_sky.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.15*day_alpha;
-		ml2 = get_moonlight2(normal)*0.1*day_alpha;
-
-		blend_colors(color, skybox_fog_color, color_sun, get_fog_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		fog_colors[idx++] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		fog_colors[idx++] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		fog_colors[idx++] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-    }
-
-	i = idx = 0;
+	update_dome_colors(&dome_sky, 0, dome_sky.slices_count, fog_colors, NULL, 3,
+		skybox_fog_color, color_sun, skybox_sunny_fog_bias, 0.15, 0.1, 1.0, 0.0);
 
 	// clouds color
 	skybox_blend_current_colors(color_sky, skybox_clouds, skybox_clouds_rainy, rain_coef);
 	skybox_blend_current_colors(color_sun, skybox_clouds_sunny, skybox_clouds_rainy, rain_coef);
-    while (i < dome_clouds.slices_count * 2)
-    {
-		normal = &dome_clouds.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.3*day_alpha;
-		ml2 = get_moonlight2(normal)*0.2*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_clouds.colors[idx] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_clouds_colors_bis[idx++] = color[0];
-		dome_clouds.colors[idx] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_clouds_colors_bis[idx++] = color[1];
-		dome_clouds.colors[idx] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_clouds_colors_bis[idx++] = color[2];
-        dome_clouds.colors[idx] = 0.0;
-		dome_clouds_colors_bis[idx++] = 0.0;
-		++i;
-    }
-    while (i < dome_clouds.vertices_count)
-    {
-		normal = &dome_clouds.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.3*day_alpha;
-		ml2 = get_moonlight2(normal)*0.2*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-		
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_clouds.colors[idx] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_clouds_colors_bis[idx++] = color[0];
-		dome_clouds.colors[idx] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_clouds_colors_bis[idx++] = color[1];
-		dome_clouds.colors[idx] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_clouds_colors_bis[idx++] = color[2];
-        dome_clouds.colors[idx] = 1.0;
-		dome_clouds_colors_bis[idx++] = rain_coef;
-		++i;
-    }
-
-	i = idx = 0;
+	update_dome_colors(&dome_clouds, 0, dome_clouds.slices_count * 2, dome_clouds.colors, dome_clouds_colors_bis, 4,
+		color_sky, color_sun, skybox_sunny_clouds_bias, 0.3, 0.2, 0.0, 0.0);
+	update_dome_colors(&dome_clouds, dome_clouds.slices_count * 2, dome_clouds.vertices_count, dome_clouds.colors, dome_clouds_colors_bis, 4,
+		color_sky, color_sun, skybox_sunny_clouds_bias, 0.3, 0.2, 1.0, rain_coef);
 
 	// clouds detail color
 	skybox_blend_current_colors(color_sky, skybox_clouds_detail, skybox_clouds_detail_rainy, rain_coef);
 	skybox_blend_current_colors(color_sun, skybox_clouds_detail_sunny, skybox_clouds_detail_rainy, rain_coef);
-    while (i < dome_clouds.slices_count * 2)
-    {
-		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(&dome_clouds.normals[i*3]), 3);
+	update_dome_colors(&dome_clouds, 0, dome_clouds.slices_count * 2, dome_clouds_detail_colors, dome_clouds_detail_colors_bis, 4,
+		color_sky, color_sun, skybox_sunny_clouds_bias, 0.0, 0.0, 0.0, 0.0);
+	update_dome_colors(&dome_clouds, dome_clouds.slices_count * 2, dome_clouds.vertices_count, dome_clouds_detail_colors, dome_clouds_detail_colors_bis, 4,
+		color_sky, color_sun, skybox_sunny_clouds_bias, 0.0, 0.0, 1.0, rain_coef);
 
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_clouds_detail_colors[idx] = color[0];
-		dome_clouds_detail_colors_bis[idx++] = color[0];
-		dome_clouds_detail_colors[idx] = color[1];
-		dome_clouds_detail_colors_bis[idx++] = color[1];
-		dome_clouds_detail_colors[idx] = color[2];
-		dome_clouds_detail_colors_bis[idx++] = color[2];
-        dome_clouds_detail_colors[idx] = 0.0;
-		dome_clouds_detail_colors_bis[idx++] = 0.0;
-		++i;
-    }
-    while (i < dome_clouds.vertices_count)
-    {
-		blend_colors(color, color_sky, color_sun, get_clouds_sunlight(&dome_clouds.normals[i*3]), 3);
+	// sky color, one ring of the dome per color table
+	for (i = 0; i < 5; ++i)
+	{
+		static float (*const sky_tables[5])[4] = { skybox_sky1, skybox_sky2, skybox_sky3, skybox_sky4, skybox_sky5 };
+		static float (*const sunny_tables[5])[4] = { skybox_sky1_sunny, skybox_sky2_sunny, skybox_sky3_sunny, skybox_sky4_sunny, skybox_sky5_sunny };
+
+		skybox_blend_current_colors(color_sky, sky_tables[i], skybox_fog_rainy, rain_coef);
+		skybox_blend_current_colors(color_sun, sunny_tables[i], skybox_fog_rainy, rain_coef);
+		end = (i < 4) ? (i + 1) * dome_sky.slices_count : dome_sky.vertices_count;
+		update_dome_colors(&dome_sky, i * dome_sky.slices_count, end, dome_sky.colors, NULL, 4,
+			color_sky, color_sun, skybox_sunny_sky_bias, 0.15, 0.1, 1.0, 0.0);
+	}
 
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
+	memcpy(skybox_sky_color, color_sun, 4*sizeof(float));
 
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_clouds, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
+	// color of the moons update
+	moon1_color[0] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+	moon1_color[1] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+	moon1_color[2] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+	moon2_color[0] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+	moon2_color[1] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+	moon2_color[2] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+}
 
-		dome_clouds_detail_colors[idx] = color[0];
-		dome_clouds_detail_colors_bis[idx++] = color[0];
-		dome_clouds_detail_colors[idx] = color[1];
-		dome_clouds_detail_colors_bis[idx++] = color[1];
-		dome_clouds_detail_colors[idx] = color[2];
-		dome_clouds_detail_colors_bis[idx++] = color[2];
-        dome_clouds_detail_colors[idx] = 1.0;
-		dome_clouds_detail_colors_bis[idx++] = rain_coef;
-		++i;
-    }
+#ifdef	USE_SIMD
+int command_sky_benchmark(char *text, int len)
+{
+	GLfloat color_sky[4], color_sun[4];
+	GLfloat *scalar_colors, *sse_colors;
+	Uint32 start, scalar_time, sse_time;
+	float diff, max_diff;
+	int i, count, loops = 1000;
+	char str[256];
+
+	count = dome_sky.vertices_count;
+	if (!SDL_HasSSE() || (count == 0) || (current_sky != SKYBOX_CLOUDY))
+	{
+		LOG_TO_CONSOLE(c_red1, "The sky benchmark needs sse and a cloudy sky.");
+		return 1;
+	}
 
-	i = idx = 0;
+	scalar_colors = malloc(count*4*sizeof(GLfloat));
+	sse_colors = malloc(count*4*sizeof(GLfloat));
 
-	// sky color
 	skybox_blend_current_colors(color_sky, skybox_sky1, skybox_fog_rainy, rain_coef);
 	skybox_blend_current_colors(color_sun, skybox_sky1_sunny, skybox_fog_rainy, rain_coef);
-	end = dome_sky.slices_count;
-    while (i < end)
-    {
-		normal = &dome_sky.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.15*day_alpha;
-		ml2 = get_moonlight2(normal)*0.1*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_sky.colors[idx++] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_sky.colors[idx++] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_sky.colors[idx++] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_sky.colors[idx++] = 1.0;
-		++i;
-    }
-
-	skybox_blend_current_colors(color_sky, skybox_sky2, skybox_fog_rainy, rain_coef);
-	skybox_blend_current_colors(color_sun, skybox_sky2_sunny, skybox_fog_rainy, rain_coef);
-	end += dome_sky.slices_count;
-    while (i < end)
-    {
-		normal = &dome_sky.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.15*day_alpha;
-		ml2 = get_moonlight2(normal)*0.1*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_sky.colors[idx++] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_sky.colors[idx++] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_sky.colors[idx++] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_sky.colors[idx++] = 1.0;
-		++i;
-    }
 
-	skybox_blend_current_colors(color_sky, skybox_sky3, skybox_fog_rainy, rain_coef);
-	skybox_blend_current_colors(color_sun, skybox_sky3_sunny, skybox_fog_rainy, rain_coef);
-	end += dome_sky.slices_count;
-    while (i < end)
-    {
-		normal = &dome_sky.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.15*day_alpha;
-		ml2 = get_moonlight2(normal)*0.1*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_sky.colors[idx++] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_sky.colors[idx++] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_sky.colors[idx++] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_sky.colors[idx++] = 1.0;
-		++i;
-    }
-
-	skybox_blend_current_colors(color_sky, skybox_sky4, skybox_fog_rainy, rain_coef);
-	skybox_blend_current_colors(color_sun, skybox_sky4_sunny, skybox_fog_rainy, rain_coef);
-	end += dome_sky.slices_count;
-    while (i < end)
-    {
-		normal = &dome_sky.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.15*day_alpha;
-		ml2 = get_moonlight2(normal)*0.1*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
-		}
-
-		dome_sky.colors[idx++] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_sky.colors[idx++] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_sky.colors[idx++] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_sky.colors[idx++] = 1.0;
-		++i;
-    }
-
-	skybox_blend_current_colors(color_sky, skybox_sky5, skybox_fog_rainy, rain_coef);
-	skybox_blend_current_colors(color_sun, skybox_sky5_sunny, skybox_fog_rainy, rain_coef);
-    while (i < dome_sky.vertices_count)
-    {
-		normal = &dome_sky.normals[i*3];
-		ml1 = get_moonlight1(normal)*0.15*day_alpha;
-		ml2 = get_moonlight2(normal)*0.1*day_alpha;
-
-		blend_colors(color, color_sky, color_sun, get_sky_sunlight(normal), 3);
-
-		color[0] *= (1.0 - rain_coef) + rain_coef*weather_color[0];
-		color[1] *= (1.0 - rain_coef) + rain_coef*weather_color[1];
-		color[2] *= (1.0 - rain_coef) + rain_coef*weather_color[2];
-
-		if (lightning_falling) {
-			skybox_vertex_to_ground_coords(&dome_sky, i, &x, &y);
-			lg = weather_get_lightning_intensity(x-camera_x, y-camera_y);
-			color[0] = color[0]*(1.0-lg) + lightning_color[0]*lg;
-			color[1] = color[1]*(1.0-lg) + lightning_color[1]*lg;
-			color[2] = color[2]*(1.0-lg) + lightning_color[2]*lg;
+	start = SDL_GetTicks();
+	for (i = 0; i < loops; ++i)
+		compute_dome_colors(&dome_sky, 0, count, scalar_colors, NULL, 4,
+			color_sky, color_sun, skybox_sunny_sky_bias, 0.15, 0.1, 1.0, 0.0);
+	scalar_time = SDL_GetTicks() - start;
+
+	start = SDL_GetTicks();
+	for (i = 0; i < loops; ++i)
+		compute_dome_colors_sse(&dome_sky, 0, count, sse_colors, NULL, 4,
+			color_sky, color_sun, skybox_sunny_sky_bias, 0.15, 0.1, 1.0, 0.0);
+	sse_time = SDL_GetTicks() - start;
+
+	// the sse path ignores lightning, so only compare without it
+	max_diff = 0.0;
+	if (!lightning_falling)
+	{
+		for (i = 0; i < count*4; ++i)
+		{
+			diff = fabsf(scalar_colors[i] - sse_colors[i]);
+			if (diff > max_diff)
+				max_diff = diff;
 		}
+	}
 
-		dome_sky.colors[idx++] = color[0] + ml1*moon1_color[0] + ml2*moon2_color[0];
-		dome_sky.colors[idx++] = color[1] + ml1*moon1_color[1] + ml2*moon2_color[1];
-		dome_sky.colors[idx++] = color[2] + ml1*moon1_color[2] + ml2*moon2_color[2];
-		dome_sky.colors[idx++] = 1.0;
-		++i;
-    }
+	free(scalar_colors);
+	free(sse_colors);
 
-	memcpy(skybox_sky_color, color_sun, 4*sizeof(float));
+	safe_snprintf(str, sizeof(str), "Sky colors of %d vertices: scalar %.4f ms, sse %.4f ms per update, max difference %.4f/255",
+		count, (float)scalar_time/loops, (float)sse_time/loops, max_diff*255.0);
+	LOG_TO_CONSOLE(c_green1, str);
 
-	// color of the moons update
-	moon1_color[0] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
-	moon1_color[1] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
-	moon1_color[2] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
-	moon2_color[0] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
-	moon2_color[1] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
-	moon2_color[2] *= (0.5 + 0.5*day_alpha)*(1.0-rain_coef);
+	return 1;
 }
+#endif	/* USE_SIMD */
 
 void update_cloudy_sky_local_colors()
 {
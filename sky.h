@@ -75,6 +75,11 @@ void free_skybox();
 void skybox_update_positions();
 void skybox_update_colors();
 
+#ifdef USE_SIMD
+// prints the time needed to compute the sky colors with and without sse
+int command_sky_benchmark(char *text, int len);
+#endif // USE_SIMD
+
 static __inline__ void blend_colors(float result[], float orig[], float dest[], float t, int size)
 {
     while (size--) result[size] = (1.0-t)*orig[size] + t*dest[size];
@@ -78,6 +78,7 @@ int last_line = 0;
 #define MAX_SOUND_VARIANTS 10				// Maximum number of different sounds allowed for the one sound type
 #define MAX_SOUND_MAP_BOUNDARIES 20			// Maximum number of boundary sets per map
 #define MAX_SOUND_WALK_BOUNDARIES 40		// Maximum number of walk boundary sets per map
+#define MAX_SOUND_MAP_PRELOADS 10			// Maximum number of sounds to preload per map
 #define MAX_ITEM_SOUND_IMAGE_IDS 30			// Maximum number of image id's linked to an item sound def
 #define MAX_SOUND_TILE_TYPES 20				// Maximum number of different tile types
 #define MAX_SOUND_TILES 30					// Maximum number of different tiles for a tile type
@@ -208,6 +209,8 @@ typedef struct
 	int num_walk_boundaries;
 	int defaults[MAX_MAP_BACKGROUND_DEFAULTS];	// ID of the default boundaries
 	int num_defaults;
+	int preload[MAX_SOUND_MAP_PRELOADS];		// Sounds likely to be played on this map
+	int num_preload;
 } map_sound_data;
 
 typedef struct
@@ -782,6 +785,443 @@ ALvoid * load_ogg_into_memory(char * szPath, ALenum *inFormat, ALsizei *inSize,
 }
 
 
+#ifdef	SOUND_ASYNC_DECODE
+/***************************
+ * SAMPLE DECODE FUNCTIONS *
+ ***************************/
+
+#define MAX_DECODED_SAMPLES 128
+#define DECODE_NO_SLOT -2					// All samples are in use, decode it without the cache
+
+typedef enum
+{
+	DECODE_UNUSED, DECODE_QUEUED, DECODE_BUSY, DECODE_READY, DECODE_FAILED
+} DECODE_STATE;
+
+typedef struct
+{
+	char file_path[MAX_FILENAME_LENGTH];	// The file as given in the config, used as key
+	DECODE_STATE state;
+	ALvoid *data;							// The decoded data, owned by the cache
+	ALenum format;
+	ALsizei size;							// Size of the decoded data in bytes
+	ALfloat freq;
+	int requested;							// A sound is waiting for this sample
+	int users;								// Number of buffers being filled from the data
+	Uint32 queue_time;						// Ticks when the sample was queued
+	Uint32 last_used;						// Use counter for the LRU
+} decoded_sample;
+
+int sound_cache_size = 16;					// Size of the decoded sample cache in MB
+
+static decoded_sample *decoded_samples = NULL;
+static SDL_mutex *decode_mutex = NULL;
+static SDL_sem *decode_semaphore = NULL;
+static SDL_Thread *decode_thread = NULL;
+static volatile int decode_thread_done = 0;
+static Uint32 decode_use_counter = 0;
+static Uint32 decoded_bytes = 0;
+
+static Uint32 decode_hits = 0;				// Samples found decoded in the cache
+static Uint32 decode_misses = 0;			// Samples a sound had to wait for
+static Uint32 decode_count = 0;
+static Uint32 decode_time = 0;				// Total time spent decoding in ms
+static Uint32 decode_max_time = 0;
+static Uint32 decode_waits = 0;				// Misses that got played
+static Uint32 decode_wait_time = 0;			// Total time between queueing and playing these
+
+/* All of the following functions expect the decode mutex to be locked */
+static int find_decoded_sample(const char *file_path)
+{
+	int i;
+
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		if (decoded_samples[i].state != DECODE_UNUSED && !strcasecmp(decoded_samples[i].file_path, file_path))
+			return i;
+	}
+	return -1;
+}
+
+static void free_decoded_sample(decoded_sample *pDecoded)
+{
+	if (pDecoded->data)
+	{
+		free(pDecoded->data);
+		decoded_bytes -= pDecoded->size;
+	}
+	pDecoded->file_path[0] = '\0';
+	pDecoded->state = DECODE_UNUSED;
+	pDecoded->data = NULL;
+	pDecoded->size = 0;
+	pDecoded->requested = 0;
+	pDecoded->users = 0;
+}
+
+/* Returns the least recently used sample no sound is waiting for or -1 */
+static int find_unused_decoded_sample(int include_failed)
+{
+	int i, lru = -1;
+
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		if ((decoded_samples[i].state == DECODE_READY || (include_failed && decoded_samples[i].state == DECODE_FAILED))
+			&& !decoded_samples[i].requested && !decoded_samples[i].users
+			&& (lru < 0 || decoded_samples[i].last_used < decoded_samples[lru].last_used))
+		{
+			lru = i;
+		}
+	}
+	return lru;
+}
+
+static void trim_decoded_samples()
+{
+	int i;
+	Uint32 max_bytes = sound_cache_size * 1048576;
+
+	while (decoded_bytes > max_bytes)
+	{
+		i = find_unused_decoded_sample(0);
+		if (i < 0)
+			break;
+		free_decoded_sample(&decoded_samples[i]);
+	}
+}
+
+static int queue_sample_decode(const char *file_path)
+{
+	int i;
+
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		if (decoded_samples[i].state == DECODE_UNUSED)
+			break;
+	}
+	if (i == MAX_DECODED_SAMPLES)
+	{
+		i = find_unused_decoded_sample(1);
+		if (i < 0)
+			return -1;
+		free_decoded_sample(&decoded_samples[i]);
+	}
+
+	safe_strncpy(decoded_samples[i].file_path, file_path, sizeof(decoded_samples[i].file_path));
+	decoded_samples[i].state = DECODE_QUEUED;
+	decoded_samples[i].queue_time = SDL_GetTicks();
+	decoded_samples[i].last_used = ++decode_use_counter;
+	SDL_SemPost(decode_semaphore);
+
+	return i;
+}
+
+/* Returns the next sample to decode, samples sounds are waiting for first */
+static int get_next_queued_sample()
+{
+	int i, next = -1;
+
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		if (decoded_samples[i].state != DECODE_QUEUED)
+			continue;
+		if (next < 0 || decoded_samples[i].requested > decoded_samples[next].requested
+			|| (decoded_samples[i].requested == decoded_samples[next].requested
+				&& decoded_samples[i].queue_time < decoded_samples[next].queue_time))
+		{
+			next = i;
+		}
+	}
+	return next;
+}
+
+static int decode_samples(void *dummy)
+{
+	int i;
+	Uint32 start, time;
+	ALvoid *data;
+	ALenum format;
+	ALsizei size;
+	ALfloat freq;
+	char filename[200];
+
+	init_thread_log("decode_samples");
+
+	while (1)
+	{
+		SDL_SemWait(decode_semaphore);
+		if (decode_thread_done)
+			break;
+
+		CHECK_AND_LOCK_MUTEX(decode_mutex);
+		i = get_next_queued_sample();
+		if (i < 0)
+		{
+			CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+			continue;
+		}
+		decoded_samples[i].state = DECODE_BUSY;
+		safe_strncpy(filename, datadir, sizeof(filename));
+		safe_strcat(filename, decoded_samples[i].file_path, sizeof(filename));
+		CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+
+		start = SDL_GetTicks();
+		data = load_ogg_into_memory(filename, &format, &size, &freq);
+		if (data && size > 0)
+		{
+			// Give back the unused part of the decode buffer
+			ALvoid *tmp = realloc(data, size);
+			if (tmp)
+				data = tmp;
+		}
+		else if (data)
+		{
+			free(data);
+			data = NULL;
+		}
+		time = SDL_GetTicks() - start;
+
+		CHECK_AND_LOCK_MUTEX(decode_mutex);
+		decode_count++;
+		decode_time += time;
+		if (time > decode_max_time)
+			decode_max_time = time;
+		if (data)
+		{
+			decoded_samples[i].state = DECODE_READY;
+			decoded_samples[i].data = data;
+			decoded_samples[i].format = format;
+			decoded_samples[i].size = size;
+			decoded_samples[i].freq = freq;
+			decoded_bytes += size;
+		}
+		else
+		{
+			// Nobody can use the sample now, so let the slot be reused
+			decoded_samples[i].state = DECODE_FAILED;
+			decoded_samples[i].requested = 0;
+		}
+		CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+	}
+
+	return 0;
+}
+
+static void init_sample_decoding()
+{
+	int i;
+
+	decoded_samples = (decoded_sample *)malloc(sizeof(decoded_sample) * MAX_DECODED_SAMPLES);
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		decoded_samples[i].data = NULL;
+		free_decoded_sample(&decoded_samples[i]);
+	}
+	decoded_bytes = 0;
+
+	decode_mutex = SDL_CreateMutex();
+	decode_semaphore = SDL_CreateSemaphore(0);
+	decode_thread_done = 0;
+	decode_thread = SDL_CreateThread(decode_samples, 0);
+	if (!decode_thread)
+	{
+		LOG_ERROR("Unable to create sample decode thread: %s\n", SDL_GetError());
+	}
+}
+
+static void free_sample_decoding()
+{
+	int i;
+
+	if (decode_thread != NULL)
+	{
+		decode_thread_done = 1;
+		SDL_SemPost(decode_semaphore);
+		SDL_WaitThread(decode_thread, NULL);
+		decode_thread = NULL;
+	}
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		free_decoded_sample(&decoded_samples[i]);
+	}
+	free(decoded_samples);
+	decoded_samples = NULL;
+	SDL_DestroySemaphore(decode_semaphore);
+	decode_semaphore = NULL;
+	SDL_DestroyMutex(decode_mutex);
+	decode_mutex = NULL;
+}
+
+/* Returns the index of the decoded sample, which is then in use until
+ * release_decoded_sample() is called, or -1 if the sample isn't decoded yet
+ * (it is queued if needed) or can't be decoded. Returns DECODE_NO_SLOT if
+ * it can't be queued because all samples are waited for or in use.
+ */
+static int get_decoded_sample(const char *file_path)
+{
+	int i;
+	decoded_sample *pDecoded;
+
+	CHECK_AND_LOCK_MUTEX(decode_mutex);
+	i = find_decoded_sample(file_path);
+	if (i < 0)
+	{
+		i = queue_sample_decode(file_path);
+		if (i >= 0)
+		{
+			decoded_samples[i].requested = 1;
+			decode_misses++;
+			i = -1;
+		}
+		else
+		{
+			i = DECODE_NO_SLOT;
+		}
+		CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+		return i;
+	}
+
+	pDecoded = &decoded_samples[i];
+	if (pDecoded->state == DECODE_QUEUED || pDecoded->state == DECODE_BUSY)
+	{
+		// Queued by the preloading, but not done yet
+		if (!pDecoded->requested)
+		{
+			pDecoded->requested = 1;
+			decode_misses++;
+		}
+		i = -1;
+	}
+	else if (pDecoded->state == DECODE_READY)
+	{
+		if (pDecoded->requested)
+		{
+			pDecoded->requested = 0;
+			decode_waits++;
+			decode_wait_time += SDL_GetTicks() - pDecoded->queue_time;
+		}
+		else
+		{
+			decode_hits++;
+		}
+		pDecoded->users++;
+		pDecoded->last_used = ++decode_use_counter;
+	}
+	else
+	{
+		i = -1;
+	}
+	CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+
+	return i;
+}
+
+static void release_decoded_sample(int index)
+{
+	CHECK_AND_LOCK_MUTEX(decode_mutex);
+	decoded_samples[index].users--;
+	trim_decoded_samples();
+	CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+}
+
+static void preload_sound_type(int type)
+{
+	int i, j;
+	sound_file *pFile;
+
+	if (type < 0 || type >= num_types)
+		return;
+
+	for (i = 0; i < sound_type_data[type].num_variants; i++)
+	{
+		for (j = 0; j < num_STAGES; j++)
+		{
+			pFile = sound_type_data[type].variant[i].part[j];
+			if (pFile && pFile->sample_num < 0 && pFile->file_path[0] != '\0'
+				&& find_decoded_sample(pFile->file_path) < 0)
+			{
+				queue_sample_decode(pFile->file_path);
+			}
+		}
+	}
+}
+
+/* Queues the walking sounds and the sounds listed as preload hints for the
+ * map, so they are decoded before they are played the first time.
+ */
+static void preload_map_samples(int map)
+{
+	int i, j;
+
+	if (decode_thread == NULL || no_sound)
+		return;
+
+	CHECK_AND_LOCK_MUTEX(decode_mutex);
+	if (map >= 0)
+	{
+		for (i = 0; i < sound_map_data[map].num_preload; i++)
+		{
+			preload_sound_type(sound_map_data[map].preload[i]);
+		}
+		for (i = 0; i < sound_map_data[map].num_walk_boundaries; i++)
+		{
+			preload_sound_type(sound_map_data[map].walk_boundaries[i].bg_sound);
+		}
+	}
+	preload_sound_type(walking_default);
+	for (i = 0; i < sound_num_tile_types; i++)
+	{
+		preload_sound_type(sound_tile_data[i].default_sound);
+		for (j = 0; j < sound_tile_data[i].num_sounds; j++)
+		{
+			preload_sound_type(sound_tile_data[i].sounds[j].sound);
+		}
+	}
+	CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+}
+
+int command_sound_cache(char *text, int len)
+{
+	int i, count = 0, queued = 0;
+	Uint32 hits, misses, decodes, time, max_time, waits, wait_time, bytes;
+	char str[200];
+
+	if (decode_mutex == NULL)
+		return 1;
+
+	CHECK_AND_LOCK_MUTEX(decode_mutex);
+	for (i = 0; i < MAX_DECODED_SAMPLES; i++)
+	{
+		if (decoded_samples[i].state == DECODE_READY)
+			count++;
+		else if (decoded_samples[i].state == DECODE_QUEUED || decoded_samples[i].state == DECODE_BUSY)
+			queued++;
+	}
+	hits = decode_hits;
+	misses = decode_misses;
+	decodes = decode_count;
+	time = decode_time;
+	max_time = decode_max_time;
+	waits = decode_waits;
+	wait_time = decode_wait_time;
+	bytes = decoded_bytes;
+	CHECK_AND_UNLOCK_MUTEX(decode_mutex);
+
+	safe_snprintf(str, sizeof(str), "Sound cache: %d samples (%u of %d KB), %d queued",
+		count, bytes / 1024, sound_cache_size * 1024, queued);
+	LOG_TO_CONSOLE(c_green1, str);
+	safe_snprintf(str, sizeof(str), "Hits: %u, misses: %u, hit rate: %.1f%%",
+		hits, misses, (hits + misses) > 0 ? (hits * 100.0f) / (hits + misses) : 0.0f);
+	LOG_TO_CONSOLE(c_green1, str);
+	safe_snprintf(str, sizeof(str), "Decoded: %u samples, %.1f ms average, %u ms max, %.1f ms average delay of a miss",
+		decodes, decodes > 0 ? (float)time / decodes : 0.0f, max_time,
+		waits > 0 ? (float)wait_time / waits : 0.0f);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* SOUND_ASYNC_DECODE */
+
+
 /**************************
  * SOUND STREAM FUNCTIONS *
  **************************/
@@ -2046,6 +2486,9 @@ int ensure_sample_loaded(char * in_filename)
 	ALuint *pBuffer;
 	sound_sample *pSample;
 	char filename[200];				// This is for the full path to the file
+#ifdef	SOUND_ASYNC_DECODE
+	int decoded = -1;
+#endif	/* SOUND_ASYNC_DECODE */
 
 	// Check if this sample is already loaded and if so, return the sample ID
 	for (i = 0; i < MAX_SOUND_FILES; i++)
@@ -2058,6 +2501,20 @@ int ensure_sample_loaded(char * in_filename)
 			return sound_files[i].sample_num;
 		}
 	}
+
+#ifdef	SOUND_ASYNC_DECODE
+	// The sample is decoded by the decode thread. Until the decoded data is
+	// available the sound isn't loaded and update_sound() tries again later.
+	// If it can't be queued, it is decoded here like without the thread.
+	if (decode_thread != NULL)
+	{
+		decoded = get_decoded_sample(in_filename);
+		if (decoded == DECODE_NO_SLOT)
+			decoded = -1;
+		else if (decoded < 0)
+			return -1;
+	}
+#endif	/* SOUND_ASYNC_DECODE */
 	
 	// Sample isn't loaded so find a space in the array
 	sample_num = -1;
@@ -2125,6 +2582,10 @@ int ensure_sample_loaded(char * in_filename)
 #ifdef _EXTRA_SOUND_DEBUG
 			LOG_ERROR("Error: Too many samples loaded. Unable to load sample: %s, num samples: %d\n", in_filename, num_samples);
 #endif //_EXTRA_SOUND_DEBUG
+#ifdef	SOUND_ASYNC_DECODE
+			if (decoded >= 0)
+				release_decoded_sample(decoded);
+#endif	/* SOUND_ASYNC_DECODE */
 			return -1;
 		}
 	}
@@ -2141,6 +2602,16 @@ int ensure_sample_loaded(char * in_filename)
 	safe_strcat(filename, in_filename, sizeof(filename));
 
 	// Load the file into memory
+#ifdef	SOUND_ASYNC_DECODE
+	if (decoded >= 0)
+	{
+		data = decoded_samples[decoded].data;
+		datasize = decoded_samples[decoded].size;
+		pSample->format = decoded_samples[decoded].format;
+		pSample->freq = decoded_samples[decoded].freq;
+	}
+	else
+#endif	/* SOUND_ASYNC_DECODE */
 	data = load_ogg_into_memory(filename, &pSample->format, &datasize, &pSample->freq);
 	if (!data)
 	{
@@ -2166,6 +2637,11 @@ int ensure_sample_loaded(char * in_filename)
 #endif //_EXTRA_SOUND_DEBUG
 		*pBuffer = 0;
 		// Get rid of the temporary data
+#ifdef	SOUND_ASYNC_DECODE
+		if (decoded >= 0)
+			release_decoded_sample(decoded);
+		else
+#endif	/* SOUND_ASYNC_DECODE */
 		free(data);
 		return -1;
 	}
@@ -2180,6 +2656,11 @@ int ensure_sample_loaded(char * in_filename)
 #endif //_EXTRA_SOUND_DEBUG
 		alDeleteBuffers(1, pBuffer);
 		// Get rid of the temporary data
+#ifdef	SOUND_ASYNC_DECODE
+		if (decoded >= 0)
+			release_decoded_sample(decoded);
+		else
+#endif	/* SOUND_ASYNC_DECODE */
 		free(data);
 		return -1;
 	}
@@ -2191,6 +2672,11 @@ int ensure_sample_loaded(char * in_filename)
 	pSample->length = (pSample->size * 1000) / ((pSample->bits >> 3) * pSample->channels * pSample->freq);
 
 	// Get rid of the temporary data
+#ifdef	SOUND_ASYNC_DECODE
+	if (decoded >= 0)
+		release_decoded_sample(decoded);
+	else
+#endif	/* SOUND_ASYNC_DECODE */
 	free(data);
 
 	if ((error=alGetError()) != AL_NO_ERROR)
@@ -2965,6 +3451,11 @@ void update_sound(int ms)
 			{
 				distanceSq = (tx - x) * (tx - x) + (ty - y) * (ty - y);
 				maxDistSq = pSoundType->distance * pSoundType->distance;
+#ifdef	SOUND_ASYNC_DECODE
+				// Omni sounds still waiting for their samples to be decoded
+				if (!sounds_list[i].loaded && !pSoundType->positional)
+					distanceSq = -1;
+#endif	/* SOUND_ASYNC_DECODE */
 				if (sound_on && (distanceSq < maxDistSq))
 				{
 					// This sound is back in range so load it into a source and play it
@@ -3423,9 +3914,12 @@ void setup_map_sounds (int map_num)
 			LOG_TO_CONSOLE(c_red1, str);
 			print_sound_boundary_coords(map_num);
 #endif // DEBUG_MAP_SOUND
-			return;
+			break;
 		}
 	}
+#ifdef	SOUND_ASYNC_DECODE
+	preload_map_samples(snd_cur_map);
+#endif	/* SOUND_ASYNC_DECODE */
 }
 
 // Find the index of the sound associated with this cookie.
@@ -3934,6 +4428,7 @@ void clear_sound_data()
 		{
 			clear_boundary_data(&sound_map_data[i].walk_boundaries[j]);
 		}
+		sound_map_data[i].num_preload = 0;
 		sound_map_data[i].num_defaults = 0;
 		for (j = 0; j < MAX_MAP_BACKGROUND_DEFAULTS; j++)
 		{
@@ -4016,6 +4511,9 @@ void initial_sound_init(void)
 		SDL_Quit();
 		exit(1);
 	}
+#ifdef	SOUND_ASYNC_DECODE
+	init_sample_decoding();
+#endif	/* SOUND_ASYNC_DECODE */
 
 	/* create arrays and do minimum initisation - memsetting to zero is not good enough.
 	 * These arrays were previous static and so valgrind could not determine if there were
@@ -4114,6 +4612,7 @@ void initial_sound_init(void)
 	for (i=0; i<MAX_SOUND_MAPS; i++)
 	{
 		sound_map_data[i].num_boundaries = sound_map_data[i].num_defaults = sound_map_data[i].num_walk_boundaries = 0;
+		sound_map_data[i].num_preload = 0;
 		sound_map_data[i].id = -1;
 	}
 
@@ -4211,6 +4710,9 @@ static void clear_playlist(void)
 /* done once at exit to delete the sound list mutex */
 void final_sound_exit(void)
 {
+#ifdef	SOUND_ASYNC_DECODE
+	free_sample_decoding();
+#endif	/* SOUND_ASYNC_DECODE */
 	SDL_DestroyMutex(sound_list_mutex);
 	sound_list_mutex = NULL;
 	free(streams);
@@ -5307,6 +5809,24 @@ void parse_map_sound(const xmlNode *inNode)
 					}
 				}
 // This block ^^ is a temporary fix for detecting 2d and 3d objects. It can be removed once the other functionality is coded.
+				else if(!xmlStrcasecmp(boundaryNode->name, (xmlChar*)"preload"))
+				{
+					// A sound to decode in advance when entering this map
+					get_string_value(content, sizeof(content), boundaryNode);
+					iVal = get_index_for_sound_type_name(content);
+					if (iVal == -1)
+					{
+						LOG_ERROR("%s: sound not found for preload '%s' in map '%s'", snd_config_error, content, pMap->name);
+					}
+					else if (pMap->num_preload < MAX_SOUND_MAP_PRELOADS)
+					{
+						pMap->preload[pMap->num_preload++] = iVal;
+					}
+					else
+					{
+						LOG_ERROR("%s: reached max preloads for map '%s'", snd_config_error, pMap->name);
+					}
+				}
 				else
 				{
 					LOG_ERROR("%s: Boundary definition expected. Found: %s", snd_config_error, attributeNode->name);
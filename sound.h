@@ -49,6 +49,9 @@ extern ALfloat warnings_gain; /*!< gain for user configured text warning sound e
 
 extern char sound_device[30];
 extern int afk_snd_warning;
+#ifdef	SOUND_ASYNC_DECODE
+extern int sound_cache_size; /*!< size of the decoded sample cache in MB, 0 keeps no decoded samples */
+#endif	/* SOUND_ASYNC_DECODE */
 
 #define MAX_SOUND_NAME_LENGTH 40
 
@@ -304,6 +307,19 @@ void check_sound_alerts(const Uint8* text, size_t len, Uint8 channel);
 #ifdef DEBUG_MAP_SOUND
 void print_sound_boundaries(int map);
 #endif // DEBUG_MAP_SOUND
+#ifdef	SOUND_ASYNC_DECODE
+/*!
+ * \ingroup sound
+ * \brief Prints the statistics of the sample decoding.
+ *
+ *      Prints the size of the decoded sample cache, its hit rate and the decode times to the console.
+ *
+ * \param text	unused
+ * \param len	unused
+ * \retval int	always 1
+ */
+int command_sound_cache(char *text, int len);
+#endif	/* SOUND_ASYNC_DECODE */
 
 static __inline__ void do_click_sound(){
 	add_sound_object(get_index_for_sound_type_name("Button Click"), 0, 0, 1);
@@ -0,0 +1,549 @@
+#define BOOST_TEST_MODULE actor compositor test
+#include <boost/test/unit_test.hpp>
+#include "../actor_compositor.h"
+#include "../load_gl_extensions.h"
+#include "../elloggingwrapper.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+PFNGLACTIVETEXTUREARBPROC ELglActiveTextureARB;
+PFNGLGENFRAMEBUFFERSEXTPROC ELglGenFramebuffersEXT;
+PFNGLDELETEFRAMEBUFFERSEXTPROC ELglDeleteFramebuffersEXT;
+PFNGLBINDFRAMEBUFFEREXTPROC ELglBindFramebufferEXT;
+PFNGLFRAMEBUFFERTEXTURE2DEXTPROC ELglFramebufferTexture2DEXT;
+PFNGLCHECKFRAMEBUFFERSTATUSEXTPROC ELglCheckFramebufferStatusEXT;
+PFNGLGENERATEMIPMAPEXTPROC ELglGenerateMipmapEXT;
+PFNGLCREATESHADEROBJECTARBPROC ELglCreateShaderObjectARB;
+PFNGLSHADERSOURCEARBPROC ELglShaderSourceARB;
+PFNGLCOMPILESHADERARBPROC ELglCompileShaderARB;
+PFNGLGETOBJECTPARAMETERIVARBPROC ELglGetObjectParameterivARB;
+PFNGLGETINFOLOGARBPROC ELglGetInfoLogARB;
+PFNGLDELETEOBJECTARBPROC ELglDeleteObjectARB;
+PFNGLCREATEPROGRAMOBJECTARBPROC ELglCreateProgramObjectARB;
+PFNGLATTACHOBJECTARBPROC ELglAttachObjectARB;
+PFNGLLINKPROGRAMARBPROC ELglLinkProgramARB;
+PFNGLUSEPROGRAMOBJECTARBPROC ELglUseProgramObjectARB;
+PFNGLGETUNIFORMLOCATIONARBPROC ELglGetUniformLocationARB;
+PFNGLUNIFORM1IARBPROC ELglUniform1iARB;
+PFNGLUNIFORM1FARBPROC ELglUniform1fARB;
+PFNGLGETHANDLEARBPROC ELglGetHandleARB;
+float anisotropic_filter = 4.0f;
+
+extern "C" void log_error(const char* file, const Uint32 line,
+	const char* message, ...)
+{
+	va_list ap;
+
+	va_start(ap, message);
+	fprintf(stderr, "%s:%u: ", file, line);
+	vfprintf(stderr, message, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+}
+
+namespace
+{
+
+	typedef std::vector<Uint8> Pixels;
+
+	template <typename T>
+	void get_proc(T &proc, const char* name)
+	{
+		proc = reinterpret_cast<T>(eglGetProcAddress(name));
+
+		BOOST_REQUIRE_MESSAGE(proc != 0, name);
+	}
+
+	/* Renders with the software OpenGL of Mesa without a window, the
+	 * test is skipped if there is no such display. */
+	class Context
+	{
+		private:
+			EGLDisplay m_display;
+			EGLContext m_context;
+
+		public:
+			Context(): m_display(EGL_NO_DISPLAY),
+				m_context(EGL_NO_CONTEXT)
+			{
+				PFNEGLGETPLATFORMDISPLAYEXTPROC get_display;
+
+				get_display = reinterpret_cast<
+					PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+					eglGetProcAddress(
+					"eglGetPlatformDisplayEXT"));
+
+				if (get_display == 0)
+				{
+					return;
+				}
+
+				m_display = get_display(
+					EGL_PLATFORM_SURFACELESS_MESA,
+					EGL_DEFAULT_DISPLAY, 0);
+
+				if ((m_display == EGL_NO_DISPLAY) ||
+					!eglInitialize(m_display, 0, 0) ||
+					!eglBindAPI(EGL_OPENGL_API))
+				{
+					m_display = EGL_NO_DISPLAY;
+
+					return;
+				}
+
+				m_context = eglCreateContext(m_display,
+					EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, 0);
+
+				if ((m_context == EGL_NO_CONTEXT) ||
+					!eglMakeCurrent(m_display,
+						EGL_NO_SURFACE, EGL_NO_SURFACE,
+						m_context))
+				{
+					m_context = EGL_NO_CONTEXT;
+
+					return;
+				}
+
+				get_proc(ELglActiveTextureARB,
+					"glActiveTextureARB");
+				get_proc(ELglGenFramebuffersEXT,
+					"glGenFramebuffersEXT");
+				get_proc(ELglDeleteFramebuffersEXT,
+					"glDeleteFramebuffersEXT");
+				get_proc(ELglBindFramebufferEXT,
+					"glBindFramebufferEXT");
+				get_proc(ELglFramebufferTexture2DEXT,
+					"glFramebufferTexture2DEXT");
+				get_proc(ELglCheckFramebufferStatusEXT,
+					"glCheckFramebufferStatusEXT");
+				get_proc(ELglGenerateMipmapEXT,
+					"glGenerateMipmapEXT");
+				get_proc(ELglCreateShaderObjectARB,
+					"glCreateShaderObjectARB");
+				get_proc(ELglShaderSourceARB,
+					"glShaderSourceARB");
+				get_proc(ELglCompileShaderARB,
+					"glCompileShaderARB");
+				get_proc(ELglGetObjectParameterivARB,
+					"glGetObjectParameterivARB");
+				get_proc(ELglGetInfoLogARB, "glGetInfoLogARB");
+				get_proc(ELglDeleteObjectARB,
+					"glDeleteObjectARB");
+				get_proc(ELglCreateProgramObjectARB,
+					"glCreateProgramObjectARB");
+				get_proc(ELglAttachObjectARB,
+					"glAttachObjectARB");
+				get_proc(ELglLinkProgramARB,
+					"glLinkProgramARB");
+				get_proc(ELglUseProgramObjectARB,
+					"glUseProgramObjectARB");
+				get_proc(ELglGetUniformLocationARB,
+					"glGetUniformLocationARB");
+				get_proc(ELglUniform1iARB, "glUniform1iARB");
+				get_proc(ELglUniform1fARB, "glUniform1fARB");
+				get_proc(ELglGetHandleARB, "glGetHandleARB");
+			}
+
+			~Context()
+			{
+				if (m_context != EGL_NO_CONTEXT)
+				{
+					free_actor_compositor();
+
+					eglMakeCurrent(m_display, EGL_NO_SURFACE,
+						EGL_NO_SURFACE, EGL_NO_CONTEXT);
+					eglDestroyContext(m_display, m_context);
+				}
+
+				if (m_display != EGL_NO_DISPLAY)
+				{
+					eglTerminate(m_display);
+				}
+			}
+
+			bool is_valid() const
+			{
+				return m_context != EGL_NO_CONTEXT;
+			}
+	};
+
+	/* A part of the layout with the images it is built from, the rows of
+	 * the images are in the order of the texture rows. */
+	class Layer
+	{
+		public:
+			Uint32 x, y, width, height;
+			Pixels part, base, mask;
+
+			Layer(const Uint32 x, const Uint32 y, const Uint32 width,
+				const Uint32 height, const Uint32 scale,
+				const bool masked, Uint32 &seed): x(x), y(y),
+				width(width), height(height)
+			{
+				Uint32 size;
+
+				size = width * height * scale * scale;
+
+				random_pixels(part, size * 4, seed);
+
+				if (masked)
+				{
+					random_pixels(base, size * 4, seed);
+					random_pixels(mask, size, seed);
+				}
+			}
+
+			static void random_pixels(Pixels &pixels,
+				const Uint32 size, Uint32 &seed)
+			{
+				Uint32 i;
+
+				pixels.resize(size);
+
+				for (i = 0; i < size; i++)
+				{
+					seed = seed * 1103515245 + 12345;
+					pixels[i] = (seed >> 16) & 0xFF;
+				}
+			}
+	};
+
+	GLuint upload(const Pixels &pixels, const Uint32 width,
+		const Uint32 height, const bool alpha)
+	{
+		GLuint id;
+
+		if (pixels.empty())
+		{
+			return 0;
+		}
+
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D, id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+			GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+			GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+			GL_CLAMP_TO_EDGE);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		if (alpha)
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, width,
+				height, 0, GL_ALPHA, GL_UNSIGNED_BYTE,
+				&pixels[0]);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width,
+				height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+				&pixels[0]);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		return id;
+	}
+
+	/* Builds the texture like copy_to_coordinates() and
+	 * copy_to_coordinates_mask2() with fast_blend() do. */
+	void build_reference(const std::vector<Layer> &layers,
+		const Uint32 scale, Pixels &result)
+	{
+		Uint32 i, j, k, c, size, width, src, dst, m, tmp;
+
+		size = ACTOR_TEXTURE_LAYOUT_SIZE * scale;
+
+		result.assign(size * size * 4, 0xFF);
+
+		for (i = 0; i < layers.size(); i++)
+		{
+			const Layer &layer = layers[i];
+
+			width = layer.width * scale;
+
+			for (j = 0; j < layer.height * scale; j++)
+			{
+				for (k = 0; k < width; k++)
+				{
+					src = j * width + k;
+					dst = (layer.y * scale + j) * size +
+						layer.x * scale + k;
+
+					for (c = 0; c < 4; c++)
+					{
+						if (layer.mask.empty())
+						{
+							tmp = layer.part[src * 4 + c];
+						}
+						else
+						{
+							m = layer.mask[src];
+							tmp = layer.part[src * 4 + c] * m;
+							tmp += layer.base[src * 4 + c] *
+								(255 - m);
+							tmp /= 255;
+						}
+
+						result[dst * 4 + c] = tmp;
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Builds the texture on the GPU and on the CPU, returns the largest
+	 * difference. The frame buffer and program object of the caller must
+	 * be bound again afterwards.
+	 */
+	Uint32 compare(const std::vector<Layer> &layers, const Uint32 scale,
+		const GLint caller_fbo = 0, const GLint caller_program = 0)
+	{
+		std::vector<actor_texture_layer_t> gpu_layers;
+		actor_texture_layer_t gpu_layer;
+		Pixels reference, result;
+		GLuint texture;
+		GLint viewport[4], program, fbo, width;
+		GLfloat anisotropy;
+		Uint32 i, size, error;
+
+		for (i = 0; i < layers.size(); i++)
+		{
+			const Layer &layer = layers[i];
+
+			gpu_layer.part = upload(layer.part, layer.width * scale,
+				layer.height * scale, false);
+			gpu_layer.base = upload(layer.base, layer.width * scale,
+				layer.height * scale, false);
+			gpu_layer.mask = upload(layer.mask, layer.width * scale,
+				layer.height * scale, true);
+			gpu_layer.x = layer.x;
+			gpu_layer.y = layer.y;
+			gpu_layer.width = layer.width;
+			gpu_layer.height = layer.height;
+
+			gpu_layers.push_back(gpu_layer);
+		}
+
+		glViewport(1, 2, 3, 4);
+
+		texture = build_actor_texture(&gpu_layers[0], gpu_layers.size(),
+			scale, GL_LINEAR_MIPMAP_LINEAR, 1);
+
+		BOOST_REQUIRE(texture != 0);
+
+		// the state of the caller is kept
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		program = static_cast<GLint>(ELglGetHandleARB(
+			GL_PROGRAM_OBJECT_ARB));
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &fbo);
+
+		BOOST_CHECK_EQUAL(viewport[0], 1);
+		BOOST_CHECK_EQUAL(viewport[3], 4);
+		BOOST_CHECK_EQUAL(program, caller_program);
+		BOOST_CHECK_EQUAL(fbo, caller_fbo);
+
+		size = ACTOR_TEXTURE_LAYOUT_SIZE * scale;
+		result.resize(size * size * 4);
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+			&result[0]);
+
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 1, GL_TEXTURE_WIDTH,
+			&width);
+
+		BOOST_CHECK_EQUAL(width, static_cast<GLint>(size / 2));
+
+		glGetTexParameterfv(GL_TEXTURE_2D,
+			GL_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+
+		BOOST_CHECK_EQUAL(anisotropy, anisotropic_filter);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(1, &texture);
+
+		for (i = 0; i < gpu_layers.size(); i++)
+		{
+			glDeleteTextures(1, &gpu_layers[i].part);
+
+			if (gpu_layers[i].base != 0)
+			{
+				glDeleteTextures(1, &gpu_layers[i].base);
+				glDeleteTextures(1, &gpu_layers[i].mask);
+			}
+		}
+
+		BOOST_CHECK_EQUAL(glGetError(), GL_NO_ERROR);
+
+		build_reference(layers, scale, reference);
+
+		error = 0;
+
+		for (i = 0; i < result.size(); i++)
+		{
+			error = std::max(error, static_cast<Uint32>(std::abs(
+				result[i] - reference[i])));
+		}
+
+		return error;
+	}
+
+	void build_layers(const Uint32 scale, std::vector<Layer> &layers)
+	{
+		Uint32 seed;
+
+		seed = 4711;
+
+		// the layout of load_enhanced_actor_threaded(), the head
+		// is drawn over the hair
+		layers.push_back(Layer(39, 88, 40, 40, scale, true, seed));
+		layers.push_back(Layer(0, 88, 39, 40, scale, true, seed));
+		layers.push_back(Layer(79, 74, 49, 54, scale, true, seed));
+		layers.push_back(Layer(34, 32, 16, 16, scale, true, seed));
+		layers.push_back(Layer(34, 0, 32, 32, scale, true, seed));
+		layers.push_back(Layer(0, 0, 34, 48, scale, false, seed));
+		layers.push_back(Layer(40, 74, 39, 14, scale, false, seed));
+		layers.push_back(Layer(66, 0, 62, 38, scale, false, seed));
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(cpu_and_gpu_textures)
+{
+	Context context;
+	std::vector<Layer> layers;
+	Uint32 scale;
+
+	if (!context.is_valid())
+	{
+		BOOST_TEST_MESSAGE("No software OpenGL, test skipped");
+
+		return;
+	}
+
+	BOOST_REQUIRE(init_actor_compositor() != 0);
+
+	for (scale = 1; scale <= 4; scale *= 2)
+	{
+		layers.clear();
+
+		build_layers(scale, layers);
+
+		// the GPU rounds the blend, the CPU truncates it
+		BOOST_CHECK_LE(compare(layers, scale), 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(empty_texture)
+{
+	Context context;
+	std::vector<Layer> layers;
+	Uint32 seed;
+
+	if (!context.is_valid())
+	{
+		BOOST_TEST_MESSAGE("No software OpenGL, test skipped");
+
+		return;
+	}
+
+	seed = 1;
+
+	// a single part, the rest of the texture stays white
+	layers.push_back(Layer(89, 38, 39, 36, 1, false, seed));
+
+	BOOST_CHECK_EQUAL(compare(layers, 1), 0);
+}
+
+BOOST_AUTO_TEST_CASE(caller_state)
+{
+	PFNGLGENPROGRAMSARBPROC gen_programs;
+	PFNGLBINDPROGRAMARBPROC bind_program;
+	PFNGLPROGRAMSTRINGARBPROC program_string;
+	PFNGLDELETEPROGRAMSARBPROC delete_programs;
+	Context context;
+	std::vector<Layer> layers;
+	GLhandleARB program, shader;
+	GLuint vertex_program, fbo, texture;
+	GLboolean enabled;
+	const char* vertex_source;
+	const char* fragment_source;
+
+	if (!context.is_valid())
+	{
+		BOOST_TEST_MESSAGE("No software OpenGL, test skipped");
+
+		return;
+	}
+
+	get_proc(gen_programs, "glGenProgramsARB");
+	get_proc(bind_program, "glBindProgramARB");
+	get_proc(program_string, "glProgramStringARB");
+	get_proc(delete_programs, "glDeleteProgramsARB");
+
+	// like a reflection or shadow pass drawing the actors with the
+	// animation program
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA,
+		GL_UNSIGNED_BYTE, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	ELglGenFramebuffersEXT(1, &fbo);
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, fbo);
+	ELglFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+		GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, texture, 0);
+
+	// moves every vertex to one point, nothing would be drawn with it
+	vertex_source = "!!ARBvp1.0\n"
+		"MOV result.position, {0.0, 0.0, 0.0, 1.0};\n"
+		"MOV result.texcoord[0], vertex.texcoord[0];\n"
+		"END\n";
+
+	gen_programs(1, &vertex_program);
+	bind_program(GL_VERTEX_PROGRAM_ARB, vertex_program);
+	program_string(GL_VERTEX_PROGRAM_ARB, GL_PROGRAM_FORMAT_ASCII_ARB,
+		strlen(vertex_source), vertex_source);
+	glEnable(GL_VERTEX_PROGRAM_ARB);
+
+	fragment_source = "void main() { gl_FragColor = vec4(0.0); }\n";
+
+	shader = ELglCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB);
+	ELglShaderSourceARB(shader, 1, &fragment_source, NULL);
+	ELglCompileShaderARB(shader);
+	program = ELglCreateProgramObjectARB();
+	ELglAttachObjectARB(program, shader);
+	ELglLinkProgramARB(program);
+	ELglUseProgramObjectARB(program);
+
+	BOOST_REQUIRE_EQUAL(glGetError(), GL_NO_ERROR);
+
+	build_layers(1, layers);
+
+	BOOST_CHECK_LE(compare(layers, 1, fbo, program), 1);
+
+	glGetBooleanv(GL_VERTEX_PROGRAM_ARB, &enabled);
+
+	BOOST_CHECK(enabled);
+
+	ELglUseProgramObjectARB(0);
+	ELglDeleteObjectARB(shader);
+	ELglDeleteObjectARB(program);
+	glDisable(GL_VERTEX_PROGRAM_ARB);
+	bind_program(GL_VERTEX_PROGRAM_ARB, 0);
+	delete_programs(1, &vertex_program);
+	ELglBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+	ELglDeleteFramebuffersEXT(1, &fbo);
+	glDeleteTextures(1, &texture);
+}
@@ -0,0 +1,169 @@
+#define BOOST_TEST_MODULE aho corasick test
+#include <boost/test/unit_test.hpp>
+#include "../aho_corasick.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+
+namespace
+{
+
+	typedef std::set<std::pair<Uint32, Uint32> > Matches;
+
+	bool same_char(const char a, const char b)
+	{
+		return (((a >= 'A') && (a <= 'Z')) ? a + 32 : a) ==
+			(((b >= 'A') && (b <= 'Z')) ? b + 32 : b);
+	}
+
+	/**
+	 * All (end, pattern) pairs, found by comparing every pattern at
+	 * every position.
+	 */
+	Matches find_naive(const std::vector<std::string> &patterns,
+		const std::string &text)
+	{
+		Matches result;
+		Uint32 i, j, k;
+
+		for (i = 0; i < text.length(); i++)
+		{
+			for (j = 0; j < patterns.size(); j++)
+			{
+				if (patterns[j].empty() ||
+					((i + patterns[j].length()) > text.length()))
+				{
+					continue;
+				}
+
+				for (k = 0; k < patterns[j].length(); k++)
+				{
+					if (!same_char(patterns[j][k], text[i + k]))
+					{
+						break;
+					}
+				}
+
+				if (k == patterns[j].length())
+				{
+					result.insert(std::make_pair(i + k - 1, j));
+				}
+			}
+		}
+
+		return result;
+	}
+
+	Matches find(const std::vector<std::string> &patterns,
+		const std::string &text)
+	{
+		aho_corasick_t automaton;
+		std::vector<const char*> data;
+		std::vector<Uint32> lengths;
+		Matches result;
+		Uint32 i, j, state;
+
+		memset(&automaton, 0, sizeof(automaton));
+
+		for (i = 0; i < patterns.size(); i++)
+		{
+			data.push_back(patterns[i].c_str());
+			lengths.push_back(patterns[i].length());
+		}
+
+		aho_corasick_build(&automaton, data.empty() ? 0 : &data[0],
+			lengths.empty() ? 0 : &lengths[0], patterns.size());
+
+		state = 0;
+
+		for (i = 0; i < text.length(); i++)
+		{
+			state = aho_corasick_next(&automaton, state, text[i]);
+
+			for (j = automaton.match_offsets[state];
+				j < automaton.match_offsets[state + 1]; j++)
+			{
+				BOOST_CHECK(result.insert(std::make_pair(i,
+					automaton.matches[j])).second);
+				BOOST_CHECK_LE(automaton.pattern_lengths[
+					automaton.matches[j]],
+					automaton.depths[state]);
+			}
+		}
+
+		aho_corasick_free(&automaton);
+
+		return result;
+	}
+
+	std::string make_string(const Uint32 size, const char* alphabet,
+		Uint32 &seed)
+	{
+		std::string result;
+		Uint32 i, count;
+
+		count = strlen(alphabet);
+
+		for (i = 0; i < size; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			result += alphabet[(seed >> 16) % count];
+		}
+
+		return result;
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(fixed_patterns)
+{
+	std::vector<std::string> patterns;
+	Matches matches;
+
+	patterns.push_back("he");
+	patterns.push_back("She");
+	patterns.push_back("his");
+	patterns.push_back("hers");
+	patterns.push_back("");
+	patterns.push_back("he");
+
+	matches = find(patterns, "USHERS and his sheep");
+
+	BOOST_CHECK(matches == find_naive(patterns, "USHERS and his sheep"));
+	BOOST_CHECK(matches.count(std::make_pair(3, 1)) == 1);
+	BOOST_CHECK(matches.count(std::make_pair(3, 0)) == 1);
+	BOOST_CHECK(matches.count(std::make_pair(3, 5)) == 1);
+	BOOST_CHECK(matches.count(std::make_pair(5, 3)) == 1);
+	BOOST_CHECK(matches.count(std::make_pair(13, 2)) == 1);
+	BOOST_CHECK_EQUAL(matches.size(), 8);
+
+	patterns.clear();
+
+	BOOST_CHECK(find(patterns, "nothing to find").empty());
+}
+
+BOOST_AUTO_TEST_CASE(random_patterns)
+{
+	std::vector<std::string> patterns;
+	std::string text;
+	Uint32 i, j, seed;
+
+	seed = 1;
+
+	for (i = 0; i < 20; i++)
+	{
+		patterns.clear();
+
+		for (j = 0; j < (i * 5 + 1); j++)
+		{
+			patterns.push_back(make_string(seed % 6 + 1, "abAB c",
+				seed));
+		}
+
+		text = make_string(2000, "abcABC \xE4", seed);
+
+		BOOST_CHECK(find(patterns, text) == find_naive(patterns, text));
+	}
+}
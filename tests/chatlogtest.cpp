@@ -0,0 +1,304 @@
+#define BOOST_TEST_MODULE chat log test
+#include <boost/test/unit_test.hpp>
+#include "../io/chat_log.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+	typedef std::vector<std::string> Lines;
+
+	const char* names[] = { "Alice", "bob", "Carol_2", "dave" };
+
+	std::string make_line(const Uint32 number)
+	{
+		char str[128];
+
+		snprintf(str, sizeof(str), "%s: line %u of the chat %s",
+			names[number % 4], number, (number % 5) ? "" : "needle");
+
+		return str;
+	}
+
+	void add_line(chat_log_batch_t &batch, const std::string &line,
+		const Uint32 time, const Uint8 channel, const char* sender)
+	{
+		memcpy(chat_log_batch_reserve(&batch, line.length() + 1),
+			line.c_str(), line.length());
+		chat_log_batch_add_line(&batch, line.length(), time, channel,
+			chat_log_sender_hash(sender, strlen(sender)));
+	}
+
+	/**
+	 * Writes count lines in batches of seven, with a banner that is not
+	 * in the index after each batch.
+	 */
+	void write_lines(chat_log_store_t &store, const Uint32 first,
+		const Uint32 count)
+	{
+		chat_log_batch_t batch;
+		Uint32 i;
+
+		memset(&batch, 0, sizeof(batch));
+
+		for (i = first; i < (first + count); i++)
+		{
+			add_line(batch, make_line(i), 1000 + i, i % 3,
+				names[i % 4]);
+
+			if ((i % 7) == 6)
+			{
+				chat_log_batch_add_text(&batch, "\nbanner\n\n", 9);
+				BOOST_CHECK_EQUAL(chat_log_store_commit(&store,
+					&batch), 0);
+			}
+		}
+
+		BOOST_CHECK_EQUAL(chat_log_store_commit(&store, &batch), 0);
+
+		chat_log_batch_free(&batch);
+	}
+
+	void add_found(const char* line, const Uint32 length, const Uint32 time,
+		const Uint8 channel, void* data)
+	{
+		static_cast<Lines*>(data)->push_back(std::string(line, length));
+	}
+
+	Lines search(chat_log_store_t &store, const chat_log_query_t &query)
+	{
+		Lines result;
+		int count;
+
+		count = chat_log_search(store.log, store.index, &query, add_found,
+			&result);
+
+		BOOST_CHECK_EQUAL(count, static_cast<int>(result.size()));
+
+		return result;
+	}
+
+	chat_log_query_t make_query(const char* text)
+	{
+		chat_log_query_t query;
+
+		memset(&query, 0, sizeof(query));
+		query.text = text;
+
+		return query;
+	}
+
+	std::string read_file(FILE* file)
+	{
+		std::string result;
+		char buffer[4096];
+		size_t size;
+
+		fflush(file);
+		fseek(file, 0, SEEK_SET);
+
+		while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			result.append(buffer, size);
+		}
+
+		return result;
+	}
+
+	FILE* make_file(const std::string &data)
+	{
+		FILE* file;
+
+		file = tmpfile();
+
+		BOOST_REQUIRE(file != 0);
+
+		fwrite(data.c_str(), data.length(), 1, file);
+		fflush(file);
+
+		return file;
+	}
+
+	/**
+	 * Opens a log and its index like they were left by a crash, then
+	 * checks that the index only has complete lines and that new lines
+	 * are written and found.
+	 */
+	void check_recovery(const std::string &log, const std::string &index,
+		const Uint32 lines_in_log)
+	{
+		chat_log_store_t store;
+		chat_log_batch_t batch;
+		chat_log_query_t query;
+		Lines found;
+		std::string data;
+		Uint32 i, expected;
+
+		BOOST_REQUIRE_EQUAL(chat_log_store_open(&store, make_file(log),
+			make_file(index)), 0);
+
+		expected = std::min<Uint32>(lines_in_log,
+			index.length() / CHAT_LOG_INDEX_RECORD_SIZE);
+
+		BOOST_CHECK_EQUAL(store.line_count, expected);
+
+		query = make_query("");
+		found = search(store, query);
+
+		BOOST_REQUIRE_EQUAL(found.size(), expected);
+
+		for (i = 0; i < expected; i++)
+		{
+			BOOST_CHECK_EQUAL(found[i], make_line(i));
+		}
+
+		memset(&batch, 0, sizeof(batch));
+		add_line(batch, "Eve: after the crash", 5000, 1, "Eve");
+		BOOST_CHECK_EQUAL(chat_log_store_commit(&store, &batch), 0);
+		chat_log_batch_free(&batch);
+
+		query = make_query("after the crash");
+		query.sender = chat_log_sender_hash("eve", 3);
+		query.use_sender = 1;
+		found = search(store, query);
+
+		BOOST_REQUIRE_EQUAL(found.size(), 1);
+		BOOST_CHECK_EQUAL(found[0], "Eve: after the crash");
+
+		data = read_file(store.log);
+
+		BOOST_CHECK((data == "Eve: after the crash\n") ||
+			(data.find("\nEve: after the crash\n") !=
+			std::string::npos));
+		BOOST_CHECK_EQUAL(read_file(store.index).length(),
+			(expected + 1) * CHAT_LOG_INDEX_RECORD_SIZE);
+
+		chat_log_store_close(&store);
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(write_and_search)
+{
+	chat_log_store_t store;
+	chat_log_query_t query;
+	Lines found;
+	Uint32 i;
+
+	BOOST_REQUIRE_EQUAL(chat_log_store_open(&store, make_file(""),
+		make_file("")), 0);
+
+	write_lines(store, 0, 100);
+
+	BOOST_CHECK_EQUAL(store.line_count, 100);
+
+	query = make_query(0);
+	found = search(store, query);
+
+	BOOST_REQUIRE_EQUAL(found.size(), 100);
+
+	for (i = 0; i < 100; i++)
+	{
+		BOOST_CHECK_EQUAL(found[i], make_line(i));
+	}
+
+	query = make_query("NEEDLE");
+	BOOST_CHECK_EQUAL(search(store, query).size(), 20);
+
+	query.from_time = 1050;
+	BOOST_CHECK_EQUAL(search(store, query).size(), 10);
+
+	query = make_query("");
+	query.channel = 1;
+	query.use_channel = 1;
+	BOOST_CHECK_EQUAL(search(store, query).size(), 33);
+
+	query.sender = chat_log_sender_hash("CAROL_2", 7);
+	query.use_sender = 1;
+	found = search(store, query);
+
+	BOOST_REQUIRE_EQUAL(found.size(), 8);
+	BOOST_CHECK_EQUAL(found[0], make_line(10));
+
+	query = make_query("not in the log");
+	BOOST_CHECK(search(store, query).empty());
+
+	chat_log_store_close(&store);
+}
+
+BOOST_AUTO_TEST_CASE(clock_going_back)
+{
+	chat_log_store_t store;
+	chat_log_batch_t batch;
+	chat_log_query_t query;
+
+	BOOST_REQUIRE_EQUAL(chat_log_store_open(&store, make_file(""),
+		make_file("")), 0);
+
+	memset(&batch, 0, sizeof(batch));
+	add_line(batch, "first", 2000, 0, "a");
+	add_line(batch, "second", 1990, 0, "a");
+	add_line(batch, "third", 2010, 0, "a");
+	BOOST_CHECK_EQUAL(chat_log_store_commit(&store, &batch), 0);
+	chat_log_batch_free(&batch);
+
+	query = make_query("");
+	query.from_time = 1995;
+	BOOST_CHECK_EQUAL(search(store, query).size(), 3);
+
+	query.from_time = 2001;
+	BOOST_CHECK_EQUAL(search(store, query).size(), 1);
+
+	chat_log_store_close(&store);
+}
+
+BOOST_AUTO_TEST_CASE(crash_recovery)
+{
+	chat_log_store_t store;
+	std::vector<Uint32> line_ends;
+	std::string log, index;
+	Uint32 i, lines;
+
+	BOOST_REQUIRE_EQUAL(chat_log_store_open(&store, make_file(""),
+		make_file("")), 0);
+
+	write_lines(store, 0, 40);
+
+	log = read_file(store.log);
+	index = read_file(store.index);
+
+	chat_log_store_close(&store);
+
+	BOOST_REQUIRE_EQUAL(index.length(), 40 * CHAT_LOG_INDEX_RECORD_SIZE);
+
+	for (i = 0; i < 40; i++)
+	{
+		line_ends.push_back(log.find(make_line(i) + "\n") +
+			make_line(i).length() + 1);
+	}
+
+	// the log is cut anywhere, the index has records past its end
+	for (i = 0; i <= log.length(); i++)
+	{
+		lines = 0;
+
+		while ((lines < 40) && (line_ends[lines] <= i))
+		{
+			lines++;
+		}
+
+		check_recovery(log.substr(0, i), index, lines);
+	}
+
+	// the index is cut anywhere, also in the middle of a record
+	for (i = 0; i <= index.length(); i++)
+	{
+		check_recovery(log, index.substr(0, i), 40);
+	}
+
+	// an old log that has no index yet
+	check_recovery(log, "", 0);
+}
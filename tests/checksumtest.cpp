@@ -0,0 +1,167 @@
+#define BOOST_TEST_MODULE checksum test
+#include <boost/test/unit_test.hpp>
+#include "../io/checksum.h"
+#include "../xz/7zCrc.h"
+#include "../xz/XzCrc64.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+	typedef std::vector<Uint8> Buffer;
+
+	Buffer make_data(const Uint32 size, const Uint32 seed)
+	{
+		Buffer data(size + 1);
+		Uint32 i, value;
+
+		value = seed;
+
+		for (i = 0; i < size; i++)
+		{
+			value = value * 1103515245 + 12345;
+			data[i] = value >> 16;
+		}
+
+		data.resize(size);
+
+		return data;
+	}
+
+	void init(const Uint32 use_simd)
+	{
+		CrcGenerateTable();
+		Crc64GenerateTable();
+		init_checksums(use_simd);
+	}
+
+	void md5(const Buffer &data, MD5_DIGEST digest)
+	{
+		MD5 md5;
+
+		MD5Open(&md5);
+		MD5Digest(&md5, data.empty() ? 0 : &data[0], data.size());
+		MD5Close(&md5, digest);
+	}
+
+	const Uint32 sizes[] = { 0, 1, 15, 16, 17, 63, 64, 65, 127, 128, 255,
+		256, 257, 300, 511, 512, 1000, 4096, 4111, 65536, 100003 };
+	const Uint32 size_count = sizeof(sizes) / sizeof(Uint32);
+
+}
+
+BOOST_AUTO_TEST_CASE(check_values)
+{
+	const char* text = "123456789";
+	const Uint8 md5_check[16] = { 0x25, 0xf9, 0xe7, 0x94, 0x32, 0x3b,
+		0x45, 0x38, 0x85, 0xf5, 0x18, 0x1f, 0x1b, 0x62, 0x4d, 0x0b };
+	const void* data[1];
+	Uint32 size[1];
+	MD5_DIGEST digest[1];
+	Uint32 use_simd;
+
+	for (use_simd = 0; use_simd < 2; use_simd++)
+	{
+		init(use_simd);
+
+		BOOST_CHECK_EQUAL(CrcCalc(text, 9), 0xCBF43926);
+		BOOST_CHECK_EQUAL(Crc64Calc(text, 9), 0x995DC9BBDF1939FAULL);
+
+		data[0] = text;
+		size[0] = 9;
+
+		md5_multi(data, size, 1, digest);
+
+		BOOST_CHECK_EQUAL(memcmp(digest[0], md5_check, 16), 0);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(crc_matches_tables)
+{
+	Buffer data;
+	Uint32 i, offset, crc32, simd_crc32;
+	Uint64 crc64, simd_crc64;
+
+	data = make_data(100003 + 16, 1);
+
+	for (i = 0; i < size_count; i++)
+	{
+		for (offset = 0; offset < 16; offset += 5)
+		{
+			init(0);
+
+			crc32 = CrcUpdate(0x12345678, &data[offset], sizes[i]);
+			crc64 = Crc64Update(0x123456789ABCDEF0ULL, &data[offset],
+				sizes[i]);
+
+			init(1);
+
+			simd_crc32 = CrcUpdate(0x12345678, &data[offset],
+				sizes[i]);
+			simd_crc64 = Crc64Update(0x123456789ABCDEF0ULL,
+				&data[offset], sizes[i]);
+
+			BOOST_CHECK_EQUAL(crc32, simd_crc32);
+			BOOST_CHECK_EQUAL(crc64, simd_crc64);
+		}
+	}
+
+	// crc of the parts must be the crc of the whole data
+	init(1);
+
+	crc32 = CrcUpdate(CRC_INIT_VAL, &data[0], 5000);
+	crc32 = CrcUpdate(crc32, &data[5000], 95003);
+	crc64 = Crc64Update(CRC64_INIT_VAL, &data[0], 5000);
+	crc64 = Crc64Update(crc64, &data[5000], 95003);
+
+	init(0);
+
+	BOOST_CHECK_EQUAL(CRC_GET_DIGEST(crc32), CrcCalc(&data[0], 100003));
+	BOOST_CHECK_EQUAL(CRC64_GET_DIGEST(crc64), Crc64Calc(&data[0],
+		100003));
+}
+
+BOOST_AUTO_TEST_CASE(md5_matches_md5)
+{
+	std::vector<Buffer> buffers;
+	std::vector<const void*> data;
+	std::vector<Uint32> buffer_sizes;
+	MD5_DIGEST digests[size_count * 2];
+	MD5_DIGEST digest;
+	Uint32 i, use_simd, count;
+
+	for (i = 0; i < (size_count * 2); i++)
+	{
+		buffers.push_back(make_data(sizes[(i * 7) % size_count], i));
+	}
+
+	for (use_simd = 0; use_simd < 2; use_simd++)
+	{
+		init(use_simd);
+
+		// every number of buffers up to all, so each lane gets a turn
+		for (count = 1; count <= buffers.size(); count++)
+		{
+			data.clear();
+			buffer_sizes.clear();
+
+			for (i = 0; i < count; i++)
+			{
+				data.push_back(buffers[i].empty() ? 0 :
+					&buffers[i][0]);
+				buffer_sizes.push_back(buffers[i].size());
+			}
+
+			md5_multi(&data[0], &buffer_sizes[0], count, digests);
+
+			for (i = 0; i < count; i++)
+			{
+				md5(buffers[i], digest);
+
+				BOOST_CHECK_EQUAL(memcmp(digests[i], digest, 16),
+					0);
+			}
+		}
+	}
+}
@@ -0,0 +1,180 @@
+#define BOOST_TEST_MODULE dds test
+#include <boost/test/unit_test.hpp>
+#include "../dds.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+	Uint32 channel_error(const Uint8* a, const Uint8* b,
+		const Uint32 channel)
+	{
+		Uint32 i, error;
+
+		error = 0;
+
+		for (i = 0; i < 16; i++)
+		{
+			error = std::max<Uint32>(error,
+				std::abs(a[i * 4 + channel] - b[i * 4 + channel]));
+		}
+
+		return error;
+	}
+
+	void set_texel(Uint8* values, const Uint32 index, const Uint8 r,
+		const Uint8 g, const Uint8 b, const Uint8 a)
+	{
+		values[index * 4 + 0] = r;
+		values[index * 4 + 1] = g;
+		values[index * 4 + 2] = b;
+		values[index * 4 + 3] = a;
+	}
+
+	void pack_and_unpack_dxt1(const Uint8* values, Uint8* result)
+	{
+		DXTColorBlock block;
+
+		pack_dxt1(values, &block);
+
+		// opaque blocks must use the four color mode
+		BOOST_CHECK(block.m_colors[0] >= block.m_colors[1]);
+
+		unpack_dxt1(&block, result);
+	}
+
+	void pack_and_unpack_dxt5(const Uint8* values, Uint8* result)
+	{
+		DXTInterpolatedAlphaBlock alpha_block;
+		DXTColorBlock color_block;
+
+		pack_dxt5(values, &alpha_block, &color_block);
+		unpack_dxt5(&alpha_block, &color_block, result);
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(solid_block)
+{
+	Uint8 values[64], result[64];
+	Uint32 i;
+
+	for (i = 0; i < 16; i++)
+	{
+		set_texel(values, i, 255, 0, 255, 255);
+	}
+
+	pack_and_unpack_dxt1(values, result);
+
+	BOOST_CHECK_EQUAL(memcmp(values, result, sizeof(values)), 0);
+
+	for (i = 0; i < 16; i++)
+	{
+		set_texel(values, i, 100, 150, 200, 77);
+	}
+
+	pack_and_unpack_dxt5(values, result);
+
+	BOOST_CHECK_LE(channel_error(values, result, 0), 4);
+	BOOST_CHECK_LE(channel_error(values, result, 1), 2);
+	BOOST_CHECK_LE(channel_error(values, result, 2), 4);
+	BOOST_CHECK_EQUAL(channel_error(values, result, 3), 0);
+}
+
+BOOST_AUTO_TEST_CASE(two_colors)
+{
+	Uint8 values[64], result[64];
+	Uint32 i;
+
+	// both colors are exact in 565
+	for (i = 0; i < 16; i++)
+	{
+		if ((i % 3) == 0)
+		{
+			set_texel(values, i, 0, 0, 0, 0);
+		}
+		else
+		{
+			set_texel(values, i, 255, 255, 255, 255);
+		}
+	}
+
+	// the unpacking rounds 63 * 255 / 63 down to 254
+	pack_and_unpack_dxt5(values, result);
+
+	BOOST_CHECK_EQUAL(channel_error(values, result, 0), 0);
+	BOOST_CHECK_LE(channel_error(values, result, 1), 1);
+	BOOST_CHECK_EQUAL(channel_error(values, result, 2), 0);
+	BOOST_CHECK_EQUAL(channel_error(values, result, 3), 0);
+
+	for (i = 0; i < 16; i++)
+	{
+		values[i * 4 + 3] = 255;
+	}
+
+	pack_and_unpack_dxt1(values, result);
+
+	BOOST_CHECK_EQUAL(channel_error(values, result, 0), 0);
+	BOOST_CHECK_LE(channel_error(values, result, 1), 1);
+	BOOST_CHECK_EQUAL(channel_error(values, result, 2), 0);
+	BOOST_CHECK_EQUAL(channel_error(values, result, 3), 0);
+}
+
+BOOST_AUTO_TEST_CASE(gradient)
+{
+	Uint8 values[64], result[64];
+	Uint32 i;
+
+	for (i = 0; i < 16; i++)
+	{
+		set_texel(values, i, 40 + i * 8, 200 - i * 6, 90 + i * 2,
+			i * 17);
+	}
+
+	pack_and_unpack_dxt5(values, result);
+
+	BOOST_CHECK_LE(channel_error(values, result, 0), 24);
+	BOOST_CHECK_LE(channel_error(values, result, 1), 16);
+	BOOST_CHECK_LE(channel_error(values, result, 2), 12);
+	// (255 - 0) / 14 is the largest error of eight alphas
+	BOOST_CHECK_LE(channel_error(values, result, 3), 19);
+}
+
+BOOST_AUTO_TEST_CASE(random_blocks)
+{
+	Uint8 values[64], result[64];
+	Uint64 error;
+	Uint32 i, j, seed;
+	int d;
+
+	seed = 12345;
+	error = 0;
+
+	for (i = 0; i < 1000; i++)
+	{
+		for (j = 0; j < 64; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			values[j] = (seed >> 16) & 0xFF;
+		}
+
+		pack_and_unpack_dxt5(values, result);
+
+		for (j = 0; j < 64; j++)
+		{
+			if ((j % 4) != 3)
+			{
+				d = values[j] - result[j];
+				error += d * d;
+			}
+		}
+
+		// the alphas are in the range of the block
+		BOOST_CHECK_LE(channel_error(values, result, 3), 19);
+	}
+
+	// noise is the worst case, the mean error stays below a third of
+	// the range
+	BOOST_CHECK_LT(error / (1000 * 48), 85 * 85);
+}
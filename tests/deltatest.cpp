@@ -0,0 +1,329 @@
+#define BOOST_TEST_MODULE delta test
+#include <boost/test/unit_test.hpp>
+#include "../io/delta.h"
+#include "../io/http_response.h"
+#include "stubserver.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+namespace
+{
+
+	Buffer make_data(const Uint32 size, const Uint32 seed)
+	{
+		Buffer data(size);
+		Uint32 i, value;
+
+		value = seed;
+
+		for (i = 0; i < size; i++)
+		{
+			value = value * 1103515245 + 12345;
+			data[i] = value >> 16;
+		}
+
+		return data;
+	}
+
+	// changes a few bytes, inserts and removes some runs
+	Buffer modify(const Buffer &source)
+	{
+		Buffer result, insert;
+		Uint32 i;
+
+		result = source;
+
+		for (i = 0; i < result.size(); i += 4099)
+		{
+			result[i] ^= 0x5A;
+		}
+
+		insert = make_data(333, 7);
+
+		result.insert(result.begin() + result.size() / 3,
+			insert.begin(), insert.end());
+		result.erase(result.begin() + result.size() / 2,
+			result.begin() + result.size() / 2 + 1000);
+
+		return result;
+	}
+
+	Buffer create(const Buffer &source, const Buffer &target)
+	{
+		void* patch;
+		Uint64 size;
+		Buffer result;
+
+		BOOST_REQUIRE_EQUAL(delta_patch_create(&source[0],
+			source.size(), target.empty() ? 0 : &target[0],
+			target.size(), &patch, &size), 0);
+
+		result.assign(static_cast<Uint8*>(patch),
+			static_cast<Uint8*>(patch) + size);
+
+		free(patch);
+
+		return result;
+	}
+
+	Uint32 apply(const Buffer &source, const Buffer &patch,
+		const Uint32 chunk_size, Buffer &target)
+	{
+		delta_patch_t state;
+		Uint32 i, size, result;
+
+		delta_patch_init(&state, &source[0], source.size());
+
+		result = 0;
+
+		for (i = 0; (i < patch.size()) && (result == 0); i += chunk_size)
+		{
+			size = std::min<Uint32>(chunk_size, patch.size() - i);
+
+			result = delta_patch_apply(&state, &patch[i], size);
+		}
+
+		if (result == 0)
+		{
+			result = delta_patch_finish(&state);
+		}
+
+		if (result == 0)
+		{
+			target.assign(state.data, state.data + state.size);
+		}
+
+		delta_patch_free(&state);
+
+		return result;
+	}
+
+	/**
+	 * Gets a file from the server, returns the http status. If a patch
+	 * state is given, the received data is applied to it while it arrives
+	 * and dropped, like the updater does.
+	 */
+	Uint32 get(const StubServer &server, const std::string &path,
+		Buffer &data, delta_patch_t* patch = 0, Uint32* patch_error = 0)
+	{
+		http_response_t response;
+		std::string request;
+		char buffer[4096];
+		Sint32 len, used;
+		int socket;
+
+		memset(&response, 0, sizeof(response));
+		http_response_init(&response);
+
+		socket = connect_to(server.get_port());
+
+		request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n"
+			"Connection: close\r\n\r\n";
+
+		BOOST_REQUIRE_EQUAL(send(socket, request.c_str(),
+			request.length(), 0),
+			static_cast<ssize_t>(request.length()));
+
+		while (response.state != hrs_done)
+		{
+			len = recv(socket, buffer, sizeof(buffer), 0);
+
+			if (len <= 0)
+			{
+				BOOST_REQUIRE_EQUAL(http_response_close(&response),
+					0);
+				break;
+			}
+
+			used = http_response_parse(&response,
+				reinterpret_cast<Uint8*>(buffer), len);
+
+			BOOST_REQUIRE_GE(used, 0);
+
+			if ((patch != 0) && (response.status == 200) &&
+				(response.size > 0))
+			{
+				if (*patch_error == 0)
+				{
+					*patch_error = delta_patch_apply(patch,
+						response.data, response.size);
+				}
+
+				response.size = 0;
+			}
+		}
+
+		close(socket);
+
+		data.assign(response.data, response.data + response.size);
+
+		http_response_free(&response);
+
+		return response.status;
+	}
+
+	/**
+	 * Updates the local file like the updater does: the patch for the
+	 * local md5 is tried first, the full file is used if there is no
+	 * patch or it can't be applied.
+	 */
+	Buffer update(const StubServer &server, const Buffer &local,
+		const std::string &local_md5, bool &patched)
+	{
+		delta_patch_t state;
+		Buffer patch, result;
+		Uint32 error;
+
+		patched = false;
+		error = 0;
+
+		delta_patch_init(&state, &local[0], local.size());
+
+		if ((get(server, "/file." + local_md5 + ".delta", patch, &state,
+			&error) == 200) && (error == 0) &&
+			(delta_patch_finish(&state) == 0))
+		{
+			patched = true;
+
+			result.assign(state.data, state.data + state.size);
+
+			// only the last received part is kept
+			BOOST_CHECK(patch.size() <= 4096);
+		}
+
+		delta_patch_free(&state);
+
+		if (patched)
+		{
+			return result;
+		}
+
+		BOOST_REQUIRE_EQUAL(get(server, "/file", result), 200);
+
+		return result;
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(apply_patch)
+{
+	Buffer source, target, patch, result;
+	Uint32 chunk_size;
+
+	source = make_data(256 * 1024, 1);
+	target = modify(source);
+	patch = create(source, target);
+
+	BOOST_CHECK_LT(patch.size(), target.size() / 20);
+
+	for (chunk_size = 1; chunk_size <= 65536; chunk_size *= 16)
+	{
+		result.clear();
+
+		BOOST_CHECK_EQUAL(apply(source, patch, chunk_size, result), 0);
+		BOOST_CHECK(result == target);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(unrelated_files)
+{
+	Buffer source, target, patch, result;
+
+	source = make_data(10000, 1);
+	target = make_data(12345, 2);
+	patch = create(source, target);
+
+	BOOST_CHECK_EQUAL(apply(source, patch, 4096, result), 0);
+	BOOST_CHECK(result == target);
+
+	target.clear();
+	patch = create(source, target);
+
+	BOOST_CHECK_EQUAL(apply(source, patch, 4096, result), 0);
+	BOOST_CHECK(result.empty());
+}
+
+BOOST_AUTO_TEST_CASE(wrong_source)
+{
+	Buffer source, target, patch, result;
+
+	source = make_data(65536, 1);
+	target = modify(source);
+	patch = create(source, target);
+
+	source[100] ^= 1;
+
+	BOOST_CHECK_NE(apply(source, patch, 4096, result), 0);
+
+	source.pop_back();
+
+	BOOST_CHECK_NE(apply(source, patch, 4096, result), 0);
+}
+
+BOOST_AUTO_TEST_CASE(corrupted_patch)
+{
+	Buffer source, target, patch, broken, result;
+
+	source = make_data(65536, 1);
+	target = modify(source);
+	patch = create(source, target);
+
+	broken = patch;
+	broken[broken.size() - 1] ^= 1;
+
+	BOOST_CHECK_NE(apply(source, broken, 4096, result), 0);
+
+	broken = patch;
+	broken.pop_back();
+
+	BOOST_CHECK_NE(apply(source, broken, 4096, result), 0);
+
+	broken = patch;
+	broken.push_back(0);
+
+	BOOST_CHECK_NE(apply(source, broken, 4096, result), 0);
+
+	broken = patch;
+	broken[0] = 'X';
+
+	BOOST_CHECK_NE(apply(source, broken, 4096, result), 0);
+}
+
+BOOST_AUTO_TEST_CASE(stub_server_update)
+{
+	StubServer server;
+	Buffer old_file, new_file, broken, result;
+	bool patched;
+
+	old_file = make_data(200000, 1);
+	new_file = modify(old_file);
+
+	server.add_file("/file", new_file);
+	server.add_file("/file.0123456789abcdef0123456789abcdef.delta",
+		create(old_file, new_file));
+	server.start();
+
+	result = update(server, old_file, "0123456789abcdef0123456789abcdef",
+		patched);
+
+	BOOST_CHECK(patched);
+	BOOST_CHECK(result == new_file);
+
+	// local file doesn't match the source of the patch
+	broken = old_file;
+	broken[5000] ^= 1;
+
+	result = update(server, broken, "0123456789abcdef0123456789abcdef",
+		patched);
+
+	BOOST_CHECK(!patched);
+	BOOST_CHECK(result == new_file);
+
+	// no patch for this md5
+	result = update(server, old_file, "fedcba9876543210fedcba9876543210",
+		patched);
+
+	BOOST_CHECK(!patched);
+	BOOST_CHECK(result == new_file);
+}
@@ -0,0 +1,507 @@
+#define BOOST_TEST_MODULE http response test
+#include <boost/test/unit_test.hpp>
+#include "../io/http_response.h"
+#include "../xz/XzEnc.h"
+#include "../xz/7zCrc.h"
+#include "../xz/XzCrc64.h"
+#include "stubserver.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+namespace
+{
+
+	struct InStream
+	{
+		ISeqInStream stream;
+		const Buffer* data;
+		size_t pos;
+	};
+
+	struct OutStream
+	{
+		ISeqOutStream stream;
+		Buffer* data;
+	};
+
+	SRes read_in_stream(void* p, void* buf, size_t* size)
+	{
+		InStream* in = static_cast<InStream*>(p);
+
+		*size = std::min(*size, in->data->size() - in->pos);
+
+		if (*size > 0)
+		{
+			memcpy(buf, &(*in->data)[in->pos], *size);
+		}
+
+		in->pos += *size;
+
+		return SZ_OK;
+	}
+
+	size_t write_out_stream(void* p, const void* buf, size_t size)
+	{
+		OutStream* out = static_cast<OutStream*>(p);
+		const Uint8* bytes = static_cast<const Uint8*>(buf);
+
+		out->data->insert(out->data->end(), bytes, bytes + size);
+
+		return size;
+	}
+
+	Buffer compress(const Buffer &data)
+	{
+		CLzma2EncProps props;
+		InStream in;
+		OutStream out;
+		Buffer result;
+
+		CrcGenerateTable();
+		Crc64GenerateTable();
+
+		Lzma2EncProps_Init(&props);
+
+		in.stream.Read = read_in_stream;
+		in.data = &data;
+		in.pos = 0;
+		out.stream.Write = write_out_stream;
+		out.data = &result;
+
+		BOOST_REQUIRE_EQUAL(Xz_Encode(&out.stream, &in.stream, &props,
+			False, 0), SZ_OK);
+
+		return result;
+	}
+
+	Buffer make_data(const Uint32 size, const Uint32 seed)
+	{
+		Buffer data(size);
+		Uint32 i, value;
+
+		value = seed;
+
+		// compressible, but not trivially
+		for (i = 0; i < size; i++)
+		{
+			value = value * 1103515245 + 12345;
+			data[i] = 'a' + ((value >> 16) % 8);
+		}
+
+		return data;
+	}
+
+	void get_digest(const Buffer &data, MD5_DIGEST digest)
+	{
+		MD5 md5;
+
+		MD5Open(&md5);
+
+		if (!data.empty())
+		{
+			MD5Digest(&md5, &data[0], data.size());
+		}
+
+		MD5Close(&md5, digest);
+	}
+
+	Buffer make_chunked_response(const Buffer &body, const Uint32 chunk)
+	{
+		std::string header;
+		Buffer result;
+		char str[32];
+		Uint32 pos, size;
+
+		header = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+		result.insert(result.end(), header.begin(), header.end());
+
+		for (pos = 0; pos < body.size(); pos += size)
+		{
+			size = std::min<Uint32>(chunk, body.size() - pos);
+			snprintf(str, sizeof(str), "%x\r\n", size);
+			result.insert(result.end(), str, str + strlen(str));
+			result.insert(result.end(), body.begin() + pos,
+				body.begin() + pos + size);
+			result.push_back('\r');
+			result.push_back('\n');
+		}
+
+		header = "0\r\nX-Trailer: yes\r\n\r\n";
+		result.insert(result.end(), header.begin(), header.end());
+
+		return result;
+	}
+
+	/**
+	 * Feeds the bytes in parts of the given size and returns the number
+	 * of used bytes.
+	 */
+	Uint32 feed(http_response_t* response, const Buffer &buffer,
+		const Uint32 step)
+	{
+		Sint32 used;
+		Uint32 pos, size;
+
+		pos = 0;
+
+		while ((pos < buffer.size()) && (response->state != hrs_done))
+		{
+			size = std::min<Uint32>(step, buffer.size() - pos);
+			used = http_response_parse(response, &buffer[pos], size);
+
+			BOOST_REQUIRE_GE(used, 0);
+
+			pos += used;
+		}
+
+		return pos;
+	}
+
+	void check_data(const http_response_t* response, const Buffer &data)
+	{
+		MD5_DIGEST digest;
+
+		BOOST_REQUIRE_EQUAL(response->state, hrs_done);
+		BOOST_REQUIRE_EQUAL(response->size, data.size());
+		BOOST_CHECK(memcmp(response->data, &data[0], data.size()) == 0);
+
+		get_digest(data, digest);
+
+		BOOST_CHECK(memcmp(response->data_digest, digest,
+			sizeof(MD5_DIGEST)) == 0);
+	}
+
+	void send_requests(const int socket,
+		const std::vector<std::string> &paths, const Uint32 first,
+		const Uint32 count, const bool keep_alive)
+	{
+		std::string requests;
+		Uint32 i;
+
+		for (i = first; i < (first + count); i++)
+		{
+			requests += "GET " + paths[i] + " HTTP/1.1\r\n"
+				"Host: localhost\r\nConnection: ";
+			requests += keep_alive ? "keep-alive" : "close";
+			requests += "\r\n\r\n";
+		}
+
+		BOOST_REQUIRE_EQUAL(send(socket, requests.c_str(),
+			requests.length(), 0),
+			static_cast<ssize_t>(requests.length()));
+	}
+
+	void receive_response(const int socket, http_response_t* response,
+		Buffer &buffer, Uint32 &pos, Uint32 &size)
+	{
+		Sint32 len;
+
+		http_response_init(response);
+
+		while (response->state != hrs_done)
+		{
+			if (pos >= size)
+			{
+				len = recv(socket, &buffer[0], buffer.size(),
+					0);
+
+				if (len <= 0)
+				{
+					BOOST_REQUIRE_EQUAL(
+						http_response_close(response),
+						0);
+
+					return;
+				}
+
+				pos = 0;
+				size = len;
+			}
+
+			len = http_response_parse(response, &buffer[pos],
+				size - pos);
+
+			BOOST_REQUIRE_GE(len, 0);
+
+			pos += len;
+		}
+	}
+
+	/**
+	 * Downloads all files, either over one connection with depth
+	 * requests in flight or with a new connection for each file, and
+	 * returns the time in seconds.
+	 */
+	double download(const StubServer &server,
+		const std::vector<std::string> &paths,
+		const std::vector<Buffer> &files, const Uint32 depth,
+		const bool keep_alive)
+	{
+		http_response_t response;
+		Buffer buffer(65536);
+		timespec start, end;
+		Uint32 i, j, count, pos, size;
+		int socket;
+
+		memset(&response, 0, sizeof(response));
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		socket = -1;
+		pos = 0;
+		size = 0;
+
+		for (i = 0; i < paths.size(); i += count)
+		{
+			count = std::min<Uint32>(depth, paths.size() - i);
+
+			if (socket < 0)
+			{
+				socket = connect_to(server.get_port());
+				pos = 0;
+				size = 0;
+			}
+
+			send_requests(socket, paths, i, count, keep_alive);
+
+			for (j = 0; j < count; j++)
+			{
+				receive_response(socket, &response, buffer,
+					pos, size);
+
+				BOOST_REQUIRE_EQUAL(response.status, 200);
+				check_data(&response, files[i + j]);
+			}
+
+			if (!keep_alive)
+			{
+				close(socket);
+				socket = -1;
+			}
+		}
+
+		if (socket >= 0)
+		{
+			close(socket);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		http_response_free(&response);
+
+		return (end.tv_sec - start.tv_sec) +
+			(end.tv_nsec - start.tv_nsec) * 1e-9;
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(http_response_content_length_test)
+{
+	http_response_t response;
+	Buffer data, buffer;
+	MD5_DIGEST digest;
+
+	memset(&response, 0, sizeof(response));
+
+	data = make_data(1000, 1);
+	buffer = make_response(data);
+
+	http_response_init(&response);
+
+	BOOST_CHECK_EQUAL(feed(&response, buffer, 1), buffer.size());
+	BOOST_CHECK_EQUAL(response.status, 200);
+	BOOST_CHECK_EQUAL(response.keep_alive, 1);
+	BOOST_CHECK_EQUAL(std::string(response.etag), "1234abcd");
+	BOOST_CHECK_EQUAL(response.xz, 0);
+
+	check_data(&response, data);
+
+	get_digest(data, digest);
+
+	BOOST_CHECK(memcmp(response.body_digest, digest,
+		sizeof(MD5_DIGEST)) == 0);
+
+	http_response_free(&response);
+}
+
+BOOST_AUTO_TEST_CASE(http_response_xz_test)
+{
+	http_response_t response;
+	Buffer data, packed, buffer;
+	MD5_DIGEST digest;
+	Uint32 step;
+
+	memset(&response, 0, sizeof(response));
+
+	data = make_data(300000, 2);
+	packed = compress(data);
+	buffer = make_response(packed);
+
+	BOOST_REQUIRE(packed.size() < data.size());
+
+	for (step = 3; step < 100000; step *= 7)
+	{
+		http_response_init(&response);
+
+		BOOST_CHECK_EQUAL(feed(&response, buffer, step),
+			buffer.size());
+		BOOST_CHECK_EQUAL(response.xz, 1);
+
+		check_data(&response, data);
+
+		get_digest(packed, digest);
+
+		BOOST_CHECK(memcmp(response.body_digest, digest,
+			sizeof(MD5_DIGEST)) == 0);
+	}
+
+	http_response_free(&response);
+}
+
+BOOST_AUTO_TEST_CASE(http_response_pipelined_test)
+{
+	http_response_t response;
+	Buffer first, second, buffer, tail;
+	Uint32 used;
+
+	memset(&response, 0, sizeof(response));
+
+	first = make_data(5000, 3);
+	second = compress(make_data(7000, 4));
+	buffer = make_chunked_response(compress(first), 333);
+	tail = make_response(second);
+	buffer.insert(buffer.end(), tail.begin(), tail.end());
+
+	http_response_init(&response);
+
+	used = feed(&response, buffer, 4096);
+
+	BOOST_CHECK_EQUAL(used, buffer.size() - tail.size());
+	BOOST_CHECK_EQUAL(response.chunked, 1);
+
+	check_data(&response, first);
+
+	http_response_init(&response);
+
+	tail.assign(buffer.begin() + used, buffer.end());
+
+	BOOST_CHECK_EQUAL(feed(&response, tail, 4096), tail.size());
+
+	check_data(&response, make_data(7000, 4));
+
+	http_response_free(&response);
+}
+
+BOOST_AUTO_TEST_CASE(http_response_close_test)
+{
+	http_response_t response;
+	std::string header;
+	Buffer data, buffer;
+
+	memset(&response, 0, sizeof(response));
+
+	data = make_data(100, 5);
+	header = "HTTP/1.0 200 OK\r\n\r\n";
+	buffer.assign(header.begin(), header.end());
+	buffer.insert(buffer.end(), data.begin(), data.end());
+
+	http_response_init(&response);
+
+	BOOST_CHECK_EQUAL(feed(&response, buffer, 7), buffer.size());
+	BOOST_CHECK_EQUAL(response.keep_alive, 0);
+	BOOST_CHECK_EQUAL(response.state, hrs_body);
+	BOOST_CHECK_EQUAL(http_response_close(&response), 0);
+
+	check_data(&response, data);
+
+	http_response_init(&response);
+
+	buffer = make_response(data);
+	buffer.resize(buffer.size() - 10);
+
+	BOOST_CHECK_EQUAL(feed(&response, buffer, 64), buffer.size());
+	BOOST_CHECK_EQUAL(http_response_close(&response), 1);
+
+	http_response_free(&response);
+}
+
+BOOST_AUTO_TEST_CASE(http_response_error_test)
+{
+	http_response_t response;
+	std::string str;
+	Buffer buffer;
+
+	memset(&response, 0, sizeof(response));
+
+	str = "HTTP/1.1 404 Not Found\r\nContent-Length: 5\r\n\r\nerror";
+	buffer.assign(str.begin(), str.end());
+
+	http_response_init(&response);
+
+	BOOST_CHECK_EQUAL(feed(&response, buffer, 100), buffer.size());
+	BOOST_CHECK_EQUAL(response.status, 404);
+	BOOST_CHECK_EQUAL(response.size, 0);
+
+	str = "garbage\r\n\r\n";
+	buffer.assign(str.begin(), str.end());
+
+	http_response_init(&response);
+
+	BOOST_CHECK_EQUAL(http_response_parse(&response, &buffer[0],
+		buffer.size()), -1);
+
+	http_response_free(&response);
+}
+
+BOOST_AUTO_TEST_CASE(http_response_stub_server_test)
+{
+	StubServer server;
+	std::vector<std::string> paths;
+	std::vector<Buffer> files;
+	Buffer data;
+	double time, total;
+	char str[64];
+	Uint32 i;
+
+	total = 0.0;
+
+	for (i = 0; i < 64; i++)
+	{
+		snprintf(str, sizeof(str), "/updates/file_%u", i);
+
+		data = make_data(20000 + i * 1000, i + 10);
+
+		if ((i % 2) == 0)
+		{
+			paths.push_back(std::string(str) + ".xz");
+			server.add_file(paths.back(), compress(data));
+		}
+		else
+		{
+			paths.push_back(str);
+			server.add_file(paths.back(), data);
+		}
+
+		files.push_back(data);
+		total += data.size();
+	}
+
+	server.start();
+
+	time = download(server, paths, files, 1, false);
+
+	BOOST_TEST_MESSAGE("one connection per file: " << time * 1000.0 <<
+		" ms, " << total / time / 1e6 << " MB/s");
+
+	time = download(server, paths, files, 1, true);
+
+	BOOST_TEST_MESSAGE("kept alive connection: " << time * 1000.0 <<
+		" ms, " << total / time / 1e6 << " MB/s");
+
+	time = download(server, paths, files, 4, true);
+
+	BOOST_TEST_MESSAGE("kept alive, 4 requests in flight: " <<
+		time * 1000.0 << " ms, " << total / time / 1e6 << " MB/s");
+}
@@ -0,0 +1,174 @@
+#define BOOST_TEST_MODULE occlusionbuffer test
+#include <boost/test/unit_test.hpp>
+#include "occlusionbuffer.hpp"
+
+using namespace eternal_lands;
+
+namespace
+{
+
+	/**
+	 * Perspective matrix looking down the negative z axis, 90 degree
+	 * field of view, near plane at 1 and far plane at 100.
+	 */
+	void get_matrix(float* matrix)
+	{
+		const float n = 1.0f;
+		const float f = 100.0f;
+		int i;
+
+		for (i = 0; i < 16; i++)
+		{
+			matrix[i] = 0.0f;
+		}
+
+		matrix[0] = 1.0f;
+		matrix[5] = 1.0f;
+		matrix[10] = (f + n) / (n - f);
+		matrix[11] = -1.0f;
+		matrix[14] = 2.0f * f * n / (n - f);
+	}
+
+	void check_occlusion(const bool use_simd, const Uint32 band_count)
+	{
+		OcclusionBuffer buffer(64, 32);
+		float matrix[16];
+		Uint32 i;
+		const float wall_min[3] = { -5.0f, -5.0f, -11.0f };
+		const float wall_max[3] = { 5.0f, 5.0f, -10.0f };
+		const float hidden_min[3] = { -1.0f, -1.0f, -30.0f };
+		const float hidden_max[3] = { 1.0f, 1.0f, -28.0f };
+		const float beside_min[3] = { 20.0f, -1.0f, -30.0f };
+		const float beside_max[3] = { 24.0f, 1.0f, -28.0f };
+		const float front_min[3] = { -1.0f, -1.0f, -6.0f };
+		const float front_max[3] = { 1.0f, 1.0f, -5.0f };
+		const float partly_min[3] = { 3.0f, -1.0f, -30.0f };
+		const float partly_max[3] = { 40.0f, 1.0f, -28.0f };
+
+		get_matrix(matrix);
+
+		buffer.set_use_simd(use_simd);
+		buffer.set_view_projection_matrix(matrix);
+		buffer.add_occluder(wall_min, wall_max);
+
+		BOOST_CHECK_EQUAL(buffer.get_triangle_count(), 12);
+
+		for (i = 0; i < band_count; i++)
+		{
+			buffer.rasterize(i, band_count);
+		}
+
+		BOOST_CHECK(!buffer.is_visible(hidden_min, hidden_max));
+		BOOST_CHECK(buffer.is_visible(beside_min, beside_max));
+		BOOST_CHECK(buffer.is_visible(front_min, front_max));
+		BOOST_CHECK(buffer.is_visible(partly_min, partly_max));
+	}
+
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_creation_test)
+{
+	OcclusionBuffer buffer(61, 30);
+
+	BOOST_CHECK_EQUAL(buffer.get_width(), 64);
+	BOOST_CHECK_EQUAL(buffer.get_height(), 32);
+	BOOST_CHECK_EQUAL(buffer.get_triangle_count(), 0);
+	BOOST_CHECK_CLOSE(buffer.get_depth(0, 0), 1.0f, 0.0001);
+	BOOST_CHECK_CLOSE(buffer.get_tile_max(7, 3), 1.0f, 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_empty_test)
+{
+	OcclusionBuffer buffer(64, 32);
+	float matrix[16];
+	const float min[3] = { -1.0f, -1.0f, -30.0f };
+	const float max[3] = { 1.0f, 1.0f, -28.0f };
+
+	get_matrix(matrix);
+
+	buffer.set_view_projection_matrix(matrix);
+	buffer.rasterize();
+
+	BOOST_CHECK(buffer.is_visible(min, max));
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_occlusion_test)
+{
+	check_occlusion(false, 1);
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_bands_test)
+{
+	check_occlusion(false, 3);
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_simd_test)
+{
+	check_occlusion(true, 1);
+	check_occlusion(true, 4);
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_near_plane_test)
+{
+	OcclusionBuffer buffer(64, 32);
+	float matrix[16];
+	const float wall_min[3] = { -5.0f, -5.0f, -11.0f };
+	const float wall_max[3] = { 5.0f, 5.0f, 10.0f };
+	const float min[3] = { -1.0f, -1.0f, -30.0f };
+	const float max[3] = { 1.0f, 1.0f, 2.0f };
+
+	get_matrix(matrix);
+
+	buffer.set_view_projection_matrix(matrix);
+	buffer.add_occluder(wall_min, wall_max);
+	buffer.rasterize();
+
+	BOOST_CHECK_EQUAL(buffer.get_triangle_count(), 0);
+	BOOST_CHECK(buffer.is_visible(min, max));
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_clear_test)
+{
+	OcclusionBuffer buffer(64, 32);
+	float matrix[16];
+	const float wall_min[3] = { -5.0f, -5.0f, -11.0f };
+	const float wall_max[3] = { 5.0f, 5.0f, -10.0f };
+	const float min[3] = { -1.0f, -1.0f, -30.0f };
+	const float max[3] = { 1.0f, 1.0f, -28.0f };
+
+	get_matrix(matrix);
+
+	buffer.set_view_projection_matrix(matrix);
+	buffer.add_occluder(wall_min, wall_max);
+	buffer.rasterize();
+
+	BOOST_CHECK(!buffer.is_visible(min, max));
+
+	buffer.clear();
+	buffer.rasterize();
+
+	BOOST_CHECK_EQUAL(buffer.get_triangle_count(), 0);
+	BOOST_CHECK(buffer.is_visible(min, max));
+}
+
+BOOST_AUTO_TEST_CASE(occlusionbuffer_screen_area_test)
+{
+	OcclusionBuffer buffer(64, 32);
+	float matrix[16];
+	const float near_min[3] = { -5.0f, -5.0f, -11.0f };
+	const float near_max[3] = { 5.0f, 5.0f, -10.0f };
+	const float far_min[3] = { -5.0f, -5.0f, -41.0f };
+	const float far_max[3] = { 5.0f, 5.0f, -40.0f };
+	const float behind_min[3] = { -5.0f, -5.0f, -11.0f };
+	const float behind_max[3] = { 5.0f, 5.0f, 10.0f };
+
+	get_matrix(matrix);
+
+	buffer.set_view_projection_matrix(matrix);
+
+	BOOST_CHECK_CLOSE(buffer.get_screen_area(near_min, near_max),
+		32.0f * 16.0f, 0.001);
+	BOOST_CHECK_GT(buffer.get_screen_area(near_min, near_max),
+		buffer.get_screen_area(far_min, far_max));
+	BOOST_CHECK_EQUAL(buffer.get_screen_area(behind_min, behind_max), 0.0f);
+}
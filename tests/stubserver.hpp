@@ -0,0 +1,227 @@
+#ifndef	UUID_3e7b0c52_1d8a_4f69_9b24_6a0f5e8c71d3
+#define	UUID_3e7b0c52_1d8a_4f69_9b24_6a0f5e8c71d3
+
+#include <boost/test/unit_test.hpp>
+#include <SDL_types.h>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+namespace
+{
+
+	typedef std::vector<Uint8> Buffer;
+
+	std::string make_header(const Uint32 size, const char* extra)
+	{
+		char str[256];
+
+		snprintf(str, sizeof(str), "HTTP/1.1 200 OK\r\n"
+			"Content-Length: %u\r\nETag: \"1234abcd\"\r\n%s\r\n",
+			size, extra);
+
+		return str;
+	}
+
+	Buffer make_response(const Buffer &body, const char* extra = "")
+	{
+		std::string header;
+		Buffer result;
+
+		header = make_header(body.size(), extra);
+
+		result.insert(result.end(), header.begin(), header.end());
+		result.insert(result.end(), body.begin(), body.end());
+
+		return result;
+	}
+
+	/**
+	 * Http server on the loopback interface that answers GET requests
+	 * from a fixed set of files, keeping the connection open unless the
+	 * client asks to close it.
+	 */
+	class StubServer
+	{
+		private:
+			std::map<std::string, Buffer> m_files;
+			pthread_t m_thread;
+			int m_socket;
+			Uint16 m_port;
+
+			static void* run(void* data)
+			{
+				static_cast<StubServer*>(data)->serve();
+
+				return 0;
+			}
+
+			void answer(const int client)
+			{
+				std::string requests, request, path;
+				std::map<std::string, Buffer>::const_iterator
+					found;
+				Buffer response;
+				char buffer[4096];
+				std::string::size_type end;
+				ssize_t len;
+				bool close_connection;
+
+				close_connection = false;
+
+				while (!close_connection)
+				{
+					end = requests.find("\r\n\r\n");
+
+					if (end == std::string::npos)
+					{
+						len = recv(client, buffer,
+							sizeof(buffer), 0);
+
+						if (len <= 0)
+						{
+							return;
+						}
+
+						requests.append(buffer, len);
+
+						continue;
+					}
+
+					request = requests.substr(0, end);
+					requests.erase(0, end + 4);
+
+					path = request.substr(4,
+						request.find(' ', 4) - 4);
+					close_connection = request.find(
+						"Connection: close") !=
+						std::string::npos;
+
+					found = m_files.find(path);
+
+					if (found == m_files.end())
+					{
+						std::string str = "HTTP/1.1 404 "
+							"Not Found\r\n"
+							"Content-Length: 0\r\n\r\n";
+
+						response.assign(str.begin(),
+							str.end());
+					}
+					else
+					{
+						response = make_response(
+							found->second,
+							close_connection ?
+							"Connection: close\r\n" :
+							"");
+					}
+
+					if (send(client, &response[0],
+						response.size(), 0) !=
+						static_cast<ssize_t>(
+							response.size()))
+					{
+						return;
+					}
+				}
+			}
+
+			void serve()
+			{
+				int client;
+
+				while ((client = accept(m_socket, 0, 0)) >= 0)
+				{
+					answer(client);
+					close(client);
+				}
+			}
+
+		public:
+			StubServer(): m_socket(-1), m_port(0)
+			{
+			}
+
+			~StubServer()
+			{
+				shutdown(m_socket, SHUT_RDWR);
+				close(m_socket);
+				pthread_join(m_thread, 0);
+			}
+
+			void add_file(const std::string &path,
+				const Buffer &data)
+			{
+				m_files[path] = data;
+			}
+
+			void start()
+			{
+				sockaddr_in addr;
+				socklen_t size;
+
+				m_socket = socket(AF_INET, SOCK_STREAM, 0);
+
+				BOOST_REQUIRE_GE(m_socket, 0);
+
+				memset(&addr, 0, sizeof(addr));
+				addr.sin_family = AF_INET;
+				addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+				addr.sin_port = 0;
+
+				BOOST_REQUIRE_EQUAL(bind(m_socket,
+					reinterpret_cast<sockaddr*>(&addr),
+					sizeof(addr)), 0);
+				BOOST_REQUIRE_EQUAL(listen(m_socket, 4), 0);
+
+				size = sizeof(addr);
+				getsockname(m_socket,
+					reinterpret_cast<sockaddr*>(&addr),
+					&size);
+				m_port = ntohs(addr.sin_port);
+
+				pthread_create(&m_thread, 0, run, this);
+			}
+
+			Uint16 get_port() const
+			{
+				return m_port;
+			}
+
+	};
+
+	int connect_to(const Uint16 port)
+	{
+		sockaddr_in addr;
+		int result;
+		int flag;
+
+		result = socket(AF_INET, SOCK_STREAM, 0);
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(port);
+
+		BOOST_REQUIRE_EQUAL(connect(result,
+			reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+		flag = 1;
+		setsockopt(result, IPPROTO_TCP, TCP_NODELAY, &flag,
+			sizeof(flag));
+
+		return result;
+	}
+
+}
+
+#endif	/* UUID_3e7b0c52_1d8a_4f69_9b24_6a0f5e8c71d3 */
@@ -28,6 +28,9 @@
 #include "url.h"
 #include "counters.h"
 #include "io/elpathwrapper.h"
+#ifdef	BUFFERED_CHAT_LOG
+#include "io/chat_log.h"
+#endif	/* BUFFERED_CHAT_LOG */
 #include "spells.h"
 #include "serverpopup.h"
 #include "sky.h"
@@ -71,6 +74,10 @@ int afk_snd_warning = 0;
 
 /* forward declaration */
 void put_small_colored_text_in_box (Uint8 color, const Uint8 *text_to_add, int len, int pixels_limit, char *buffer);
+#ifdef	CHAT_LINE_INDEX
+static void remove_first_line_index_messages (int nr_messages);
+static void truncate_line_indices (int imsg);
+#endif	/* CHAT_LINE_INDEX */
 
 void alloc_text_message_data (text_message *msg, int size)
 {
@@ -149,6 +156,9 @@ void open_chat_log(){
 
 	char chat_log_file[100];
 	char srv_log_file[100];
+#ifdef	BUFFERED_CHAT_LOG
+	int result;
+#endif	/* BUFFERED_CHAT_LOG */
 
 	time(&c_time);
 	l_time = localtime(&c_time);
@@ -166,16 +176,26 @@ void open_chat_log(){
 		safe_strncpy(srv_log_file, "srv_log.txt", sizeof(srv_log_file));
 	}
 
+#ifdef	BUFFERED_CHAT_LOG
+	result = start_chat_log_writer (chat_log_file,
+		(log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE) ? srv_log_file : NULL);
+	if (result < 0)
+#else	/* BUFFERED_CHAT_LOG */
 	chat_log = open_file_config (chat_log_file, "a");
 	if (log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE)
 		srv_log = open_file_config (srv_log_file, "a");
 	if (chat_log == NULL)
+#endif	/* BUFFERED_CHAT_LOG */
 	{
 		LOG_TO_CONSOLE(c_red3, "Unable to open log file to write. We will NOT be recording anything.");
 		log_chat = LOG_NONE;
 		return;
 	}
+#ifdef	BUFFERED_CHAT_LOG
+	else if (result > 0)
+#else	/* BUFFERED_CHAT_LOG */
 	else if ((log_chat == LOG_SERVER || log_chat == LOG_SERVER_SEPERATE) && srv_log == NULL)
+#endif	/* BUFFERED_CHAT_LOG */
 	{
 		LOG_TO_CONSOLE(c_red3, "Unable to open server log file to write. We will fall back to recording everything in chat_log.txt.");
 		log_chat = LOG_CHAT;
@@ -183,7 +203,11 @@ void open_chat_log(){
 	}
 	strftime(sttime, sizeof(sttime), "\n\nLog started at %Y-%m-%d %H:%M:%S localtime", l_time);
 	safe_snprintf(starttime, sizeof(starttime), "%s (%s)\n\n", sttime, tzname[l_time->tm_isdst>0]);
+#ifdef	BUFFERED_CHAT_LOG
+	chat_log_write_text (starttime, strlen(starttime));
+#else	/* BUFFERED_CHAT_LOG */
 	fwrite (starttime, strlen(starttime), 1, chat_log);
+#endif	/* BUFFERED_CHAT_LOG */
 }
 
 
@@ -195,25 +219,35 @@ void timestamp_chat_log(){
 		return; //we're not logging anything
 	}
 
+#ifdef	BUFFERED_CHAT_LOG
+	if (!chat_log_writer_running()){
+#else	/* BUFFERED_CHAT_LOG */
 	if (chat_log == NULL){
+#endif	/* BUFFERED_CHAT_LOG */
 		open_chat_log();
 	} else {
 		time(&c_time);
 		l_time = localtime(&c_time);
 		strftime(sttime, sizeof(sttime), "Hourly time-stamp: log continued at %Y-%m-%d %H:%M:%S localtime", l_time);
 		safe_snprintf(starttime, sizeof(starttime), "%s (%s)\n", sttime, tzname[l_time->tm_isdst>0]);
+#ifdef	BUFFERED_CHAT_LOG
+		chat_log_write_text (starttime, strlen(starttime));
+#else	/* BUFFERED_CHAT_LOG */
 		fwrite (starttime, strlen(starttime), 1, chat_log);
+#endif	/* BUFFERED_CHAT_LOG */
 	}
 }
 
 
 void write_to_log (Uint8 channel, const Uint8* const data, int len)
 {
+#ifndef	BUFFERED_CHAT_LOG
 	int i, j;
 	Uint8 ch;
 	char str[1024];
 	struct tm *l_time; time_t c_time;
 	FILE *fout;
+#endif	/* BUFFERED_CHAT_LOG */
 
 #ifdef NEW_SOUND
 	// Check if this string matches text we play a sound for
@@ -225,6 +259,17 @@ void write_to_log (Uint8 channel, const Uint8* const data, int len)
 		// we're not logging those
 		return;
 
+#ifdef	BUFFERED_CHAT_LOG
+	if (!chat_log_writer_running()){
+		open_chat_log();
+		if (!chat_log_writer_running()){
+			return;
+		}
+	}
+
+	// The line is written with the next batch, on the writer thread
+	chat_log_write (channel == CHAT_SERVER && log_chat >= 3, channel, data, len, !show_timestamp);
+#else	/* BUFFERED_CHAT_LOG */
 	if (chat_log == NULL){
 		open_chat_log();
 		if(chat_log == NULL){
@@ -270,6 +315,7 @@ void write_to_log (Uint8 channel, const Uint8* const data, int len)
 
 	// Flush the file, so the content is written even when EL crashes.
 	fflush (fout);
+#endif	/* BUFFERED_CHAT_LOG */
 }
 
 void send_input_text_line (char *line, int line_len)
@@ -929,6 +975,9 @@ void put_colored_text_in_buffer (Uint8 color, Uint8 channel, const Uint8 *text_t
 		}
 		memmove(display_text_buffer, &display_text_buffer[DISPLAY_TEXT_BUFFER_DEL], sizeof(text_message)*num_move);
 		last_message -= DISPLAY_TEXT_BUFFER_DEL;
+#ifdef	CHAT_LINE_INDEX
+		remove_first_line_index_messages (DISPLAY_TEXT_BUFFER_DEL);
+#endif	/* CHAT_LINE_INDEX */
 		for (i = num_move; i < DISPLAY_TEXT_BUFFER_SIZE; i++)
 			init_text_message (display_text_buffer + i, 0);
 	}
@@ -1201,6 +1250,177 @@ void put_small_colored_text_in_box (Uint8 color, const Uint8 *text_to_add, int l
 }
 
 
+#ifdef	CHAT_LINE_INDEX
+#define LINE_INDEX_COUNT 8
+
+/*
+ * The number of lines of the messages before each message in
+ * display_text_buffer, for one filter, zoom and width. Messages are only
+ * counted, they are rewrapped when they are drawn.
+ */
+typedef struct
+{
+	float zoom;
+	int width;
+	Uint8 filter;
+	int separate;
+	int count;			// the number of messages in the index
+	Uint32 last_use;
+	int lines[DISPLAY_TEXT_BUFFER_SIZE + 1];
+} line_index;
+
+static line_index line_indices[LINE_INDEX_COUNT];
+static Uint32 line_index_uses = 0;
+
+static int get_separate_channels (void)
+{
+	return (local_chat_separate ? 1 : 0) | (personal_chat_separate ? 2 : 0) |
+		(guild_chat_separate ? 4 : 0) | (server_chat_separate ? 8 : 0) |
+		(mod_chat_separate ? 16 : 0);
+}
+
+static int message_in_filter (const text_message *msg, Uint8 filter)
+{
+	int msgchan = msg->chan_idx;
+
+	switch (msgchan) {
+		case CHAT_LOCAL:    if (!local_chat_separate)    msgchan = CHAT_ALL; break;
+		case CHAT_PERSONAL: if (!personal_chat_separate) msgchan = CHAT_ALL; break;
+		case CHAT_GM:       if (!guild_chat_separate)    msgchan = CHAT_ALL; break;
+		case CHAT_SERVER:   if (!server_chat_separate)   msgchan = CHAT_ALL; break;
+		case CHAT_MOD:      if (!mod_chat_separate)      msgchan = CHAT_ALL; break;
+		case CHAT_MODPM:                                 msgchan = CHAT_ALL; break;
+	}
+
+	return msgchan == filter || msgchan == CHAT_ALL || filter == FILTER_ALL;
+}
+
+static int count_message_lines (const text_message *msg, float zoom, int width)
+{
+	if (msg->data == NULL || msg->deleted)
+		return 0;
+
+	// wrap_lines is a byte, so only trust it for short messages
+	if (msg->wrap_width == width && msg->wrap_zoom == zoom && msg->wrap_lines < 255)
+		return msg->wrap_lines;
+
+	return count_soft_breaks (msg->data, msg->len, msg->size, zoom, width);
+}
+
+static line_index *get_line_index (Uint8 filter, float zoom, int width)
+{
+	line_index *index = NULL;
+	int separate = get_separate_channels ();
+	int i;
+
+	for (i = 0; i < LINE_INDEX_COUNT; i++)
+	{
+		if (line_indices[i].filter == filter && line_indices[i].zoom == zoom &&
+			line_indices[i].width == width && line_indices[i].separate == separate)
+		{
+			index = &line_indices[i];
+			break;
+		}
+		if (index == NULL || line_indices[i].last_use < index->last_use)
+			index = &line_indices[i];
+	}
+
+	if (i == LINE_INDEX_COUNT)
+	{
+		// reuse the least recently used index
+		index->filter = filter;
+		index->zoom = zoom;
+		index->width = width;
+		index->separate = separate;
+		index->count = 0;
+		index->lines[0] = 0;
+	}
+
+	index->last_use = ++line_index_uses;
+
+	// add the new messages
+	for ( ; index->count <= last_message; index->count++)
+	{
+		i = index->count;
+		index->lines[i + 1] = index->lines[i];
+		if (message_in_filter (&display_text_buffer[i], filter))
+			index->lines[i + 1] += count_message_lines (&display_text_buffer[i], zoom, width);
+	}
+
+	return index;
+}
+
+static void remove_first_line_index_messages (int nr_messages)
+{
+	int i, j, lines;
+
+	for (i = 0; i < LINE_INDEX_COUNT; i++)
+	{
+		line_index *index = &line_indices[i];
+
+		if (index->count <= nr_messages)
+		{
+			index->count = 0;
+			index->lines[0] = 0;
+			continue;
+		}
+
+		lines = index->lines[nr_messages];
+		index->count -= nr_messages;
+		for (j = 0; j <= index->count; j++)
+			index->lines[j] = index->lines[j + nr_messages] - lines;
+	}
+}
+
+/* forget the lines of a message and the messages after it */
+static void truncate_line_indices (int imsg)
+{
+	int i;
+
+	for (i = 0; i < LINE_INDEX_COUNT; i++)
+	{
+		if (line_indices[i].count > imsg)
+			line_indices[i].count = imsg;
+	}
+}
+
+static void clear_line_indices (void)
+{
+	int i;
+
+	for (i = 0; i < LINE_INDEX_COUNT; i++)
+	{
+		line_indices[i].count = 0;
+		line_indices[i].lines[0] = 0;
+	}
+}
+
+/* the last message that starts before or at the line */
+static int find_line_message (const line_index *index, int line)
+{
+	int low = 0, high = last_message, middle;
+
+	while (low < high)
+	{
+		middle = (low + high + 1) / 2;
+		if (index->lines[middle] <= line)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return low;
+}
+
+int get_display_line_count (Uint8 filter, float zoom, int width)
+{
+	if (last_message < 0)
+		return 0;
+
+	return get_line_index (filter, zoom, width)->lines[last_message + 1];
+}
+#endif	/* CHAT_LINE_INDEX */
+
 // find the last lines, according to the current time
 int find_last_lines_time (int *msg, int *offset, Uint8 filter, int width)
 {
@@ -1219,6 +1439,61 @@ int find_last_lines_time (int *msg, int *offset, Uint8 filter, int width)
 
 int find_line_nr (int nr_lines, int line, Uint8 filter, int *msg, int *offset, float zoom, int width)
 {
+#ifdef	CHAT_LINE_INDEX
+	int lines_no = nr_lines - line;
+	int imsg, ichar, target;
+	line_index *index;
+	char *data;
+
+	if (last_message < 0) {
+		/* No data in buffer */
+		*msg = *offset = 0;
+		return 1;
+	}
+
+	// the first line of the message is found, if there are no more lines
+	if (lines_no < 1)
+		lines_no = 1;
+
+	while (1)
+	{
+		index = get_line_index (filter, zoom, width);
+
+		// the number of the line, counted from the first message
+		target = index->lines[last_message + 1] - lines_no;
+		if (target < 0)
+		{
+			*msg = 0;
+			*offset = 0;
+			return 1;
+		}
+
+		imsg = find_line_message (index, target);
+
+		// only this message needs its line breaks
+		rewrap_message (&display_text_buffer[imsg], zoom, width, NULL);
+
+		// again if the message lost text when it was rewrapped
+		if (index->count > imsg)
+			break;
+	}
+
+	*msg = imsg;
+	*offset = 0;
+	data = display_text_buffer[imsg].data;
+	target -= index->lines[imsg];
+
+	for (ichar = 0; target > 0 && ichar < display_text_buffer[imsg].len; ichar++)
+	{
+		if (data[ichar] == '\n' || data[ichar] == '\r')
+		{
+			if (--target == 0)
+				*offset = ichar+1;
+		}
+	}
+
+	return 1;
+#else	/* CHAT_LINE_INDEX */
 	int line_count = 0, lines_no = nr_lines - line;
 	int imsg, ichar;
 	char *data;
@@ -1282,6 +1557,7 @@ int find_line_nr (int nr_lines, int line, Uint8 filter, int *msg, int *offset, f
 	*msg = 0;
 	*offset = 0;
 	return 1;
+#endif	/* CHAT_LINE_INDEX */
 }
 
 void clear_display_text_buffer ()
@@ -1297,6 +1573,9 @@ void clear_display_text_buffer ()
 
 	last_message = -1;
 	last_server_message_time = cur_time;
+#ifdef	CHAT_LINE_INDEX
+	clear_line_indices ();
+#endif	/* CHAT_LINE_INDEX */
 
 	clear_console();
 	if(use_windowed_chat == 2){
@@ -1320,6 +1599,12 @@ int rewrap_message(text_message * msg, float zoom, int width, int * cursor)
 		msg->wrap_width = width;
 		msg->wrap_zoom = zoom;
 		msg->max_line_width = max_line_width;
+#ifdef	CHAT_LINE_INDEX
+		// a message that fills its buffer may have lost text, count it again
+		if (msg->len >= msg->size - 1 && msg >= display_text_buffer &&
+			msg < display_text_buffer + DISPLAY_TEXT_BUFFER_SIZE)
+			truncate_line_indices (msg - display_text_buffer);
+#endif	/* CHAT_LINE_INDEX */
 	} else {
 		nlines = msg->wrap_lines;
 	}
@@ -373,6 +373,21 @@ int find_last_lines_time (int *msg, int *offset, Uint8 filter, int width);
  */
 int find_line_nr (int nr_lines, int line, Uint8 filter, int *msg, int *offset, float zoom, int width);
 
+#ifdef	CHAT_LINE_INDEX
+/*!
+ * \ingroup text_font
+ * \brief Counts the lines in the text message buffer
+ *
+ *	counts the lines of the messages in a channel when they are wrapped with the zoom and width, without wrapping them
+ *
+ * \param filter   the channel in which to count the lines, or FILTER_ALL to count the lines in all channels
+ * \param zoom     the text zoom that is to be used for wrapping
+ * \param width    the text width that is to be used for wrapping
+ * \retval The number of lines
+ */
+int get_display_line_count (Uint8 filter, float zoom, int width);
+#endif	/* CHAT_LINE_INDEX */
+
 /*!
  * \ingroup interface_console
  * \brief Moves the screen up one line in console mode.
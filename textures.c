@@ -19,6 +19,16 @@
 #include "threads.h"
 #include "memory.h"
 #include <assert.h>
+#ifdef	DDS_TEXTURE_CACHE
+#include "dds_cache.h"
+#include "text.h"
+#endif	/* DDS_TEXTURE_CACHE */
+#ifdef	ACTOR_PART_CACHE
+#include "text.h"
+#endif	/* ACTOR_PART_CACHE */
+#ifdef	FBO_ACTOR_TEXTURES
+#include "actor_compositor.h"
+#endif	/* FBO_ACTOR_TEXTURES */
 #else	/* NEW_TEXTURES */
 #include "io/elfilewrapper.h"
 #include "ddsimage.h"
@@ -33,13 +43,61 @@
 
 #ifdef	ELC
 #define ACTOR_TEXTURE_CACHE_MAX 256
+#ifdef	ACTOR_PART_CACHE
+#define ACTOR_TEXTURE_THREAD_COUNT 8
+#define ACTOR_PART_CACHE_MAX 256
+#else	/* ACTOR_PART_CACHE */
 #define ACTOR_TEXTURE_THREAD_COUNT 2
+#endif	/* ACTOR_PART_CACHE */
 
 actor_texture_cache_t* actor_texture_handles = NULL;
 SDL_Thread* actor_texture_threads[ACTOR_TEXTURE_THREAD_COUNT];
 Uint32 max_actor_texture_handles = 32;
 queue_t* actor_texture_queue = NULL;
 Uint32 actor_texture_threads_done = 0;
+#ifdef	ACTOR_PART_CACHE
+int actor_texture_thread_count = 2;
+int actor_part_cache_size = 32;
+
+/*!
+ * A decoded part image, the same parts are used by many actors.
+ */
+typedef struct
+{
+	char file_name[MAX_FILE_PATH];	/*!< the name of the opened file */
+	image_t image;			/*!< the decoded image */
+	Uint32 hash;			/*!< hash value of the file name */
+	Uint32 compression;		/*!< the compression used to load it */
+	Uint32 unpack;			/*!< was the image unpacked? */
+	Uint32 width;			/*!< the size that was asked for */
+	Uint32 height;
+	Uint32 size;			/*!< the size of the image data */
+	Uint32 access_time;		/*!< last time used */
+} actor_part_cache_t;
+
+static actor_part_cache_t actor_part_cache[ACTOR_PART_CACHE_MAX];
+static SDL_mutex* actor_part_cache_mutex = NULL;
+static Uint32 actor_part_cache_used = 0;
+static Uint32 actor_part_cache_time = 0;
+static Uint32 actor_part_cache_hits = 0;
+static Uint32 actor_part_cache_misses = 0;
+#endif	/* ACTOR_PART_CACHE */
+#ifdef	FBO_ACTOR_TEXTURES
+int use_fbo_actor_textures = 1;
+
+typedef enum
+{
+	acs_unknown = 0,
+	acs_ready,
+	acs_failed
+} actor_compositor_state_type;
+
+/*!
+ * The extensions are loaded after the texture cache is initialised, so the
+ * compositor is checked the first time an actor texture is bound.
+ */
+static actor_compositor_state_type actor_compositor_state = acs_unknown;
+#endif	/* FBO_ACTOR_TEXTURES */
 #endif	/* ELC */
 
 #define TEXTURE_CACHE_MAX 8192
@@ -545,6 +603,7 @@ static Uint32 load_texture(texture_cache_t* texture_handle)
 	image_t image;
 	GLuint id;
 	Uint32 strip_mipmaps, base_level, wrap_mode_repeat, af, i, compression;
+	Uint32 result;
 	GLenum min_filter;
 	texture_format_type format;
 
@@ -593,8 +652,22 @@ static Uint32 load_texture(texture_cache_t* texture_handle)
 			break;
 	}
 
-	if (load_image_data(texture_handle->file_name, compression, 0,
-		strip_mipmaps, base_level, &image) == 0)
+#ifdef	DDS_TEXTURE_CACHE
+	// the gui and font textures are not compressed
+	if ((texture_handle->type == tt_mesh) ||
+		(texture_handle->type == tt_image))
+	{
+		result = load_image_data_cached(texture_handle->file_name,
+			compression, strip_mipmaps, base_level, &image);
+	}
+	else
+#endif	/* DDS_TEXTURE_CACHE */
+	{
+		result = load_image_data(texture_handle->file_name,
+			compression, 0, strip_mipmaps, base_level, &image);
+	}
+
+	if (result == 0)
 	{
 		texture_handle->load_err = 1;
 
@@ -980,6 +1053,222 @@ Uint32 load_image_data_file_size(el_file_ptr file, const Uint32 compression,
 	return 1;
 }
 
+#ifdef	ACTOR_PART_CACHE
+static void free_actor_part(const Uint32 index)
+{
+	actor_part_cache_used -= actor_part_cache[index].size;
+
+	free_image(&actor_part_cache[index].image);
+
+	memset(&actor_part_cache[index], 0, sizeof(actor_part_cache_t));
+}
+
+static void clear_actor_part_cache()
+{
+	Uint32 i;
+
+	for (i = 0; i < ACTOR_PART_CACHE_MAX; i++)
+	{
+		if (actor_part_cache[i].image.image != 0)
+		{
+			free_actor_part(i);
+		}
+	}
+}
+
+static Uint32 copy_actor_part(const actor_part_cache_t* part, image_t* image)
+{
+	memcpy(image, &part->image, sizeof(image_t));
+
+	image->image = malloc_aligned(part->size, 16);
+
+	if (image->image == 0)
+	{
+		return 0;
+	}
+
+	memcpy(image->image, part->image.image, part->size);
+
+	return 1;
+}
+
+static Uint32 find_actor_part(const char* file_name, const Uint32 hash,
+	const Uint32 compression, const Uint32 unpack, const Uint32 width,
+	const Uint32 height)
+{
+	Uint32 i;
+
+	for (i = 0; i < ACTOR_PART_CACHE_MAX; i++)
+	{
+		if ((actor_part_cache[i].image.image != 0) &&
+			(actor_part_cache[i].hash == hash) &&
+			(actor_part_cache[i].compression == compression) &&
+			(actor_part_cache[i].unpack == unpack) &&
+			(actor_part_cache[i].width == width) &&
+			(actor_part_cache[i].height == height) &&
+			(strcmp(actor_part_cache[i].file_name, file_name) == 0))
+		{
+			return i;
+		}
+	}
+
+	return ACTOR_PART_CACHE_MAX;
+}
+
+static void add_actor_part(const char* file_name, const Uint32 hash,
+	const Uint32 compression, const Uint32 unpack, const Uint32 width,
+	const Uint32 height, const image_t* image)
+{
+	Uint32 i, index, empty, size, max_size, access_time;
+
+	size = image->offsets[image->mipmaps - 1] +
+		image->sizes[image->mipmaps - 1];
+	max_size = actor_part_cache_size * 1024 * 1024;
+
+	// one big image should not throw out all the others
+	if ((size * 4) > max_size)
+	{
+		return;
+	}
+
+	if (find_actor_part(file_name, hash, compression, unpack, width,
+		height) != ACTOR_PART_CACHE_MAX)
+	{
+		// another thread decoded it at the same time
+		return;
+	}
+
+	while (1)
+	{
+		index = ACTOR_PART_CACHE_MAX;
+		empty = ACTOR_PART_CACHE_MAX;
+		access_time = 0;
+
+		for (i = 0; i < ACTOR_PART_CACHE_MAX; i++)
+		{
+			if (actor_part_cache[i].image.image == 0)
+			{
+				empty = i;
+			}
+			else if ((index == ACTOR_PART_CACHE_MAX) ||
+				(actor_part_cache[i].access_time < access_time))
+			{
+				index = i;
+				access_time = actor_part_cache[i].access_time;
+			}
+		}
+
+		if (((empty != ACTOR_PART_CACHE_MAX) &&
+			((actor_part_cache_used + size) <= max_size)) ||
+			(index == ACTOR_PART_CACHE_MAX))
+		{
+			break;
+		}
+
+		free_actor_part(index);
+	}
+
+	memcpy(&actor_part_cache[empty].image, image, sizeof(image_t));
+
+	actor_part_cache[empty].image.image = malloc_aligned(size, 16);
+
+	if (actor_part_cache[empty].image.image == 0)
+	{
+		memset(&actor_part_cache[empty], 0, sizeof(actor_part_cache_t));
+
+		return;
+	}
+
+	memcpy(actor_part_cache[empty].image.image, image->image, size);
+
+	safe_strncpy(actor_part_cache[empty].file_name, file_name,
+		sizeof(actor_part_cache[empty].file_name));
+	actor_part_cache[empty].hash = hash;
+	actor_part_cache[empty].compression = compression;
+	actor_part_cache[empty].unpack = unpack;
+	actor_part_cache[empty].width = width;
+	actor_part_cache[empty].height = height;
+	actor_part_cache[empty].size = size;
+	actor_part_cache[empty].access_time = ++actor_part_cache_time;
+
+	actor_part_cache_used += size;
+}
+#endif	/* ACTOR_PART_CACHE */
+
+/*!
+ * Loads a part of an enhanced actor texture. With ACTOR_PART_CACHE, the
+ * decoded parts are kept in a cache shared by all threads, because the
+ * same skins, masks and clothes are used by many actors.
+ */
+static Uint32 load_actor_part_image(el_file_ptr file, const Uint32 compression,
+	const Uint32 unpack, const Uint32 width, const Uint32 height,
+	image_t* image)
+{
+#ifdef	ACTOR_PART_CACHE
+	char file_name[MAX_FILE_PATH];
+	Uint32 hash, index, result;
+
+	if (actor_part_cache_size <= 0)
+	{
+		if (actor_part_cache_used != 0)
+		{
+			CHECK_AND_LOCK_MUTEX(actor_part_cache_mutex);
+
+			clear_actor_part_cache();
+
+			CHECK_AND_UNLOCK_MUTEX(actor_part_cache_mutex);
+		}
+
+		return load_image_data_file_size(file, compression, unpack,
+			width, height, image);
+	}
+
+	safe_strncpy(file_name, el_file_name(file), sizeof(file_name));
+	hash = mem_hash(file_name, strlen(file_name));
+
+	CHECK_AND_LOCK_MUTEX(actor_part_cache_mutex);
+
+	index = find_actor_part(file_name, hash, compression, unpack, width,
+		height);
+
+	if (index != ACTOR_PART_CACHE_MAX)
+	{
+		actor_part_cache[index].access_time = ++actor_part_cache_time;
+		actor_part_cache_hits++;
+
+		result = copy_actor_part(&actor_part_cache[index], image);
+
+		CHECK_AND_UNLOCK_MUTEX(actor_part_cache_mutex);
+
+		el_close(file);
+
+		return result;
+	}
+
+	actor_part_cache_misses++;
+
+	CHECK_AND_UNLOCK_MUTEX(actor_part_cache_mutex);
+
+	if (load_image_data_file_size(file, compression, unpack, width,
+		height, image) == 0)
+	{
+		return 0;
+	}
+
+	CHECK_AND_LOCK_MUTEX(actor_part_cache_mutex);
+
+	add_actor_part(file_name, hash, compression, unpack, width, height,
+		image);
+
+	CHECK_AND_UNLOCK_MUTEX(actor_part_cache_mutex);
+
+	return 1;
+#else	/* ACTOR_PART_CACHE */
+	return load_image_data_file_size(file, compression, unpack, width,
+		height, image);
+#endif	/* ACTOR_PART_CACHE */
+}
+
 static Uint32 load_to_coordinates(el_file_ptr file, const Uint32 x,
 	const Uint32 y, const Uint32 width, const Uint32 height,
 	const Uint32 use_compressed_image, const Uint32 scale, image_t *dst)
@@ -1002,7 +1291,7 @@ static Uint32 load_to_coordinates(el_file_ptr file, const Uint32 x,
 
 	if (use_compressed_image == 1)
 	{
-		if (load_image_data_file_size(file, tct_s3tc, 0, tw, th,
+		if (load_actor_part_image(file, tct_s3tc, 0, tw, th,
 			&image) == 0)
 		{
 			LOG_ERROR("Can't load file '%s'.", el_file_name(file));
@@ -1031,7 +1320,7 @@ static Uint32 load_to_coordinates(el_file_ptr file, const Uint32 x,
 	}
 	else
 	{
-		if (load_image_data_file_size(file, 0, 1, tw, th, &image) == 0)
+		if (load_actor_part_image(file, 0, 1, tw, th, &image) == 0)
 		{
 			LOG_ERROR("Can't load file '%s'.", el_file_name(file));
 			return 0;
@@ -1089,7 +1378,7 @@ static Uint32 load_to_coordinates_mask2(el_file_ptr source0, el_file_ptr source1
 			use_compressed_image, scale, dest);
 	}
 
-	if (load_image_data_file_size(source0, 0, 1, tw, th, &src0) == 0)
+	if (load_actor_part_image(source0, 0, 1, tw, th, &src0) == 0)
 	{
 		LOG_ERROR("Can't load file '%s'.", el_file_name(source0));
 		free_image(&src0);
@@ -1105,7 +1394,7 @@ static Uint32 load_to_coordinates_mask2(el_file_ptr source0, el_file_ptr source1
 		return 0;
 	}
 
-	if (load_image_data_file_size(source1, 0, 1, tw, th, &src1) == 0)
+	if (load_actor_part_image(source1, 0, 1, tw, th, &src1) == 0)
 	{
 		LOG_ERROR("Can't load file '%s'.", el_file_name(source1));
 		free_image(&src0);
@@ -1121,7 +1410,7 @@ static Uint32 load_to_coordinates_mask2(el_file_ptr source0, el_file_ptr source1
 		return 0;
 	}
 
-	if (load_image_data_file_size(mask, 0, 0, tw, th, &msk) == 0)
+	if (load_actor_part_image(mask, 0, 0, tw, th, &msk) == 0)
 	{
 		LOG_ERROR("Can't load file '%s'.", el_file_name(mask));
 		return 0;
@@ -1625,11 +1914,161 @@ static void copy_enhanced_actor_file_name(char* dest, const char* source)
 	safe_strncpy2(dest, source, MAX_FILE_PATH, get_file_name_len(source));
 }
 
+#ifdef	ACTOR_PART_CACHE
+static Uint32 find_shared_actor_texture(const Uint32 handle,
+	const Uint32 hash, const enhanced_actor_images_t* files)
+{
+	Uint32 i, found;
+
+	for (i = 0; i < ACTOR_TEXTURE_CACHE_MAX; i++)
+	{
+		if (i == handle)
+		{
+			continue;
+		}
+
+		CHECK_AND_LOCK_MUTEX(actor_texture_handles[i].mutex);
+
+		// only a texture that is built for this slot can be shared
+		found = (actor_texture_handles[i].used != 0) &&
+			(actor_texture_handles[i].alias ==
+				ACTOR_TEXTURE_CACHE_MAX) &&
+			(actor_texture_handles[i].hash == hash) &&
+			(memcmp(&actor_texture_handles[i].files, files,
+				sizeof(enhanced_actor_images_t)) == 0);
+
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[i].mutex);
+
+		if (found != 0)
+		{
+			return i;
+		}
+	}
+
+	return ACTOR_TEXTURE_CACHE_MAX;
+}
+
+static void share_actor_texture(const Uint32 handle, const Uint32 shared)
+{
+	CHECK_AND_LOCK_MUTEX(actor_texture_handles[shared].mutex);
+
+	actor_texture_handles[shared].used++;
+
+	CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[shared].mutex);
+
+	actor_texture_handles[handle].alias = shared;
+}
+
+/*!
+ * The texture of the handle is used by other handles, but the handle gets
+ * new files. The texture is moved to one of the handles that use it, the
+ * others use it from there and the handle itself uses it until its own
+ * texture is loaded. Must be called without the mutex of the handle.
+ */
+static void unshare_actor_texture(const Uint32 handle)
+{
+	actor_texture_cache_t* owner;
+	actor_texture_cache_t* texture;
+	Uint32 i, reload;
+
+	texture = &actor_texture_handles[handle];
+	owner = 0;
+	reload = 0;
+
+	for (i = 0; i < ACTOR_TEXTURE_CACHE_MAX; i++)
+	{
+		if (i == handle)
+		{
+			continue;
+		}
+
+		CHECK_AND_LOCK_MUTEX(actor_texture_handles[i].mutex);
+
+		if (actor_texture_handles[i].alias != handle)
+		{
+			CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[i].mutex);
+
+			continue;
+		}
+
+		CHECK_AND_LOCK_MUTEX(texture->mutex);
+
+		if ((owner == 0) && (actor_texture_handles[i].hash ==
+			texture->hash) && (memcmp(&actor_texture_handles[i].files,
+			&texture->files, sizeof(enhanced_actor_images_t)) == 0))
+		{
+			owner = &actor_texture_handles[i];
+
+			// the handle only uses the shared texture, so it has
+			// nothing of its own that would be lost
+			free_actor_texture_resources(owner);
+
+			owner->id = texture->id;
+			owner->new_id = texture->new_id;
+			memcpy(&owner->image, &texture->image, sizeof(image_t));
+			owner->state = texture->state;
+			owner->alias = ACTOR_TEXTURE_CACHE_MAX;
+
+			texture->id = 0;
+			texture->new_id = 0;
+			texture->image.image = 0;
+			texture->state = tst_unloaded;
+
+			// the thread only stores images for the current files
+			if ((owner->state == tst_unloaded) ||
+				(owner->state == tst_image_loading))
+			{
+				owner->state = tst_unloaded;
+				reload = 1;
+			}
+		}
+		else if (owner != 0)
+		{
+			actor_texture_handles[i].alias = owner -
+				actor_texture_handles;
+			owner->used++;
+		}
+		else
+		{
+			CHECK_AND_UNLOCK_MUTEX(texture->mutex);
+			CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[i].mutex);
+
+			continue;
+		}
+
+		texture->used--;
+
+		CHECK_AND_UNLOCK_MUTEX(texture->mutex);
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[i].mutex);
+	}
+
+	if (owner == 0)
+	{
+		return;
+	}
+
+	CHECK_AND_LOCK_MUTEX(texture->mutex);
+
+	free_actor_texture_resources(texture);
+	share_actor_texture(handle, owner - actor_texture_handles);
+
+	CHECK_AND_UNLOCK_MUTEX(texture->mutex);
+
+	if (reload != 0)
+	{
+		queue_push_signal(actor_texture_queue, owner);
+	}
+}
+#endif	/* ACTOR_PART_CACHE */
+
 Uint32 load_enhanced_actor(const enhanced_actor* actor, const char* name)
 {
 	enhanced_actor_images_t files;
 	char str[MAX_ACTOR_NAME];
 	Uint32 i, handle, hash, access_time;
+#ifdef	ACTOR_PART_CACHE
+	Uint32 shared;
+#endif	/* ACTOR_PART_CACHE */
 
 	memset(str, 0, sizeof(str));
 
@@ -1673,6 +2112,10 @@ Uint32 load_enhanced_actor(const enhanced_actor* actor, const char* name)
 	hash = mem_hash(&files, sizeof(files));
 
 	assert(actor_texture_handles != 0);
+#ifdef	ACTOR_PART_CACHE
+	shared = find_shared_actor_texture(ACTOR_TEXTURE_CACHE_MAX, hash,
+		&files);
+#endif	/* ACTOR_PART_CACHE */
 	handle = ACTOR_TEXTURE_CACHE_MAX;
 
 	for (i = 0; i < ACTOR_TEXTURE_CACHE_MAX; i++)
@@ -1781,6 +2224,20 @@ Uint32 load_enhanced_actor(const enhanced_actor* actor, const char* name)
 		actor_texture_handles[handle].used = 1;
 		actor_texture_handles[handle].access_time = cur_time;
 
+#ifdef	ACTOR_PART_CACHE
+		if (shared != ACTOR_TEXTURE_CACHE_MAX)
+		{
+			// an actor with the same files, use its texture
+			share_actor_texture(handle, shared);
+			actor_texture_handles[handle].state =
+				tst_texture_loaded;
+
+			CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+			return handle;
+		}
+#endif	/* ACTOR_PART_CACHE */
+
 		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
 
 		queue_push_signal(actor_texture_queue, &actor_texture_handles[handle]);
@@ -1795,9 +2252,212 @@ Uint32 load_enhanced_actor(const enhanced_actor* actor, const char* name)
 	}
 }
 
+static void set_actor_texture_id(const Uint32 handle, const GLuint id)
+{
+	if (actor_texture_handles[handle].id == 0)
+	{
+		actor_texture_handles[handle].id = id;
+		actor_texture_handles[handle].state = tst_texture_loaded;
+	}
+	else
+	{
+		if (actor_texture_handles[handle].new_id != 0)
+		{
+			LOG_ERROR("New texture id in use at texture"
+				" handle: %i.", handle);
+
+			glDeleteTextures(1, &actor_texture_handles[handle].new_id);
+		}
+
+		actor_texture_handles[handle].new_id = id;
+		actor_texture_handles[handle].state = tst_texture_loading;
+	}
+}
+
+#ifdef	FBO_ACTOR_TEXTURES
+static Uint32 get_actor_compositor_ready()
+{
+	if (actor_compositor_state == acs_unknown)
+	{
+		if ((use_fbo_actor_textures != 0) &&
+			have_extension(ext_framebuffer_object) &&
+			have_extension(arb_shader_objects) &&
+			have_extension(arb_fragment_shader) &&
+			have_extension(arb_shading_language_100) &&
+			(init_actor_compositor() != 0))
+		{
+			actor_compositor_state = acs_ready;
+		}
+		else
+		{
+			actor_compositor_state = acs_failed;
+		}
+	}
+
+	return actor_compositor_state == acs_ready;
+}
+
+static void add_actor_texture_layer(const char* part, const char* base,
+	const char* mask, const Uint32 x, const Uint32 y, const Uint32 width,
+	const Uint32 height, actor_texture_layer_t* layers, Uint32* count,
+	Uint32* scale, Uint32* alpha)
+{
+	actor_texture_layer_t* layer;
+	Uint32 handle;
+	GLint size;
+
+	if (part[0] == 0)
+	{
+		return;
+	}
+
+	layer = &layers[*count];
+
+	memset(layer, 0, sizeof(actor_texture_layer_t));
+
+	handle = load_texture_cached(part, tt_atlas);
+	layer->part = get_texture_id(handle);
+
+	if (layer->part == 0)
+	{
+		LOG_ERROR("Can't load file '%s'.", part);
+
+		return;
+	}
+
+	if ((base[0] != 0) && (mask[0] != 0))
+	{
+		layer->base = get_texture_id(load_texture_cached(base,
+			tt_atlas));
+		layer->mask = get_texture_id(load_texture_cached(mask,
+			tt_atlas));
+	}
+
+	bind_texture_id(layer->part);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &size);
+
+	// the parts are drawn at the largest scale all of them have
+	*scale = min2u(*scale, size / width);
+	*alpha |= get_texture_alpha(handle);
+
+	layer->x = x;
+	layer->y = y;
+	layer->width = width;
+	layer->height = height;
+
+	(*count)++;
+}
+
+static Uint32 compose_actor_texture(const Uint32 handle)
+{
+	actor_texture_layer_t layers[12];
+	const enhanced_actor_images_t* files;
+	Uint32 count, scale, alpha, af;
+	GLenum min_filter;
+	GLuint id;
+
+	files = &actor_texture_handles[handle].files;
+	count = 0;
+	alpha = 0;
+
+	// the same filters as the textures built on the CPU
+	if (poor_man != 0)
+	{
+		scale = 2;
+		min_filter = GL_LINEAR_MIPMAP_NEAREST;
+		af = 0;
+	}
+	else
+	{
+		scale = 8;
+		min_filter = GL_LINEAR_MIPMAP_LINEAR;
+		af = 1;
+	}
+
+	add_actor_texture_layer(files->pants_tex, files->legs_base,
+		files->pants_mask, 39, 88, 40, 40, layers, &count, &scale,
+		&alpha);
+	add_actor_texture_layer(files->boots_tex, files->boots_base,
+		files->boots_mask, 0, 88, 39, 40, layers, &count, &scale,
+		&alpha);
+	add_actor_texture_layer(files->torso_tex, files->body_base,
+		files->torso_mask, 79, 74, 49, 54, layers, &count, &scale,
+		&alpha);
+	add_actor_texture_layer(files->arms_tex, files->arms_base,
+		files->arms_mask, 0, 48, 40, 40, layers, &count, &scale,
+		&alpha);
+	add_actor_texture_layer(files->hands_tex, files->hands_tex_save,
+		files->hands_mask, 34, 32, 16, 16, layers, &count, &scale,
+		&alpha);
+	add_actor_texture_layer(files->head_tex, files->head_base,
+		files->head_mask, 34, 0, 32, 32, layers, &count, &scale,
+		&alpha);
+	add_actor_texture_layer(files->hair_tex, "", "", 0, 0, 34, 48,
+		layers, &count, &scale, &alpha);
+	add_actor_texture_layer(files->weapon_tex, "", "", 89, 38, 39, 36,
+		layers, &count, &scale, &alpha);
+	add_actor_texture_layer(files->shield_tex, "", "", 50, 38, 39, 36,
+		layers, &count, &scale, &alpha);
+	add_actor_texture_layer(files->helmet_tex, "", "", 40, 74, 39, 14,
+		layers, &count, &scale, &alpha);
+	add_actor_texture_layer(files->neck_tex, "", "", 40, 48, 10, 26,
+		layers, &count, &scale, &alpha);
+	add_actor_texture_layer(files->cape_tex, "", "", 66, 0, 62, 38,
+		layers, &count, &scale, &alpha);
+
+	while ((scale & (scale - 1)) != 0)
+	{
+		scale &= scale - 1;
+	}
+
+	id = build_actor_texture(layers, count, max2u(scale, 1), min_filter,
+		af);
+
+	if (id == 0)
+	{
+		return 0;
+	}
+
+	actor_texture_handles[handle].image.alpha = alpha;
+
+	set_actor_texture_id(handle, id);
+
+	return 1;
+}
+
+/* The threads skipped every texture while the compositor was ready, so
+ * all textures that are not built yet are given back to them. */
+static void use_actor_texture_threads()
+{
+	Uint32 i, unloaded;
+
+	for (i = 0; i < ACTOR_TEXTURE_CACHE_MAX; i++)
+	{
+		CHECK_AND_LOCK_MUTEX(actor_texture_handles[i].mutex);
+
+		unloaded = (actor_texture_handles[i].used != 0) &&
+			(actor_texture_handles[i].state == tst_unloaded);
+
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[i].mutex);
+
+		if (unloaded != 0)
+		{
+			queue_push_signal(actor_texture_queue,
+				&actor_texture_handles[i]);
+		}
+	}
+}
+#endif	/* FBO_ACTOR_TEXTURES */
+
 Uint32 bind_actor_texture(const Uint32 handle, char* alpha)
 {
 	Uint32 af, result;
+#ifdef	ACTOR_PART_CACHE
+	Uint32 alias;
+#endif	/* ACTOR_PART_CACHE */
+#ifdef	FBO_ACTOR_TEXTURES
+	Uint32 compositor_failed;
+#endif	/* FBO_ACTOR_TEXTURES */
 	GLuint id;
 	GLenum min_filter;
 	texture_format_type format;
@@ -1825,6 +2485,10 @@ Uint32 bind_actor_texture(const Uint32 handle, char* alpha)
 
 	actor_texture_handles[handle].access_time = cur_time;
 
+#ifdef	FBO_ACTOR_TEXTURES
+	compositor_failed = 0;
+#endif	/* FBO_ACTOR_TEXTURES */
+
 	if (alpha != 0)
 	{
 		*alpha = actor_texture_handles[handle].image.alpha;
@@ -1876,33 +2540,65 @@ Uint32 bind_actor_texture(const Uint32 handle, char* alpha)
 
 		actor_texture_handles[handle].image.image = 0;
 
-		if (actor_texture_handles[handle].id == 0)
+		set_actor_texture_id(handle, id);
+	}
+#ifdef	FBO_ACTOR_TEXTURES
+	else if ((actor_texture_handles[handle].state == tst_unloaded) &&
+		(get_actor_compositor_ready() != 0))
+	{
+		if (compose_actor_texture(handle) == 0)
 		{
-			actor_texture_handles[handle].id = id;
-			actor_texture_handles[handle].state = tst_texture_loaded;
+			LOG_ERROR("Building actor texture %i with the frame "
+				"buffer failed, using the threads.", handle);
+
+			actor_compositor_state = acs_failed;
+			compositor_failed = 1;
 		}
-		else
-		{
-			if (actor_texture_handles[handle].new_id != 0)
-			{
-				LOG_ERROR("New texture id in use at texture"
-					" handle: %i.", handle);
+	}
+#endif	/* FBO_ACTOR_TEXTURES */
 
-				glDeleteTextures(1, &actor_texture_handles[handle].new_id);
-			}
+#ifdef	ACTOR_PART_CACHE
+	alias = actor_texture_handles[handle].alias;
 
-			actor_texture_handles[handle].new_id = id;
-			actor_texture_handles[handle].state = tst_texture_loading;
-		}
+	if (result != 0)
+	{
+		actor_texture_handles[handle].alias = ACTOR_TEXTURE_CACHE_MAX;
 	}
+#endif	/* ACTOR_PART_CACHE */
 
 	CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
 
+#ifdef	FBO_ACTOR_TEXTURES
+	if (compositor_failed != 0)
+	{
+		use_actor_texture_threads();
+	}
+#endif	/* FBO_ACTOR_TEXTURES */
+
+#ifdef	ACTOR_PART_CACHE
+	if (alias != ACTOR_TEXTURE_CACHE_MAX)
+	{
+		if (result != 0)
+		{
+			// the own texture is used, release the shared one
+			free_actor_texture(alias);
+		}
+		else
+		{
+			result = bind_actor_texture(alias, alpha);
+		}
+	}
+#endif	/* ACTOR_PART_CACHE */
+
 	return result;
 }
 
 void free_actor_texture(const Uint32 handle)
 {
+#ifdef	ACTOR_PART_CACHE
+	Uint32 alias;
+
+#endif	/* ACTOR_PART_CACHE */
 	if (handle >= ACTOR_TEXTURE_CACHE_MAX)
 	{
 		LOG_ERROR("handle: %i, max_handle: %i\n", handle,
@@ -1924,7 +2620,38 @@ void free_actor_texture(const Uint32 handle)
 	}
 #endif	/* DEBUG */
 
+#ifdef	ACTOR_PART_CACHE
+	if (actor_texture_handles[handle].used == 0)
+	{
+		LOG_ERROR("actor texture used value is invalid: %i.", handle);
+
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+		return;
+	}
+
+	actor_texture_handles[handle].used--;
+
+	if (actor_texture_handles[handle].used != 0)
+	{
+		// still used by other handles
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+		return;
+	}
+
+	alias = actor_texture_handles[handle].alias;
+	actor_texture_handles[handle].alias = ACTOR_TEXTURE_CACHE_MAX;
+
+	// without an own texture, the handle can't be used again as it is
+	if ((alias != ACTOR_TEXTURE_CACHE_MAX) &&
+		(actor_texture_handles[handle].id == 0))
+	{
+		free_actor_texture_resources(&actor_texture_handles[handle]);
+	}
+#else	/* ACTOR_PART_CACHE */
 	actor_texture_handles[handle].used = 0;
+#endif	/* ACTOR_PART_CACHE */
 
 	if (handle >= max_actor_texture_handles)
 	{
@@ -1932,6 +2659,13 @@ void free_actor_texture(const Uint32 handle)
 	}
 
 	CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+#ifdef	ACTOR_PART_CACHE
+	if (alias != ACTOR_TEXTURE_CACHE_MAX)
+	{
+		free_actor_texture(alias);
+	}
+#endif	/* ACTOR_PART_CACHE */
 }
 
 Uint32 get_actor_texture_ready(const Uint32 handle)
@@ -2035,6 +2769,9 @@ void change_enhanced_actor(const Uint32 handle, enhanced_actor* actor)
 {
 	enhanced_actor_images_t files;
 	Uint32 hash;
+#ifdef	ACTOR_PART_CACHE
+	Uint32 shared, alias;
+#endif	/* ACTOR_PART_CACHE */
 
 	if (handle >= ACTOR_TEXTURE_CACHE_MAX)
 	{
@@ -2104,6 +2841,51 @@ void change_enhanced_actor(const Uint32 handle, enhanced_actor* actor)
  		}
  	}
 
+#ifdef	ACTOR_PART_CACHE
+	if (actor_texture_handles[handle].used > 1)
+	{
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+		unshare_actor_texture(handle);
+
+		CHECK_AND_LOCK_MUTEX(actor_texture_handles[handle].mutex);
+	}
+
+	CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+	shared = find_shared_actor_texture(handle, hash, &files);
+
+	CHECK_AND_LOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+	// only switch to a texture that is already there
+	if ((shared != ACTOR_TEXTURE_CACHE_MAX) &&
+		(actor_texture_handles[handle].used == 1) &&
+		(actor_texture_handles[shared].id != 0))
+	{
+		alias = actor_texture_handles[handle].alias;
+
+		free_actor_texture_resources(&actor_texture_handles[handle]);
+
+		memcpy(&actor_texture_handles[handle].files, &files,
+			sizeof(files));
+
+		actor_texture_handles[handle].hash = hash;
+		actor_texture_handles[handle].access_time = cur_time;
+
+		share_actor_texture(handle, shared);
+		actor_texture_handles[handle].state = tst_texture_loaded;
+
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[handle].mutex);
+
+		if (alias != ACTOR_TEXTURE_CACHE_MAX)
+		{
+			free_actor_texture(alias);
+		}
+
+		return;
+	}
+#endif	/* ACTOR_PART_CACHE */
+
 	memcpy(&actor_texture_handles[handle].files, &files, sizeof(files));
 
 	actor_texture_handles[handle].hash = hash;
@@ -2139,7 +2921,13 @@ int load_enhanced_actor_thread(void* done)
 
 		CHECK_AND_LOCK_MUTEX(actor->mutex);
 
+#ifdef	FBO_ACTOR_TEXTURES
+		// the compositor builds the texture when it is bound
+		while ((actor->state == tst_unloaded) &&
+			(actor_compositor_state != acs_ready))
+#else	/* FBO_ACTOR_TEXTURES */
 		while (actor->state == tst_unloaded)
+#endif	/* FBO_ACTOR_TEXTURES */
 		{
 			memcpy(&files, &actor->files, sizeof(files));
 			hash = actor->hash;
@@ -2231,14 +3019,29 @@ void init_texture_cache()
 	{
 		actor_texture_handles[i].mutex = SDL_CreateMutex();
 		actor_texture_handles[i].state = tst_unloaded;
+#ifdef	ACTOR_PART_CACHE
+		actor_texture_handles[i].alias = ACTOR_TEXTURE_CACHE_MAX;
+#endif	/* ACTOR_PART_CACHE */
 	}
 
+#ifdef	ACTOR_PART_CACHE
+	actor_part_cache_mutex = SDL_CreateMutex();
+
+	actor_texture_thread_count = clampi(actor_texture_thread_count, 1,
+		ACTOR_TEXTURE_THREAD_COUNT);
+
+	for (i = 0; i < (Uint32)actor_texture_thread_count; i++)
+#else	/* ACTOR_PART_CACHE */
 	for (i = 0; i < ACTOR_TEXTURE_THREAD_COUNT; i++)
+#endif	/* ACTOR_PART_CACHE */
 	{
 		actor_texture_threads[i] = SDL_CreateThread(
 			load_enhanced_actor_thread, &actor_texture_threads_done);
 	}
 #endif	/* ELC */
+#ifdef	DDS_TEXTURE_CACHE
+	init_dds_cache();
+#endif	/* DDS_TEXTURE_CACHE */
 }
 
 void free_texture_cache()
@@ -2246,12 +3049,22 @@ void free_texture_cache()
 	Uint32 i;
 #ifdef	ELC
 	int result;
+#endif	/* ELC */
+
+#ifdef	DDS_TEXTURE_CACHE
+	free_dds_cache();
+#endif	/* DDS_TEXTURE_CACHE */
+#ifdef	ELC
 
 	actor_texture_threads_done = 1;
 
 	while (queue_pop(actor_texture_queue) != 0);
 
+#ifdef	ACTOR_PART_CACHE
+	for (i = 0; i < (Uint32)actor_texture_thread_count; i++)
+#else	/* ACTOR_PART_CACHE */
 	for (i = 0; i < ACTOR_TEXTURE_THREAD_COUNT; i++)
+#endif	/* ACTOR_PART_CACHE */
 	{
 		SDL_CondBroadcast(actor_texture_queue->condition);
 		SDL_WaitThread(actor_texture_threads[i], &result);
@@ -2259,6 +3072,18 @@ void free_texture_cache()
 
 	queue_destroy(actor_texture_queue);
 
+#ifdef	ACTOR_PART_CACHE
+	clear_actor_part_cache();
+
+	SDL_DestroyMutex(actor_part_cache_mutex);
+	actor_part_cache_mutex = NULL;
+#endif	/* ACTOR_PART_CACHE */
+#ifdef	FBO_ACTOR_TEXTURES
+	free_actor_compositor();
+
+	actor_compositor_state = acs_unknown;
+#endif	/* FBO_ACTOR_TEXTURES */
+
 	for (i = 0; i < ACTOR_TEXTURE_CACHE_MAX; i++)
 	{
 		free_actor_texture_resources(&actor_texture_handles[i]);
@@ -2308,6 +3133,144 @@ void unload_texture_cache()
 #endif	/* ELC */
 }
 
+#if	defined(DDS_TEXTURE_CACHE) && defined(ELC)
+static Uint32 reload_textures(Uint32* count, Uint32* size)
+{
+	Uint32 i, start;
+
+	*count = 0;
+	*size = 0;
+
+	start = SDL_GetTicks();
+
+	for (i = 0; i < texture_handles_used; i++)
+	{
+		if ((texture_handles[i].id == 0) ||
+			((texture_handles[i].type != tt_mesh) &&
+			(texture_handles[i].type != tt_image)))
+		{
+			continue;
+		}
+
+		cache_adj_size(texture_cache,
+			-compact_texture(&texture_handles[i]),
+			&texture_handles[i]);
+
+		if (load_texture_handle(i) != 0)
+		{
+			(*count)++;
+			*size += texture_handles[i].size;
+		}
+	}
+
+	glFinish();
+
+	return SDL_GetTicks() - start;
+}
+
+int command_texture_cache_benchmark(char *text, int len)
+{
+	char str[256];
+	Uint32 time, count, size;
+
+	use_dds_cache = 0;
+
+	time = reload_textures(&count, &size);
+
+	safe_snprintf(str, sizeof(str), "without cache: %d textures in %d "
+		"ms, %d kb", count, time, size / 1024);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	use_dds_cache = 1;
+
+	time = reload_textures(&count, &size);
+
+	safe_snprintf(str, sizeof(str), "first use: %d textures in %d ms, "
+		"%d kb", count, time, size / 1024);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	time = SDL_GetTicks();
+
+	wait_dds_cache();
+
+	safe_snprintf(str, sizeof(str), "cache written in %d ms",
+		SDL_GetTicks() - time);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	time = reload_textures(&count, &size);
+
+	safe_snprintf(str, sizeof(str), "cached: %d textures in %d ms, %d kb",
+		count, time, size / 1024);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* DDS_TEXTURE_CACHE && ELC */
+
+#if	defined(ACTOR_PART_CACHE) && defined(ELC)
+int command_actor_texture_stats(char *text, int len)
+{
+	char str[256];
+	Uint32 i, hits, misses, count, size, used, textures, shared;
+
+	CHECK_AND_LOCK_MUTEX(actor_part_cache_mutex);
+
+	hits = actor_part_cache_hits;
+	misses = actor_part_cache_misses;
+	size = actor_part_cache_used;
+	count = 0;
+
+	for (i = 0; i < ACTOR_PART_CACHE_MAX; i++)
+	{
+		if (actor_part_cache[i].image.image != 0)
+		{
+			count++;
+		}
+	}
+
+	CHECK_AND_UNLOCK_MUTEX(actor_part_cache_mutex);
+
+	safe_snprintf(str, sizeof(str), "part cache: %d hits, %d misses "
+		"(%d%% hit rate), %d images, %d kb of %d kb", hits, misses,
+		((hits + misses) > 0) ? hits * 100 / (hits + misses) : 0,
+		count, size / 1024, actor_part_cache_size * 1024);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	used = 0;
+	textures = 0;
+	shared = 0;
+
+	for (i = 0; i < ACTOR_TEXTURE_CACHE_MAX; i++)
+	{
+		CHECK_AND_LOCK_MUTEX(actor_texture_handles[i].mutex);
+
+		if (actor_texture_handles[i].used != 0)
+		{
+			used++;
+
+			if (actor_texture_handles[i].alias ==
+				ACTOR_TEXTURE_CACHE_MAX)
+			{
+				textures++;
+			}
+			else
+			{
+				shared++;
+			}
+		}
+
+		CHECK_AND_UNLOCK_MUTEX(actor_texture_handles[i].mutex);
+	}
+
+	safe_snprintf(str, sizeof(str), "actor textures: %d used, %d "
+		"distinct, %d shared, built by %d threads", used, textures,
+		shared, actor_texture_thread_count);
+	LOG_TO_CONSOLE(c_green1, str);
+
+	return 1;
+}
+#endif	/* ACTOR_PART_CACHE && ELC */
+
 #ifdef	DEBUG
 void dump_texture_cache()
 {
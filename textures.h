@@ -217,7 +217,12 @@ typedef struct
 	GLuint id;			/*!< the id of the texture */
 	GLuint new_id;			/*!< the id of the new texture */
 	Uint32 hash;			/*!< hash value of the files */
+#ifdef	ACTOR_PART_CACHE
+	Uint32 used;			/*!< the number of actors and handles using it */
+	Uint32 alias;			/*!< the handle whose texture is used while there is no own */
+#else	/* ACTOR_PART_CACHE */
 	Uint32 used;			/*!< if this is used at the moment? */
+#endif	/* ACTOR_PART_CACHE */
 	Uint32 access_time;		/*!< last time used */
 	texture_state_type state;	/*!< the texture states e.g. loading */
 } actor_texture_cache_t;
@@ -306,6 +311,46 @@ void change_enhanced_actor(const Uint32 handle, enhanced_actor* actor);
  */
 void unload_actor_texture_cache();
 
+#ifdef	DDS_TEXTURE_CACHE
+/*!
+ * \ingroup 	textures
+ * \brief 	Times loading the textures that are loaded.
+ *
+ *      	Loads the loaded mesh and image textures again without the
+ *		dds cache, with the cache while it is written and with the
+ *		written cache, and prints the time of each.
+ *
+ * \param   	text Unused.
+ * \param   	len Unused.
+ * \retval int	Always returns 1.
+ * \callgraph
+ */
+int command_texture_cache_benchmark(char *text, int len);
+#endif	/* DDS_TEXTURE_CACHE */
+
+#ifdef	ACTOR_PART_CACHE
+extern int actor_texture_thread_count;	/*!< the number of threads that build the actor textures */
+extern int actor_part_cache_size;	/*!< size of the decoded part image cache in MB, 0 disables it */
+
+/*!
+ * \ingroup 	textures
+ * \brief 	Prints the actor texture statistics.
+ *
+ *      	Prints the hit rate of the decoded part image cache and the
+ *		number of actor textures that are built and shared.
+ *
+ * \param   	text Unused.
+ * \param   	len Unused.
+ * \retval int	Always returns 1.
+ * \callgraph
+ */
+int command_actor_texture_stats(char *text, int len);
+#endif	/* ACTOR_PART_CACHE */
+
+#ifdef	FBO_ACTOR_TEXTURES
+extern int use_fbo_actor_textures;	/*!< build the actor textures with a frame buffer object if supported */
+#endif	/* FBO_ACTOR_TEXTURES */
+
 #endif	//ELC
 
 #ifdef	DEBUG
@@ -35,10 +35,78 @@ char map_file_name[256];
 GLfloat* terrain_tile_buffer = 0;
 GLuint terrain_tile_buffer_object = 0;
 int terrain_buffer_usage = 0;
+#ifdef	STATIC_TERRAIN_BUFFER
+typedef struct
+{
+	Uint32 texture;
+	Uint32 start;
+	Uint32 count;
+} terrain_range;
+
+GLuint* terrain_tile_indices = 0;
+GLuint terrain_tile_index_object = 0;
+static Uint32* terrain_tile_slots = 0;
+static terrain_range terrain_ranges[256];
+static Uint32 terrain_range_count = 0;
+
+#define	TERRAIN_NO_SLOT	0xFFFFFFFF
+
+/* The whole terrain grid is built and uploaded once per map, culling only
+ * rebuilds the index list and one draw range per tile texture. */
+static __inline__ void build_static_terrain_grid(int terrain_buffer_size)
+{
+	Uint32 x, y, slot;
+	float x_scaled, y_scaled;
+	int cur_tile;
+
+	terrain_tile_slots = realloc(terrain_tile_slots, tile_map_size_x *
+		tile_map_size_y * sizeof(Uint32));
+
+	slot = 0;
+
+	for (y = 0; y < tile_map_size_y; y++)
+	{
+		for (x = 0; x < tile_map_size_x; x++)
+		{
+			cur_tile = tile_map[y * tile_map_size_x + x];
+
+			if ((cur_tile == 255) || IS_WATER_TILE(cur_tile) ||
+				(slot >= terrain_buffer_size))
+			{
+				terrain_tile_slots[y * tile_map_size_x + x] = TERRAIN_NO_SLOT;
+				continue;
+			}
+
+			x_scaled = x * 3.0f;
+			y_scaled = y * 3.0f;
+
+			terrain_tile_buffer[slot * 8 + 0] = x_scaled;
+			terrain_tile_buffer[slot * 8 + 1] = y_scaled + 3.0f;
+			terrain_tile_buffer[slot * 8 + 2] = x_scaled;
+			terrain_tile_buffer[slot * 8 + 3] = y_scaled;
+			terrain_tile_buffer[slot * 8 + 4] = x_scaled + 3.0f;
+			terrain_tile_buffer[slot * 8 + 5] = y_scaled;
+			terrain_tile_buffer[slot * 8 + 6] = x_scaled + 3.0f;
+			terrain_tile_buffer[slot * 8 + 7] = y_scaled + 3.0f;
+
+			terrain_tile_slots[y * tile_map_size_x + x] = slot;
+			slot++;
+		}
+	}
+
+	terrain_range_count = 0;
+	terrain_buffer_usage = 0;
+}
+#endif	/* STATIC_TERRAIN_BUFFER */
 
 void init_terrain_buffers(int terrain_buffer_size)
 {
 	terrain_tile_buffer = realloc(terrain_tile_buffer, terrain_buffer_size * 4 * 2 * sizeof(GLfloat));
+#ifdef	STATIC_TERRAIN_BUFFER
+	terrain_tile_indices = realloc(terrain_tile_indices, terrain_buffer_size * 4 * sizeof(GLuint));
+
+	build_static_terrain_grid(terrain_buffer_size);
+#endif	/* STATIC_TERRAIN_BUFFER */
 
 	if (have_extension(arb_vertex_buffer_object))
 	{
@@ -46,16 +114,155 @@ void init_terrain_buffers(int terrain_buffer_size)
 		{
 			ELglGenBuffersARB(1, &terrain_tile_buffer_object);
 		}
+#ifdef	STATIC_TERRAIN_BUFFER
+		if (terrain_tile_index_object == 0)
+		{
+			ELglGenBuffersARB(1, &terrain_tile_index_object);
+		}
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, terrain_tile_buffer_object);
+		ELglBufferDataARB(GL_ARRAY_BUFFER_ARB, terrain_buffer_size * 4 * 2 * sizeof(GLfloat),
+			terrain_tile_buffer, GL_STATIC_DRAW_ARB);
+		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+		ELglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, terrain_tile_index_object);
+		ELglBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0, 0, GL_STREAM_DRAW_ARB);
+		ELglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+#else	/* STATIC_TERRAIN_BUFFER */
 		else
 		{
 			ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, terrain_tile_buffer_object);
 			ELglBufferDataARB(GL_ARRAY_BUFFER_ARB, 0, 0, GL_DYNAMIC_DRAW_ARB);
 			ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 		}
+#endif	/* STATIC_TERRAIN_BUFFER */
+	}
+
+}
+
+void free_terrain_buffers()
+{
+	if (terrain_tile_buffer)
+	{
+		free(terrain_tile_buffer);
+		terrain_tile_buffer = 0;
+	}
+#ifdef	STATIC_TERRAIN_BUFFER
+	if (terrain_tile_indices)
+	{
+		free(terrain_tile_indices);
+		terrain_tile_indices = 0;
+	}
+	if (terrain_tile_slots)
+	{
+		free(terrain_tile_slots);
+		terrain_tile_slots = 0;
+	}
+	terrain_range_count = 0;
+#endif	/* STATIC_TERRAIN_BUFFER */
+}
+
+#ifdef	STATIC_TERRAIN_BUFFER
+static __inline__ void build_terrain_buffer()
+{
+	unsigned int i, j, l, x, y, start, stop, slot, texture;
+#ifdef CLUSTER_INSIDES_OLD
+	short cluster = get_actor_cluster ();
+	short tile_cluster;
+#endif
+
+	if (get_bbox_intersect_flag(main_bbox_tree, TYPE_TERRAIN, ide_changed))
+	{
+		clear_bbox_intersect_flag(main_bbox_tree, TYPE_TERRAIN, ide_changed);
+	}
+	else
+	{
+		return;
+	}
+
+	j = 0;
+	terrain_range_count = 0;
+
+	get_intersect_start_stop(main_bbox_tree, TYPE_TERRAIN, &start, &stop);
+
+	/* The intersection list is sorted by tile type, so every texture
+	 * ends up in exactly one contiguous range of indices. */
+	for (i = start; i < stop; i++)
+	{
+		l = get_intersect_item_ID(main_bbox_tree, i);
+		x = get_terrain_x (l);
+		y = get_terrain_y (l);
+
+#ifdef CLUSTER_INSIDES_OLD
+		tile_cluster = get_cluster (6*x, 6*y);
+		if (tile_cluster && tile_cluster != cluster)
+			continue;
+#endif
+
+		slot = terrain_tile_slots[y * tile_map_size_x + x];
+
+		if (slot == TERRAIN_NO_SLOT)
+		{
+			continue;
+		}
+
+#ifdef	NEW_TEXTURES
+		texture = tile_list[tile_map[y * tile_map_size_x + x]];
+#else	/* NEW_TEXTURES */
+		texture = get_texture_id(tile_list[tile_map[y * tile_map_size_x + x]]);
+#endif	/* NEW_TEXTURES */
+
+		if ((terrain_range_count == 0) ||
+			(terrain_ranges[terrain_range_count - 1].texture != texture))
+		{
+			terrain_ranges[terrain_range_count].texture = texture;
+			terrain_ranges[terrain_range_count].start = j * 4;
+			terrain_ranges[terrain_range_count].count = 0;
+			terrain_range_count++;
+		}
+
+		terrain_tile_indices[j * 4 + 0] = slot * 4 + 0;
+		terrain_tile_indices[j * 4 + 1] = slot * 4 + 1;
+		terrain_tile_indices[j * 4 + 2] = slot * 4 + 2;
+		terrain_tile_indices[j * 4 + 3] = slot * 4 + 3;
+		terrain_ranges[terrain_range_count - 1].count += 4;
+		j++;
 	}
 
+	terrain_buffer_usage = j;
+
+	if (have_extension(arb_vertex_buffer_object))
+	{
+		ELglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, terrain_tile_index_object);
+		ELglBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, terrain_buffer_usage * 4 * sizeof(GLuint),
+			terrain_tile_indices, GL_STREAM_DRAW_ARB);
+		ELglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	}
 }
 
+static __inline__ void draw_terrain_ranges()
+{
+	Uint32 i;
+
+	for (i = 0; i < terrain_range_count; i++)
+	{
+#ifdef	NEW_TEXTURES
+		bind_texture(terrain_ranges[i].texture);
+#else	/* NEW_TEXTURES */
+		bind_texture_id(terrain_ranges[i].texture);
+#endif	/* NEW_TEXTURES */
+
+		if (use_vertex_buffers)
+		{
+			glDrawElements(GL_QUADS, terrain_ranges[i].count, GL_UNSIGNED_INT,
+				(const GLvoid*)(terrain_ranges[i].start * sizeof(GLuint)));
+		}
+		else
+		{
+			glDrawElements(GL_QUADS, terrain_ranges[i].count, GL_UNSIGNED_INT,
+				terrain_tile_indices + terrain_ranges[i].start);
+		}
+	}
+}
+#else	/* STATIC_TERRAIN_BUFFER */
 static __inline__ void build_terrain_buffer()
 {
 	unsigned int i, j, l, x, y, start, stop;
@@ -114,6 +321,7 @@ static __inline__ void build_terrain_buffer()
 		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
 	}
 }
+#endif	/* STATIC_TERRAIN_BUFFER */
 
 #ifdef	NEW_TEXTURES
 void draw_quad_tiles(const unsigned int start, const unsigned int stop,
@@ -338,6 +546,9 @@ void draw_tile_map()
 	if (use_vertex_buffers)
 	{
 		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, terrain_tile_buffer_object);
+#ifdef	STATIC_TERRAIN_BUFFER
+		ELglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, terrain_tile_index_object);
+#endif	/* STATIC_TERRAIN_BUFFER */
 		glInterleavedArrays(GL_V2F, 0, 0);
 	}
 	else
@@ -352,11 +563,15 @@ void draw_tile_map()
 		glEnable(GL_MULTISAMPLE);
 	}
 #endif	/* FSAA */
+#ifdef	STATIC_TERRAIN_BUFFER
+	draw_terrain_ranges();
+#else	/* STATIC_TERRAIN_BUFFER */
 #ifdef	NEW_TEXTURES
 	draw_quad_tiles(start, stop, 0, tile_list[0]);
 #else	/* NEW_TEXTURES */
 	draw_terrain_quad_tiles(start, stop);
 #endif	/* NEW_TEXTURES */
+#endif	/* STATIC_TERRAIN_BUFFER */
 #ifdef	FSAA
 	if (fsaa > 1)
 	{
@@ -369,6 +584,9 @@ void draw_tile_map()
 	if (use_vertex_buffers)
 	{
 		ELglBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+#ifdef	STATIC_TERRAIN_BUFFER
+		ELglBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+#endif	/* STATIC_TERRAIN_BUFFER */
 	}
 
 	glDisableClientState(GL_VERTEX_ARRAY);
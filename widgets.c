@@ -2294,6 +2294,12 @@ int text_field_resize (widget_list *w, int width, int height)
 				tf->select.lines = realloc (tf->select.lines, tf->nr_visible_lines * sizeof (text_field_line));
 			tf->select.sm = tf->select.em = tf->select.sc = tf->select.ec = -1;
 
+#ifdef	CHAT_LINE_INDEX
+			if (tf->buffer == display_text_buffer)
+				// only counted, the messages are rewrapped when they are drawn
+				nr_lines = get_display_line_count (FILTER_ALL, w->size, width - tf->scrollbar_width);
+			else
+#endif	/* CHAT_LINE_INDEX */
 			for (i = 0; i < tf->buf_size; i++)
 			{
 				int *cursor = i == tf->msg ? &(tf->cursor) : NULL;
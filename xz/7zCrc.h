@@ -10,6 +10,11 @@ EXTERN_C_BEGIN
 
 extern UInt32 g_CrcTable[];
 
+typedef UInt32 (MY_FAST_CALL *CRC_FUNC)(UInt32 v, const void *data, size_t size, const UInt32 *table);
+
+/* Set by CrcGenerateTable, can be replaced with a faster function */
+extern CRC_FUNC g_CrcUpdate;
+
 /* Call CrcGenerateTable one time before other CRC functions */
 void MY_FAST_CALL CrcGenerateTable(void);
 
@@ -5,6 +5,17 @@
 
 #define kCrc64Poly UINT64_CONST(0xC96C5795D7870F42)
 UInt64 g_Crc64Table[256];
+CRC64_FUNC g_Crc64Update;
+
+#define CRC64_UPDATE_BYTE_2(crc, b) (table[((crc) ^ (b)) & 0xFF] ^ ((crc) >> 8))
+
+static UInt64 MY_FAST_CALL Crc64UpdateT1(UInt64 v, const void *data, size_t size, const UInt64 *table)
+{
+  const Byte *p = (const Byte *)data;
+  for (; size > 0 ; size--, p++)
+    v = CRC64_UPDATE_BYTE_2(v, *p);
+  return v;
+}
 
 void MY_FAST_CALL Crc64GenerateTable(void)
 {
@@ -17,14 +28,12 @@ void MY_FAST_CALL Crc64GenerateTable(void)
       r = (r >> 1) ^ ((UInt64)kCrc64Poly & ~((r & 1) - 1));
     g_Crc64Table[i] = r;
   }
+  g_Crc64Update = Crc64UpdateT1;
 }
 
 UInt64 MY_FAST_CALL Crc64Update(UInt64 v, const void *data, size_t size)
 {
-  const Byte *p = (const Byte *)data;
-  for (; size > 0 ; size--, p++)
-    v = CRC64_UPDATE_BYTE(v, *p);
-  return v;
+  return g_Crc64Update(v, data, size, g_Crc64Table);
 }
 
 UInt64 MY_FAST_CALL Crc64Calc(const void *data, size_t size)
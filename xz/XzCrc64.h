@@ -12,6 +12,11 @@ EXTERN_C_BEGIN
 
 extern UInt64 g_Crc64Table[];
 
+typedef UInt64 (MY_FAST_CALL *CRC64_FUNC)(UInt64 v, const void *data, size_t size, const UInt64 *table);
+
+/* Set by Crc64GenerateTable, can be replaced with a faster function */
+extern CRC64_FUNC g_Crc64Update;
+
 void MY_FAST_CALL Crc64GenerateTable(void);
 
 #define CRC64_INIT_VAL UINT64_CONST(0xFFFFFFFFFFFFFFFF)
@@ -0,0 +1,114 @@
+/*
+ * Packs a file into a xz file with several blocks, which the client can
+ * unpack on several threads (see io/xz_blocks.c).
+ *
+ * Usage: xzpack [-b <block size in kb>] [-l <level>] <file> [xz file]
+ *
+ * The xz file is "<file>.xz" if no name is given. Build with
+ * io/xz_blocks.c and the xz/ sources, linked against SDL.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "io/xz_blocks.h"
+#include "xz/7zCrc.h"
+#include "xz/XzCrc64.h"
+
+int main(int argc, char **argv)
+{
+	char xz_name[1024];
+	FILE *file;
+	void *data, *buffer;
+	Uint64 buffer_size;
+	Uint32 block_size, level;
+	long size;
+	int i;
+
+	block_size = XZ_BLOCKS_DEFAULT_BLOCK_SIZE;
+	level = 6;
+
+	for (i = 1; (i + 1) < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-b") == 0)
+		{
+			block_size = atoi(argv[i + 1]) * 1024;
+		}
+		else if (strcmp(argv[i], "-l") == 0)
+		{
+			level = atoi(argv[i + 1]);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if ((i >= argc) || ((argc - i) > 2) || (block_size == 0) ||
+		(level > 9))
+	{
+		fprintf(stderr, "Usage: %s [-b <block size in kb>] "
+			"[-l <level>] <file> [xz file]\n", argv[0]);
+		return 1;
+	}
+
+	if ((argc - i) == 2)
+	{
+		snprintf(xz_name, sizeof(xz_name), "%s", argv[i + 1]);
+	}
+	else
+	{
+		snprintf(xz_name, sizeof(xz_name), "%s.xz", argv[i]);
+	}
+
+	file = fopen(argv[i], "rb");
+
+	if (file == 0)
+	{
+		fprintf(stderr, "Can't open '%s'\n", argv[i]);
+		return 1;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data = malloc(size + 1);
+
+	if ((data == 0) || (fread(data, 1, size, file) != (size_t)size))
+	{
+		fprintf(stderr, "Can't read '%s'\n", argv[i]);
+		return 1;
+	}
+
+	fclose(file);
+
+	CrcGenerateTable();
+	Crc64GenerateTable();
+
+	if (xz_blocks_pack(data, size, block_size, level, &buffer,
+		&buffer_size) != 0)
+	{
+		fprintf(stderr, "Can't pack '%s'\n", argv[i]);
+		return 1;
+	}
+
+	file = fopen(xz_name, "wb");
+
+	if ((file == 0) || (fwrite(buffer, 1, buffer_size, file) !=
+		buffer_size))
+	{
+		fprintf(stderr, "Can't write '%s'\n", xz_name);
+		return 1;
+	}
+
+	fclose(file);
+
+	printf("%s: %ld bytes in %ld blocks, %llu bytes packed\n", xz_name,
+		size, (size + block_size - 1) / block_size,
+		(unsigned long long)buffer_size);
+
+	free(buffer);
+	free(data);
+
+	return 0;
+}